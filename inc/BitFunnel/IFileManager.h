@@ -104,6 +104,7 @@ namespace BitFunnel
         virtual FileDescriptor1 CumulativeTermCounts(size_t shard) = 0;
         virtual FileDescriptor1 DocFreqTable(size_t shard) = 0;
         virtual FileDescriptor1 IndexedIdfTable(size_t shard) = 0;
+        virtual FileDescriptor1 IndexSnapshot(size_t shard) = 0;
         //virtual FileDescriptor1 DocTable(size_t shard) = 0;
         //virtual FileDescriptor1 ScoreTable(size_t shard) = 0;
         virtual FileDescriptor1 TermTable(size_t shard) = 0;
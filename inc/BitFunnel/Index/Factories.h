@@ -93,12 +93,16 @@ namespace BitFunnel
             CreateIndexedIdfTable(std::istream& input,
                                   Term::IdfX10 defaultIdf);
 
+        // If threadActiveSlices is true, each ingestion thread adds documents
+        // to its own active Slice in each Shard. Each document must then be
+        // ingested on the thread that called IIngestor::Add() for it.
         std::unique_ptr<IIngestor>
             CreateIngestor(IDocumentDataSchema const & docDataSchema,
                            IRecycler& recycler,
                            ITermTableCollection const & termTables,
                            IShardDefinition const & shardDefinition,
-                           ISliceBufferAllocator& sliceBufferAllocator);
+                           ISliceBufferAllocator& sliceBufferAllocator,
+                           bool threadActiveSlices);
 
         std::unique_ptr<IRecycler> CreateRecycler();
 
@@ -107,6 +111,27 @@ namespace BitFunnel
         std::unique_ptr<ISliceBufferAllocator>
             CreateSliceBufferAllocator(size_t blockSize, size_t blockCount);
 
+        // Creates an ISliceBufferAllocator that reserves address space for
+        // maxBlockCount buffers but only commits memory for
+        // segmentBlockCount buffers at a time as the index grows. When all
+        // maxBlockCount buffers are in use, TryAllocate() returns nullptr
+        // and IIngestor::TryAdd() refuses documents.
+        std::unique_ptr<ISliceBufferAllocator>
+            CreateGrowableSliceBufferAllocator(size_t blockSize,
+                                               size_t segmentBlockCount,
+                                               size_t maxBlockCount);
+
+        // Creates an ISliceBufferAllocator that splits its buffers across
+        // the online NUMA nodes of the machine and allocates from the node
+        // of the Shard that requests the buffer. Query threads are not bound
+        // to nodes, so this placement is only a hint. Pools are backed by
+        // large pages when useLargePages is set and the platform can supply
+        // them.
+        std::unique_ptr<ISliceBufferAllocator>
+            CreateNumaSliceBufferAllocator(size_t blockSize,
+                                           size_t blockCount,
+                                           bool useLargePages);
+
         std::unique_ptr<ITermTable> CreateTermTable();
         std::unique_ptr<ITermTable> CreateTermTable(std::istream & input);
 
@@ -133,5 +158,13 @@ namespace BitFunnel
 
         std::unique_ptr<ITermTreatment>
             CreateTreatmentPrivateShardRank0And3(double density, double snr);
+
+        // Rank 0 rows plus rows at the specified rank, which must be in
+        // [1, c_maxRankValue]. Rank 3 is equivalent to
+        // CreateTreatmentPrivateShardRank0And3().
+        std::unique_ptr<ITermTreatment>
+            CreateTreatmentPrivateSharedRank0AndN(double density,
+                                                  double snr,
+                                                  Rank rank);
     }
 }
@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <vector>                               // std::vector parameter.
+
 #include "BitFunnel/Index/DocumentHandle.h"     // DocumentHandle parameter.
 #include "BitFunnel/IInterface.h"               // Inherits from IInterface.
 #include "BitFunnel/Term.h"                     // Term::StreamId parameter.
@@ -48,6 +50,10 @@ namespace BitFunnel
         // Returns true iff the document contains a specific term.
         virtual bool Contains(Term & term) const = 0;
 
+        // Appends the raw hash of each of the document's postings to
+        // hashes. Used to fill the document's PostingBlob.
+        virtual void GetPostingHashes(std::vector<Term::Hash> & hashes) const = 0;
+
 
         // Opens a named stream for term additions. Subsequent calls to
         // AddTerm() will add terms to this stream.
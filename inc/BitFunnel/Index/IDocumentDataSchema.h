@@ -75,5 +75,19 @@ namespace BitFunnel
 
         // Returns the sizes of the fixed sized blobs defined in the schema.
         virtual std::vector<unsigned> const & GetFixedSizeBlobSizes() const = 0;
+
+        // Registers a variable size blob that will hold a compact copy of
+        // each document's postings and returns its id. The IIngestor fills
+        // this blob and the query pipeline uses it to eliminate the false
+        // positives of the bit-sliced match. See PostingBlob. May be called
+        // at most once.
+        virtual VariableSizeBlobId RegisterPostingBlob() = 0;
+
+        // Returns true if RegisterPostingBlob() has been called.
+        virtual bool HasPostingBlob() const = 0;
+
+        // Returns the id assigned by RegisterPostingBlob(). Throws if the
+        // schema has no posting blob.
+        virtual VariableSizeBlobId GetPostingBlob() const = 0;
     };
 }
@@ -35,6 +35,7 @@ namespace BitFunnel
 {
     class IDocument;
     class IDocumentCache;
+    class IDocumentDataSchema;
     class IFileManager;
     class IRecycler;
     class ITokenManager;
@@ -79,12 +80,31 @@ namespace BitFunnel
         virtual void WriteStatistics(IFileManager & fileManager,
                                      TermToText const * termToText) const = 0;
 
+        // Writes a snapshot of each Shard's slices to the IndexSnapshot files
+        // defined by the FileManager. Ingestion must be paused while the
+        // snapshot is written.
+        virtual void WriteSnapshot(IFileManager & fileManager) const = 0;
+
+        // Memory-maps the IndexSnapshot files written by WriteSnapshot() into
+        // an empty index with the same configuration. The documents in the
+        // snapshot become visible to queries and may be deleted, and
+        // ingestion may continue. Ingestion statistics, such as the
+        // DocumentLengthHistogram, are not restored. Throws if a snapshot is
+        // not compatible with this index.
+        virtual void LoadSnapshot(IFileManager & fileManager) = 0;
+
 
         // Returns a reference to the IDocument cache. This cache holds ingested
         // IDocuments for use in query verification diagnostics.
         virtual IDocumentCache & GetDocumentCache() const = 0;
 
 
+        // Returns the IDocumentDataSchema that describes the per document
+        // data in the DocTable. When the schema has a posting blob, Add()
+        // fills it with the document's postings.
+        virtual IDocumentDataSchema const & GetDocumentDataSchema() const = 0;
+
+
         // Adds a document to the index. Throws if there is no space to add the
         // document which means the system is running at its maximum capacity.
         // The IDocument must implement the Place method which should call
@@ -93,6 +113,14 @@ namespace BitFunnel
         // value.
         virtual void Add(DocId id, IDocument const & document) = 0;
 
+        // Adds a document to the index, like Add(), unless the document
+        // needs a new slice and the ISliceBufferAllocator is at capacity.
+        // In that case TryAdd() returns false without modifying the index.
+        // Callers can use this as a backpressure signal and retry once
+        // deleted documents' slices have been recycled or ingestion has
+        // been redirected elsewhere.
+        virtual bool TryAdd(DocId id, IDocument const & document) = 0;
+
         // Removes a document from serving. The document with the specified id
         // will no longer be returned from the queries. Returns true if the
         // document was successfully removed and false otherwise. False means
@@ -137,9 +165,17 @@ namespace BitFunnel
 
         virtual ITokenManager& GetTokenManager() const = 0;
 
-        // Shuts down the index and releases resources allocated to it.
+        // Shuts down the index and releases resources allocated to it,
+        // including the active slices of ingestion threads.
         virtual void Shutdown() = 0;
 
+        // When the ingestor was created with threadActiveSlices, releases
+        // the partially filled slice held by each ingestion thread, so that
+        // it is recycled once its documents are expired. Call when
+        // ingestion threads exit or go idle. Threads that ingest again
+        // start new slices.
+        virtual void ReleaseThreadSlices() = 0;
+
         //
         // Group management functions.
         //
@@ -23,6 +23,7 @@
 #pragma once
 
 #include <cstddef>                      // ptrdiff_t return value.
+#include <stdint.h>                     // uint64_t return value.
 
 #include "BitFunnel/BitFunnelTypes.h"   // DocIndex return value.
 #include "BitFunnel/IInterface.h"       // Base class.
@@ -32,6 +33,7 @@
 namespace BitFunnel
 {
 
+    class ITermTable;
     class TermToText;
 
     class IShard : public IInterface
@@ -52,6 +54,23 @@ namespace BitFunnel
         // Returns the offset of the row in the slice buffer in a shard.
         virtual ptrdiff_t GetRowOffset(RowId rowId) const = 0;
 
+        // Returns the TermTable for this shard. Each shard has its own
+        // TermTable, so the RowIds for a Term may differ from shard to shard.
+        virtual ITermTable const & GetTermTable() const = 0;
+
+        // Returns a number that identifies this shard and its TermTable. No
+        // two shards created by the process share a generation, so data
+        // derived from a shard, such as a compiled plan, can be checked
+        // against it even if a later shard reuses the same addresses.
+        virtual uint64_t GetGeneration() const = 0;
+
+        // Returns the offset of the DocId for DocIndex 0 in a slice buffer
+        // and the distance in bytes between the DocIds of consecutive
+        // DocIndex values. The DocId for DocIndex i is the DocId at
+        // sliceBuffer + GetDocIdOffset() + i * GetDocIdStride().
+        virtual ptrdiff_t GetDocIdOffset() const = 0;
+        virtual size_t GetDocIdStride() const = 0;
+
         virtual void TemporaryWriteDocumentFrequencyTable(std::ostream& out,
                                                   TermToText const * termToText) const = 0;
 
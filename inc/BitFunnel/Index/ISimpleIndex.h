@@ -72,6 +72,12 @@ namespace BitFunnel
         virtual void SetTermTableCollection(
             std::unique_ptr<ITermTableCollection> termTables) = 0;
 
+        // Gives each ingestion thread its own active Slice in each Shard, so
+        // that threads ingesting in parallel do not write to the same cache
+        // lines. The index holds up to one partially filled Slice per shard
+        // and ingestion thread. Disabled by default.
+        virtual void SetThreadActiveSlices(bool enabled) = 0;
+
         virtual void ConfigureForStatistics(char const * directory,
                                             size_t gramSize,
                                             bool generateTermToText) = 0;
@@ -53,7 +53,15 @@ namespace BitFunnel
         // Allocates a buffer for a Slice and returns a pointer to it.
         // Implementors may restrict byteSize to a pre-defined set of values, or
         // even require a single value to be used for all slices in the Index.
-        virtual void* Allocate(size_t byteSize) = 0;
+        // numaNode, in [0, GetNumaNodeCount()), is the node of the Shard
+        // that will own the buffer. NUMA aware allocators place the buffer
+        // on that node when they can. Other allocators ignore it.
+        virtual void* Allocate(size_t byteSize, size_t numaNode) = 0;
+
+        // Allocates a buffer for a Slice like Allocate(), but returns nullptr
+        // instead of throwing when the allocator is at capacity. Callers use
+        // this to apply backpressure to ingestion.
+        virtual void* TryAllocate(size_t byteSize, size_t numaNode) = 0;
 
         // Returns the allocator when a Slice is being recycled back to the pool
         // for re-use. Buffer is zero initialized upon return.
@@ -67,5 +75,21 @@ namespace BitFunnel
         // one for each shard. At this point this method may not be applicable
         // and can be removed.
         virtual size_t GetSliceBufferSize() const = 0;
+
+        // Returns the number of buffers currently allocated.
+        virtual size_t GetAllocatedBufferCount() const = 0;
+
+        // Returns the largest number of buffers that have been allocated at
+        // the same time since the allocator was created.
+        virtual size_t GetHighWaterBufferCount() const = 0;
+
+        // Returns the number of buffers backed by committed memory, whether
+        // allocated or not. Allocators that reserve their entire pool up
+        // front return the size of the pool.
+        virtual size_t GetCommittedBufferCount() const = 0;
+
+        // Returns the number of NUMA nodes on which the allocator places
+        // buffers. Allocators that are not NUMA aware return 1.
+        virtual size_t GetNumaNodeCount() const = 0;
     };
 }
@@ -147,6 +147,12 @@ namespace BitFunnel
         // Writes the contents of the ITermTable to a stream.
         virtual void Write(std::ostream& output) const = 0;
 
+        // Returns a hash of the contents of the ITermTable. Term tables with
+        // the same contents have the same hash, regardless of the order in
+        // which their terms were added. Used to verify that an index snapshot
+        // was written with this term table.
+        virtual uint64_t GetHash() const = 0;
+
         //
         // Reader methods called by RowIdSequence::const_iterator.
         //
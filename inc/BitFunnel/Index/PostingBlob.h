@@ -0,0 +1,72 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <stddef.h>                 // size_t parameter.
+#include <vector>                   // std::vector parameter.
+
+#include "BitFunnel/Term.h"         // Term::Hash parameter.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // PostingBlob is a read-only view of the compact copy of a document's
+    // postings stored in the DocTable's variable size blob area. The blob
+    // consists of a posting count followed by the sorted raw hashes of the
+    // postings. Since the blob lives next to the document's slice, the query
+    // pipeline can use it to eliminate the false positives of the bit-sliced
+    // match without consulting the IDocumentCache.
+    //
+    // See IDocumentDataSchema::RegisterPostingBlob().
+    //
+    //*************************************************************************
+    class PostingBlob
+    {
+    public:
+        // Constructs a view of a blob previously filled by Write(). A
+        // nullptr blob is treated as a document without postings.
+        PostingBlob(void const * blob);
+
+        // Returns the number of postings in the blob.
+        size_t GetPostingCount() const;
+
+        // Returns true if the blob contains a posting for the term.
+        bool Contains(Term const & term) const;
+
+        // Returns the number of bytes required to hold a blob with
+        // postingCount postings.
+        static size_t GetByteCount(size_t postingCount);
+
+        // Writes the postings with the specified raw hashes to a blob of
+        // GetByteCount(hashes.size()) bytes. Sorts and removes duplicates
+        // from hashes. Returns the number of bytes used.
+        static size_t Write(void * blob, std::vector<Term::Hash> & hashes);
+
+    private:
+        size_t m_postingCount;
+        Term::Hash const * m_hashes;
+    };
+}
@@ -24,7 +24,7 @@
 
 #include <memory>                       // std::unique_ptr return value.
 
-#include "BitFunnel/BitFunnelTypes.h"   // DocId paramter.
+#include "BitFunnel/BitFunnelTypes.h"   // DocId, ShardId paramter.
 #include "BitFunnel/Term.h"             // Term::StreamId paramter.
 
 namespace BitFunnel
@@ -47,9 +47,13 @@ namespace BitFunnel
             CreatePrimeFactorsTermTable(DocId maxDocId,
                                         Term::StreamId streamId);
 
+        // Creates an index of PrimeFactors documents 0..maxDocId. When
+        // shardCount is greater than one, documents are distributed across
+        // shards by posting count, as described in PrimeFactorsDocument.cpp.
         std::unique_ptr<ISimpleIndex>
             CreatePrimeFactorsIndex(IFileSystem & fileSystem,
                                     DocId maxDocId,
-                                    Term::StreamId streamId);
+                                    Term::StreamId streamId,
+                                    ShardId shardCount = 1);
     }
 }
@@ -30,21 +30,67 @@
 namespace BitFunnel
 {
     class IAllocator;
+    class IConfiguration;
+    class IDocumentCache;
     class IInputStream;
     class IMatchVerifier;
+    class IPlanCache;
     class IPlanRows;
     class ISimpleIndex;
+    class IThreadPool;
+    class QueryLimits;
     class TermMatchNode;
 
     namespace Factories
     {
         std::unique_ptr<IMatchVerifier> CreateMatchVerifier();
 
+        // Creates a thread safe LRU cache holding up to capacity compiled
+        // query plans for use with RunSimplePlanner().
+        std::unique_ptr<IPlanCache> CreatePlanCache(size_t capacity);
+
 
         IPlanRows& CreatePlanRows(IInputStream& input,
                                   const ISimpleIndex& index,
                                   IAllocator& allocator);
 
-        std::vector<DocId> RunSimplePlanner(TermMatchNode const & tree, ISimpleIndex const & index);
+        // Runs the query against every shard, scanning slices with up to
+        // threadCount threads, and returns the matches from all shards.
+        // Threads other than the caller are taken from threadPool, if
+        // supplied. See SimplePlanner for details.
+        std::vector<DocId> RunSimplePlanner(TermMatchNode const & tree,
+                                            ISimpleIndex const & index,
+                                            size_t threadCount = 1,
+                                            IThreadPool * threadPool = nullptr);
+
+        // Runs the query as above, but stops once the query reaches one of
+        // its limits. Sets terminatedEarly to true if the matches were
+        // truncated. Compiled plans are reused from planCache, if supplied.
+        std::vector<DocId> RunSimplePlanner(TermMatchNode const & tree,
+                                            ISimpleIndex const & index,
+                                            QueryLimits const & limits,
+                                            bool & terminatedEarly,
+                                            size_t threadCount = 1,
+                                            IThreadPool * threadPool = nullptr,
+                                            IPlanCache * planCache = nullptr);
+
+        // Runs a batch of queries on the calling thread, scanning each
+        // shard's slices once for the whole batch (see ByteCodeBatchRunner).
+        // Returns the matches of each query, in the order of trees.
+        // Compiled plans are reused from planCache, if supplied.
+        std::vector<std::vector<DocId>>
+            RunSimplePlannerBatch(std::vector<TermMatchNode const *> const & trees,
+                                  ISimpleIndex const & index,
+                                  IPlanCache * planCache = nullptr);
+
+        // Returns the ids, in increasing order, of the documents in cache
+        // that match the query, evaluated directly against each document's
+        // postings. Used as the ground truth when verifying the index. See
+        // DocumentCacheMatcher for details.
+        std::vector<DocId> MatchDocumentCache(TermMatchNode const & tree,
+                                              IConfiguration const & configuration,
+                                              IDocumentCache const & cache,
+                                              size_t threadCount = 1,
+                                              IThreadPool * threadPool = nullptr);
     }
 }
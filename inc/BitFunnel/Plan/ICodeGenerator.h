@@ -52,7 +52,12 @@ namespace BitFunnel
 
         // Stack machine primitives
         virtual void AndStack() = 0;
+
+        // Loads the accumulator with value, sign extended to 64 bits. The
+        // constant -1 matches every document in the quadword and 0 matches
+        // none of them.
         virtual void Constant(int value) = 0;
+
         virtual void Not() = 0;
         virtual void OrStack() = 0;
         virtual void UpdateFlags() = 0;
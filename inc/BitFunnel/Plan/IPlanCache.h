@@ -0,0 +1,89 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                    // size_t return value.
+#include <stdint.h>                    // uint64_t parameter.
+#include <memory>                      // std::shared_ptr return value.
+#include <string>                      // std::string parameter.
+#include <vector>                      // std::vector parameter.
+
+#include "BitFunnel/IInterface.h"      // IInterface base class.
+
+
+namespace BitFunnel
+{
+    class ShardPlan;
+
+    //*************************************************************************
+    //
+    // IPlanCache is a bounded cache of compiled query plans, shared by the
+    // queries run against a single ISimpleIndex. Plans are keyed by a
+    // canonical form of the TermMatchNode tree, so queries that differ only
+    // in the order of their AND or OR operands share a plan. When the cache
+    // is full, the least recently used plan is evicted.
+    //
+    // A plan is only reused for the shards it was compiled for, as identified
+    // by IShard::GetGeneration(). Plans for replaced shards are never
+    // returned, but stay in the cache until evicted or until Clear().
+    //
+    // IPlanCache is thread safe.
+    //
+    //*************************************************************************
+    class IPlanCache : public IInterface
+    {
+    public:
+        // The compiled plan for each shard of the index, in shard order.
+        typedef std::vector<std::unique_ptr<ShardPlan>> ShardPlans;
+
+        // Returns the plans for key, or nullptr if there are no plans for
+        // key or if they were compiled for shards of other generations.
+        // Updates the hit and miss counters.
+        virtual std::shared_ptr<ShardPlans const>
+            Find(std::string const & key,
+                 std::vector<uint64_t> const & shardGenerations) = 0;
+
+        // Adds or replaces the plans for key, evicting the least recently
+        // used plans if the cache is full.
+        virtual void Add(std::string const & key,
+                         std::vector<uint64_t> const & shardGenerations,
+                         std::shared_ptr<ShardPlans const> plans) = 0;
+
+        // Returns the maximum number of plans held by the cache.
+        virtual size_t GetCapacity() const = 0;
+
+        // Returns the number of plans currently held by the cache.
+        virtual size_t GetSize() const = 0;
+
+        // Returns the number of lookups that found a usable plan, and the
+        // number that did not, since construction or the last call to
+        // ResetCounters().
+        virtual size_t GetHitCount() const = 0;
+        virtual size_t GetMissCount() const = 0;
+
+        virtual void ResetCounters() = 0;
+
+        // Removes every plan from the cache.
+        virtual void Clear() = 0;
+    };
+}
@@ -0,0 +1,71 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>     // size_t embedded.
+#include <stdint.h>     // SIZE_MAX.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // QueryLimits bounds the work done by a single query. Matching stops
+    // once at least maxMatches matches have been found or once timeLimit
+    // seconds have elapsed, and the query's results are reported as
+    // truncated. A timeLimit of zero means there is no time limit. The
+    // default QueryLimits does not limit the query.
+    //
+    //*************************************************************************
+    class QueryLimits
+    {
+    public:
+        QueryLimits(size_t maxMatches = c_unlimitedMatches,
+                    double timeLimit = 0.0)
+          : m_maxMatches(maxMatches),
+            m_timeLimit(timeLimit)
+        {
+        }
+
+        size_t GetMaxMatches() const
+        {
+            return m_maxMatches;
+        }
+
+        double GetTimeLimit() const
+        {
+            return m_timeLimit;
+        }
+
+        bool IsUnlimited() const
+        {
+            return m_maxMatches == c_unlimitedMatches && m_timeLimit == 0.0;
+        }
+
+        static const size_t c_unlimitedMatches = SIZE_MAX;
+
+    private:
+        size_t m_maxMatches;
+        double m_timeLimit;
+    };
+}
@@ -23,12 +23,15 @@
 #pragma once
 
 #include <memory>                               // std::unique_ptr embedded.
+#include <vector>                               // std::vector parameter.
 
 #include "BitFunnel/Allocators/IAllocator.h"    // Template parameter.
+#include "BitFunnel/BitFunnelTypes.h"           // DocId template parameter.
 
 
 namespace BitFunnel
 {
+    class ISimpleIndex;
     class IStreamConfiguration;
     class TermMatchNode;
 
@@ -39,6 +42,18 @@ namespace BitFunnel
 
         TermMatchNode const * ParseQuery(char const * query);
 
+        // Optional stage that follows the bit-sliced match. Removes the
+        // documents in matches that do not satisfy the tree, according to
+        // the PostingBlob stored with each document. Matches that are no
+        // longer in the index are also removed. Preserves the order of the
+        // remaining matches and returns the number of matches removed.
+        //
+        // The index's IDocumentDataSchema must have a posting blob. See
+        // IDocumentDataSchema::RegisterPostingBlob().
+        size_t FilterMatches(TermMatchNode const & tree,
+                             ISimpleIndex const & index,
+                             std::vector<DocId> & matches) const;
+
     private:
         IStreamConfiguration const & m_streamConfiguration;
         std::unique_ptr<IAllocator> m_allocator;
@@ -0,0 +1,118 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <iosfwd>       // std::ostream parameter.
+#include <string>       // std::string embedded.
+#include <vector>       // std::vector parameter.
+
+
+namespace BitFunnel
+{
+    class IPlanCache;
+    class ISimpleIndex;
+
+    //*************************************************************************
+    //
+    // QueryRunner is a load generator for an ISimpleIndex. It processes a
+    // list of queries a specified number of times on a pool of threads and
+    // records the latency and match count of every query execution.
+    //
+    //*************************************************************************
+    class QueryRunner
+    {
+    public:
+        class Statistics
+        {
+        public:
+            // The latencies and matchCounts vectors are indexed by the
+            // position of each execution in the run. Execution i processed
+            // query i % queries.size().
+            Statistics(size_t threadCount,
+                       std::vector<std::string> const & queries,
+                       std::vector<double> const & latencies,
+                       std::vector<size_t> const & matchCounts,
+                       double elapsedTime);
+
+            size_t GetThreadCount() const;
+            size_t GetUniqueQueryCount() const;
+            size_t GetProcessedCount() const;
+
+            // Returns the wall clock time for the entire run, in seconds.
+            double GetElapsedTime() const;
+
+            // Returns the number of queries processed per second of wall
+            // clock time.
+            double GetQPS() const;
+
+            // Returns the latency, in seconds, at or below which the
+            // specified fraction of query executions completed. The fraction
+            // must be in the range [0.0, 1.0].
+            double GetLatencyPercentile(double fraction) const;
+
+            // Returns the sum of the match counts of all query executions.
+            size_t GetTotalMatchCount() const;
+
+            // Writes a human readable summary of the run.
+            void Print(std::ostream& out) const;
+
+            // Writes one CSV row per query execution, containing the query
+            // text, its latency, and its match count.
+            void WriteCsv(std::ostream& out) const;
+
+        private:
+            const size_t m_threadCount;
+            std::vector<std::string> m_queries;
+            std::vector<double> m_latencies;
+            std::vector<size_t> m_matchCounts;
+            double m_elapsedTime;
+
+            // Copy of m_latencies in ascending order, for percentiles.
+            std::vector<double> m_sortedLatencies;
+        };
+
+
+        // Processes each of the queries iterations times, distributed
+        // across threadCount threads. Each query is parsed and planned
+        // independently on every execution. Every query is first run once,
+        // untimed, on the calling thread, so a query that cannot be parsed
+        // or planned throws here rather than on a worker thread.
+        //
+        // If planCache is supplied, compiled plans are shared across
+        // executions through the cache. The untimed run does not use the
+        // cache, so the first timed execution of each query compiles its
+        // plan and is counted as a miss.
+        //
+        // If batchSize is greater than one, each thread takes batchSize
+        // consecutive executions at a time and runs them together with
+        // Factories::RunSimplePlannerBatch(), which scans each shard once
+        // per batch instead of once per query. The latency of every
+        // execution in a batch is the latency of the whole batch.
+        static Statistics Run(ISimpleIndex const & index,
+                              size_t threadCount,
+                              std::vector<std::string> const & queries,
+                              size_t iterations,
+                              IPlanCache * planCache = nullptr,
+                              size_t batchSize = 1);
+    };
+}
@@ -29,6 +29,7 @@ namespace BitFunnel
 {
     class IConfiguration;
     class IDocument;
+    class PostingBlob;
 
     class TermMatchTreeEvaluator
     {
@@ -38,18 +39,38 @@ namespace BitFunnel
         bool Evaluate(TermMatchNode const & root,
                       IDocument const & document);
 
+        // Evaluates the tree against the postings in a document's
+        // PostingBlob. Used to eliminate false positives at query time.
+        bool Evaluate(TermMatchNode const & root,
+                      PostingBlob const & postings);
+
     private:
+        // DOCUMENT is either IDocument or PostingBlob.
+        template <typename DOCUMENT>
+        bool EvaluateNode(TermMatchNode const & root,
+                          DOCUMENT const & document);
+
+        template <typename DOCUMENT>
         bool Evaluate(TermMatchNode::And const & tree,
-                      IDocument const & document);
+                      DOCUMENT const & document);
 
+        template <typename DOCUMENT>
         bool Evaluate(TermMatchNode::Not const & tree,
-                      IDocument const & document);
+                      DOCUMENT const & document);
 
+        template <typename DOCUMENT>
         bool Evaluate(TermMatchNode::Or const & tree,
-                      IDocument const & document);
+                      DOCUMENT const & document);
 
+        // A document matches a phrase if it contains each of the phrase's
+        // n-grams. See GetPhraseTerms().
+        template <typename DOCUMENT>
+        bool Evaluate(TermMatchNode::Phrase const & tree,
+                      DOCUMENT const & document);
+
+        template <typename DOCUMENT>
         bool Evaluate(TermMatchNode::Unigram const & tree,
-                      IDocument const & document);
+                      DOCUMENT const & document);
 
         IConfiguration const & m_configuration;
     };
@@ -159,7 +159,8 @@ namespace BitFunnel
         static double IdfX10ToFrequency(IdfX10 idf);
 
         // Convert a frequency at rank 0 to an equivalent frequency at higher
-        // rank.
+        // rank. Each bit at rank r covers 2^r bits at rank 0, so the result
+        // is 1 - (1 - frequency)^(2^r).
         static double FrequencyAtRank(double frequency, Rank rank);
 
         // Static method that calculates IDF value from document frequency and
@@ -28,6 +28,7 @@
 
 #include "ITaskDistributor.h"
 #include "IThreadManager.h"
+#include "IThreadPool.h"
 
 namespace BitFunnel
 {
@@ -41,6 +42,26 @@ namespace BitFunnel
         std::unique_ptr<IBlockAllocator>
             CreateBlockAllocator(size_t blockSize, size_t totalBlockCount);
 
+        // Creates an IBlockAllocator whose pool is backed by large pages
+        // when useLargePages is set and the platform can supply them, and
+        // is placed on the specified NUMA node. Use
+        // AlignedBuffer::c_anyNumaNode (i.e. size_t(-1)) for no preference.
+        std::unique_ptr<IBlockAllocator>
+            CreateBlockAllocator(size_t blockSize,
+                                 size_t totalBlockCount,
+                                 bool useLargePages,
+                                 size_t numaNode);
+
+        // Creates an IBlockAllocator that reserves address space for
+        // maxBlockCount blocks up front, but commits memory in segments of
+        // segmentBlockCount blocks as they are needed. AllocateBlock()
+        // throws and TryAllocateBlock() returns nullptr once maxBlockCount
+        // blocks are allocated or no more memory can be committed.
+        std::unique_ptr<IBlockAllocator>
+            CreateSegmentedBlockAllocator(size_t blockSize,
+                                          size_t segmentBlockCount,
+                                          size_t maxBlockCount);
+
         // TODO: return unique_ptr.
         IObjectFormatter* CreateObjectFormatter(std::ostream& output);
 
@@ -52,6 +73,9 @@ namespace BitFunnel
         std::unique_ptr<IThreadManager> CreateThreadManager(
             const std::vector<IThreadBase*>& threads);
 
+        // Creates an IThreadPool with threadCount worker threads.
+        std::unique_ptr<IThreadPool> CreateThreadPool(size_t threadCount);
+
         std::unique_ptr<ITokenManager> CreateTokenManager();
     }
 }
@@ -51,10 +51,28 @@ namespace BitFunnel
         // for allocation, this method throws.
         virtual uint64_t* AllocateBlock() = 0;
 
+        // Allocates a block of memory from a pool. Returns nullptr if no
+        // block is available for allocation.
+        virtual uint64_t* TryAllocateBlock() = 0;
+
         // Returns the block back to the pool.
         virtual void ReleaseBlock(uint64_t* block) = 0;
 
         // Returns the size of the blocks in the pool.
         virtual size_t GetBlockSize() const = 0;
+
+        // Returns true if the address lies within this allocator's pool.
+        virtual bool Contains(void const * address) const = 0;
+
+        // Returns the number of blocks currently allocated.
+        virtual size_t GetAllocatedBlockCount() const = 0;
+
+        // Returns the largest number of blocks that have been allocated at
+        // the same time since the allocator was created.
+        virtual size_t GetHighWaterBlockCount() const = 0;
+
+        // Returns the number of blocks backed by committed memory. This
+        // includes blocks on the free list.
+        virtual size_t GetCommittedBlockCount() const = 0;
     };
 }
@@ -0,0 +1,58 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                     // size_t return value.
+#include <vector>                       // std::vector parameter.
+
+#include "BitFunnel/IInterface.h"       // Base class.
+
+
+namespace BitFunnel
+{
+    class ITaskProcessor;
+
+    //*************************************************************************
+    //
+    // IThreadPool is an abstract base class or interface for a set of
+    // long-lived worker threads that can be applied to a single unit of work,
+    // such as one query, without the cost of starting threads.
+    //
+    //*************************************************************************
+    class IThreadPool : public IInterface
+    {
+    public:
+        // Returns the number of worker threads in the pool. The thread that
+        // calls Run() also does work, so Run() can make use of up to
+        // GetThreadCount() + 1 threads.
+        virtual size_t GetThreadCount() const = 0;
+
+        // Calls processors[i]->ProcessTask(i) once for each processor, on
+        // the calling thread (for i == 0) and on pool threads. Returns after
+        // every call has returned. Calls to Run() from different threads are
+        // serialized.
+        //
+        // processors.size() must not exceed GetThreadCount() + 1.
+        virtual void Run(std::vector<ITaskProcessor*> const & processors) = 0;
+    };
+}
@@ -195,7 +195,10 @@ namespace BitFunnel
     {
         size_t count = ReadField<size_t>(stream);
         std::vector<T> vector(count);
-        ReadArray(stream, vector.data(), count);
+        if (count > 0)
+        {
+            ReadArray(stream, vector.data(), count);
+        }
         return vector;
     }
 
@@ -233,6 +236,9 @@ namespace BitFunnel
                                       std::vector<T> const & vector)
     {
         WriteField<size_t>(stream, vector.size());
-        WriteArray(stream, vector.data(), vector.size());
+        if (!vector.empty())
+        {
+            WriteArray(stream, vector.data(), vector.size());
+        }
     }
 }
@@ -63,6 +63,10 @@ namespace BitFunnel
                                                    indexDirectory,
                                                    "IndexedIdfTable",
                                                    ".bin")),
+          m_indexSnapshot(new ParameterizedFile1(fileSystem,
+                                                 indexDirectory,
+                                                 "IndexSnapshot",
+                                                 ".bin")),
           m_termTable(new ParameterizedFile1(fileSystem,
                                              indexDirectory,
                                              "TermTable",
@@ -113,6 +117,12 @@ namespace BitFunnel
     }
 
 
+    FileDescriptor1 FileManager::IndexSnapshot(size_t shard)
+    {
+        return FileDescriptor1(*m_indexSnapshot, shard);
+    }
+
+
     FileDescriptor1 FileManager::TermTable(size_t shard)
     {
         return FileDescriptor1(*m_termTable, shard);
@@ -27,6 +27,7 @@
 #include "AlignedBuffer.h"
 #include "BitFunnel/Exceptions.h"
 #include "LoggerInterfaces/Logging.h"
+#include "Rounding.h"
 
 #ifdef BITFUNNEL_PLATFORM_WINDOWS
 #include <Windows.h>   // For VirtualAlloc/VirtualFree.
@@ -36,18 +37,118 @@
 #include <sys/mman.h>  // For mmap/munmap.
 #endif
 
+#ifdef __linux__
+#include <linux/mempolicy.h>    // For MPOL_PREFERRED.
+#include <sys/syscall.h>        // For SYS_mbind.
+#include <unistd.h>             // For syscall.
+#endif
+
 
 namespace BitFunnel
 {
+#ifdef __linux__
+    // Sizes of the large pages on x64.
+    static const unsigned c_log2LargePageSize = 21;
+    static const unsigned c_log2HugePageSize = 30;
+
+
+    // Maps size bytes backed by explicit huge pages of 2^log2PageSize
+    // bytes. Returns nullptr if no such pages are available.
+    static void* MapHugePages(size_t size, unsigned log2PageSize)
+    {
+        int flags = MAP_ANON | MAP_PRIVATE | MAP_HUGETLB;
+#ifdef MAP_HUGE_SHIFT
+        flags |= static_cast<int>(log2PageSize << MAP_HUGE_SHIFT);
+#else
+        // Without MAP_HUGE_SHIFT only the default huge page size is
+        // available.
+        if (log2PageSize != c_log2LargePageSize)
+        {
+            return nullptr;
+        }
+#endif
+        void* buffer = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        return (buffer == MAP_FAILED) ? nullptr : buffer;
+    }
+
+
+    // Asks the kernel to place the pages of the buffer on numaNode. This is
+    // a hint and failures are ignored, since the buffer is usable wherever
+    // it is placed. Must be called before the buffer is first touched.
+    static void PreferNumaNode(void* buffer, size_t size, size_t numaNode)
+    {
+        unsigned long nodeMask = 0;
+        if (numaNode >= sizeof(nodeMask) * 8)
+        {
+            return;
+        }
+        nodeMask = 1ul << numaNode;
+
+        syscall(SYS_mbind,
+                buffer,
+                size,
+                MPOL_PREFERRED,
+                &nodeMask,
+                sizeof(nodeMask) * 8,
+                0);
+    }
+#endif
+
 
     AlignedBuffer::AlignedBuffer(size_t size, int alignment)
+        : AlignedBuffer(size, alignment, false, c_anyNumaNode)
+    {
+    }
+
+
+    AlignedBuffer::AlignedBuffer(size_t size,
+                                 int alignment,
+                                 bool useLargePages,
+                                 size_t numaNode)
     {
         m_requestedSize = size;
+        m_usesLargePages = false;
+        m_rawBuffer = nullptr;
 
 #ifdef BITFUNNEL_PLATFORM_WINDOWS
         size_t padding = 1ULL << alignment;
         m_actualSize = m_requestedSize + padding;
-        m_rawBuffer = VirtualAlloc(nullptr, m_actualSize, MEM_COMMIT, PAGE_READWRITE);
+
+        const DWORD node = (numaNode == c_anyNumaNode) ?
+            NUMA_NO_PREFERRED_NODE :
+            static_cast<DWORD>(numaNode);
+
+        if (useLargePages)
+        {
+            // Large pages require the SeLockMemoryPrivilege. Fall back to
+            // default pages if the allocation fails.
+            const size_t largePageSize = GetLargePageMinimum();
+            if (largePageSize > 0)
+            {
+                const size_t largeSize = RoundUp(m_actualSize, largePageSize);
+                m_rawBuffer = VirtualAllocExNuma(GetCurrentProcess(),
+                                                 nullptr,
+                                                 largeSize,
+                                                 MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                                                 PAGE_READWRITE,
+                                                 node);
+                if (m_rawBuffer != nullptr)
+                {
+                    m_actualSize = largeSize;
+                    m_usesLargePages = true;
+                }
+            }
+        }
+
+        if (m_rawBuffer == nullptr)
+        {
+            m_rawBuffer = VirtualAllocExNuma(GetCurrentProcess(),
+                                             nullptr,
+                                             m_actualSize,
+                                             MEM_RESERVE | MEM_COMMIT,
+                                             PAGE_READWRITE,
+                                             node);
+        }
         LogAssertB(m_rawBuffer != nullptr, "VirtualAlloc() failed.");
         m_alignedBuffer = (char *)(((size_t)m_rawBuffer + padding -1) & ~(padding -1));
 #else
@@ -58,20 +159,88 @@ namespace BitFunnel
         // is sufficient.
         LogAssertB(alignment <= c_pageSize, "Alignment > 4096.\n");
         m_actualSize = m_requestedSize;
-        m_rawBuffer = mmap(nullptr, size,
-                           PROT_READ | PROT_WRITE,
-                           MAP_ANON | MAP_PRIVATE,
-                           -1,  // No file descriptor.
-                           0);
-        if (m_rawBuffer == MAP_FAILED)
+
+#ifdef __linux__
+        if (useLargePages)
+        {
+            // Prefer 1GB pages for buffers of at least 1GB, then 2MB pages.
+            for (unsigned log2PageSize : { c_log2HugePageSize, c_log2LargePageSize })
+            {
+                const size_t pageSize = static_cast<size_t>(1) << log2PageSize;
+                if (log2PageSize == c_log2HugePageSize && size < pageSize)
+                {
+                    continue;
+                }
+
+                const size_t largeSize = RoundUp(size, pageSize);
+                void* buffer = MapHugePages(largeSize, log2PageSize);
+                if (buffer != nullptr)
+                {
+                    m_rawBuffer = buffer;
+                    m_alignedBuffer = buffer;
+                    m_actualSize = largeSize;
+                    m_usesLargePages = true;
+                    break;
+                }
+            }
+
+            if (m_rawBuffer == nullptr)
+            {
+                // No huge pages are reserved. Request transparent huge pages
+                // for a range aligned to the large page size.
+                const size_t pageSize = static_cast<size_t>(1) << c_log2LargePageSize;
+                const size_t paddedSize = size + pageSize;
+                void* buffer = mmap(nullptr,
+                                    paddedSize,
+                                    PROT_READ | PROT_WRITE,
+                                    MAP_ANON | MAP_PRIVATE,
+                                    -1,
+                                    0);
+                if (buffer != MAP_FAILED)
+                {
+                    m_rawBuffer = buffer;
+                    m_alignedBuffer = reinterpret_cast<void*>(
+                        RoundUp(reinterpret_cast<size_t>(buffer), pageSize));
+                    m_actualSize = paddedSize;
+                    m_usesLargePages =
+                        (madvise(m_alignedBuffer, size, MADV_HUGEPAGE) == 0);
+                }
+            }
+        }
+#else
+        // Large pages are only supported on Linux and Windows.
+        (void)useLargePages;
+#endif
+
+        if (m_rawBuffer == nullptr)
+        {
+            m_rawBuffer = mmap(nullptr, size,
+                               PROT_READ | PROT_WRITE,
+                               MAP_ANON | MAP_PRIVATE,
+                               -1,  // No file descriptor.
+                               0);
+            if (m_rawBuffer == MAP_FAILED)
+            {
+                m_rawBuffer = nullptr;
+
+                std::stringstream errorMessage;
+                errorMessage << "AlignedBuffer Failed to mmap: "
+                             << std::strerror(errno)
+                             << std::endl;
+                throw FatalError(errorMessage.str());
+            }
+            m_alignedBuffer = m_rawBuffer;
+        }
+
+#ifdef __linux__
+        if (numaNode != c_anyNumaNode)
         {
-            std::stringstream errorMessage;
-            errorMessage << "AlignedBuffer Failed to mmap: "
-                         << std::strerror(errno)
-                         << std::endl;
-            throw FatalError(errorMessage.str());
+            PreferNumaNode(m_alignedBuffer, size, numaNode);
         }
-        m_alignedBuffer = m_rawBuffer;
+#else
+        // NUMA placement is only supported on Linux and Windows.
+        (void)numaNode;
+#endif
 #endif
     }
 
@@ -98,4 +267,10 @@ namespace BitFunnel
     {
         return m_requestedSize;
     }
+
+
+    bool AlignedBuffer::UsesLargePages() const
+    {
+        return m_usesLargePages;
+    }
 }
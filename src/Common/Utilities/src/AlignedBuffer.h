@@ -24,6 +24,9 @@
 #pragma once
 
 
+#include <stddef.h>  // size_t parameter.
+
+
 namespace BitFunnel
 {
     //*************************************************************************
@@ -32,20 +35,44 @@ namespace BitFunnel
     // boundary. This is intended to be used for allocating "large" blocks of
     // memory, something like 10GB or 100GB at a time.
     //
+    // Buffers may be backed by large pages, which reduces TLB misses when
+    // the matcher scans rows spread across the buffer, and may be placed on
+    // a specific NUMA node.
+    //
     //*************************************************************************
     class AlignedBuffer
     {
     public:
         AlignedBuffer(size_t size, int alignment);
+
+        // When useLargePages is true, the buffer is backed by 1GB or 2MB
+        // pages if the operating system has them available. On Linux,
+        // transparent huge pages are requested when no explicit huge pages
+        // are available. Otherwise the buffer falls back to default pages.
+        // When numaNode is not c_anyNumaNode, the buffer is preferentially
+        // placed on that NUMA node.
+        AlignedBuffer(size_t size,
+                      int alignment,
+                      bool useLargePages,
+                      size_t numaNode);
+
         ~AlignedBuffer();
 
         void *GetBuffer() const;
         size_t GetSize() const;
 
+        // Returns true if the buffer is backed by large pages.
+        bool UsesLargePages() const;
+
+        // Value for the numaNode constructor parameter that lets the
+        // operating system choose where to place the buffer.
+        static const size_t c_anyNumaNode = static_cast<size_t>(-1);
+
     private:
         size_t m_requestedSize;
         size_t m_actualSize;
         void *m_rawBuffer;
         void *m_alignedBuffer;
+        bool m_usesLargePages;
     };
 }
@@ -53,7 +53,10 @@ namespace BitFunnel
         virtual void Reset() override;
 
     private:
-        void DebugInitialize();
+        // In debug builds, fills the first byteCount bytes of the buffer
+        // with 0xcc to expose reads of uninitialized memory. Does nothing
+        // in release builds.
+        void DebugInitialize(size_t byteCount);
 
         size_t m_bufferSize;
         size_t m_bytesAllocated;
@@ -43,11 +43,41 @@ namespace BitFunnel
     }
 
 
+    std::unique_ptr<IBlockAllocator>
+        Factories::
+        CreateBlockAllocator(size_t blockSize,
+                             size_t totalBlockCount,
+                             bool useLargePages,
+                             size_t numaNode)
+    {
+        return std::unique_ptr<IBlockAllocator>(
+            new BlockAllocator(blockSize,
+                               totalBlockCount,
+                               useLargePages,
+                               numaNode));
+    }
+
+
 
     BlockAllocator::BlockAllocator(size_t blockSize, size_t totalBlockCount)
+        : BlockAllocator(blockSize,
+                         totalBlockCount,
+                         false,
+                         AlignedBuffer::c_anyNumaNode)
+    {
+    }
+
+
+    BlockAllocator::BlockAllocator(size_t blockSize,
+                                   size_t totalBlockCount,
+                                   bool useLargePages,
+                                   size_t numaNode)
         : m_blockSize(RoundUp<size_t>(blockSize, c_byteAlignment)),
+          m_totalBlockCount(totalBlockCount),
           m_totalPoolSize(m_blockSize * totalBlockCount),
-          m_pool(m_totalPoolSize, c_log2ByteAlignment)
+          m_pool(m_totalPoolSize, c_log2ByteAlignment, useLargePages, numaNode),
+          m_allocatedBlockCount(0),
+          m_highWaterBlockCount(0)
     {
         // DESIGN NOTE: technically, one can create an allocator with a size = 0
         // which would simply throw on the first allocation. This would allow
@@ -81,15 +111,31 @@ namespace BitFunnel
 
     uint64_t * BlockAllocator::AllocateBlock()
     {
-        std::lock_guard<std::mutex> lock(m_lock);
-
-        if (m_freeListHead == nullptr)
+        uint64_t * block = TryAllocateBlock();
+        if (block == nullptr)
         {
             throw FatalError("Out of memory");
         }
 
+        return block;
+    }
+
+
+    uint64_t * BlockAllocator::TryAllocateBlock()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
         uint64_t * block = m_freeListHead;
-        m_freeListHead = reinterpret_cast<uint64_t*>(*m_freeListHead);
+        if (block != nullptr)
+        {
+            m_freeListHead = reinterpret_cast<uint64_t*>(*m_freeListHead);
+
+            ++m_allocatedBlockCount;
+            if (m_allocatedBlockCount > m_highWaterBlockCount)
+            {
+                m_highWaterBlockCount = m_allocatedBlockCount;
+            }
+        }
 
         return block;
     }
@@ -122,6 +168,7 @@ namespace BitFunnel
         *blockPtr = m_freeListHead;
 
         m_freeListHead = block;
+        --m_allocatedBlockCount;
     }
 
 
@@ -129,4 +176,38 @@ namespace BitFunnel
     {
         return m_blockSize;
     }
+
+
+    bool BlockAllocator::Contains(void const * address) const
+    {
+        char const * bufferStart = static_cast<char const *>(m_pool.GetBuffer());
+        char const * a = static_cast<char const *>(address);
+        return a >= bufferStart && a < bufferStart + m_totalPoolSize;
+    }
+
+
+    size_t BlockAllocator::GetAllocatedBlockCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_allocatedBlockCount;
+    }
+
+
+    size_t BlockAllocator::GetHighWaterBlockCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_highWaterBlockCount;
+    }
+
+
+    size_t BlockAllocator::GetCommittedBlockCount() const
+    {
+        return m_totalBlockCount;
+    }
+
+
+    bool BlockAllocator::UsesLargePages() const
+    {
+        return m_pool.UsesLargePages();
+    }
 }
@@ -58,12 +58,28 @@ namespace BitFunnel
         // c_byteAlignment.
         BlockAllocator(size_t blockSize, size_t totalBlockCount);
 
+        // Constructs an allocator whose pool is backed by large pages if
+        // useLargePages is set and placed on numaNode, if the platform
+        // supports it. See AlignedBuffer for the fallbacks.
+        BlockAllocator(size_t blockSize,
+                       size_t totalBlockCount,
+                       bool useLargePages,
+                       size_t numaNode);
+
         //
         // IBlockAllocator API.
         //
         virtual uint64_t* AllocateBlock() override;
+        virtual uint64_t* TryAllocateBlock() override;
         virtual void ReleaseBlock(uint64_t*) override;
         virtual size_t GetBlockSize() const override;
+        virtual bool Contains(void const * address) const override;
+        virtual size_t GetAllocatedBlockCount() const override;
+        virtual size_t GetHighWaterBlockCount() const override;
+        virtual size_t GetCommittedBlockCount() const override;
+
+        // Returns true if the pool is backed by large pages.
+        bool UsesLargePages() const;
 
     private:
         // Byte alignment of the allocated blocks.
@@ -71,15 +87,22 @@ namespace BitFunnel
         static const unsigned c_byteAlignment = 1U << c_log2ByteAlignment;
 
         const size_t m_blockSize;
+        const size_t m_totalBlockCount;
         const size_t m_totalPoolSize;
 
-        // Lock protecting operations on the pool.
-        std::mutex m_lock;
+        // Lock protecting operations on the pool. Mutable so that the const
+        // statistics methods can take it.
+        mutable std::mutex m_lock;
 
         // Underlying pool of memory blocks.
         AlignedBuffer m_pool;
 
         // A pointer to the first available block.
         uint64_t * m_freeListHead;
+
+        // Number of blocks currently allocated and the largest value it has
+        // reached.
+        size_t m_allocatedBlockCount;
+        size_t m_highWaterBlockCount;
     };
 }
@@ -0,0 +1,127 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <fstream>
+#include <string>
+
+#include "Numa.h"
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+#include <Windows.h>        // For GetNumaHighestNodeNumber, etc.
+#endif
+
+
+namespace BitFunnel
+{
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+
+    std::vector<size_t> GetNumaNodes()
+    {
+        std::vector<size_t> nodes;
+
+        ULONG highestNode;
+        if (GetNumaHighestNodeNumber(&highestNode))
+        {
+            // Nodes without processors are not available for placement.
+            for (ULONG node = 0; node <= highestNode; ++node)
+            {
+                GROUP_AFFINITY affinity;
+                if (GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity) &&
+                    affinity.Mask != 0)
+                {
+                    nodes.push_back(node);
+                }
+            }
+        }
+
+        if (nodes.empty())
+        {
+            nodes.push_back(0);
+        }
+        return nodes;
+    }
+
+#elif defined(__linux__)
+
+    std::vector<size_t> GetNumaNodes()
+    {
+        // The file lists ranges of node numbers, e.g. "0-3" or "0,2-3".
+        // Unlike the "possible" list, it omits nodes that cannot currently
+        // hold memory.
+        std::vector<size_t> nodes;
+
+        std::ifstream input("/sys/devices/system/node/online");
+        std::string list;
+        if (std::getline(input, list))
+        {
+            size_t rangeStart = 0;
+            size_t current = 0;
+            bool inRange = false;
+            bool hasDigits = false;
+            for (size_t i = 0; i <= list.size(); ++i)
+            {
+                const char c = (i < list.size()) ? list[i] : ',';
+                if (c >= '0' && c <= '9')
+                {
+                    current = current * 10 + static_cast<size_t>(c - '0');
+                    hasDigits = true;
+                }
+                else if (c == '-' && hasDigits)
+                {
+                    rangeStart = current;
+                    inRange = true;
+                    current = 0;
+                    hasDigits = false;
+                }
+                else if (c == ',' && hasDigits)
+                {
+                    for (size_t node = inRange ? rangeStart : current;
+                         node <= current;
+                         ++node)
+                    {
+                        nodes.push_back(node);
+                    }
+                    inRange = false;
+                    current = 0;
+                    hasDigits = false;
+                }
+            }
+        }
+
+        if (nodes.empty())
+        {
+            nodes.push_back(0);
+        }
+        return nodes;
+    }
+
+#else
+
+    std::vector<size_t> GetNumaNodes()
+    {
+        return std::vector<size_t>(1, 0);
+    }
+
+#endif
+}
@@ -20,49 +20,21 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+
 #pragma once
 
-#include <vector>       // std::vector parameter
+#include <stddef.h>     // size_t template parameter.
+#include <vector>       // std::vector return value.
 
 
 namespace BitFunnel
 {
-    class ISimpleIndex;
-
-    class QueryRunner
-    {
-    public:
-        class Statistics
-        {
-        public:
-            Statistics(size_t threadCount,
-                       size_t uniqueQueryCount,
-                       size_t processedCount,
-                       double elapsedTime);
-
-            void Print(std::ostream& out) const;
-
-        private:
-            const size_t m_threadCount;
-            const size_t m_uniqueQueryCount;
-            size_t m_processedCount;
-            double m_elapsedTime;
-        };
-
-
-        //QueryRunner(ISimpleIndex const & index,
-        //            size_t threadCount);
-
-        static Statistics Run(ISimpleIndex const & index,
-                              size_t threadCount,
-                              std::vector<std::string> const & queries,
-                              size_t iterations);
-
-    //private:
-    //    //
-    //    // Constructor parameters
-    //    //
-    //    ISimpleIndex const & m_index;
-    //    const size_t m_threadCount;
-    };
+    //
+    // Helpers for placing memory on the NUMA nodes of the machine.
+    //
+
+    // Returns the numbers of the NUMA nodes that are online, in increasing
+    // order. Node numbers need not be contiguous. Returns { 0 } on
+    // platforms that do not report NUMA nodes.
+    std::vector<size_t> GetNumaNodes();
 }
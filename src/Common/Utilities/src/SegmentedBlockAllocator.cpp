@@ -0,0 +1,261 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <algorithm>    // std::min()
+#include <memory>
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "LoggerInterfaces/Logging.h"
+#include "Rounding.h"
+#include "SegmentedBlockAllocator.h"
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+#include <Windows.h>   // For VirtualAlloc/VirtualFree.
+#else
+#include <sys/mman.h>  // For mmap/mprotect/munmap.
+#endif
+
+
+namespace BitFunnel
+{
+    // Granularity of commits. Segments start on page boundaries.
+    static const size_t c_pageSize = 4096;
+
+
+    std::unique_ptr<IBlockAllocator>
+        Factories::
+        CreateSegmentedBlockAllocator(size_t blockSize,
+                                      size_t segmentBlockCount,
+                                      size_t maxBlockCount)
+    {
+        return std::unique_ptr<IBlockAllocator>(
+            new SegmentedBlockAllocator(blockSize,
+                                        segmentBlockCount,
+                                        maxBlockCount));
+    }
+
+
+    SegmentedBlockAllocator::SegmentedBlockAllocator(size_t blockSize,
+                                                     size_t segmentBlockCount,
+                                                     size_t maxBlockCount)
+        : m_blockSize(RoundUp<size_t>(blockSize, c_byteAlignment)),
+          m_segmentBlockCount(segmentBlockCount),
+          m_maxBlockCount(maxBlockCount),
+          m_segmentSize(RoundUp<size_t>(m_blockSize * segmentBlockCount,
+                                        c_pageSize)),
+          m_maxSegmentCount((segmentBlockCount == 0) ?
+                            0 :
+                            (maxBlockCount + segmentBlockCount - 1) / segmentBlockCount),
+          m_buffer(nullptr),
+          m_segmentCount(0),
+          m_committedBlockCount(0),
+          m_freeListHead(nullptr),
+          m_allocatedBlockCount(0),
+          m_highWaterBlockCount(0)
+    {
+        LogAssertB(m_blockSize > 0, "m_blockSize of 0.");
+        LogAssertB(segmentBlockCount > 0, "segmentBlockCount of 0.");
+        LogAssertB(maxBlockCount > 0, "maxBlockCount of 0.");
+
+        const size_t reservedSize = m_segmentSize * m_maxSegmentCount;
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        m_buffer = static_cast<char*>(
+            VirtualAlloc(nullptr, reservedSize, MEM_RESERVE, PAGE_NOACCESS));
+        if (m_buffer == nullptr)
+        {
+            throw FatalError("SegmentedBlockAllocator failed to reserve address space.");
+        }
+#else
+        // MAP_NORESERVE keeps the reservation from counting against the
+        // commit limit until segments are made accessible.
+        void* buffer = mmap(nullptr,
+                            reservedSize,
+                            PROT_NONE,
+                            MAP_ANON | MAP_PRIVATE | MAP_NORESERVE,
+                            -1,  // No file descriptor.
+                            0);
+        if (buffer == MAP_FAILED)
+        {
+            throw FatalError("SegmentedBlockAllocator failed to reserve address space.");
+        }
+        m_buffer = static_cast<char*>(buffer);
+#endif
+    }
+
+
+    SegmentedBlockAllocator::~SegmentedBlockAllocator()
+    {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        VirtualFree(m_buffer, 0, MEM_RELEASE);
+#else
+        munmap(m_buffer, m_segmentSize * m_maxSegmentCount);
+#endif
+    }
+
+
+    uint64_t * SegmentedBlockAllocator::AllocateBlock()
+    {
+        uint64_t * block = TryAllocateBlock();
+        if (block == nullptr)
+        {
+            throw FatalError("Out of memory");
+        }
+
+        return block;
+    }
+
+
+    uint64_t * SegmentedBlockAllocator::TryAllocateBlock()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        if (m_freeListHead == nullptr && !TryCommitSegment())
+        {
+            return nullptr;
+        }
+
+        uint64_t * block = m_freeListHead;
+        m_freeListHead = reinterpret_cast<uint64_t*>(*m_freeListHead);
+
+        ++m_allocatedBlockCount;
+        if (m_allocatedBlockCount > m_highWaterBlockCount)
+        {
+            m_highWaterBlockCount = m_allocatedBlockCount;
+        }
+
+        return block;
+    }
+
+
+    void SegmentedBlockAllocator::ReleaseBlock(uint64_t * block)
+    {
+        char const * blockReturned = reinterpret_cast<char const *>(block);
+
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        // Checking that the returned block belongs to a committed segment.
+        LogAssertB(blockReturned >= m_buffer,
+                   "ReleaseBlock out of range (< bufferStart).");
+        const size_t offset = static_cast<size_t>(blockReturned - m_buffer);
+        const size_t segment = offset / m_segmentSize;
+        LogAssertB(segment < m_segmentCount,
+                   "ReleaseBlock out of range (past end).");
+
+        const size_t segmentOffset = offset % m_segmentSize;
+        LogAssertB(segmentOffset % m_blockSize == 0,
+                   "Block offset (relative to beginning of segment) not a multiple of blockSize");
+        LogAssertB(segmentOffset / m_blockSize
+                   < GetSegmentBlockCount(segment),
+                   "ReleaseBlock in padding at end of segment.");
+
+        // Add the block to the head of the free list.
+        uint64_t** blockPtr = reinterpret_cast<uint64_t**>(block);
+        *blockPtr = m_freeListHead;
+        m_freeListHead = block;
+        --m_allocatedBlockCount;
+    }
+
+
+    size_t SegmentedBlockAllocator::GetBlockSize() const
+    {
+        return m_blockSize;
+    }
+
+
+    bool SegmentedBlockAllocator::Contains(void const * address) const
+    {
+        char const * a = static_cast<char const *>(address);
+        return a >= m_buffer && a < m_buffer + m_segmentSize * m_maxSegmentCount;
+    }
+
+
+    size_t SegmentedBlockAllocator::GetAllocatedBlockCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_allocatedBlockCount;
+    }
+
+
+    size_t SegmentedBlockAllocator::GetHighWaterBlockCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_highWaterBlockCount;
+    }
+
+
+    size_t SegmentedBlockAllocator::GetCommittedBlockCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_committedBlockCount;
+    }
+
+
+    bool SegmentedBlockAllocator::TryCommitSegment()
+    {
+        if (m_segmentCount == m_maxSegmentCount)
+        {
+            return false;
+        }
+
+        const size_t blockCount = GetSegmentBlockCount(m_segmentCount);
+        char * segment = m_buffer + m_segmentCount * m_segmentSize;
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        if (VirtualAlloc(segment, m_segmentSize, MEM_COMMIT, PAGE_READWRITE) == nullptr)
+        {
+            return false;
+        }
+#else
+        if (mprotect(segment, m_segmentSize, PROT_READ | PROT_WRITE) != 0)
+        {
+            return false;
+        }
+#endif
+
+        // Thread the new blocks onto the free list in address order.
+        for (size_t block = 0; block < blockCount; ++block)
+        {
+            char** nextBlockPtr = reinterpret_cast<char**>(segment + block * m_blockSize);
+            *nextBlockPtr = (block != blockCount - 1) ?
+                segment + (block + 1) * m_blockSize :
+                reinterpret_cast<char*>(m_freeListHead);
+        }
+        m_freeListHead = reinterpret_cast<uint64_t*>(segment);
+
+        ++m_segmentCount;
+        m_committedBlockCount += blockCount;
+
+        return true;
+    }
+
+
+    size_t SegmentedBlockAllocator::GetSegmentBlockCount(size_t segment) const
+    {
+        // The last segment holds the blocks left over from maxBlockCount.
+        return (std::min)(m_segmentBlockCount,
+                          m_maxBlockCount - segment * m_segmentBlockCount);
+    }
+}
@@ -0,0 +1,120 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+
+#include <mutex>        // std::mutex member.
+#include <stddef.h>     // size_t member.
+#include <stdint.h>     // uint64_t member.
+
+#include "BitFunnel/NonCopyable.h"
+#include "BitFunnel/Utilities/IBlockAllocator.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // SegmentedBlockAllocator is an implementation of the IBlockAllocator
+    // whose pool grows on demand. At construction it reserves, but does not
+    // commit, address space for the maximum number of blocks. Memory is
+    // committed one segment of blocks at a time when the free list runs
+    // out, so the pool only consumes memory for the blocks that have
+    // actually been needed. Committed segments are kept until destruction.
+    //
+    // Each segment starts at a page boundary. As with BlockAllocator, the
+    // free list is stored in the first quadword of each free block.
+    //
+    // TryAllocateBlock() returns nullptr once the maximum number of blocks
+    // is allocated or the operating system refuses to commit another
+    // segment, allowing callers to apply backpressure rather than fail.
+    //
+    //*************************************************************************
+    class SegmentedBlockAllocator : public IBlockAllocator, NonCopyable
+    {
+    public:
+        // Constructs an allocator for at most maxBlockCount blocks, which
+        // commits segmentBlockCount blocks at a time. Requested blockSize
+        // will be rounded up to the next multiple of c_byteAlignment.
+        SegmentedBlockAllocator(size_t blockSize,
+                                size_t segmentBlockCount,
+                                size_t maxBlockCount);
+
+        ~SegmentedBlockAllocator();
+
+        //
+        // IBlockAllocator API.
+        //
+        virtual uint64_t* AllocateBlock() override;
+        virtual uint64_t* TryAllocateBlock() override;
+        virtual void ReleaseBlock(uint64_t*) override;
+        virtual size_t GetBlockSize() const override;
+        virtual bool Contains(void const * address) const override;
+        virtual size_t GetAllocatedBlockCount() const override;
+        virtual size_t GetHighWaterBlockCount() const override;
+        virtual size_t GetCommittedBlockCount() const override;
+
+    private:
+        // Commits the next segment and pushes its blocks onto the free list.
+        // Returns false if the pool is at its maximum size or the memory
+        // could not be committed. Must be called with m_lock held.
+        bool TryCommitSegment();
+
+        // Returns the number of blocks in a segment.
+        size_t GetSegmentBlockCount(size_t segment) const;
+
+        // Byte alignment of the allocated blocks.
+        static const unsigned c_log2ByteAlignment = 3;
+        static const unsigned c_byteAlignment = 1U << c_log2ByteAlignment;
+
+        const size_t m_blockSize;
+        const size_t m_segmentBlockCount;
+        const size_t m_maxBlockCount;
+
+        // Byte size of each segment, rounded up to a page.
+        const size_t m_segmentSize;
+        const size_t m_maxSegmentCount;
+
+        // Reserved address space for all of the segments.
+        char * m_buffer;
+
+        // Lock protecting operations on the pool. Mutable so that the const
+        // statistics methods can take it.
+        mutable std::mutex m_lock;
+
+        // Number of segments committed so far.
+        size_t m_segmentCount;
+
+        // Number of blocks in the committed segments.
+        size_t m_committedBlockCount;
+
+        // A pointer to the first available block.
+        uint64_t * m_freeListHead;
+
+        // Number of blocks currently allocated and the largest value it has
+        // reached.
+        size_t m_allocatedBlockCount;
+        size_t m_highWaterBlockCount;
+    };
+}
@@ -0,0 +1,145 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/ITaskProcessor.h"
+#include "LoggerInterfaces/Check.h"
+#include "ThreadPool.h"
+
+
+namespace BitFunnel
+{
+    std::unique_ptr<IThreadPool> Factories::CreateThreadPool(size_t threadCount)
+    {
+        return std::unique_ptr<IThreadPool>(new ThreadPool(threadCount));
+    }
+
+
+    ThreadPool::ThreadPool(size_t threadCount)
+      : m_processors(nullptr),
+        m_generation(0),
+        m_pendingCount(0),
+        m_shutdown(false)
+    {
+        for (size_t i = 0; i < threadCount; ++i)
+        {
+            m_threads.push_back(std::thread(&ThreadPool::ThreadEntryPoint, this, i));
+        }
+    }
+
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_shutdown = true;
+        }
+        m_workAvailable.notify_all();
+
+        for (auto & thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+
+    size_t ThreadPool::GetThreadCount() const
+    {
+        return m_threads.size();
+    }
+
+
+    void ThreadPool::Run(std::vector<ITaskProcessor*> const & processors)
+    {
+        CHECK_LE(processors.size(), m_threads.size() + 1)
+            << "Too many processors for ThreadPool.";
+
+        if (processors.empty())
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> runLock(m_runLock);
+
+        const size_t workerCount = processors.size() - 1;
+        if (workerCount > 0)
+        {
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_processors = &processors;
+                m_pendingCount = workerCount;
+                ++m_generation;
+            }
+            m_workAvailable.notify_all();
+        }
+
+        processors[0]->ProcessTask(0);
+
+        if (workerCount > 0)
+        {
+            std::unique_lock<std::mutex> lock(m_lock);
+            m_workComplete.wait(lock, [this] { return m_pendingCount == 0; });
+            m_processors = nullptr;
+        }
+    }
+
+
+    void ThreadPool::ThreadEntryPoint(size_t worker)
+    {
+        size_t generation = 0;
+
+        for (;;)
+        {
+            ITaskProcessor * processor = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(m_lock);
+                m_workAvailable.wait(lock, [&] {
+                    return m_shutdown || m_generation != generation;
+                });
+
+                if (m_shutdown)
+                {
+                    return;
+                }
+
+                // Workers without a processor may wake after Run() has
+                // returned and cleared m_processors.
+                generation = m_generation;
+                if (m_processors != nullptr && worker + 1 < m_processors->size())
+                {
+                    processor = (*m_processors)[worker + 1];
+                }
+            }
+
+            if (processor != nullptr)
+            {
+                processor->ProcessTask(worker + 1);
+
+                std::lock_guard<std::mutex> lock(m_lock);
+                if (--m_pendingCount == 0)
+                {
+                    m_workComplete.notify_one();
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,83 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <condition_variable>                   // std::condition_variable member.
+#include <mutex>                                // std::mutex member.
+#include <thread>                               // std::thread member.
+#include <vector>                               // std::vector member.
+
+#include "BitFunnel/NonCopyable.h"              // Base class.
+#include "BitFunnel/Utilities/IThreadPool.h"    // Base class.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // ThreadPool is an IThreadPool whose worker threads wait on a condition
+    // variable between calls to Run(). Each call to Run() publishes the
+    // processors as a new generation of work and wakes the workers. Worker
+    // i runs processors[i + 1], if there is one, and the calling thread runs
+    // processors[0].
+    //
+    //*************************************************************************
+    class ThreadPool : public IThreadPool, NonCopyable
+    {
+    public:
+        ThreadPool(size_t threadCount);
+
+        // Stops and joins the worker threads.
+        ~ThreadPool();
+
+        //
+        // IThreadPool methods.
+        //
+        virtual size_t GetThreadCount() const override;
+        virtual void Run(std::vector<ITaskProcessor*> const & processors) override;
+
+    private:
+        void ThreadEntryPoint(size_t worker);
+
+        // Serializes calls to Run().
+        std::mutex m_runLock;
+
+        // Protects the remaining members.
+        std::mutex m_lock;
+        std::condition_variable m_workAvailable;
+        std::condition_variable m_workComplete;
+
+        std::vector<ITaskProcessor*> const * m_processors;
+
+        // Incremented by Run() to release the workers.
+        size_t m_generation;
+
+        // Number of pool threads still running processors for the current
+        // generation.
+        size_t m_pendingCount;
+
+        bool m_shutdown;
+
+        std::vector<std::thread> m_threads;
+    };
+}
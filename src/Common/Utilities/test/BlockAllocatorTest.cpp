@@ -143,5 +143,56 @@ namespace BitFunnel
             allocator->ReleaseBlock(block + 2);
             allocator->ReleaseBlock(block + 4);
         }
+
+
+        TEST(BlockAllocator, TryAllocateBlock)
+        {
+            static const size_t c_blockSize = 16;
+            static const size_t c_totalBlockCount = 2;
+
+            std::unique_ptr<IBlockAllocator> allocator(
+                Factories::CreateBlockAllocator(c_blockSize,
+                                                c_totalBlockCount));
+
+            uint64_t * const block1 = allocator->TryAllocateBlock();
+            uint64_t * const block2 = allocator->TryAllocateBlock();
+            EXPECT_NE(block1, nullptr);
+            EXPECT_NE(block2, nullptr);
+            EXPECT_NE(block1, block2);
+
+            EXPECT_TRUE(allocator->Contains(block1));
+            EXPECT_TRUE(allocator->Contains(block2 + 1));
+            EXPECT_FALSE(allocator->Contains(&c_blockSize));
+
+            // No more blocks available.
+            EXPECT_EQ(allocator->TryAllocateBlock(), nullptr);
+
+            allocator->ReleaseBlock(block2);
+            EXPECT_EQ(block2, allocator->TryAllocateBlock());
+        }
+
+
+        TEST(BlockAllocator, LargePagesAndNumaNode)
+        {
+            // Large pages and NUMA placement are hints. The pool falls back
+            // to default pages and placement when they are unavailable.
+            static const size_t c_blockSize = 4096;
+            static const size_t c_totalBlockCount = 8;
+
+            std::unique_ptr<IBlockAllocator> allocator(
+                Factories::CreateBlockAllocator(c_blockSize,
+                                                c_totalBlockCount,
+                                                true,
+                                                0));
+
+            for (size_t i = 0; i < c_totalBlockCount; ++i)
+            {
+                uint64_t * const block = allocator->AllocateBlock();
+                block[c_blockSize / sizeof(uint64_t) - 1] = i;
+                EXPECT_TRUE(allocator->Contains(block));
+            }
+
+            EXPECT_ANY_THROW(allocator->AllocateBlock());
+        }
     }
 }
@@ -0,0 +1,139 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <algorithm>    // std::min()
+#include <memory>
+#include <set>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/IBlockAllocator.h"
+#include "LoggerInterfaces/Logging.h"
+#include "ThrowingLogger.h"
+
+
+namespace BitFunnel
+{
+    namespace SegmentedBlockAllocatorTest
+    {
+        TEST(SegmentedBlockAllocator, GrowsBySegment)
+        {
+            static const size_t c_blockSize = 24;
+            static const size_t c_segmentBlockCount = 3;
+            static const size_t c_maxBlockCount = 7;
+
+            std::unique_ptr<IBlockAllocator> allocator(
+                Factories::CreateSegmentedBlockAllocator(c_blockSize,
+                                                         c_segmentBlockCount,
+                                                         c_maxBlockCount));
+
+            EXPECT_EQ(c_blockSize, allocator->GetBlockSize());
+
+            // No memory is committed until the first allocation.
+            EXPECT_EQ(0u, allocator->GetCommittedBlockCount());
+
+            std::set<uint64_t*> blocks;
+            for (size_t i = 0; i < c_maxBlockCount; ++i)
+            {
+                uint64_t * block = allocator->TryAllocateBlock();
+                ASSERT_NE(block, nullptr);
+                EXPECT_TRUE(allocator->Contains(block));
+
+                // Blocks must be writable.
+                block[c_blockSize / sizeof(uint64_t) - 1] = i;
+                blocks.insert(block);
+
+                // Segments are committed one at a time. The last segment
+                // only holds the blocks left over.
+                const size_t expectedCommitted =
+                    (std::min)(c_maxBlockCount,
+                               (i / c_segmentBlockCount + 1) * c_segmentBlockCount);
+                EXPECT_EQ(expectedCommitted, allocator->GetCommittedBlockCount());
+                EXPECT_EQ(i + 1, allocator->GetAllocatedBlockCount());
+            }
+            EXPECT_EQ(c_maxBlockCount, blocks.size());
+
+            // The pool is at capacity.
+            EXPECT_EQ(allocator->TryAllocateBlock(), nullptr);
+            EXPECT_ANY_THROW(allocator->AllocateBlock());
+
+            // Released blocks are reused without committing more memory.
+            uint64_t * block = *blocks.begin();
+            allocator->ReleaseBlock(block);
+            EXPECT_EQ(c_maxBlockCount - 1, allocator->GetAllocatedBlockCount());
+            EXPECT_EQ(block, allocator->TryAllocateBlock());
+
+            for (auto b : blocks)
+            {
+                allocator->ReleaseBlock(b);
+            }
+            EXPECT_EQ(0u, allocator->GetAllocatedBlockCount());
+            EXPECT_EQ(c_maxBlockCount, allocator->GetHighWaterBlockCount());
+            EXPECT_EQ(c_maxBlockCount, allocator->GetCommittedBlockCount());
+        }
+
+
+        TEST(SegmentedBlockAllocator, HighWaterMark)
+        {
+            std::unique_ptr<IBlockAllocator> allocator(
+                Factories::CreateSegmentedBlockAllocator(8, 2, 10));
+
+            uint64_t * block1 = allocator->AllocateBlock();
+            uint64_t * block2 = allocator->AllocateBlock();
+            allocator->ReleaseBlock(block1);
+            uint64_t * block3 = allocator->AllocateBlock();
+            EXPECT_EQ(2u, allocator->GetHighWaterBlockCount());
+
+            allocator->ReleaseBlock(block2);
+            allocator->ReleaseBlock(block3);
+            EXPECT_EQ(0u, allocator->GetAllocatedBlockCount());
+            EXPECT_EQ(2u, allocator->GetHighWaterBlockCount());
+            EXPECT_EQ(2u, allocator->GetCommittedBlockCount());
+        }
+
+
+        TEST(SegmentedBlockAllocator, ReleaseWrongBlock)
+        {
+            ThrowingLogger logger;
+            Logging::RegisterLogger(&logger);
+
+            static const size_t c_blockSize = 16;
+
+            std::unique_ptr<IBlockAllocator> allocator(
+                Factories::CreateSegmentedBlockAllocator(c_blockSize, 4, 16));
+
+            uint64_t * block = allocator->AllocateBlock();
+
+            // Cannot release a block which is not positioned at a multiple
+            // of the blockSize.
+            EXPECT_ANY_THROW(allocator->ReleaseBlock(block + 1));
+
+            // Cannot release a block from a segment which is not committed.
+            EXPECT_ANY_THROW(allocator->ReleaseBlock(block + 1024));
+
+            allocator->ReleaseBlock(block);
+        }
+    }
+}
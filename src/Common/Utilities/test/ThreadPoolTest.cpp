@@ -0,0 +1,139 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/NonCopyable.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/ITaskProcessor.h"
+#include "BitFunnel/Utilities/IThreadPool.h"
+
+
+namespace BitFunnel
+{
+    namespace ThreadPoolTest
+    {
+        class CountingProcessor : public ITaskProcessor, NonCopyable
+        {
+        public:
+            CountingProcessor(std::atomic<size_t> & total)
+              : m_total(total),
+                m_callCount(0),
+                m_taskId(0)
+            {
+            }
+
+            void ProcessTask(size_t taskId) override
+            {
+                ++m_callCount;
+                m_taskId = taskId;
+                m_threadId = std::this_thread::get_id();
+                ++m_total;
+            }
+
+            void Finished() override
+            {
+            }
+
+            size_t GetCallCount() const
+            {
+                return m_callCount;
+            }
+
+            size_t GetTaskId() const
+            {
+                return m_taskId;
+            }
+
+            std::thread::id GetThreadId() const
+            {
+                return m_threadId;
+            }
+
+        private:
+            std::atomic<size_t> & m_total;
+            size_t m_callCount;
+            size_t m_taskId;
+            std::thread::id m_threadId;
+        };
+
+
+        TEST(ThreadPool, Run)
+        {
+            static const size_t c_threadCount = 4;
+            static const size_t c_runCount = 100;
+
+            auto pool = Factories::CreateThreadPool(c_threadCount);
+            EXPECT_EQ(pool->GetThreadCount(), c_threadCount);
+
+            // Use every number of processors from 1 to c_threadCount + 1 many
+            // times to exercise the handoff between generations.
+            for (size_t run = 0; run < c_runCount; ++run)
+            {
+                const size_t processorCount = 1 + run % (c_threadCount + 1);
+
+                std::atomic<size_t> total(0);
+                std::vector<std::unique_ptr<CountingProcessor>> owners;
+                std::vector<ITaskProcessor*> processors;
+                for (size_t i = 0; i < processorCount; ++i)
+                {
+                    owners.emplace_back(new CountingProcessor(total));
+                    processors.push_back(owners.back().get());
+                }
+
+                pool->Run(processors);
+
+                EXPECT_EQ(total.load(), processorCount);
+                for (size_t i = 0; i < processorCount; ++i)
+                {
+                    EXPECT_EQ(owners[i]->GetCallCount(), 1u);
+                    EXPECT_EQ(owners[i]->GetTaskId(), i);
+                }
+
+                // Processor 0 runs on the calling thread.
+                EXPECT_EQ(owners[0]->GetThreadId(), std::this_thread::get_id());
+                for (size_t i = 1; i < processorCount; ++i)
+                {
+                    EXPECT_NE(owners[i]->GetThreadId(), std::this_thread::get_id());
+                }
+            }
+        }
+
+
+        TEST(ThreadPool, NoWorkers)
+        {
+            auto pool = Factories::CreateThreadPool(0);
+
+            std::atomic<size_t> total(0);
+            CountingProcessor processor(total);
+            std::vector<ITaskProcessor*> processors(1, &processor);
+
+            pool->Run(processors);
+            EXPECT_EQ(processor.GetCallCount(), 1u);
+        }
+    }
+}
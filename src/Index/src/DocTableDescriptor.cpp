@@ -136,6 +136,36 @@ namespace BitFunnel
     }
 
 
+    DocTableDescriptor::DocTableDescriptor(std::istream& input)
+        : m_bufferOffset(StreamUtilities::ReadField<ptrdiff_t>(input)),
+          m_capacity(StreamUtilities::ReadField<DocIndex>(input)),
+          m_variableSizeBlobCount(StreamUtilities::ReadField<unsigned>(input)),
+          m_fixedSizeBlobOffsets(StreamUtilities::ReadVector<unsigned>(input)),
+          m_bytesPerItem(StreamUtilities::ReadField<size_t>(input))
+    {
+    }
+
+
+    void DocTableDescriptor::Write(std::ostream& output) const
+    {
+        StreamUtilities::WriteField<ptrdiff_t>(output, m_bufferOffset);
+        StreamUtilities::WriteField<DocIndex>(output, m_capacity);
+        StreamUtilities::WriteField<unsigned>(output, m_variableSizeBlobCount);
+        StreamUtilities::WriteVector(output, m_fixedSizeBlobOffsets);
+        StreamUtilities::WriteField<size_t>(output, m_bytesPerItem);
+    }
+
+
+    bool DocTableDescriptor::IsCompatibleWith(DocTableDescriptor const & other) const
+    {
+        return m_bufferOffset == other.m_bufferOffset
+            && m_capacity == other.m_capacity
+            && m_variableSizeBlobCount == other.m_variableSizeBlobCount
+            && m_fixedSizeBlobOffsets == other.m_fixedSizeBlobOffsets
+            && m_bytesPerItem == other.m_bytesPerItem;
+    }
+
+
     void DocTableDescriptor::Initialize(void* sliceBuffer) const
     {
         char* const buffer = reinterpret_cast<char*>(sliceBuffer) +
@@ -149,6 +179,20 @@ namespace BitFunnel
     {
         if (m_variableSizeBlobCount > 0)
         {
+            // The buffer may have been loaded from a file and hold pointers
+            // from another process. Clear them first so that Cleanup() is
+            // safe even if reading fails part way through.
+            for (DocIndex i = 0; i < m_capacity; ++i)
+            {
+                for (unsigned blob = 0; blob < m_variableSizeBlobCount; ++blob)
+                {
+                    VariableSizeBlob& blobData =
+                        GetVariableBlobRef(sliceBuffer, i, blob);
+                    blobData.m_size = 0;
+                    blobData.m_data = nullptr;
+                }
+            }
+
             for (DocIndex i = 0; i < m_capacity; ++i)
             {
                 for (unsigned blob = 0; blob < m_variableSizeBlobCount; ++blob)
@@ -241,6 +285,19 @@ namespace BitFunnel
     }
 
 
+    ptrdiff_t DocTableDescriptor::GetDocIdOffset() const
+    {
+        // The DocId is stored at the beginning of each item.
+        return m_bufferOffset;
+    }
+
+
+    size_t DocTableDescriptor::GetDocIdStride() const
+    {
+        return m_bytesPerItem;
+    }
+
+
     void* DocTableDescriptor::AllocateVariableSizeBlob(void* sliceBuffer,
                                                        DocIndex index,
                                                        VariableSizeBlobId blob,
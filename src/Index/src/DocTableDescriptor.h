@@ -88,6 +88,13 @@ namespace BitFunnel
         // Slice can create a cached copy of the DocTableDescriptor from Shard.
         DocTableDescriptor(DocTableDescriptor const & other);
 
+        // Constructs a DocTableDescriptor from a layout previously written by
+        // Write(). Used to check the compatibility of index snapshots.
+        DocTableDescriptor(std::istream& input);
+
+        // Writes the layout of the DocTable to a stream.
+        void Write(std::ostream& output) const;
+
         // Initializes the DocTable in the block of memory at sliceBuffer +
         // bufferOffset, where bufferOffset was the value passed to the
         // constructor. This block must be large enough to hold the DocTable, as
@@ -131,6 +138,13 @@ namespace BitFunnel
         // Stores the document's unique identifier.
         void SetDocId(void* sliceBuffer, DocIndex index, DocId id) const;
 
+        // Returns the offset in the slice buffer of the DocId for the
+        // document at index 0 and the distance in bytes between the DocIds
+        // of consecutive documents. These allow callers that process many
+        // documents to read DocIds without going through GetDocId().
+        ptrdiff_t GetDocIdOffset() const;
+        size_t GetDocIdStride() const;
+
         //
         // NaviteJIT methods.
         //
@@ -146,7 +160,7 @@ namespace BitFunnel
 
         // Returns true if the given DocTableDescriptor is data-compatible with
         // this instance. Used when loading Slices from the stream.
-        // TODO: confirm our compatibility policy.
+        // Descriptors are compatible when their layouts are identical.
         bool IsCompatibleWith(DocTableDescriptor const & other) const;
 
         // Represents a descriptor for a variable size blob which contains the
@@ -85,6 +85,15 @@ namespace BitFunnel
     }
 
 
+    void Document::GetPostingHashes(std::vector<Term::Hash> & hashes) const
+    {
+        for (auto const & posting : m_postings)
+        {
+            hashes.push_back(posting.GetRawHash());
+        }
+    }
+
+
     void Document::OpenStream(Term::StreamId id)
     {
         if (m_streamIsOpen)
@@ -65,6 +65,10 @@ namespace BitFunnel
         // Returns true iff the document contains a specific term.
         virtual bool Contains(Term & term) const override;
 
+        // Appends the raw hash of each of the document's postings to
+        // hashes. Used to fill the document's PostingBlob.
+        virtual void GetPostingHashes(std::vector<Term::Hash> & hashes) const override;
+
         // Opens a named stream for term additions. Subsequent calls to
         // AddTerm() will add terms to this stream.
         virtual void OpenStream(Term::StreamId id) override;
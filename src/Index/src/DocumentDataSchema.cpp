@@ -25,6 +25,7 @@
 
 #include "BitFunnel/Index/Factories.h"
 #include "DocumentDataSchema.h"
+#include "LoggerInterfaces/Check.h"
 
 namespace BitFunnel
 {
@@ -37,7 +38,9 @@ namespace BitFunnel
     // static const size_t s_bytesPerDocId = sizeof(DocId);
 
     DocumentDataSchema::DocumentDataSchema()
-        : m_variableSizeBlobCount(0)
+        : m_variableSizeBlobCount(0),
+          m_hasPostingBlob(false),
+          m_postingBlob(0)
     {
     }
 
@@ -68,4 +71,31 @@ namespace BitFunnel
     {
         return m_fixedSizeBlobSizes;
     }
+
+
+    VariableSizeBlobId DocumentDataSchema::RegisterPostingBlob()
+    {
+        CHECK_FALSE(m_hasPostingBlob)
+            << "Posting blob already registered.";
+
+        m_postingBlob = RegisterVariableSizeBlob();
+        m_hasPostingBlob = true;
+
+        return m_postingBlob;
+    }
+
+
+    bool DocumentDataSchema::HasPostingBlob() const
+    {
+        return m_hasPostingBlob;
+    }
+
+
+    VariableSizeBlobId DocumentDataSchema::GetPostingBlob() const
+    {
+        CHECK_TRUE(m_hasPostingBlob)
+            << "Schema has no posting blob.";
+
+        return m_postingBlob;
+    }
 }
@@ -51,6 +51,9 @@ namespace BitFunnel
         virtual FixedSizeBlobId RegisterFixedSizeBlob(unsigned byteCount) override;
         virtual unsigned GetVariableSizeBlobCount() const override;
         virtual std::vector<unsigned> const & GetFixedSizeBlobSizes() const override;
+        virtual VariableSizeBlobId RegisterPostingBlob() override;
+        virtual bool HasPostingBlob() const override;
+        virtual VariableSizeBlobId GetPostingBlob() const override;
 
     private:
 
@@ -61,5 +64,10 @@ namespace BitFunnel
         // constituants of the document ingestion. FixedSizeBlobId acts as an
         // index into this array.
         std::vector<unsigned> m_fixedSizeBlobSizes;
+
+        // Variable size blob holding the postings of each document. Valid
+        // only when m_hasPostingBlob is true.
+        bool m_hasPostingBlob;
+        VariableSizeBlobId m_postingBlob;
     };
 }
@@ -91,7 +91,10 @@ namespace BitFunnel
 
     void DocumentHandle::AddPosting(Term const & term)
     {
-        m_slice->GetShard().AddPosting(term, m_index, m_slice->GetSliceBuffer());
+        m_slice->GetShard().AddPosting(term,
+                                       m_index,
+                                       m_slice->GetSliceBuffer(),
+                                       m_slice->IsThreadOwned());
     }
 
 
@@ -129,7 +132,8 @@ namespace BitFunnel
                     row.GetIndex(),
                     m_index);
 
-        return bit == 1ull;
+        // RowTableDescriptor::GetBit() returns the masked bit on some platforms.
+        return bit != 0;
     }
 
 
@@ -28,10 +28,12 @@
 #include "BitFunnel/IFileManager.h"
 #include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Index/IDocument.h"
+#include "BitFunnel/Index/IDocumentDataSchema.h"
 #include "BitFunnel/Index/IIndexedIdfTable.h"
 #include "BitFunnel/Index/IRecycler.h"
 #include "BitFunnel/Index/ISliceBufferAllocator.h"
 #include "BitFunnel/Index/ITermTableCollection.h"
+#include "BitFunnel/Index/PostingBlob.h"
 #include "BitFunnel/Utilities/Factories.h"
 #include "DocumentHandleInternal.h"
 #include "Ingestor.h"
@@ -46,13 +48,15 @@ namespace BitFunnel
                               IRecycler& recycler,
                               ITermTableCollection const & termTables,
                               IShardDefinition const & shardDefinition,
-                              ISliceBufferAllocator& sliceBufferAllocator)
+                              ISliceBufferAllocator& sliceBufferAllocator,
+                              bool threadActiveSlices)
     {
         return std::unique_ptr<IIngestor>(new Ingestor(docDataSchema,
                                                        recycler,
                                                        termTables,
                                                        shardDefinition,
-                                                       sliceBufferAllocator));
+                                                       sliceBufferAllocator,
+                                                       threadActiveSlices));
     }
 
 
@@ -60,8 +64,10 @@ namespace BitFunnel
                        IRecycler& recycler,
                        ITermTableCollection const & termTables,
                        IShardDefinition const & shardDefinition,
-                       ISliceBufferAllocator& sliceBufferAllocator)
-        : m_recycler(recycler),
+                       ISliceBufferAllocator& sliceBufferAllocator,
+                       bool threadActiveSlices)
+        : m_docDataSchema(docDataSchema),
+          m_recycler(recycler),
           m_shardDefinition(shardDefinition),
           m_documentCount(0),   // TODO: This member is now redundant (with m_documentMap).
           m_totalSourceByteSize(0),
@@ -71,6 +77,8 @@ namespace BitFunnel
           m_sliceBufferAllocator(sliceBufferAllocator)
     {
         // Create shards based on shard definition in m_shardDefinition..
+        // Shards are spread over the NUMA nodes of the allocator.
+        const size_t numaNodeCount = m_sliceBufferAllocator.GetNumaNodeCount();
         for (ShardId shardId = 0; shardId < m_shardDefinition.GetShardCount(); ++shardId)
         {
             m_shards.push_back(
@@ -80,7 +88,9 @@ namespace BitFunnel
                               termTables.GetTermTable(shardId),
                               docDataSchema,
                               m_sliceBufferAllocator,
-                              m_sliceBufferAllocator.GetSliceBufferSize())));
+                              m_sliceBufferAllocator.GetSliceBufferSize(),
+                              threadActiveSlices,
+                              shardId % numaNodeCount)));
         }
     }
 
@@ -142,18 +152,72 @@ namespace BitFunnel
     }
 
 
+    IDocumentDataSchema const & Ingestor::GetDocumentDataSchema() const
+    {
+        return m_docDataSchema;
+    }
+
+
+    void Ingestor::WriteSnapshot(IFileManager & fileManager) const
+    {
+        for (size_t shard = 0; shard < m_shards.size(); ++shard)
+        {
+            auto out = fileManager.IndexSnapshot(shard).OpenForWrite();
+            m_shards[shard]->WriteSnapshot(*out);
+        }
+    }
+
+
+    void Ingestor::LoadSnapshot(IFileManager & fileManager)
+    {
+        if (m_documentCount > 0)
+        {
+            RecoverableError error("Ingestor::LoadSnapshot(): index is not empty.");
+            throw error;
+        }
+
+        for (size_t shard = 0; shard < m_shards.size(); ++shard)
+        {
+            // The snapshot is mapped directly from the file, bypassing the
+            // streams provided by IFileSystem.
+            const std::string path = fileManager.IndexSnapshot(shard).GetName();
+            auto handles = m_shards[shard]->LoadSnapshot(path.c_str());
+
+            for (auto const & handle : handles)
+            {
+                m_documentMap->Add(handle);
+            }
+            m_documentCount += handles.size();
+        }
+    }
+
+
     void Ingestor::Add(DocId id, IDocument const & document)
     {
+        if (!TryAdd(id, document))
+        {
+            RecoverableError error("Ingestor::Add: slice buffer allocator is at capacity.");
+            throw error;
+        }
+    }
+
+
+    bool Ingestor::TryAdd(DocId id, IDocument const & document)
+    {
+        // Choose correct shard and then allocate handle.
+        ShardId shardId = m_shardDefinition.GetShard(document.GetPostingCount());
+        DocumentHandleInternal handle;
+        if (!m_shards[shardId]->TryAllocateDocument(id, handle))
+        {
+            return false;
+        }
+
         ++m_documentCount;
         m_totalSourceByteSize += document.GetSourceByteSize();
 
         // Add postingCount to the DocumentLengthHistogram
         m_histogram.AddDocument(document.GetPostingCount());
 
-        // Choose correct shard and then allocate handle.
-        ShardId shardId = m_shardDefinition.GetShard(document.GetPostingCount());
-        DocumentHandleInternal handle = m_shards[shardId]->AllocateDocument(id);
-
         //std::cout
         //    << "IIngestor::Add("
         //    << id << "): "
@@ -163,6 +227,17 @@ namespace BitFunnel
 
         document.Ingest(handle);
 
+        // Fill the posting blob before the document becomes visible to
+        // queries.
+        if (m_docDataSchema.HasPostingBlob())
+        {
+            std::vector<Term::Hash> hashes;
+            document.GetPostingHashes(hashes);
+            void * blob =
+                handle.AllocateVariableSizeBlob(m_docDataSchema.GetPostingBlob(),
+                                                PostingBlob::GetByteCount(hashes.size()));
+            PostingBlob::Write(blob, hashes);
+        }
 
         // TODO: REVIEW: Why are Activate() and CommitDocument() separate operations?
         handle.Activate();
@@ -192,6 +267,8 @@ namespace BitFunnel
             // Re-throw the original exception back to the caller.
             throw;
         }
+
+        return true;
     }
 
 
@@ -291,10 +368,20 @@ namespace BitFunnel
 
     void Ingestor::Shutdown()
     {
+        ReleaseThreadSlices();
         m_tokenManager->Shutdown();
     }
 
 
+    void Ingestor::ReleaseThreadSlices()
+    {
+        for (auto & shard : m_shards)
+        {
+            shard->ReleaseThreadSlices();
+        }
+    }
+
+
     void Ingestor::OpenGroup(GroupId /*groupId*/)
     {
         throw NotImplemented();
@@ -57,7 +57,8 @@ namespace BitFunnel
                  IRecycler& recycle,
                  ITermTableCollection const & termTables,
                  IShardDefinition const & shardDefinition,
-                 ISliceBufferAllocator& sliceBufferAllocator);
+                 ISliceBufferAllocator& sliceBufferAllocator,
+                 bool threadActiveSlices);
 
         virtual ~Ingestor();
 
@@ -76,12 +77,26 @@ namespace BitFunnel
         virtual void WriteStatistics(IFileManager & fileManager,
                                      TermToText const * termToText) const override;
 
+        // Writes a snapshot of each Shard to the IndexSnapshot file for the
+        // shard. Ingestion must be paused while the snapshot is written.
+        virtual void WriteSnapshot(IFileManager & fileManager) const override;
+
+        // Maps the IndexSnapshot file for each shard and adds its documents to
+        // the DocumentMap. The index must be empty.
+        virtual void LoadSnapshot(IFileManager & fileManager) override;
+
 
         // Returns a reference to the IDocument cache. This cache holds ingested
         // IDocuments for use in query verification diagnostics.
         virtual IDocumentCache & GetDocumentCache() const override;
 
 
+        // Returns the IDocumentDataSchema that describes the per document
+        // data in the DocTable. When the schema has a posting blob, Add()
+        // fills it with the document's postings.
+        virtual IDocumentDataSchema const & GetDocumentDataSchema() const override;
+
+
         // Adds a document to the index. Throws if there is no space to add the
         // document which means the system is running at its maximum capacity.
         // The IDocument must implement the Place method which should call
@@ -89,6 +104,7 @@ namespace BitFunnel
         // Throws if the index already contains a document with the same id
         // value.
         virtual void Add(DocId id, IDocument const & document) override;
+        virtual bool TryAdd(DocId id, IDocument const & document) override;
 
         // Removes a document from serving. The document with the specified id
         // will no longer be returned from the queries. Returns true if the
@@ -135,6 +151,9 @@ namespace BitFunnel
         // Shuts down the index and releases resources allocated to it.
         virtual void Shutdown() override;
 
+        // Releases the active slices of ingestion threads in every shard.
+        virtual void ReleaseThreadSlices() override;
+
         //
         // Group management functions.
         //
@@ -157,6 +176,7 @@ namespace BitFunnel
         virtual void ExpireGroup(GroupId groupId) override;
 
     private:
+        IDocumentDataSchema const & m_docDataSchema;
         IRecycler& m_recycler;
         IShardDefinition const & m_shardDefinition;
 
@@ -0,0 +1,178 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <cstring>
+#include <sstream>
+
+#include "BitFunnel/Exceptions.h"
+#include "LoggerInterfaces/Logging.h"
+#include "MemoryMappedFile.h"
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+#include <Windows.h>    // For CreateFileMapping/MapViewOfFile.
+#else
+#include <cerrno>
+#include <fcntl.h>      // For open.
+#include <sys/mman.h>   // For mmap/munmap.
+#include <unistd.h>     // For close.
+#endif
+
+
+namespace BitFunnel
+{
+    static void ThrowMappingError(char const * operation, char const * path)
+    {
+        std::stringstream message;
+        message << "MemoryMappedFile: " << operation << " failed";
+        if (path != nullptr)
+        {
+            message << " for " << path;
+        }
+#ifndef BITFUNNEL_PLATFORM_WINDOWS
+        message << ": " << std::strerror(errno);
+#endif
+        message << ".";
+
+        RecoverableError error(message.str());
+        throw error;
+    }
+
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+
+    MemoryMappedFile::MemoryMappedFile(char const * path)
+    {
+        m_file = CreateFileA(path,
+                             GENERIC_READ,
+                             FILE_SHARE_READ,
+                             nullptr,
+                             OPEN_EXISTING,
+                             FILE_ATTRIBUTE_NORMAL,
+                             nullptr);
+        if (m_file == INVALID_HANDLE_VALUE)
+        {
+            ThrowMappingError("CreateFile", path);
+        }
+
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+        if (m_mapping == nullptr)
+        {
+            CloseHandle(m_file);
+            ThrowMappingError("CreateFileMapping", path);
+        }
+    }
+
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        // Views mapped from this file remain valid after their handles are
+        // closed.
+        CloseHandle(m_mapping);
+        CloseHandle(m_file);
+    }
+
+
+    void* MemoryMappedFile::Map(size_t offset, size_t byteCount)
+    {
+        const uint64_t position = static_cast<uint64_t>(offset);
+        void* region = MapViewOfFile(m_mapping,
+                                     FILE_MAP_COPY,
+                                     static_cast<DWORD>(position >> 32),
+                                     static_cast<DWORD>(position),
+                                     byteCount);
+        if (region == nullptr)
+        {
+            ThrowMappingError("MapViewOfFile", nullptr);
+        }
+
+        return region;
+    }
+
+
+    /* static */
+    void MemoryMappedFile::Unmap(void* region, size_t /*byteCount*/)
+    {
+        // Unmap() runs on cleanup paths, so failures are logged rather
+        // than thrown.
+        if (!UnmapViewOfFile(region))
+        {
+            LogB(Logging::Error,
+                 "MemoryMappedFile",
+                 "UnmapViewOfFile failed with error %lu.",
+                 GetLastError());
+        }
+    }
+
+#else
+
+    MemoryMappedFile::MemoryMappedFile(char const * path)
+        : m_file(open(path, O_RDONLY))
+    {
+        if (m_file == -1)
+        {
+            ThrowMappingError("open", path);
+        }
+    }
+
+
+    MemoryMappedFile::~MemoryMappedFile()
+    {
+        // Mappings remain valid after the file descriptor is closed.
+        close(m_file);
+    }
+
+
+    void* MemoryMappedFile::Map(size_t offset, size_t byteCount)
+    {
+        void* region = mmap(nullptr,
+                            byteCount,
+                            PROT_READ | PROT_WRITE,
+                            MAP_PRIVATE,
+                            m_file,
+                            static_cast<off_t>(offset));
+        if (region == MAP_FAILED)
+        {
+            ThrowMappingError("mmap", nullptr);
+        }
+
+        return region;
+    }
+
+
+    /* static */
+    void MemoryMappedFile::Unmap(void* region, size_t byteCount)
+    {
+        // Unmap() runs on cleanup paths, so failures are logged rather
+        // than thrown.
+        if (munmap(region, byteCount) != 0)
+        {
+            LogB(Logging::Error,
+                 "MemoryMappedFile",
+                 "munmap failed: %s.",
+                 std::strerror(errno));
+        }
+    }
+
+#endif
+}
@@ -0,0 +1,73 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <stddef.h>                 // size_t parameter.
+
+#include "BitFunnel/NonCopyable.h"  // Base class.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // MemoryMappedFile maps regions of an existing file into memory. Regions
+    // are mapped copy-on-write: they may be modified in memory, but the
+    // changes are never written back to the file. This allows index
+    // snapshots to be used directly as slice buffers.
+    //
+    // Mapped regions remain valid after the MemoryMappedFile is destroyed
+    // and must be released with Unmap().
+    //
+    //*************************************************************************
+    class MemoryMappedFile : NonCopyable
+    {
+    public:
+        // Opens the file at path for mapping. Throws if the file cannot be
+        // opened.
+        MemoryMappedFile(char const * path);
+
+        ~MemoryMappedFile();
+
+        // Maps byteCount bytes starting at offset. The offset must be a
+        // multiple of c_granularity. Throws if the region cannot be mapped.
+        void* Map(size_t offset, size_t byteCount);
+
+        // Releases a region returned by Map().
+        static void Unmap(void* region, size_t byteCount);
+
+        // Offsets passed to Map() must be multiples of this value. It is the
+        // allocation granularity on Windows and a multiple of the page size
+        // on other platforms.
+        static const size_t c_granularity = 1ull << 16;
+
+    private:
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        void* m_file;
+        void* m_mapping;
+#else
+        int m_file;
+#endif
+    };
+}
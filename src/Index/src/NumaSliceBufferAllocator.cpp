@@ -0,0 +1,169 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <stdint.h>
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "LoggerInterfaces/Logging.h"
+#include "Numa.h"
+#include "NumaSliceBufferAllocator.h"
+
+
+namespace BitFunnel
+{
+    std::unique_ptr<ISliceBufferAllocator>
+        Factories::CreateNumaSliceBufferAllocator(size_t blockSize,
+                                                  size_t blockCount,
+                                                  bool useLargePages)
+    {
+        return std::unique_ptr<ISliceBufferAllocator>(
+            new NumaSliceBufferAllocator(blockSize,
+                                         blockCount,
+                                         useLargePages,
+                                         GetNumaNodes()));
+    }
+
+
+    NumaSliceBufferAllocator::NumaSliceBufferAllocator(size_t blockSize,
+                                                       size_t blockCount,
+                                                       bool useLargePages,
+                                                       std::vector<size_t> const & nodes)
+        : m_allocatedCount(0),
+          m_highWaterCount(0)
+    {
+        LogAssertB(blockCount > 0, "blockCount of 0.");
+        LogAssertB(!nodes.empty(), "No NUMA nodes.");
+
+        // Don't create empty pools when there are more nodes than blocks.
+        size_t nodeCount = nodes.size();
+        if (nodeCount > blockCount)
+        {
+            nodeCount = blockCount;
+        }
+
+        const size_t blocksPerNode = (blockCount + nodeCount - 1) / nodeCount;
+        for (size_t i = 0; i < nodeCount; ++i)
+        {
+            m_nodes.push_back(
+                Factories::CreateBlockAllocator(blockSize,
+                                                blocksPerNode,
+                                                useLargePages,
+                                                nodes[i]));
+        }
+    }
+
+
+    void* NumaSliceBufferAllocator::Allocate(size_t byteSize, size_t numaNode)
+    {
+        void* buffer = TryAllocate(byteSize, numaNode);
+        if (buffer == nullptr)
+        {
+            throw FatalError("Out of memory");
+        }
+
+        return buffer;
+    }
+
+
+    void* NumaSliceBufferAllocator::TryAllocate(size_t byteSize, size_t numaNode)
+    {
+        LogAssertB(GetSliceBufferSize() == byteSize,
+                   "Allocate byteSize != block size.");
+
+        // Start with the requested node, then try the others in order. There
+        // may be fewer pools than nodes if there are fewer blocks than nodes.
+        const size_t nodeCount = m_nodes.size();
+        const size_t first = numaNode % nodeCount;
+        for (size_t i = 0; i < nodeCount; ++i)
+        {
+            uint64_t* block = m_nodes[(first + i) % nodeCount]->TryAllocateBlock();
+            if (block != nullptr)
+            {
+                const size_t allocatedCount = ++m_allocatedCount;
+                size_t highWaterCount = m_highWaterCount;
+                while (allocatedCount > highWaterCount &&
+                       !m_highWaterCount.compare_exchange_weak(highWaterCount,
+                                                               allocatedCount))
+                {
+                }
+
+                return block;
+            }
+        }
+
+        return nullptr;
+    }
+
+
+    void NumaSliceBufferAllocator::Release(void* buffer)
+    {
+        for (auto & node : m_nodes)
+        {
+            if (node->Contains(buffer))
+            {
+                node->ReleaseBlock(reinterpret_cast<uint64_t*>(buffer));
+                --m_allocatedCount;
+                return;
+            }
+        }
+
+        LogAbortB("Release buffer not owned by NumaSliceBufferAllocator.");
+    }
+
+
+    size_t NumaSliceBufferAllocator::GetSliceBufferSize() const
+    {
+        return m_nodes.front()->GetBlockSize();
+    }
+
+
+    size_t NumaSliceBufferAllocator::GetAllocatedBufferCount() const
+    {
+        return m_allocatedCount;
+    }
+
+
+    size_t NumaSliceBufferAllocator::GetHighWaterBufferCount() const
+    {
+        return m_highWaterCount;
+    }
+
+
+    size_t NumaSliceBufferAllocator::GetCommittedBufferCount() const
+    {
+        size_t count = 0;
+        for (auto const & node : m_nodes)
+        {
+            count += node->GetCommittedBlockCount();
+        }
+        return count;
+    }
+
+
+    size_t NumaSliceBufferAllocator::GetNumaNodeCount() const
+    {
+        return m_nodes.size();
+    }
+}
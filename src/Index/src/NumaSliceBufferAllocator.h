@@ -0,0 +1,93 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <atomic>       // std::atomic member.
+#include <memory>       // std::unique_ptr member.
+#include <stddef.h>     // size_t parameter.
+#include <vector>       // std::vector member.
+
+#include "BitFunnel/Index/ISliceBufferAllocator.h"
+#include "BitFunnel/Utilities/IBlockAllocator.h"
+#include "BitFunnel/NonCopyable.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // NumaSliceBufferAllocator is an ISliceBufferAllocator that splits its
+    // pool of slice buffers evenly across the NUMA nodes of the machine.
+    // Each node's pool is placed on that node and, optionally, backed by
+    // large pages to reduce TLB misses while matching.
+    //
+    // Allocate() prefers a buffer from the node requested by the Shard,
+    // regardless of which thread ingests into it, and falls back to the
+    // other nodes when that node's pool is exhausted.
+    //
+    // Placement is only a hint for the benefit of the caller. Query threads
+    // are not bound to NUMA nodes, and SliceScheduler hands out slices
+    // without regard to their node, so a slice is local to the thread that
+    // scans it only when the operating system happens to run that thread on
+    // the shard's node.
+    //
+    // This class is thread safe.
+    //
+    //*************************************************************************
+    class NumaSliceBufferAllocator : public ISliceBufferAllocator, NonCopyable
+    {
+    public:
+        // Creates an allocator for blockCount buffers of blockSize bytes,
+        // split across the NUMA nodes numbered in nodes. Each node receives
+        // blockCount / nodes.size() buffers, rounded up. The numaNode
+        // parameter of Allocate() indexes nodes.
+        NumaSliceBufferAllocator(size_t blockSize,
+                                 size_t blockCount,
+                                 bool useLargePages,
+                                 std::vector<size_t> const & nodes);
+
+        //
+        // ISliceBufferAllocator API.
+        //
+        virtual void* Allocate(size_t byteSize, size_t numaNode) override;
+        virtual void* TryAllocate(size_t byteSize, size_t numaNode) override;
+        virtual void Release(void* buffer) override;
+        virtual size_t GetSliceBufferSize() const override;
+        virtual size_t GetAllocatedBufferCount() const override;
+        virtual size_t GetHighWaterBufferCount() const override;
+        virtual size_t GetCommittedBufferCount() const override;
+        virtual size_t GetNumaNodeCount() const override;
+
+    private:
+        // One pool of buffers for each NUMA node, in the order of the nodes
+        // passed to the constructor.
+        std::vector<std::unique_ptr<IBlockAllocator>> m_nodes;
+
+        // Buffers allocated across all nodes and the largest value it has
+        // reached. The per-node high water marks don't add up to the
+        // overall high water mark, so it is tracked here.
+        std::atomic<size_t> m_allocatedCount;
+        std::atomic<size_t> m_highWaterCount;
+    };
+}
@@ -0,0 +1,78 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>                        // std::sort(), std::unique().
+#include <stdint.h>                         // uint64_t.
+
+#include "BitFunnel/Index/PostingBlob.h"
+
+
+namespace BitFunnel
+{
+    PostingBlob::PostingBlob(void const * blob)
+      : m_postingCount(0),
+        m_hashes(nullptr)
+    {
+        if (blob != nullptr)
+        {
+            auto header = reinterpret_cast<uint64_t const *>(blob);
+            m_postingCount = static_cast<size_t>(header[0]);
+            m_hashes = reinterpret_cast<Term::Hash const *>(header + 1);
+        }
+    }
+
+
+    size_t PostingBlob::GetPostingCount() const
+    {
+        return m_postingCount;
+    }
+
+
+    bool PostingBlob::Contains(Term const & term) const
+    {
+        return std::binary_search(m_hashes,
+                                  m_hashes + m_postingCount,
+                                  term.GetRawHash());
+    }
+
+
+    size_t PostingBlob::GetByteCount(size_t postingCount)
+    {
+        return sizeof(uint64_t) + postingCount * sizeof(Term::Hash);
+    }
+
+
+    size_t PostingBlob::Write(void * blob, std::vector<Term::Hash> & hashes)
+    {
+        std::sort(hashes.begin(), hashes.end());
+        hashes.erase(std::unique(hashes.begin(), hashes.end()), hashes.end());
+
+        auto header = reinterpret_cast<uint64_t *>(blob);
+        header[0] = hashes.size();
+        std::copy(hashes.begin(),
+                  hashes.end(),
+                  reinterpret_cast<Term::Hash *>(header + 1));
+
+        return GetByteCount(hashes.size());
+    }
+}
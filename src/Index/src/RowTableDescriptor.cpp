@@ -26,6 +26,7 @@
 #include "BitFunnel/Index/ITermTable.h"
 #include "BitFunnel/Index/Row.h"
 #include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Utilities/StreamUtilities.h"
 #include "LoggerInterfaces/Check.h"
 #include "LoggerInterfaces/Logging.h"
 #include "RowTableDescriptor.h"
@@ -71,6 +72,27 @@ namespace BitFunnel
     }
 
 
+    RowTableDescriptor::RowTableDescriptor(std::istream& input)
+        : m_capacity(StreamUtilities::ReadField<DocIndex>(input)),
+          m_rowCount(StreamUtilities::ReadField<RowIndex>(input)),
+          m_rank(StreamUtilities::ReadField<Rank>(input)),
+          m_maxRank(StreamUtilities::ReadField<Rank>(input)),
+          m_bufferOffset(StreamUtilities::ReadField<ptrdiff_t>(input)),
+          m_bytesPerRow(Row::BytesInRow(m_capacity, m_rank, m_maxRank))
+    {
+    }
+
+
+    void RowTableDescriptor::Write(std::ostream& output) const
+    {
+        StreamUtilities::WriteField<DocIndex>(output, m_capacity);
+        StreamUtilities::WriteField<RowIndex>(output, m_rowCount);
+        StreamUtilities::WriteField<Rank>(output, m_rank);
+        StreamUtilities::WriteField<Rank>(output, m_maxRank);
+        StreamUtilities::WriteField<ptrdiff_t>(output, m_bufferOffset);
+    }
+
+
     void RowTableDescriptor::Initialize(void* sliceBuffer,
                                         ITermTable const & termTable) const
     {
@@ -152,6 +174,20 @@ namespace BitFunnel
     }
 
 
+    void RowTableDescriptor::SetBitExclusive(void* sliceBuffer,
+                                             RowIndex rowIndex,
+                                             DocIndex docIndex) const
+    {
+        CHECK_LT(rowIndex, m_rowCount)
+            << "rowIndex out of range.";
+        uint64_t* const row = GetRowData(sliceBuffer, rowIndex);
+        const size_t offset = QwordPositionFromDocIndex(docIndex);
+        uint64_t bitPos = docIndex & 0x3F;
+
+        *(row + offset) |= 1ull << bitPos;
+    }
+
+
     void RowTableDescriptor::ClearBit(void* sliceBuffer,
                                       RowIndex rowIndex,
                                       DocIndex docIndex) const
@@ -179,6 +215,17 @@ namespace BitFunnel
     }
 
 
+    bool RowTableDescriptor::IsCompatibleWith(RowTableDescriptor const & other) const
+    {
+        return m_capacity == other.m_capacity
+            && m_rowCount == other.m_rowCount
+            && m_rank == other.m_rank
+            && m_maxRank == other.m_maxRank
+            && m_bufferOffset == other.m_bufferOffset
+            && m_bytesPerRow == other.m_bytesPerRow;
+    }
+
+
     /* static */
     size_t RowTableDescriptor::GetBufferSize(DocIndex capacity,
                                              RowIndex rowCount,
@@ -24,6 +24,7 @@
 #pragma once
 
 #include <cstddef>                      // size_t embedded.
+#include <iosfwd>                       // std::istream, std::ostream parameters.
 
 #include "BitFunnel/BitFunnelTypes.h"   // DocIndex parameter.
 #include "BitFunnel/Index/RowId.h"      // RowIndex parameter.
@@ -64,6 +65,13 @@ namespace BitFunnel
         // create a cached copy of the RowTableDescriptor from Shard.
         RowTableDescriptor(RowTableDescriptor const & other);
 
+        // Constructs a RowTableDescriptor from dimensions previously written
+        // by Write(). Used to check the compatibility of index snapshots.
+        RowTableDescriptor(std::istream& input);
+
+        // Writes the dimensions of the RowTable to a stream.
+        void Write(std::ostream& output) const;
+
         // Zero out row buffer. May not be required if buffers come out of
         // allocator zero initialized. Expected to be called one per
         // sliceBuffer. All rows are initialized with zero in all bits except
@@ -81,6 +89,14 @@ namespace BitFunnel
         // Sets a bit in the given row and column.
         void SetBit(void* sliceBuffer, RowIndex rowIndex, DocIndex docIndex) const;
 
+        // Same as SetBit(), but with a plain read-modify-write instead of an
+        // interlocked operation. Only safe when no other thread writes to
+        // the row in this slice buffer at the same time, e.g. for posting
+        // rows of a Slice owned by a single ingestion thread.
+        void SetBitExclusive(void* sliceBuffer,
+                             RowIndex rowIndex,
+                             DocIndex docIndex) const;
+
         // Clears a bit in the given row and column.
         void ClearBit(void* sliceBuffer, RowIndex rowIndex, DocIndex docIndex) const;
 
@@ -21,6 +21,12 @@
 // THE SOFTWARE.
 
 
+#include <algorithm>    // std::min()
+#include <atomic>       // std::atomic static.
+#include <fstream>
+#include <sstream>
+#include <thread>       // std::this_thread::yield()
+
 #include "BitFunnel/Exceptions.h"
 #include "BitFunnel/Index/IRecycler.h"
 #include "BitFunnel/Index/ISliceBufferAllocator.h"
@@ -29,8 +35,12 @@
 #include "BitFunnel/Index/RowIdSequence.h"
 #include "BitFunnel/Index/Token.h"
 #include "BitFunnel/Term.h"
+#include "BitFunnel/Utilities/FileHeader.h"
+#include "BitFunnel/Utilities/StreamUtilities.h"
+#include "BitFunnel/Utilities/Version.h"
 #include "IRecyclable.h"
 #include "LoggerInterfaces/Logging.h"
+#include "MemoryMappedFile.h"
 #include "Recycler.h"
 #include "Rounding.h"
 #include "Shard.h"
@@ -69,18 +79,187 @@ namespace BitFunnel
     }
 
 
+    // Version of the format written by Shard::WriteSnapshot().
+    static const Version c_snapshotVersion(1, 0, 0);
+
+
+    // Returns the distance between consecutive slice buffers in a snapshot.
+    static size_t GetSnapshotStride(size_t sliceBufferSize)
+    {
+        return RoundUp(sliceBufferSize, MemoryMappedFile::c_granularity);
+    }
+
+
+    // Writes byteCount zero bytes to output.
+    static void WritePadding(std::ostream& output, size_t byteCount)
+    {
+        static const char zeros[4096] = {};
+        while (byteCount > 0)
+        {
+            const size_t count = (std::min)(byteCount, sizeof(zeros));
+            StreamUtilities::WriteBytes(output, zeros, count);
+            byteCount -= count;
+        }
+    }
+
+
+    // Source of Shard::GetGeneration() values.
+    static std::atomic<uint64_t> s_nextGeneration(1);
+
+
+    static void ThrowSnapshotError(char const * path, char const * reason)
+    {
+        std::stringstream message;
+        message << "Shard::LoadSnapshot(): " << path << ": " << reason;
+        RecoverableError error(message.str());
+        throw error;
+    }
+
+
+    //*************************************************************************
+    //
+    // ThreadSlot
+    //
+    // Assigns each thread that allocates documents from Shards with thread
+    // active slices a slot number in [0, Shard::c_maxThreadActiveSliceCount)
+    // that no other living thread holds. A thread keeps its slot until it
+    // exits, so the Slice in the slot is only written by one thread at a
+    // time. Threads which find all slots taken get c_noSlot.
+    //
+    // The slots in use are the set bits of s_usedSlots. The atomic
+    // operations which release and acquire a slot order the writes of its
+    // previous owner before those of the next one.
+    //
+    //*************************************************************************
+    class ThreadSlot : NonCopyable
+    {
+    public:
+        ThreadSlot();
+        ~ThreadSlot();
+
+        size_t GetSlot() const;
+
+        static const size_t c_noSlot = Shard::c_maxThreadActiveSliceCount;
+
+        // Returns the slot of the calling thread.
+        static size_t GetCurrentThreadSlot();
+
+    private:
+        size_t m_slot;
+
+        static std::atomic<uint64_t> s_usedSlots;
+    };
+
+
+    static_assert(Shard::c_maxThreadActiveSliceCount == 64,
+                  "ThreadSlot requires one bit per slot in a uint64_t.");
+
+    std::atomic<uint64_t> ThreadSlot::s_usedSlots(0);
+
+
+    ThreadSlot::ThreadSlot()
+        : m_slot(c_noSlot)
+    {
+        uint64_t used = s_usedSlots;
+        while (used != ~0ull)
+        {
+            size_t slot = 0;
+            while ((used & (1ull << slot)) != 0)
+            {
+                ++slot;
+            }
+
+            if (s_usedSlots.compare_exchange_weak(used, used | (1ull << slot)))
+            {
+                m_slot = slot;
+                break;
+            }
+        }
+    }
+
+
+    ThreadSlot::~ThreadSlot()
+    {
+        if (m_slot != c_noSlot)
+        {
+            s_usedSlots &= ~(1ull << m_slot);
+        }
+    }
+
+
+    size_t ThreadSlot::GetSlot() const
+    {
+        return m_slot;
+    }
+
+
+    size_t ThreadSlot::GetCurrentThreadSlot()
+    {
+        static thread_local ThreadSlot slot;
+        return slot.GetSlot();
+    }
+
+
+    //*************************************************************************
+    //
+    // AllocationPause
+    //
+    // Sets Shard::m_isAllocationPaused for its lifetime, so that allocation
+    // resumes even if writing a snapshot throws.
+    //
+    //*************************************************************************
+    class AllocationPause : NonCopyable
+    {
+    public:
+        explicit AllocationPause(std::atomic<bool>& isPaused)
+            : m_isPaused(isPaused)
+        {
+            m_isPaused = true;
+        }
+
+        ~AllocationPause()
+        {
+            m_isPaused = false;
+        }
+
+    private:
+        std::atomic<bool>& m_isPaused;
+    };
+
+
+    //*************************************************************************
+    //
+    // Shard
+    //
+    //*************************************************************************
+    Shard::ThreadActiveSlice::ThreadActiveSlice()
+        : m_slice(nullptr),
+          m_isReading(false)
+    {
+    }
+
+
     Shard::Shard(IRecycler& recycler,
                  ITokenManager& tokenManager,
                  ITermTable const & termTable,
                  IDocumentDataSchema const & docDataSchema,
                  ISliceBufferAllocator& sliceBufferAllocator,
-                 size_t sliceBufferSize)
+                 size_t sliceBufferSize,
+                 bool threadActiveSlices,
+                 size_t numaNode)
         : m_recycler(recycler),
           m_tokenManager(tokenManager),
           m_termTable(termTable),
+          m_generation(s_nextGeneration++),
           m_sliceBufferAllocator(sliceBufferAllocator),
+          m_numaNode(numaNode),
           m_documentActiveRowId(RowIdForActiveDocument(termTable)),
           m_activeSlice(nullptr),
+          m_activeSliceEpoch(0),
+          m_isAllocationPaused(false),
+          m_threadActiveSlices(threadActiveSlices ?
+                               new ThreadActiveSlice[c_maxThreadActiveSliceCount] :
+                               nullptr),
           m_sliceBuffers(new std::vector<void*>()),
           m_sliceCapacity(GetCapacityForByteSize(sliceBufferSize,
                                                  docDataSchema,
@@ -89,6 +268,9 @@ namespace BitFunnel
           // TODO: will need one global, not one per shard.
           m_docFrequencyTableBuilder(new DocumentFrequencyTableBuilder())
     {
+        m_activeSliceReaders[0] = 0;
+        m_activeSliceReaders[1] = 0;
+
         const size_t bufferSize =
             InitializeDescriptors(this,
                                   m_sliceCapacity,
@@ -107,36 +289,212 @@ namespace BitFunnel
 
     DocumentHandleInternal Shard::AllocateDocument(DocId id)
     {
+        DocumentHandleInternal handle;
+        if (!TryAllocateDocument(id, handle))
+        {
+            RecoverableError error("Shard::AllocateDocument: slice buffer allocator is at capacity.");
+            throw error;
+        }
+
+        return handle;
+    }
+
+
+    bool Shard::TryAllocateDocument(DocId id, DocumentHandleInternal& handle)
+    {
+        if (m_threadActiveSlices.get() != nullptr)
+        {
+            const size_t slot = ThreadSlot::GetCurrentThreadSlot();
+            if (slot != ThreadSlot::c_noSlot)
+            {
+                return TryAllocateThreadDocument(m_threadActiveSlices[slot],
+                                                 id,
+                                                 handle);
+            }
+        }
+
+        DocIndex index;
+
+        // Try the active slice without taking m_slicesLock. Once a
+        // document is allocated, the slice cannot be recycled until the
+        // document is expired, so the pointer remains valid after leaving
+        // the reader count.
+        {
+            // A reader that registers under an epoch which has already been
+            // advanced would not be waited for by the next
+            // WaitForActiveSliceReaders(), which waits on the other
+            // counter. Register again until the epoch is unchanged.
+            size_t epoch = m_activeSliceEpoch;
+            ++m_activeSliceReaders[epoch % 2];
+            while (m_activeSliceEpoch != epoch)
+            {
+                --m_activeSliceReaders[epoch % 2];
+                epoch = m_activeSliceEpoch;
+                ++m_activeSliceReaders[epoch % 2];
+            }
+
+            // While a snapshot is written, allocation waits for
+            // m_slicesLock.
+            Slice* slice = m_isAllocationPaused ? nullptr : m_activeSlice.load();
+            const bool allocated =
+                (slice != nullptr) && slice->TryAllocateDocument(index);
+            --m_activeSliceReaders[epoch % 2];
+
+            if (allocated)
+            {
+                handle = DocumentHandleInternal(slice, index, id);
+                return true;
+            }
+        }
+
         std::lock_guard<std::mutex> lock(m_slicesLock);
+
+        // Another thread may have created a new slice while this one waited
+        // for the lock. Threads on the fast path may also fill a new slice
+        // before this thread allocates from it.
+        Slice* slice = m_activeSlice;
+        while (slice == nullptr || !slice->TryAllocateDocument(index))
+        {
+            if (!TryCreateNewActiveSlice())
+            {
+                return false;
+            }
+            slice = m_activeSlice;
+        }
+
+        handle = DocumentHandleInternal(slice, index, id);
+        return true;
+    }
+
+
+    bool Shard::TryAllocateThreadDocument(ThreadActiveSlice& activeSlice,
+                                          DocId id,
+                                          DocumentHandleInternal& handle)
+    {
         DocIndex index;
-        if (m_activeSlice == nullptr || !m_activeSlice->TryAllocateDocument(index))
+
+        // RecycleSlice() clears activeSlice.m_slice before it waits for
+        // m_isReading to be false, so either it waits for this thread or
+        // this thread sees nullptr. WriteSnapshot() does the same with
+        // m_isAllocationPaused.
         {
-            CreateNewActiveSlice();
+            activeSlice.m_isReading = true;
+            Slice* slice =
+                m_isAllocationPaused ? nullptr : activeSlice.m_slice.load();
+            const bool allocated =
+                (slice != nullptr) && slice->TryAllocateDocument(index);
+            activeSlice.m_isReading = false;
+
+            if (allocated)
+            {
+                handle = DocumentHandleInternal(slice, index, id);
+                return true;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_slicesLock);
+
+        // The active Slice still has room if this thread waited for a
+        // snapshot.
+        Slice* slice = activeSlice.m_slice;
+        if (slice == nullptr || !slice->TryAllocateDocument(index))
+        {
+            // No other thread allocates from the new Slice, so it has room.
+            slice = TryCreateNewSlice(true);
+            if (slice == nullptr)
+            {
+                return false;
+            }
+            activeSlice.m_slice = slice;
 
-            LogAssertB(m_activeSlice->TryAllocateDocument(index),
-                       "Newly allocated slice has no space.");
+            const bool allocated = slice->TryAllocateDocument(index);
+            LogAssertB(allocated, "New thread owned Slice is full.");
         }
 
-        return DocumentHandleInternal(m_activeSlice, index, id);
+        handle = DocumentHandleInternal(slice, index, id);
+        return true;
     }
 
 
-    void* Shard::AllocateSliceBuffer()
+    void Shard::ReleaseThreadSlices()
     {
-        return m_sliceBufferAllocator.Allocate(m_sliceBufferSize);
+        if (m_threadActiveSlices.get() == nullptr)
+        {
+            return;
+        }
+
+        std::vector<Slice*> expiredSlices;
+        {
+            std::lock_guard<std::mutex> lock(m_slicesLock);
+
+            for (size_t i = 0; i < c_maxThreadActiveSliceCount; ++i)
+            {
+                ThreadActiveSlice& activeSlice = m_threadActiveSlices[i];
+                Slice* slice = activeSlice.m_slice;
+                if (slice == nullptr)
+                {
+                    continue;
+                }
+
+                // As in RecycleSlice(), the owner either sees nullptr or
+                // finishes its allocation before the Slice is sealed.
+                activeSlice.m_slice = nullptr;
+                while (activeSlice.m_isReading)
+                {
+                    std::this_thread::yield();
+                }
+
+                if (slice->Seal())
+                {
+                    expiredSlices.push_back(slice);
+                }
+            }
+        }
+
+        // RecycleSlice() takes m_slicesLock.
+        for (auto slice : expiredSlices)
+        {
+            Slice::DecrementRefCount(slice);
+        }
+    }
+
+
+    void* Shard::TryAllocateSliceBuffer()
+    {
+        return m_sliceBufferAllocator.TryAllocate(m_sliceBufferSize, m_numaNode);
+    }
+
+    // Must be called with m_slicesLock held.
+    bool Shard::TryCreateNewActiveSlice()
+    {
+        Slice* newSlice = TryCreateNewSlice(false);
+        if (newSlice == nullptr)
+        {
+            return false;
+        }
+
+        m_activeSlice = newSlice;
+
+        return true;
     }
 
+
     // Must be called with m_slicesLock held.
-    void Shard::CreateNewActiveSlice()
+    Slice* Shard::TryCreateNewSlice(bool isThreadOwned)
     {
-        Slice* newSlice = new Slice(*this);
+        void* sliceBuffer = TryAllocateSliceBuffer();
+        if (sliceBuffer == nullptr)
+        {
+            return nullptr;
+        }
+
+        Slice* newSlice = new Slice(*this, sliceBuffer, isThreadOwned);
 
         std::vector<void*>* oldSlices = m_sliceBuffers;
         std::vector<void*>* const newSlices = new std::vector<void*>(*m_sliceBuffers);
         newSlices->push_back(newSlice->GetSliceBuffer());
 
         m_sliceBuffers = newSlices;
-        m_activeSlice = newSlice;
 
         // TODO: think if this can be done outside of the lock.
         std::unique_ptr<IRecyclable>
@@ -145,6 +503,8 @@ namespace BitFunnel
                                                             m_tokenManager));
 
         m_recycler.ScheduleRecyling(recyclableSliceList);
+
+        return newSlice;
     }
 
 
@@ -221,6 +581,24 @@ namespace BitFunnel
     }
 
 
+    uint64_t Shard::GetGeneration() const
+    {
+        return m_generation;
+    }
+
+
+    ptrdiff_t Shard::GetDocIdOffset() const
+    {
+        return m_docTable->GetDocIdOffset();
+    }
+
+
+    size_t Shard::GetDocIdStride() const
+    {
+        return m_docTable->GetDocIdStride();
+    }
+
+
     size_t Shard::GetUsedCapacityInBytes() const
     {
         // TODO: does this really need to be locked?
@@ -316,6 +694,26 @@ namespace BitFunnel
                 // last Slice in the Shard.
                 m_activeSlice = nullptr;
             }
+
+            // Threads in AllocateDocument() may have read the pointer to the
+            // Slice while it was active.
+            WaitForActiveSliceReaders();
+
+            if (slice.IsThreadOwned())
+            {
+                for (size_t i = 0; i < c_maxThreadActiveSliceCount; ++i)
+                {
+                    ThreadActiveSlice& activeSlice = m_threadActiveSlices[i];
+                    if (activeSlice.m_slice == &slice)
+                    {
+                        activeSlice.m_slice = nullptr;
+                        while (activeSlice.m_isReading)
+                        {
+                            std::this_thread::yield();
+                        }
+                    }
+                }
+            }
         }
 
         // Scheduling the Slice and the old list of slice buffers can be
@@ -329,15 +727,295 @@ namespace BitFunnel
     }
 
 
+    void Shard::WaitForActiveSliceReaders()
+    {
+        // Readers that see the new epoch also see the current value of
+        // m_activeSlice, since the epoch is advanced after it was modified.
+        // Only the readers of the previous epoch need to leave. They leave
+        // promptly, so spinning is cheaper than blocking.
+        const size_t epoch = m_activeSliceEpoch++;
+        while (m_activeSliceReaders[epoch % 2] != 0)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+
+    void Shard::WaitForLockFreeAllocators() const
+    {
+        // Threads that register after m_isAllocationPaused was set do not
+        // allocate, so each counter only needs to be seen at zero once.
+        for (auto const & readers : m_activeSliceReaders)
+        {
+            while (readers != 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        if (m_threadActiveSlices.get() != nullptr)
+        {
+            for (size_t i = 0; i < c_maxThreadActiveSliceCount; ++i)
+            {
+                while (m_threadActiveSlices[i].m_isReading)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        }
+    }
+
+
     void Shard::ReleaseSliceBuffer(void* sliceBuffer)
     {
         m_sliceBufferAllocator.Release(sliceBuffer);
     }
 
 
+    void Shard::ReleaseMappedSliceBuffer(void* sliceBuffer)
+    {
+        MemoryMappedFile::Unmap(sliceBuffer, m_sliceBufferSize);
+    }
+
+
+    void Shard::WriteSnapshot(std::ostream& output) const
+    {
+        std::lock_guard<std::mutex> lock(m_slicesLock);
+
+        // Threads that allocate without m_slicesLock would otherwise modify
+        // the slices while they are written.
+        AllocationPause pause(m_isAllocationPaused);
+        WaitForLockFreeAllocators();
+
+        // Fully expired slices are waiting to be recycled and hold no
+        // documents worth restoring.
+        std::vector<Slice*> slices;
+        std::vector<size_t> allocatedCounts;
+        std::vector<size_t> expiredCounts;
+        for (auto buffer : *m_sliceBuffers.load())
+        {
+            Slice* slice = Slice::GetSliceFromBuffer(buffer, GetSlicePtrOffset());
+
+            size_t allocatedCount;
+            size_t commitPendingCount;
+            size_t expiredCount;
+            slice->GetDocumentCounts(allocatedCount,
+                                     commitPendingCount,
+                                     expiredCount);
+            if (commitPendingCount > 0)
+            {
+                RecoverableError error("Shard::WriteSnapshot(): a document is still being ingested.");
+                throw error;
+            }
+
+            if (expiredCount < m_sliceCapacity)
+            {
+                slices.push_back(slice);
+                allocatedCounts.push_back(allocatedCount);
+                expiredCounts.push_back(expiredCount);
+            }
+        }
+
+        std::stringstream header;
+        FileHeader fileHeader(c_snapshotVersion, "IndexSnapshot");
+        fileHeader.Write(header);
+
+        StreamUtilities::WriteField<uint64_t>(header, m_termTable.GetHash());
+        StreamUtilities::WriteField<uint64_t>(header, m_sliceBufferSize);
+        StreamUtilities::WriteField<uint64_t>(header, m_sliceCapacity);
+
+        m_docTable->Write(header);
+        StreamUtilities::WriteField<uint32_t>(header,
+                                              static_cast<uint32_t>(m_rowTables.size()));
+        for (auto const & rowTable : m_rowTables)
+        {
+            rowTable.Write(header);
+        }
+
+        StreamUtilities::WriteField<uint64_t>(header, slices.size());
+        for (size_t i = 0; i < slices.size(); ++i)
+        {
+            StreamUtilities::WriteField<uint64_t>(header, allocatedCounts[i]);
+            StreamUtilities::WriteField<uint64_t>(header, expiredCounts[i]);
+        }
+
+        const std::string headerBytes = header.str();
+        StreamUtilities::WriteBytes(output, headerBytes.c_str(), headerBytes.size());
+
+        // Slice buffers start at mappable offsets.
+        const size_t stride = GetSnapshotStride(m_sliceBufferSize);
+        WritePadding(output,
+                     RoundUp(headerBytes.size(), MemoryMappedFile::c_granularity)
+                     - headerBytes.size());
+
+        for (auto slice : slices)
+        {
+            StreamUtilities::WriteBytes(output,
+                                        static_cast<char const *>(slice->GetSliceBuffer()),
+                                        m_sliceBufferSize);
+            WritePadding(output, stride - m_sliceBufferSize);
+        }
+
+        for (auto slice : slices)
+        {
+            m_docTable->WriteVariableSizeBlobs(slice->GetSliceBuffer(), output);
+        }
+    }
+
+
+    std::vector<DocumentHandleInternal> Shard::LoadSnapshot(char const * path)
+    {
+        std::lock_guard<std::mutex> lock(m_slicesLock);
+
+        if (!m_sliceBuffers.load()->empty())
+        {
+            ThrowSnapshotError(path, "shard already has slices.");
+        }
+
+        std::ifstream input(path, std::ios::binary);
+        if (!input.is_open())
+        {
+            ThrowSnapshotError(path, "cannot open file.");
+        }
+
+        FileHeader fileHeader(input);
+        if (fileHeader.UserData() != "IndexSnapshot" ||
+            !fileHeader.GetVersion().IsCompatibleWith(c_snapshotVersion))
+        {
+            ThrowSnapshotError(path, "incompatible file format.");
+        }
+
+        if (StreamUtilities::ReadField<uint64_t>(input) != m_termTable.GetHash())
+        {
+            ThrowSnapshotError(path, "TermTable does not match.");
+        }
+
+        if (StreamUtilities::ReadField<uint64_t>(input) != m_sliceBufferSize ||
+            StreamUtilities::ReadField<uint64_t>(input) != m_sliceCapacity)
+        {
+            ThrowSnapshotError(path, "slice buffer size does not match.");
+        }
+
+        DocTableDescriptor docTable(input);
+        if (!m_docTable->IsCompatibleWith(docTable))
+        {
+            ThrowSnapshotError(path, "DocTable layout does not match.");
+        }
+
+        const uint32_t rowTableCount = StreamUtilities::ReadField<uint32_t>(input);
+        if (rowTableCount != m_rowTables.size())
+        {
+            ThrowSnapshotError(path, "RowTable layout does not match.");
+        }
+        for (auto const & rowTable : m_rowTables)
+        {
+            RowTableDescriptor other(input);
+            if (!rowTable.IsCompatibleWith(other))
+            {
+                ThrowSnapshotError(path, "RowTable layout does not match.");
+            }
+        }
+
+        const size_t sliceCount =
+            static_cast<size_t>(StreamUtilities::ReadField<uint64_t>(input));
+        std::vector<size_t> allocatedCounts;
+        std::vector<size_t> expiredCounts;
+        for (size_t i = 0; i < sliceCount; ++i)
+        {
+            allocatedCounts.push_back(
+                static_cast<size_t>(StreamUtilities::ReadField<uint64_t>(input)));
+            expiredCounts.push_back(
+                static_cast<size_t>(StreamUtilities::ReadField<uint64_t>(input)));
+            if (allocatedCounts.back() > m_sliceCapacity ||
+                expiredCounts.back() > allocatedCounts.back())
+            {
+                ThrowSnapshotError(path, "invalid document counts.");
+            }
+        }
+
+        const size_t bufferStart =
+            RoundUp(static_cast<size_t>(input.tellg()),
+                    MemoryMappedFile::c_granularity);
+        const size_t stride = GetSnapshotStride(m_sliceBufferSize);
+
+        // The variable size blobs follow the slice buffers.
+        input.seekg(static_cast<std::streamoff>(bufferStart + sliceCount * stride));
+        if (!input.good())
+        {
+            ThrowSnapshotError(path, "file is truncated.");
+        }
+
+        MemoryMappedFile file(path);
+        std::vector<std::unique_ptr<Slice>> slices;
+        for (size_t i = 0; i < sliceCount; ++i)
+        {
+            void* buffer = file.Map(bufferStart + i * stride, m_sliceBufferSize);
+            try
+            {
+                m_docTable->LoadVariableSizeBlobs(buffer, input);
+            }
+            catch (...)
+            {
+                m_docTable->Cleanup(buffer);
+                MemoryMappedFile::Unmap(buffer, m_sliceBufferSize);
+                throw;
+            }
+
+            slices.emplace_back(new Slice(*this,
+                                          buffer,
+                                          allocatedCounts[i],
+                                          expiredCounts[i]));
+        }
+
+        // Expired documents have their active bit cleared.
+        std::vector<DocumentHandleInternal> handles;
+        for (size_t i = 0; i < sliceCount; ++i)
+        {
+            for (DocIndex index = 0; index < allocatedCounts[i]; ++index)
+            {
+                DocumentHandleInternal handle(slices[i].get(), index);
+                if (handle.GetBit(m_documentActiveRowId))
+                {
+                    handles.push_back(handle);
+                }
+            }
+        }
+
+        if (sliceCount > 0)
+        {
+            std::vector<void*>* oldSlices = m_sliceBuffers;
+            std::vector<void*>* const newSlices = new std::vector<void*>();
+            for (auto const & slice : slices)
+            {
+                newSlices->push_back(slice->GetSliceBuffer());
+            }
+
+            m_sliceBuffers = newSlices;
+
+            // Documents are allocated from the last slice until it is full.
+            m_activeSlice = slices.back().get();
+
+            for (auto & slice : slices)
+            {
+                slice.release();
+            }
+
+            std::unique_ptr<IRecyclable>
+                recyclableSliceList(new DeferredSliceListDelete(nullptr,
+                                                                oldSlices,
+                                                                m_tokenManager));
+
+            m_recycler.ScheduleRecyling(recyclableSliceList);
+        }
+
+        return handles;
+    }
+
+
     void Shard::AddPosting(Term const & term,
                            DocIndex index,
-                           void* sliceBuffer)
+                           void* sliceBuffer,
+                           bool isThreadOwned)
     {
         if (m_docFrequencyTableBuilder.get() != nullptr)
         {
@@ -348,11 +1026,26 @@ namespace BitFunnel
 
         RowIdSequence rows(term, m_termTable);
 
-        for (auto const row : rows)
+        // Only the owning thread writes postings to a thread owned Slice.
+        // The document active row and fact rows may be modified by other
+        // threads, so they are always written with interlocked operations.
+        if (isThreadOwned)
         {
-            m_rowTables[row.GetRank()].SetBit(sliceBuffer,
-                                              row.GetIndex(),
-                                              index);
+            for (auto const row : rows)
+            {
+                m_rowTables[row.GetRank()].SetBitExclusive(sliceBuffer,
+                                                           row.GetIndex(),
+                                                           index);
+            }
+        }
+        else
+        {
+            for (auto const row : rows)
+            {
+                m_rowTables[row.GetRank()].SetBit(sliceBuffer,
+                                                  row.GetIndex(),
+                                                  index);
+            }
         }
     }
 
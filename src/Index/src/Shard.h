@@ -67,16 +67,36 @@ namespace BitFunnel
         // Constructs an empty Shard with no slices. sliceBufferSize must be
         // sufficient to hold the minimum capacity Slice. The minimum capacity
         // is determined by a value returned by Row::DocumentsInRank0Row(1).
+        //
+        // If threadActiveSlices is true, each of the first
+        // c_maxThreadActiveSliceCount threads to allocate documents gets its
+        // own active Slice, so that ingestion threads do not write to the
+        // same cache lines. The documents allocated by a thread must then be
+        // ingested on that thread. Additional threads share a single active
+        // Slice. The Shard will have up to one partially filled Slice per
+        // ingestion thread.
+        //
+        // numaNode is passed to ISliceBufferAllocator::TryAllocate(), so
+        // that all of the Shard's slices are placed on one NUMA node. This
+        // is a hint only: query threads are not bound to that node.
         Shard(IRecycler& recycler,
               ITokenManager& tokenManager,
               ITermTable const & termTable,
               IDocumentDataSchema const & docDataSchema,
               ISliceBufferAllocator& sliceBufferAllocator,
-              size_t sliceBufferSize);
+              size_t sliceBufferSize,
+              bool threadActiveSlices = false,
+              size_t numaNode = 0);
 
         virtual ~Shard();
 
-        void AddPosting(Term const & term, DocIndex index, void* sliceBuffer);
+        // Sets the bits for the term's rows in a document's column. If
+        // isThreadOwned is true, the bits are set without interlocked
+        // operations. See Slice::IsThreadOwned().
+        void AddPosting(Term const & term,
+                        DocIndex index,
+                        void* sliceBuffer,
+                        bool isThreadOwned);
         void AssertFact(FactHandle fact, bool value, DocIndex index, void* sliceBuffer);
 
         void TemporaryRecordDocument();
@@ -105,6 +125,16 @@ namespace BitFunnel
         // Returns the offset of the row in the slice buffer in a shard.
         virtual ptrdiff_t GetRowOffset(RowId rowId) const;
 
+        // Returns term table associated with this shard.
+        virtual ITermTable const & GetTermTable() const;
+
+        // Returns the process-unique generation of this shard.
+        virtual uint64_t GetGeneration() const;
+
+        // Returns the layout of DocIds in the DocTable.
+        virtual ptrdiff_t GetDocIdOffset() const;
+        virtual size_t GetDocIdStride() const;
+
         //
         // Shard exclusive members.
         //
@@ -116,30 +146,63 @@ namespace BitFunnel
         // this method throws.
         //
         // Implementation:
+        // DocIndex docIndex;
+        // if (m_activeSlice != nullptr && m_activeSlice->TryAllocateDocument(docIndex))
+        //   return DocumentHandleInternal(m_activeSlice, docIndex);
+        //
         // with (m_slicesLock)
-        //   DocIndex docIndex;
         //   while (m_activeSlice == nullptr || !m_activeSlice->TryAllocateDocument(docIndex))
         //   {
-        //       CreateNewActiveSlice();
+        //       TryCreateNewActiveSlice();
         //   }
         //
         //   return DocumentHandleInternal(m_activeSlice, docIndex);
+        //
+        // Only the first document of each slice takes m_slicesLock.
+        //
+        // With thread active slices, the same is done with the calling
+        // thread's active Slice instead of m_activeSlice.
         DocumentHandleInternal AllocateDocument(DocId id);
 
-        // Loads a Slice from a previously serialized state and adds it to the
-        // list of Slices. As part of deserialization, LoadSlice loads
-        // RowTable/DocTable descriptors from the stream and verifies that it is
-        // compatible with the current descriptors. Uses descriptor's
-        // IsCompatibleWith methods for verification, and if not passed, this
-        // function throws.
+        // Same as AllocateDocument(), except that it returns false, without
+        // allocating, when a new slice is required and the
+        // SliceBufferAllocator is at capacity.
+        bool TryAllocateDocument(DocId id, DocumentHandleInternal& handle);
+
+        // Detaches the active Slice of each ingestion thread and seals it
+        // with Slice::Seal(), so that it is recycled once its documents are
+        // expired rather than held until its owner fills it. A thread that
+        // allocates another document gets a new Slice. Call when ingestion
+        // threads exit or go idle. Does nothing if the Shard was not
+        // constructed with threadActiveSlices.
+        void ReleaseThreadSlices();
+
+        // Writes a snapshot of the Shard's slices to a stream. The snapshot
+        // starts with a header holding the TermTable hash and the layout of
+        // the DocTable and RowTables, followed by the raw slice buffers and
+        // the variable size blobs. Slice buffers start at offsets aligned to
+        // MemoryMappedFile::c_granularity so that LoadSnapshot() can map them
+        // in place. Fully expired slices are not written.
         //
-        // Design intent is that the serialized files act as a cache, and it is
-        // expected that the index may not be able to restore some or all slices
-        // from the cache, and the host will re-ingest the documents which were
-        // not restored.
-        //void LoadSlice(std::istream& input);
-
-        // TODO: WriteSlice here or in Slice?
+        // Documents are not allocated while the snapshot is written. Throws
+        // if some document has been allocated but not yet committed, so
+        // ingestion should be paused by the caller.
+        void WriteSnapshot(std::ostream& output) const;
+
+        // Memory-maps the snapshot at path, previously written by
+        // WriteSnapshot(), and adds its slices to this Shard without
+        // copying the slice buffers. The buffers are mapped copy-on-write,
+        // so the Shard may continue to ingest and expire documents without
+        // modifying the file. Returns handles to the active documents in the
+        // snapshot.
+        //
+        // Throws if the Shard already has slices or if the snapshot's
+        // TermTable hash, slice buffer size, or DocTable and RowTable
+        // layouts differ from this Shard's.
+        //
+        // Design intent is that the snapshots act as a cache. If a snapshot
+        // cannot be loaded, the host will re-ingest its documents.
+        std::vector<DocumentHandleInternal> LoadSnapshot(char const * path);
 
         // Remove slice buffer and its Slice from the list of slices. Throws if
         // slice buffer wasn't found in the list of active slice buffers.
@@ -148,9 +211,6 @@ namespace BitFunnel
         // copy of the vector of slices, is scheduled for recycling.
         void RecycleSlice(Slice& slice);
 
-        // Returns term table associated with this shard.
-        ITermTable const & GetTermTable() const;
-
         // Descriptor for RowTables and DocTable.
         DocTableDescriptor const & GetDocTable() const;
         RowTableDescriptor const & GetRowTable(Rank) const;
@@ -160,24 +220,17 @@ namespace BitFunnel
         RowId GetDocumentActiveRowId() const;
 
         // Allocates memory for the slice buffer. The buffer has the size of
-        // m_sliceBufferSize.
-        void* AllocateSliceBuffer();
-
-        // Allocates and loads the contents of the slice buffer from the
-        // stream. The stream has the size of the buffer embedded as the first
-        // element, and the function verifies that it matches the value stored
-        // in buffer m_sliceBufferSize.
-        //void* LoadSliceBuffer(std::istream& input);
-
-        // Writes the contents of the slice buffer to the output stream. The
-        // size of the stream is stored in m_sliceBufferSize and is written
-        // before the buffer's data for compatibility checks.
-        //void WriteSliceBuffer(void* buffer, std::ostream& output);
+        // m_sliceBufferSize. Returns nullptr if the SliceBufferAllocator is
+        // at capacity.
+        void* TryAllocateSliceBuffer();
 
         // Releases the slice buffer and returns it to the
         // ISliceBufferAllocator.
         void ReleaseSliceBuffer(void* sliceBuffer);
 
+        // Unmaps a slice buffer that was mapped by LoadSnapshot().
+        void ReleaseMappedSliceBuffer(void* sliceBuffer);
+
         // Returns the size in bytes of the used capacity in the Shard.
         size_t GetUsedCapacityInBytes() const;
 
@@ -205,14 +258,51 @@ namespace BitFunnel
         // is stored. This is the same offset for all slices in the Shard.
         static ptrdiff_t GetSlicePtrOffset();
 
+        // Maximum number of threads which may have their own active Slice
+        // in a Shard constructed with threadActiveSlices.
+        static const size_t c_maxThreadActiveSliceCount = 64;
+
     private:
-        // Tries to add a new slice. Throws if no memory in the allocator.
+        // Active Slice owned by the ingestion thread in one thread slot.
+        // m_isReading is set while the owner uses m_slice without holding
+        // m_slicesLock. It plays the role of m_activeSliceReaders, but it is
+        // only written by the owner. The padding keeps the entries of
+        // different threads on different cache lines.
+        struct ThreadActiveSlice
+        {
+            ThreadActiveSlice();
+
+            std::atomic<Slice*> m_slice;
+            std::atomic<bool> m_isReading;
+            char m_padding[c_bytesPerCacheLine];
+        };
+
+        // Implements TryAllocateDocument() for a thread which owns
+        // activeSlice.
+        bool TryAllocateThreadDocument(ThreadActiveSlice& activeSlice,
+                                       DocId id,
+                                       DocumentHandleInternal& handle);
+
+        // Creates a Slice and adds its buffer to the list of slice buffers.
+        // Returns nullptr if no memory in the allocator. Must be called with
+        // m_slicesLock held.
+        Slice* TryCreateNewSlice(bool isThreadOwned);
+
+        // Tries to add a new slice. Returns false if no memory in the
+        // allocator.
         // Implementation:
         //   std::vector<void*>* newSlices = new std::vector<void*>(m_sliceBuffers);
-        //   Slice* newSlice = new Slice(*this);
-        //   newSlices.push_back(newSlice->GetBuffer());
-        //   swap newSlices and m_sliceBuffers, schedule newSlices for recycling.
-        void CreateNewActiveSlice();
+        //   Slice* newSlice = TryCreateNewSlice(false);
+        //   m_activeSlice = newSlice;
+        bool TryCreateNewActiveSlice();
+
+        // Waits until no thread can hold a pointer to a Slice that was
+        // active before this call. Must be called with m_slicesLock held.
+        void WaitForActiveSliceReaders();
+
+        // Waits until no thread is allocating without m_slicesLock. Must be
+        // called with m_slicesLock held and m_isAllocationPaused set.
+        void WaitForLockFreeAllocators() const;
 
         // Constructor parameters.
 
@@ -223,9 +313,15 @@ namespace BitFunnel
         // TermTable for this shard.
         ITermTable const & m_termTable;
 
+        // Process-unique number assigned at construction.
+        const uint64_t m_generation;
+
         // Allocator that provides blocks of memory for Slice buffers.
         ISliceBufferAllocator& m_sliceBufferAllocator;
 
+        // NUMA node on which the allocator places the Slice buffers.
+        const size_t m_numaNode;
+
         // Row which is used to mark documents as soft deleted.  The value of 0
         // means the document in this column is soft deleted and excluded from
         // matching. Typically this is a private rank 0 row. During the
@@ -234,16 +330,37 @@ namespace BitFunnel
         const RowId m_documentActiveRowId;
 
 
-        // Lock protecting operations on the list of slices. Protects the
-        // AllocateDocument method.
+        // Lock protecting operations on the list of slices. AllocateDocument
+        // only takes it when the active slice is full.
         // This lock is used in const member functions, as a result, it is
         // declared as mutable.
         mutable std::mutex m_slicesLock;
 
         // Pointer to the current Slice where documents are being ingested to.
         // Initially set to nullptr. First call to AllocateDocument() will
-        // allocate a new Slice via CreateNewActiveSlice().
-        Slice* m_activeSlice;
+        // allocate a new Slice via TryCreateNewActiveSlice(). Only modified
+        // with m_slicesLock held, but read without it by AllocateDocument().
+        std::atomic<Slice*> m_activeSlice;
+
+        // Number of threads in AllocateDocument() that may be using
+        // m_activeSlice without holding m_slicesLock. Readers register in
+        // the counter selected by m_activeSliceEpoch, and register again if
+        // the epoch changed while they did. Before a Slice is recycled,
+        // WaitForActiveSliceReaders() advances the epoch and waits for the
+        // readers of the previous epoch to leave, so that none of them can
+        // still hold a pointer to the Slice.
+        std::atomic<size_t> m_activeSliceEpoch;
+        std::atomic<size_t> m_activeSliceReaders[2];
+
+        // Set by WriteSnapshot() while it holds m_slicesLock. Threads that
+        // see it after registering as readers take m_slicesLock instead of
+        // allocating from their active Slice.
+        mutable std::atomic<bool> m_isAllocationPaused;
+
+        // Active Slices indexed by thread slot, or nullptr if the Shard was
+        // not constructed with threadActiveSlices. Modified only with
+        // m_slicesLock held.
+        std::unique_ptr<ThreadActiveSlice[]> m_threadActiveSlices;
 
         // Vector of pointers to slice buffers.
         //
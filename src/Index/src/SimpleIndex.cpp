@@ -53,7 +53,8 @@ namespace BitFunnel
 
     SimpleIndex::SimpleIndex(IFileSystem& fileSystem)
         : m_fileSystem(fileSystem),
-          m_isStarted(false)
+          m_isStarted(false),
+          m_threadActiveSlices(false)
     {
     }
 
@@ -148,6 +149,13 @@ namespace BitFunnel
     }
 
 
+    void SimpleIndex::SetThreadActiveSlices(bool enabled)
+    {
+        EnsureStarted(false);
+        m_threadActiveSlices = enabled;
+    }
+
+
     //
     // Configuration methods.
     //
@@ -343,7 +351,8 @@ namespace BitFunnel
                                                *m_recycler,
                                                *m_termTables,
                                                *m_shardDefinition,
-                                               *m_sliceAllocator);
+                                               *m_sliceAllocator,
+                                               m_threadActiveSlices);
 
         m_isStarted = true;
     }
@@ -353,6 +362,13 @@ namespace BitFunnel
     {
         EnsureStarted(true);
 
+        // Releasing the slices of ingestion threads may schedule slices
+        // for recycling, so the ingestor shuts down first.
+        if (m_ingestor != nullptr)
+        {
+            m_ingestor->Shutdown();
+        }
+
         if (m_recycler != nullptr)
         {
             m_recycler->Shutdown();
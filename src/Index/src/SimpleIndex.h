@@ -71,6 +71,7 @@ namespace BitFunnel
             std::unique_ptr<ISliceBufferAllocator> sliceAllocator) override;
         virtual void SetTermTableCollection(
             std::unique_ptr<ITermTableCollection> termTables) override;
+        virtual void SetThreadActiveSlices(bool enabled) override;
 
 
         virtual void ConfigureForStatistics(char const * directory,
@@ -109,6 +110,8 @@ namespace BitFunnel
 
         bool m_isStarted;
 
+        bool m_threadActiveSlices;
+
         //
         // Members initialized by StartIndex().
         //
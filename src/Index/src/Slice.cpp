@@ -28,16 +28,20 @@
 
 namespace BitFunnel
 {
-    Slice::Slice(Shard& shard)
+    Slice::Slice(Shard& shard, void* sliceBuffer, bool isThreadOwned)
         : m_shard(shard),
           m_temporaryNextDocIndex(0U),
           m_capacity(shard.GetSliceCapacity()),
           m_refCount(1),
-          m_buffer(shard.AllocateSliceBuffer()),
-          m_unallocatedCount(shard.GetSliceCapacity()),
-          m_commitPendingCount(0),
-          m_expiredCount(0)
+          m_buffer(sliceBuffer),
+          m_allocationState(shard.GetSliceCapacity() * c_unallocatedUnit),
+          m_expiredCount(0),
+          m_isMapped(false),
+          m_isThreadOwned(isThreadOwned)
     {
+        LogAssertB(m_capacity < c_unallocatedUnit,
+                   "Slice capacity does not fit in m_allocationState.");
+
         Initialize();
 
         // Perform start up initialization of the DocTable and RowTables after
@@ -50,12 +54,45 @@ namespace BitFunnel
     }
 
 
+    Slice::Slice(Shard& shard,
+                 void* mappedBuffer,
+                 DocIndex allocatedCount,
+                 size_t expiredCount)
+        : m_shard(shard),
+          m_temporaryNextDocIndex(0U),
+          m_capacity(shard.GetSliceCapacity()),
+          m_refCount(1),
+          m_buffer(mappedBuffer),
+          m_allocationState((shard.GetSliceCapacity() - allocatedCount)
+                            * c_unallocatedUnit),
+          m_expiredCount(expiredCount),
+          m_isMapped(true),
+          m_isThreadOwned(false)
+    {
+        LogAssertB(allocatedCount <= m_capacity,
+                   "Mapped slice allocated more documents than its capacity.");
+        LogAssertB(expiredCount <= allocatedCount,
+                   "Mapped slice expired more documents than allocated.");
+
+        // The DocTable and RowTables were loaded with the buffer. Only the
+        // pointer to the Slice is stale.
+        Initialize();
+    }
+
+
     Slice::~Slice()
     {
         try
         {
             GetDocTable().Cleanup(m_buffer);
-            m_shard.ReleaseSliceBuffer(m_buffer);
+            if (m_isMapped)
+            {
+                m_shard.ReleaseMappedSliceBuffer(m_buffer);
+            }
+            else
+            {
+                m_shard.ReleaseSliceBuffer(m_buffer);
+            }
         }
         catch (...)
         {
@@ -64,6 +101,12 @@ namespace BitFunnel
     }
 
 
+    bool Slice::IsThreadOwned() const
+    {
+        return m_isThreadOwned;
+    }
+
+
     Shard& Slice::GetShard() const
     {
         return m_shard;
@@ -72,14 +115,14 @@ namespace BitFunnel
 
     bool Slice::CommitDocument()
     {
-        std::lock_guard<std::mutex> lock(m_docIndexLock);
-
-        LogAssertB(m_commitPendingCount > 0,
-                   "CommitDocument with m_commitPendingCount == 0");
+        const uint64_t state = m_allocationState.fetch_sub(c_commitPendingUnit);
 
-        --m_commitPendingCount;
+        LogAssertB(GetCommitPendingCount(state) > 0,
+                   "CommitDocument with commit pending count == 0");
 
-        return (m_unallocatedCount + m_commitPendingCount) == 0;
+        // This was the last document if the slice had no unallocated
+        // DocIndex'es and this was the only commit pending.
+        return state == c_commitPendingUnit;
     }
 
 
@@ -96,17 +139,50 @@ namespace BitFunnel
 
     bool Slice::ExpireDocument()
     {
-        std::lock_guard<std::mutex> lock(m_docIndexLock);
+        // Cannot expire more than what was committed. Seal() counts the
+        // DocIndex'es it takes as committed before it counts them as
+        // expired, so the committed count is read after incrementing
+        // m_expiredCount.
+        const size_t expiredCount = ++m_expiredCount;
 
-        // Cannot expire more than what was committed.
+        const uint64_t state = m_allocationState;
         const DocIndex committedCount =
-            m_capacity - m_unallocatedCount - m_commitPendingCount;
-        LogAssertB(m_expiredCount < committedCount,
+            m_capacity - GetUnallocatedCount(state) - GetCommitPendingCount(state);
+        LogAssertB(expiredCount <= committedCount,
                    "Slice expired more documents than committed.");
 
-        m_expiredCount++;
+        return expiredCount == m_capacity;
+    }
 
-        return m_expiredCount == m_capacity;
+
+    bool Slice::Seal()
+    {
+        uint64_t state = m_allocationState;
+        while (!m_allocationState.compare_exchange_weak(
+                   state,
+                   state & c_commitPendingMask))
+        {
+        }
+
+        const size_t unallocatedCount = GetUnallocatedCount(state);
+        if (unallocatedCount == 0)
+        {
+            return false;
+        }
+
+        return (m_expiredCount += unallocatedCount) == m_capacity;
+    }
+
+
+    void Slice::GetDocumentCounts(size_t& allocatedCount,
+                                  size_t& commitPendingCount,
+                                  size_t& expiredCount) const
+    {
+        const uint64_t state = m_allocationState;
+
+        allocatedCount = m_capacity - GetUnallocatedCount(state);
+        commitPendingCount = GetCommitPendingCount(state);
+        expiredCount = m_expiredCount;
     }
 
 
@@ -168,17 +244,34 @@ namespace BitFunnel
 
     bool Slice::TryAllocateDocument(size_t& index)
     {
-        std::lock_guard<std::mutex> lock(m_docIndexLock);
-
-        if (m_unallocatedCount == 0)
+        uint64_t state = m_allocationState;
+        do
         {
-            return false;
+            if (GetUnallocatedCount(state) == 0)
+            {
+                return false;
+            }
         }
+        while (!m_allocationState.compare_exchange_weak(
+                   state,
+                   state - c_unallocatedUnit + c_commitPendingUnit));
 
-        index = m_capacity - m_unallocatedCount;
-        m_unallocatedCount--;
-        m_commitPendingCount++;
+        index = m_capacity - GetUnallocatedCount(state);
 
         return true;
     }
+
+
+    /* static */
+    size_t Slice::GetUnallocatedCount(uint64_t state)
+    {
+        return static_cast<size_t>(state >> c_unallocatedShift);
+    }
+
+
+    /* static */
+    size_t Slice::GetCommitPendingCount(uint64_t state)
+    {
+        return static_cast<size_t>(state & c_commitPendingMask);
+    }
 }
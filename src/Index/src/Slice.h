@@ -25,7 +25,6 @@
 #include <atomic>
 #include <stddef.h>
 #include <stdint.h>
-#include <mutex>
 
 #include "BitFunnel/NonCopyable.h"      // Inherits from NonCopyable.
 #include "BitFunnel/BitFunnelTypes.h"   // for DocIndex, Rank.
@@ -126,17 +125,24 @@ namespace BitFunnel
         // is dictated by the DocTable alignment.
         //static const size_t c_bufferByteAlignment = c_docTableByteAlignment;
 
-        // Creates a slice that belogs to a given Shard.
-        // Allocates a slice buffer using the allocator from the Shard.
-        // Stores pointer to the buffer in m_sliceBuffer.
-        Slice(Shard& shard);
-
-        // Creates a slice from its serialized representation from an input
-        // stream. Verifies that the Slice is compatible with the one in the
-        // stream by comparing Shard's RowTableDescriptor and
-        // DocTableDescriptor with copies read from the stream. Throws if the
-        // descriptors are not compatible.
-        //Slice(Shard& shard, std::istream& input);
+        // Creates a slice that belogs to a given Shard over a slice buffer
+        // allocated from the Shard's ISliceBufferAllocator. The Slice takes
+        // ownership of the buffer and returns it to the allocator when it is
+        // destroyed. If isThreadOwned is true, documents are allocated from
+        // the Slice and ingested by a single thread at a time, so that its
+        // postings may be written without interlocked operations.
+        Slice(Shard& shard, void* sliceBuffer, bool isThreadOwned);
+
+        // Creates a slice over a buffer that was mapped from an index
+        // snapshot by Shard::LoadSnapshot(). The buffer already holds the
+        // DocTable and RowTables, so they are not initialized. The first
+        // allocatedCount documents are considered committed, and
+        // expiredCount of them expired. The buffer is returned with
+        // Shard::ReleaseMappedSliceBuffer() when the Slice is destroyed.
+        Slice(Shard& shard,
+              void* mappedBuffer,
+              DocIndex allocatedCount,
+              size_t expiredCount);
 
         // Releases all heap-allocated data blobs, returns the slice buffer
         // back to its allocator and destroys the Slice.
@@ -147,6 +153,10 @@ namespace BitFunnel
         // parent Shard.
         void* GetSliceBuffer() const;
 
+        // Returns true if documents in this Slice are ingested by a single
+        // thread at a time. See Shard::c_maxThreadActiveSliceCount.
+        bool IsThreadOwned() const;
+
         // Returns the shard which owns this slice.
         // DESIGN NOTE: Shard is required to get access to shared objects at either
         // a Shard level or Index level (e.g. Recycler, backup system etc.)
@@ -156,10 +166,13 @@ namespace BitFunnel
         DocTableDescriptor const & GetDocTable() const;
         RowTableDescriptor const & GetRowTable(Rank rank) const;
 
-        // Serializes the slice to a given output stream. Only slices that are
-        // full (all columns are allocated and committed) may be serialized.
-        // Thread safe with respect to concurrent calls to const methods.
-        //void Write(std::ostream& output) const;
+        // Returns the number of allocated, commit pending, and expired
+        // documents in the slice as a consistent snapshot. Used when writing
+        // index snapshots.
+        // Thread safe.
+        void GetDocumentCounts(size_t& allocatedCount,
+                               size_t& commitPendingCount,
+                               size_t& expiredCount) const;
 
         //
         // Document allocation methods.
@@ -168,14 +181,15 @@ namespace BitFunnel
         // Attempts to allocate a DocIndex. If Slice is not full, this method
         // returns true with index set to the allocated DocIndex. Otherwise
         // this method returns false.
-        // Thread safe.
+        // Thread safe and lock free.
         //
         // Implementation:
-        // with (m_docIndexLock)
-        //   if (m_unallocated == 0) return false;
-        //   m_unallocatedCount--
-        //   m_commitPendingCount++
-        //   return true
+        // do
+        //   state = m_allocationState
+        //   if (unallocated(state) == 0) return false;
+        // while (!compare_exchange(m_allocationState,
+        //                          state - c_unallocatedUnit + c_commitPendingUnit))
+        // return true
         bool TryAllocateDocument(DocIndex& index);
 
         // Makes document visible to the matcher. May only be called once per
@@ -185,10 +199,9 @@ namespace BitFunnel
         // Thread safe.
         //
         // Implementation:
-        // with (m_docIndexLock)
-        //   LogAssert(m_commitPendingCount > 0)
-        //   --m_commitPendingCount;
-        //   return (m_unallocated + m_commitPending) == 0;
+        //   state = fetch_sub(m_allocationState, c_commitPendingUnit)
+        //   LogAssert(commitPending(state) > 0)
+        //   return state == c_commitPendingUnit;
         bool CommitDocument();
 
         // Hides document from future matching operations. May only be called
@@ -200,11 +213,20 @@ namespace BitFunnel
         // Thread safe.
         //
         // Implementation:
-        // with (m_docIndexLock)
         //   m_expiredCount++;
         //   return m_expiredCount == m_capacity.
         bool ExpireDocument();
 
+        // Stops allocation from the Slice by counting its unallocated
+        // DocIndex'es as expired, so that the Slice is recycled once the
+        // documents already allocated from it are expired. Returns true if
+        // the entire capacity of the Slice is now expired, in which case the
+        // caller is responsible of recycling the Slice, as with
+        // ExpireDocument(). Returns false otherwise.
+        //
+        // Thread safe.
+        bool Seal();
+
         // Returns true if the Slice is fully expired, meaning that all of its
         // documents are expired. In this case the Slice can be removed from
         // the index.
@@ -238,6 +260,18 @@ namespace BitFunnel
         // Returns a reference to the Slice pointer which is placed inside a sliceBuffer.
         static Slice*& GetSlicePointer(void* sliceBuffer, ptrdiff_t slicePtrOffset);
 
+        // Accessors for the fields packed into m_allocationState.
+        static size_t GetUnallocatedCount(uint64_t state);
+        static size_t GetCommitPendingCount(uint64_t state);
+
+        // Units of the fields packed into m_allocationState. The number of
+        // unallocated DocIndex'es occupies the high 32 bits and the number
+        // of commit pending DocIndex'es the low 32 bits.
+        static const unsigned c_unallocatedShift = 32;
+        static const uint64_t c_commitPendingUnit = 1ull;
+        static const uint64_t c_unallocatedUnit = 1ull << c_unallocatedShift;
+        static const uint64_t c_commitPendingMask = c_unallocatedUnit - 1;
+
         // Shard which owns this slice.
         Shard& m_shard;
 
@@ -246,14 +280,6 @@ namespace BitFunnel
         // Capacity of the slice.
         const size_t m_capacity;
 
-        // Lock protecting operations on DocIndex members below to guarantee
-        // atomic state changes that depend on these values.
-        // There isn't a straightforward way to use std::atomic because
-        // ExpireDocument uses `m_unallocatedCount - m_commitPending`.
-        // DESIGN NOTE: made mutable in order to be able to acquire a lock from
-        // const methods.
-        mutable std::mutex m_docIndexLock;
-
         // Reference count of the Slice. Initially Slice is created with one
         // reference. Slice taken for a backup increases its reference count
         // by one for the duration of the backup writing and then is decreased
@@ -270,17 +296,30 @@ namespace BitFunnel
         // Slice. See the class comment for more details on buffer layout.
         void* const m_buffer;
 
-        // The number of unallocated DocIndex'es in the slice. When created,
-        // Slice starts with the value of m_capacity in this field and gradually
-        // goes down as documents are being ingested.
-        size_t m_unallocatedCount;
-
-        // The number of DocIndex'es that have been allocated but not yet
-        // committed by a call to CommitDocument().
-        size_t m_commitPendingCount;
+        // The number of unallocated DocIndex'es in the slice, and the number
+        // of DocIndex'es that have been allocated but not yet committed by a
+        // call to CommitDocument(). When created, Slice starts with
+        // m_capacity unallocated DocIndex'es, which gradually go down as
+        // documents are being ingested.
+        //
+        // DESIGN NOTE: The two counts are packed into a single word so that
+        // allocation and commit are single atomic operations, and so that
+        // ExpireDocument() and GetDocumentCounts() see consistent values
+        // without taking a lock. Allocation uses compare-exchange rather
+        // than fetch-add, since a fetch-add on a full slice would have to be
+        // undone, exposing a transient commit pending count to other
+        // threads.
+        std::atomic<uint64_t> m_allocationState;
 
         // The number of DocIndex'es that have been expired from the slice.
         // When this value reaches m_capacity, the slice can be recycled.
         std::atomic<size_t> m_expiredCount;
+
+        // True if m_buffer was mapped from an index snapshot rather than
+        // allocated from the Shard's ISliceBufferAllocator.
+        const bool m_isMapped;
+
+        // True if the Slice is the active Slice of a single ingestion thread.
+        const bool m_isThreadOwned;
     };
 }
@@ -22,6 +22,7 @@
 
 
 #include <stdint.h>
+#include <utility>      // std::move()
 
 #include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Utilities/Factories.h"
@@ -39,6 +40,19 @@ namespace BitFunnel
     }
 
 
+    std::unique_ptr<ISliceBufferAllocator>
+        Factories::CreateGrowableSliceBufferAllocator(size_t blockSize,
+                                                      size_t segmentBlockCount,
+                                                      size_t maxBlockCount)
+    {
+        return std::unique_ptr<ISliceBufferAllocator>(
+            new SliceBufferAllocator(
+                Factories::CreateSegmentedBlockAllocator(blockSize,
+                                                         segmentBlockCount,
+                                                         maxBlockCount)));
+    }
+
+
     SliceBufferAllocator::SliceBufferAllocator(size_t blockSize,
                                                size_t blockCount)
         : m_blockAllocator(Factories::CreateBlockAllocator(blockSize,
@@ -47,7 +61,14 @@ namespace BitFunnel
     }
 
 
-    void* SliceBufferAllocator::Allocate(size_t byteSize)
+    SliceBufferAllocator::SliceBufferAllocator(
+        std::unique_ptr<IBlockAllocator> blockAllocator)
+        : m_blockAllocator(std::move(blockAllocator))
+    {
+    }
+
+
+    void* SliceBufferAllocator::Allocate(size_t byteSize, size_t /*numaNode*/)
     {
         // Other implementations of IBlockAllocator may not have this
         // restriction.
@@ -58,6 +79,15 @@ namespace BitFunnel
     }
 
 
+    void* SliceBufferAllocator::TryAllocate(size_t byteSize, size_t /*numaNode*/)
+    {
+        LogAssertB(m_blockAllocator->GetBlockSize() == byteSize,
+                   "TryAllocate byteSize != block size.");
+
+        return m_blockAllocator->TryAllocateBlock();
+    }
+
+
     void SliceBufferAllocator::Release(void* buffer)
     {
         m_blockAllocator->ReleaseBlock(reinterpret_cast<uint64_t*>(buffer));
@@ -68,4 +98,28 @@ namespace BitFunnel
     {
         return m_blockAllocator->GetBlockSize();
     }
+
+
+    size_t SliceBufferAllocator::GetAllocatedBufferCount() const
+    {
+        return m_blockAllocator->GetAllocatedBlockCount();
+    }
+
+
+    size_t SliceBufferAllocator::GetHighWaterBufferCount() const
+    {
+        return m_blockAllocator->GetHighWaterBlockCount();
+    }
+
+
+    size_t SliceBufferAllocator::GetCommittedBufferCount() const
+    {
+        return m_blockAllocator->GetCommittedBlockCount();
+    }
+
+
+    size_t SliceBufferAllocator::GetNumaNodeCount() const
+    {
+        return 1;
+    }
 }
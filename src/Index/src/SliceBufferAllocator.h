@@ -52,12 +52,21 @@ namespace BitFunnel
         // hood to allocate and release blocks of the same byte size.
         SliceBufferAllocator(size_t blockSize, size_t blockCount);
 
+        // Creates a SliceBufferAllocator which hands out the blocks of the
+        // specified IBlockAllocator.
+        SliceBufferAllocator(std::unique_ptr<IBlockAllocator> blockAllocator);
+
         //
         // ISliceBufferAllocator API.
         //
-        virtual void* Allocate(size_t byteSize) override;
+        virtual void* Allocate(size_t byteSize, size_t numaNode) override;
+        virtual void* TryAllocate(size_t byteSize, size_t numaNode) override;
         virtual void Release(void* buffer) override;
         virtual size_t GetSliceBufferSize() const override;
+        virtual size_t GetAllocatedBufferCount() const override;
+        virtual size_t GetHighWaterBufferCount() const override;
+        virtual size_t GetCommittedBufferCount() const override;
+        virtual size_t GetNumaNodeCount() const override;
 
     private:
 
@@ -296,7 +296,8 @@ namespace BitFunnel
 
     double Term::FrequencyAtRank(double frequency, Rank rank)
     {
-        return 1.0 - pow(1.0 - frequency, rank + 1.0);
+        // A bit at rank r is the OR of 2^r bits at rank 0.
+        return 1.0 - pow(1.0 - frequency, static_cast<double>(1ull << rank));
     }
 
 
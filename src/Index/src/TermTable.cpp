@@ -21,6 +21,7 @@
 // THE SOFTWARE.
 
 
+#include <algorithm>    // std::sort()
 #include <math.h>
 #include <sstream>
 
@@ -28,6 +29,7 @@
 #include "BitFunnel/Exceptions.h"
 #include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Utilities/StreamUtilities.h"
+#include "MurmurHash2.h"
 #include "TermTable.h"
 
 
@@ -135,6 +137,70 @@ namespace BitFunnel
 
     static_assert(std::is_trivially_copyable<std::array<std::array<PackedRowIdSequence, 10>, 10>>::value, "foo");
 
+    // Writes the fields of a PackedRowIdSequence for GetHash(). The binary
+    // image used by Write() is not suitable for hashing because the unused
+    // bits of its bit fields are undefined.
+    static void WriteRowsForHash(std::ostream& output, PackedRowIdSequence rows)
+    {
+        StreamUtilities::WriteField<RowIndex>(output, rows.GetStart());
+        StreamUtilities::WriteField<RowIndex>(output, rows.GetEnd());
+        StreamUtilities::WriteField<uint32_t>(output,
+                                              static_cast<uint32_t>(rows.GetType()));
+    }
+
+
+    uint64_t TermTable::GetHash() const
+    {
+        // m_termHashToRows is unordered, so its entries are hashed in order
+        // of their term hashes.
+        std::vector<Term::Hash> hashes;
+        hashes.reserve(m_termHashToRows.size());
+        for (auto const & entry : m_termHashToRows)
+        {
+            hashes.push_back(entry.first);
+        }
+        std::sort(hashes.begin(), hashes.end());
+
+        std::stringstream stream;
+        for (auto hash : hashes)
+        {
+            StreamUtilities::WriteField<Term::Hash>(stream, hash);
+            WriteRowsForHash(stream, m_termHashToRows.find(hash)->second);
+        }
+
+        for (auto inUse : m_ranksInUse)
+        {
+            StreamUtilities::WriteField<uint8_t>(stream, inUse ? 1 : 0);
+        }
+        StreamUtilities::WriteField<Rank>(stream, m_maxRankInUse);
+
+        for (auto const & recipes : m_adhocRows)
+        {
+            for (auto rows : recipes)
+            {
+                WriteRowsForHash(stream, rows);
+            }
+        }
+
+        for (auto row : m_rowIds)
+        {
+            StreamUtilities::WriteField<Rank>(stream, row.GetRank());
+            StreamUtilities::WriteField<RowIndex>(stream, row.GetIndex());
+        }
+
+        StreamUtilities::WriteVector(stream, m_explicitRowCounts);
+        StreamUtilities::WriteVector(stream, m_adhocRowCounts);
+        StreamUtilities::WriteVector(stream, m_sharedRowCounts);
+        StreamUtilities::WriteField<RowIndex>(stream, m_factRowCount);
+
+        const unsigned c_murmurHashSeedForTermTable = 123456789;
+        const std::string bytes = stream.str();
+        return MurmurHash64A(bytes.data(),
+                             bytes.size(),
+                             c_murmurHashSeedForTermTable);
+    }
+
+
     void TermTable::OpenTerm()
     {
         EnsureSealed(false);
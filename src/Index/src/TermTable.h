@@ -45,6 +45,9 @@ namespace BitFunnel
         // Writes the contents of the ITermTable to a stream.
         virtual void Write(std::ostream& output) const override;
 
+        // Returns a hash of the contents of the ITermTable.
+        virtual uint64_t GetHash() const override;
+
         // Instructs the TermTable to start recording RowIds added by AddRowId.
         virtual void OpenTerm() override;
 
@@ -26,6 +26,7 @@
 
 #include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Term.h"
+#include "LoggerInterfaces/Check.h"
 #include "TermTreatments.h"
 
 
@@ -62,6 +63,17 @@ namespace BitFunnel
     }
 
 
+    std::unique_ptr<ITermTreatment>
+        Factories::CreateTreatmentPrivateSharedRank0AndN(double density,
+                                                         double snr,
+                                                         Rank rank)
+    {
+        return
+            std::unique_ptr<ITermTreatment>(
+                new TreatmentPrivateSharedRank0AndN(density, snr, rank));
+    }
+
+
 
     //*************************************************************************
     //
@@ -148,14 +160,21 @@ namespace BitFunnel
 
     //*************************************************************************
     //
-    // TreatmentPrivateSharedRank0And3
+    // TreatmentPrivateSharedRank0AndN
     //
-    // Terms get one or more rank 0 and rank 3 rows that could be private or
+    // Terms get one or more rank 0 and rank N rows that could be private or
     // shared, depending on term frequency.
     //
     //*************************************************************************
-    TreatmentPrivateSharedRank0And3::TreatmentPrivateSharedRank0And3(double density, double snr)
+    TreatmentPrivateSharedRank0AndN::TreatmentPrivateSharedRank0AndN(double density,
+                                                                     double snr,
+                                                                     Rank rank)
     {
+        CHECK_GT(rank, 0u)
+            << "Rank N must be above rank 0.";
+        CHECK_LE(rank, c_maxRankValue)
+            << "Rank " << rank << " out of range.";
+
         // Fill up vector of RowConfigurations. GetTreatment() will use the
         // IdfSum() value of the Term as an index into this vector.
         for (Term::IdfX10 idf = 0; idf <= Term::c_maxIdfX10Value; ++idf)
@@ -185,7 +204,6 @@ namespace BitFunnel
 #endif
                 if (k > 1)
                 {
-                    Rank rank = 3;
                     double frequencyAtRank = Term::FrequencyAtRank(frequency, rank);
                     if (frequencyAtRank >= density)
                     {
@@ -207,7 +225,7 @@ namespace BitFunnel
     }
 
 
-    RowConfiguration TreatmentPrivateSharedRank0And3::GetTreatment(Term term) const
+    RowConfiguration TreatmentPrivateSharedRank0AndN::GetTreatment(Term term) const
     {
         // DESIGN NOTE: we can't c_maxIdfX10Value directly to min because min
         // takes a reference and the compiler has already turned it into a
@@ -216,4 +234,15 @@ namespace BitFunnel
         Term::IdfX10 idf = std::min(term.GetIdfSum(), local);
         return m_configurations[idf];
     }
+
+
+    //*************************************************************************
+    //
+    // TreatmentPrivateSharedRank0And3
+    //
+    //*************************************************************************
+    TreatmentPrivateSharedRank0And3::TreatmentPrivateSharedRank0And3(double density, double snr)
+      : TreatmentPrivateSharedRank0AndN(density, snr, 3)
+    {
+    }
 }
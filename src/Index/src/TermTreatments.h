@@ -24,6 +24,7 @@
 
 #include <vector>                           // std::vector member.
 
+#include "BitFunnel/BitFunnelTypes.h"       // Rank parameter.
 #include "BitFunnel/Index/ITermTreatment.h" // Base class.
 
 
@@ -81,20 +82,21 @@ namespace BitFunnel
 
     //*************************************************************************
     //
-    // TreatmentPrivateSharedRank0And3
+    // TreatmentPrivateSharedRank0AndN
     //
     // Term treatment based on target bit density, signal to noise ratio and
     // the term's IdfSum() value.
     //
-    // Treatments may now include rank 0 and rank 3 rows. Common terms will
-    // get a private row, while rare terms will get a combination of rank of
-    // private and shared rows from ranks 0 and 3.
+    // Treatments may include rank 0 rows and rows at one higher rank, N.
+    // Common terms will get a private row, while rare terms will get a
+    // rank 0 row and a combination of private and shared rows at rank N.
+    // A rank N row lets the matcher skip 2^N rank 0 quadwords at a time.
     //
     //*************************************************************************
-    class TreatmentPrivateSharedRank0And3 : public ITermTreatment
+    class TreatmentPrivateSharedRank0AndN : public ITermTreatment
     {
     public:
-        TreatmentPrivateSharedRank0And3(double density, double snr);
+        TreatmentPrivateSharedRank0AndN(double density, double snr, Rank rank);
 
         //
         // ITermTreatment methods.
@@ -105,4 +107,18 @@ namespace BitFunnel
     private:
         std::vector<RowConfiguration> m_configurations;
     };
+
+
+    //*************************************************************************
+    //
+    // TreatmentPrivateSharedRank0And3
+    //
+    // TreatmentPrivateSharedRank0AndN with rank 3 rows.
+    //
+    //*************************************************************************
+    class TreatmentPrivateSharedRank0And3 : public TreatmentPrivateSharedRank0AndN
+    {
+    public:
+        TreatmentPrivateSharedRank0And3(double density, double snr);
+    };
 }
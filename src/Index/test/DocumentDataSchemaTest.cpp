@@ -67,5 +67,21 @@ namespace BitFunnel
             /* const VariableSizeBlobId variableBlob1 = */ schema.RegisterVariableSizeBlob();
             EXPECT_EQ(schema.GetVariableSizeBlobCount(), 2u);
         }
+
+
+        TEST(DocumentDataSchema, PostingBlob)
+        {
+            DocumentDataSchema schema;
+            EXPECT_FALSE(schema.HasPostingBlob());
+
+            schema.RegisterVariableSizeBlob();
+            const VariableSizeBlobId postingBlob = schema.RegisterPostingBlob();
+
+            // The posting blob is an ordinary variable size blob.
+            EXPECT_EQ(postingBlob, 1u);
+            EXPECT_EQ(schema.GetVariableSizeBlobCount(), 2u);
+            EXPECT_TRUE(schema.HasPostingBlob());
+            EXPECT_EQ(schema.GetPostingBlob(), postingBlob);
+        }
     }
 }
@@ -20,8 +20,10 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <iostream>
 #include <limits>
 #include <memory>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 
@@ -30,12 +32,19 @@
 #include "BitFunnel/BitFunnelTypes.h"
 #include "BitFunnel/Configuration/IFileSystem.h"
 #include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/IDocument.h"
+#include "BitFunnel/Index/IDocumentDataSchema.h"
 #include "BitFunnel/Index/IIngestor.h"
 #include "BitFunnel/Index/IShard.h"
 #include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/ISliceBufferAllocator.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/ITermTableCollection.h"
 #include "BitFunnel/Index/RowIdSequence.h"
 #include "BitFunnel/Mocks/Factories.h"
 #include "BitFunnel/Term.h"
+#include "BitFunnel/Utilities/Stopwatch.h"
 #include "DocumentFrequencyTable.h"
 #include "Primes.h"
 
@@ -255,4 +264,135 @@ namespace BitFunnel
         EXPECT_EQ(docFreqHistogram[21], 1u);
         EXPECT_EQ(docFreqHistogram[31], 1u);
     }
+
+
+    // Verify that TryAdd() refuses documents, without modifying the index,
+    // once the slice buffer allocator is at capacity.
+    TEST(Ingestor, TryAddBackpressure)
+    {
+        static const DocId c_maxDocId = 1000;
+        static const size_t c_maxSliceCount = 2;
+
+        auto fileSystem = Factories::CreateFileSystem();
+
+        auto termTables = Factories::CreateTermTableCollection();
+        termTables->AddTermTable(
+            Factories::CreatePrimeFactorsTermTable(c_maxDocId, c_streamId));
+
+        auto index = Factories::CreateSimpleIndex(*fileSystem);
+        index->SetTermTableCollection(std::move(termTables));
+        index->SetSliceBufferAllocator(
+            Factories::CreateGrowableSliceBufferAllocator(20000,
+                                                          1,
+                                                          c_maxSliceCount));
+        index->ConfigureAsMock(1, false);
+        index->StartIndex();
+
+        auto & ingestor = index->GetIngestor();
+        const DocIndex sliceCapacity = ingestor.GetShard(0).GetSliceCapacity();
+        ASSERT_LT(sliceCapacity * c_maxSliceCount, c_maxDocId);
+
+        DocId id = 0;
+        for (;; ++id)
+        {
+            auto document =
+                Factories::CreatePrimeFactorsDocument(index->GetConfiguration(),
+                                                      id,
+                                                      c_maxDocId,
+                                                      c_streamId);
+            if (!ingestor.TryAdd(id, *document))
+            {
+                EXPECT_ANY_THROW(ingestor.Add(id, *document));
+                break;
+            }
+        }
+
+        EXPECT_EQ(sliceCapacity * c_maxSliceCount, id);
+        EXPECT_FALSE(ingestor.Contains(id));
+        EXPECT_TRUE(ingestor.Contains(id - 1));
+        EXPECT_EQ(c_maxSliceCount, ingestor.GetShard(0).GetSliceBuffers().size());
+    }
+
+
+    // Reports ingestion throughput into a single shard as a function of the
+    // number of ingestion threads, with and without thread active slices.
+    // This test is disabled by default. Run it
+    // with
+    //   IndexTest --gtest_also_run_disabled_tests
+    //             --gtest_filter=*IngestionScalingBenchmark*
+    TEST(Ingestor, DISABLED_IngestionScalingBenchmark)
+    {
+        static const DocId c_maxPrime = 9999;
+        static const DocId c_documentCount = 65536;
+        static const size_t c_termsPerDocument = 16;
+        static const size_t c_maxThreadCount = 64;
+
+        for (int threadActiveSlices = 0; threadActiveSlices < 2; ++threadActiveSlices)
+        {
+            for (size_t threadCount = 1; threadCount <= c_maxThreadCount; threadCount *= 2)
+            {
+                auto fileSystem = Factories::CreateFileSystem();
+
+                auto termTables = Factories::CreateTermTableCollection();
+                termTables->AddTermTable(
+                    Factories::CreatePrimeFactorsTermTable(c_maxPrime, c_streamId));
+
+                auto index = Factories::CreateSimpleIndex(*fileSystem);
+                index->SetTermTableCollection(std::move(termTables));
+                index->SetSliceBufferAllocator(
+                    Factories::CreateGrowableSliceBufferAllocator(200000, 16, 4096));
+                index->SetThreadActiveSlices(threadActiveSlices != 0);
+                index->ConfigureAsMock(1, false);
+                index->StartIndex();
+                auto & ingestor = index->GetIngestor();
+
+                // Create the documents up front so that only Add() is timed.
+                // Each document has terms with explicit rows in the
+                // PrimeFactors TermTable.
+                std::vector<std::unique_ptr<IDocument>> documents;
+                for (DocId id = 0; id < c_documentCount; ++id)
+                {
+                    auto document = Factories::CreateDocument(index->GetConfiguration(), id);
+                    document->OpenStream(c_streamId);
+                    for (size_t i = 0; i < c_termsPerDocument; ++i)
+                    {
+                        const size_t prime = (id * 31 + i * 97) % Primes::c_primesBelow10000.size();
+                        document->AddTerm(Primes::c_primesBelow10000Text[prime].c_str());
+                    }
+                    document->CloseStream();
+                    document->CloseDocument(0);
+                    documents.push_back(std::move(document));
+                }
+
+                Stopwatch stopwatch;
+                std::vector<std::thread> threads;
+                for (size_t t = 0; t < threadCount; ++t)
+                {
+                    threads.emplace_back([&ingestor, &documents, t, threadCount]()
+                    {
+                        for (DocId id = t; id < c_documentCount; id += threadCount)
+                        {
+                            ingestor.Add(id, *documents[id]);
+                        }
+                    });
+                }
+                for (auto & thread : threads)
+                {
+                    thread.join();
+                }
+                const double elapsed = stopwatch.ElapsedTime();
+
+                for (DocId id = 0; id < c_documentCount; ++id)
+                {
+                    EXPECT_TRUE(ingestor.Contains(id));
+                }
+
+                std::cout << "threadActiveSlices = " << threadActiveSlices
+                          << ", threads = " << threadCount
+                          << ", documents/s = "
+                          << static_cast<size_t>(c_documentCount / elapsed)
+                          << std::endl;
+            }
+        }
+    }
 }
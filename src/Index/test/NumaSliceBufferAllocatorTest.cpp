@@ -0,0 +1,174 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <memory>
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/ISliceBufferAllocator.h"
+#include "NumaSliceBufferAllocator.h"
+
+
+namespace BitFunnel
+{
+    namespace NumaSliceBufferAllocatorTest
+    {
+        static const size_t c_blockSize = 4096;
+
+
+        // Allocates every buffer, checks that the pool is exhausted, then
+        // releases and reallocates the buffers.
+        static void VerifyAllocator(ISliceBufferAllocator& allocator,
+                                    size_t blockCount)
+        {
+            EXPECT_EQ(c_blockSize, allocator.GetSliceBufferSize());
+
+            std::set<void*> buffers;
+            for (size_t i = 0; i < blockCount; ++i)
+            {
+                void* buffer = allocator.Allocate(c_blockSize, 0);
+                EXPECT_NE(buffer, nullptr);
+
+                // Buffers must be writable.
+                static_cast<char*>(buffer)[c_blockSize - 1] = 1;
+                buffers.insert(buffer);
+            }
+            EXPECT_EQ(blockCount, buffers.size());
+
+            EXPECT_ANY_THROW(allocator.Allocate(c_blockSize, 0));
+
+            for (auto buffer : buffers)
+            {
+                allocator.Release(buffer);
+            }
+
+            std::set<void*> reallocated;
+            for (size_t i = 0; i < blockCount; ++i)
+            {
+                reallocated.insert(allocator.Allocate(c_blockSize, 0));
+            }
+            EXPECT_EQ(buffers, reallocated);
+
+            for (auto buffer : reallocated)
+            {
+                allocator.Release(buffer);
+            }
+        }
+
+
+        TEST(NumaSliceBufferAllocator, SingleNode)
+        {
+            static const size_t c_blockCount = 5;
+            NumaSliceBufferAllocator allocator(c_blockSize,
+                                               c_blockCount,
+                                               false,
+                                               std::vector<size_t>(1, 0));
+            VerifyAllocator(allocator, c_blockCount);
+        }
+
+
+        TEST(NumaSliceBufferAllocator, MultipleNodes)
+        {
+            // Buffers are split across the nodes. Once the requested node
+            // is exhausted, buffers come from the other nodes. Placement on
+            // a node that doesn't exist falls back to the default.
+            static const size_t c_blockCount = 6;
+            const std::vector<size_t> nodes = { 0, 1, 2 };
+            NumaSliceBufferAllocator allocator(c_blockSize,
+                                               c_blockCount,
+                                               false,
+                                               nodes);
+            EXPECT_EQ(nodes.size(), allocator.GetNumaNodeCount());
+            VerifyAllocator(allocator, c_blockCount);
+        }
+
+
+        TEST(NumaSliceBufferAllocator, RequestedNode)
+        {
+            // Each node has two buffers. Buffers requested for a node come
+            // from that node's pool, whichever node the thread runs on.
+            static const size_t c_blockCount = 6;
+            NumaSliceBufferAllocator allocator(c_blockSize,
+                                               c_blockCount,
+                                               false,
+                                               { 0, 1, 2 });
+
+            std::set<void*> node1;
+            node1.insert(allocator.Allocate(c_blockSize, 1));
+            node1.insert(allocator.Allocate(c_blockSize, 1));
+            EXPECT_EQ(2u, node1.size());
+
+            std::set<void*> node2;
+            node2.insert(allocator.Allocate(c_blockSize, 2));
+            node2.insert(allocator.Allocate(c_blockSize, 2));
+            EXPECT_EQ(2u, node2.size());
+
+            // Node 1 is exhausted, so the next buffer for it comes from
+            // another node.
+            void* fallback = allocator.Allocate(c_blockSize, 1);
+            EXPECT_EQ(0u, node1.count(fallback));
+            EXPECT_EQ(0u, node2.count(fallback));
+            allocator.Release(fallback);
+
+            // Released buffers return to their own node.
+            for (auto buffer : node1)
+            {
+                allocator.Release(buffer);
+            }
+            std::set<void*> reallocated;
+            reallocated.insert(allocator.Allocate(c_blockSize, 1));
+            reallocated.insert(allocator.Allocate(c_blockSize, 1));
+            EXPECT_EQ(node1, reallocated);
+
+            for (auto buffer : reallocated)
+            {
+                allocator.Release(buffer);
+            }
+            for (auto buffer : node2)
+            {
+                allocator.Release(buffer);
+            }
+        }
+
+
+        TEST(NumaSliceBufferAllocator, LargePages)
+        {
+            // Large pages may not be available, in which case the allocator
+            // falls back to default pages.
+            static const size_t c_blockCount = 4;
+            auto allocator =
+                Factories::CreateNumaSliceBufferAllocator(c_blockSize,
+                                                          c_blockCount,
+                                                          true);
+
+            EXPECT_EQ(c_blockSize, allocator->GetSliceBufferSize());
+            void* buffer = allocator->Allocate(c_blockSize, 0);
+            static_cast<char*>(buffer)[0] = 1;
+            allocator->Release(buffer);
+        }
+    }
+}
@@ -20,7 +20,14 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <atomic>
+#include <chrono>
+#include <functional>
 #include <future>
+#include <set>
+#include <streambuf>
+#include <thread>
+#include <utility>
 
 #include "gtest/gtest.h"
 
@@ -114,5 +121,422 @@ namespace BitFunnel
             recycler->Shutdown();
             background.wait();
         }
+
+
+        TEST(Shard, Backpressure)
+        {
+            auto recycler = Factories::CreateRecycler();
+            auto background = std::async(std::launch::async, &IRecycler::Run, recycler.get());
+
+            auto tokenManager = Factories::CreateTokenManager();
+            auto termTable = Factories::CreateTermTable();
+            termTable->Seal();
+
+            DocumentDataSchema docDataSchema;
+
+            const size_t blockSize =
+                GetMinimumBlockSize(docDataSchema, *termTable);
+
+            // Room for two slices, committed one at a time.
+            static const size_t c_maxSliceCount = 2;
+            auto allocator =
+                Factories::CreateGrowableSliceBufferAllocator(blockSize,
+                                                              1,
+                                                              c_maxSliceCount);
+
+            Shard shard(*recycler, *tokenManager, *termTable, docDataSchema, *allocator, blockSize);
+
+            const DocIndex sliceCapacity = shard.GetSliceCapacity();
+            std::vector<Slice*> slices;
+            DocId id = 0;
+            for (; id < sliceCapacity * c_maxSliceCount; ++id)
+            {
+                DocumentHandleInternal h;
+                ASSERT_TRUE(shard.TryAllocateDocument(id, h));
+                if (id % sliceCapacity == 0)
+                {
+                    slices.push_back(h.GetSlice());
+                    EXPECT_EQ(slices.size(), allocator->GetCommittedBufferCount());
+                }
+                h.GetSlice()->CommitDocument();
+            }
+
+            EXPECT_EQ(c_maxSliceCount, allocator->GetAllocatedBufferCount());
+            EXPECT_EQ(c_maxSliceCount, allocator->GetHighWaterBufferCount());
+
+            // The allocator is at capacity.
+            DocumentHandleInternal h;
+            EXPECT_FALSE(shard.TryAllocateDocument(id, h));
+            EXPECT_ANY_THROW(shard.AllocateDocument(id));
+
+            // Recycling a slice makes room for another.
+            for (DocIndex i = 0; i < sliceCapacity; ++i)
+            {
+                slices[0]->ExpireDocument();
+            }
+            shard.RecycleSlice(*slices[0]);
+            while (allocator->GetAllocatedBufferCount() != c_maxSliceCount - 1) {}
+
+            EXPECT_TRUE(shard.TryAllocateDocument(id, h));
+            h.GetSlice()->CommitDocument();
+            EXPECT_EQ(c_maxSliceCount, allocator->GetHighWaterBufferCount());
+            EXPECT_EQ(c_maxSliceCount, allocator->GetCommittedBufferCount());
+
+            tokenManager->Shutdown();
+            recycler->Shutdown();
+            background.wait();
+        }
+
+
+        TEST(Shard, ConcurrentAllocation)
+        {
+            auto recycler = Factories::CreateRecycler();
+            auto background = std::async(std::launch::async, &IRecycler::Run, recycler.get());
+
+            auto tokenManager = Factories::CreateTokenManager();
+            auto termTable = Factories::CreateTermTable();
+            termTable->Seal();
+
+            DocumentDataSchema docDataSchema;
+
+            const size_t blockSize =
+                GetMinimumBlockSize(docDataSchema, *termTable);
+
+            std::unique_ptr<TrackingSliceBufferAllocator>
+                trackingAllocator(new TrackingSliceBufferAllocator(blockSize));
+
+            Shard shard(*recycler, *tokenManager, *termTable, docDataSchema, *trackingAllocator, blockSize);
+
+            // Enough documents per thread that the threads race to create
+            // new slices.
+            static const size_t c_threadCount = 8;
+            const size_t sliceCapacity = shard.GetSliceCapacity();
+            const size_t documentsPerThread = sliceCapacity * 3 + 1;
+
+            std::vector<std::vector<DocumentHandleInternal>> handles(c_threadCount);
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < c_threadCount; ++t)
+            {
+                threads.emplace_back([&shard, &handles, t, documentsPerThread]()
+                {
+                    for (size_t i = 0; i < documentsPerThread; ++i)
+                    {
+                        const DocId id = t * documentsPerThread + i;
+                        handles[t].push_back(shard.AllocateDocument(id));
+                        handles[t].back().GetSlice()->CommitDocument();
+                    }
+                });
+            }
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+
+            // Every document has its own column.
+            std::set<std::pair<Slice*, DocIndex>> columns;
+            for (auto const & threadHandles : handles)
+            {
+                for (auto const & handle : threadHandles)
+                {
+                    EXPECT_LT(handle.GetIndex(), sliceCapacity);
+                    columns.insert(std::make_pair(handle.GetSlice(), handle.GetIndex()));
+                }
+            }
+            const size_t documentCount = c_threadCount * documentsPerThread;
+            EXPECT_EQ(documentCount, columns.size());
+
+            // Only the last slice has unallocated columns.
+            const size_t expectedSliceCount =
+                (documentCount + sliceCapacity - 1) / sliceCapacity;
+            EXPECT_EQ(expectedSliceCount, shard.GetSliceBuffers().size());
+            EXPECT_EQ(expectedSliceCount, trackingAllocator->GetInUseBuffersCount());
+
+            tokenManager->Shutdown();
+            recycler->Shutdown();
+            background.wait();
+        }
+
+
+        TEST(Shard, ThreadActiveSlices)
+        {
+            auto recycler = Factories::CreateRecycler();
+            auto background = std::async(std::launch::async, &IRecycler::Run, recycler.get());
+
+            auto tokenManager = Factories::CreateTokenManager();
+            auto termTable = Factories::CreateTermTable();
+            termTable->Seal();
+
+            DocumentDataSchema docDataSchema;
+
+            const size_t blockSize =
+                GetMinimumBlockSize(docDataSchema, *termTable);
+
+            std::unique_ptr<TrackingSliceBufferAllocator>
+                trackingAllocator(new TrackingSliceBufferAllocator(blockSize));
+
+            Shard shard(*recycler,
+                        *tokenManager,
+                        *termTable,
+                        docDataSchema,
+                        *trackingAllocator,
+                        blockSize,
+                        true);
+
+            static const size_t c_threadCount = 4;
+            const size_t sliceCapacity = shard.GetSliceCapacity();
+            const size_t documentsPerThread = sliceCapacity * 2 + 1;
+
+            // Threads wait for each other before exiting. Otherwise a thread
+            // could take over the slot, and the active slice, of a thread
+            // that has exited.
+            std::atomic<size_t> finishedCount(0);
+
+            std::vector<std::vector<DocumentHandleInternal>> handles(c_threadCount);
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < c_threadCount; ++t)
+            {
+                threads.emplace_back([&shard, &handles, &finishedCount, t, documentsPerThread]()
+                {
+                    for (size_t i = 0; i < documentsPerThread; ++i)
+                    {
+                        const DocId id = t * documentsPerThread + i;
+                        handles[t].push_back(shard.AllocateDocument(id));
+                        handles[t].back().GetSlice()->CommitDocument();
+                    }
+
+                    ++finishedCount;
+                    while (finishedCount < c_threadCount)
+                    {
+                        std::this_thread::yield();
+                    }
+                });
+            }
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+
+            // Each thread fills its own slices, in order, and ends with a
+            // partially filled slice of its own.
+            std::set<Slice*> slices;
+            for (auto const & threadHandles : handles)
+            {
+                std::set<Slice*> threadSlices;
+                for (size_t i = 0; i < threadHandles.size(); ++i)
+                {
+                    Slice* slice = threadHandles[i].GetSlice();
+                    EXPECT_TRUE(slice->IsThreadOwned());
+                    EXPECT_EQ(i % sliceCapacity, threadHandles[i].GetIndex());
+                    threadSlices.insert(slice);
+                }
+                EXPECT_EQ(3u, threadSlices.size());
+
+                for (auto slice : threadSlices)
+                {
+                    EXPECT_TRUE(slices.insert(slice).second);
+                }
+            }
+            EXPECT_EQ(c_threadCount * 3, shard.GetSliceBuffers().size());
+            EXPECT_EQ(c_threadCount * 3, trackingAllocator->GetInUseBuffersCount());
+
+            tokenManager->Shutdown();
+            recycler->Shutdown();
+            background.wait();
+        }
+
+
+        TEST(Shard, ReleaseThreadSlices)
+        {
+            auto recycler = Factories::CreateRecycler();
+            auto background = std::async(std::launch::async, &IRecycler::Run, recycler.get());
+
+            auto tokenManager = Factories::CreateTokenManager();
+            auto termTable = Factories::CreateTermTable();
+            termTable->Seal();
+
+            DocumentDataSchema docDataSchema;
+
+            const size_t blockSize =
+                GetMinimumBlockSize(docDataSchema, *termTable);
+
+            std::unique_ptr<TrackingSliceBufferAllocator>
+                trackingAllocator(new TrackingSliceBufferAllocator(blockSize));
+
+            Shard shard(*recycler,
+                        *tokenManager,
+                        *termTable,
+                        docDataSchema,
+                        *trackingAllocator,
+                        blockSize,
+                        true);
+
+            const size_t sliceCapacity = shard.GetSliceCapacity();
+
+            // Each thread ingests one document into its own slice. The
+            // document of the first thread is expired before the slices are
+            // released.
+            static const size_t c_threadCount = 2;
+            std::atomic<size_t> finishedCount(0);
+            std::vector<DocumentHandleInternal> handles(c_threadCount);
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < c_threadCount; ++t)
+            {
+                threads.emplace_back([&shard, &handles, &finishedCount, t]()
+                {
+                    handles[t] = shard.AllocateDocument(t);
+                    handles[t].GetSlice()->CommitDocument();
+
+                    ++finishedCount;
+                    while (finishedCount < c_threadCount)
+                    {
+                        std::this_thread::yield();
+                    }
+                });
+            }
+            for (auto & thread : threads)
+            {
+                thread.join();
+            }
+
+            handles[0].Expire();
+            EXPECT_EQ(2u, shard.GetSliceBuffers().size());
+
+            // The slice with no live documents is recycled right away. The
+            // other one counts its unallocated columns as expired.
+            shard.ReleaseThreadSlices();
+            ASSERT_EQ(1u, shard.GetSliceBuffers().size());
+
+            Slice* slice = handles[1].GetSlice();
+            size_t allocatedCount;
+            size_t commitPendingCount;
+            size_t expiredCount;
+            slice->GetDocumentCounts(allocatedCount,
+                                     commitPendingCount,
+                                     expiredCount);
+            EXPECT_EQ(sliceCapacity, allocatedCount);
+            EXPECT_EQ(0u, commitPendingCount);
+            EXPECT_EQ(sliceCapacity - 1, expiredCount);
+
+            // Releasing again does nothing.
+            shard.ReleaseThreadSlices();
+            EXPECT_EQ(1u, shard.GetSliceBuffers().size());
+
+            // Expiring the last document recycles the second slice.
+            handles[1].Expire();
+            EXPECT_EQ(0u, shard.GetSliceBuffers().size());
+
+            tokenManager->Shutdown();
+            recycler->Shutdown();
+            background.wait();
+
+            EXPECT_EQ(0u, trackingAllocator->GetInUseBuffersCount());
+        }
+
+
+        // Stream buffer which discards its output, and calls a function
+        // before the first write.
+        class FirstWriteStreamBuffer : public std::streambuf
+        {
+        public:
+            explicit FirstWriteStreamBuffer(std::function<void()> onFirstWrite)
+                : m_onFirstWrite(onFirstWrite)
+            {
+            }
+
+        protected:
+            virtual std::streamsize xsputn(char const * /*s*/,
+                                           std::streamsize count) override
+            {
+                OnWrite();
+                return count;
+            }
+
+            virtual int_type overflow(int_type c) override
+            {
+                OnWrite();
+                return traits_type::not_eof(c);
+            }
+
+        private:
+            void OnWrite()
+            {
+                if (m_onFirstWrite)
+                {
+                    auto onFirstWrite = m_onFirstWrite;
+                    m_onFirstWrite = nullptr;
+                    onFirstWrite();
+                }
+            }
+
+            std::function<void()> m_onFirstWrite;
+        };
+
+
+        TEST(Shard, SnapshotPausesAllocation)
+        {
+            for (int threadActiveSlices = 0; threadActiveSlices < 2; ++threadActiveSlices)
+            {
+                auto recycler = Factories::CreateRecycler();
+                auto background = std::async(std::launch::async, &IRecycler::Run, recycler.get());
+
+                auto tokenManager = Factories::CreateTokenManager();
+                auto termTable = Factories::CreateTermTable();
+                termTable->Seal();
+
+                DocumentDataSchema docDataSchema;
+
+                const size_t blockSize =
+                    GetMinimumBlockSize(docDataSchema, *termTable);
+
+                std::unique_ptr<TrackingSliceBufferAllocator>
+                    trackingAllocator(new TrackingSliceBufferAllocator(blockSize));
+
+                Shard shard(*recycler,
+                            *tokenManager,
+                            *termTable,
+                            docDataSchema,
+                            *trackingAllocator,
+                            blockSize,
+                            threadActiveSlices != 0);
+
+                // The first document gives the ingestion thread an active
+                // slice with room, so that the second one would be
+                // allocated without m_slicesLock.
+                std::promise<void> ready;
+                std::promise<void> go;
+                std::atomic<bool> allocated(false);
+                std::thread ingestion([&]()
+                {
+                    shard.AllocateDocument(0).GetSlice()->CommitDocument();
+                    ready.set_value();
+
+                    go.get_future().wait();
+                    shard.AllocateDocument(1).GetSlice()->CommitDocument();
+                    allocated = true;
+                });
+                ready.get_future().wait();
+
+                // The second document is requested while the snapshot is
+                // being written.
+                bool allocatedDuringSnapshot = true;
+                FirstWriteStreamBuffer buffer([&]()
+                {
+                    go.set_value();
+                    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+                    allocatedDuringSnapshot = allocated;
+                });
+                std::ostream output(&buffer);
+                shard.WriteSnapshot(output);
+
+                ingestion.join();
+                EXPECT_FALSE(allocatedDuringSnapshot) << threadActiveSlices;
+                EXPECT_TRUE(allocated);
+                EXPECT_EQ(1u, shard.GetSliceBuffers().size());
+
+                tokenManager->Shutdown();
+                recycler->Shutdown();
+                background.wait();
+            }
+        }
     }
 }
@@ -0,0 +1,248 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/IFileManager.h"
+#include "BitFunnel/Index/DocumentHandle.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/IDocument.h"
+#include "BitFunnel/Index/IDocumentDataSchema.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/ISliceBufferAllocator.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/ITermTableCollection.h"
+#include "BitFunnel/Index/PostingBlob.h"
+#include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Term.h"
+#include "Primes.h"
+
+
+namespace BitFunnel
+{
+    namespace SnapshotTest
+    {
+        static const Term::StreamId c_streamId = 0;
+        static const DocId c_maxDocId = 1000;
+
+        // Creates an empty index with a PrimeFactors TermTable for
+        // documents up to maxDocId. The schema stores a posting blob for
+        // each document and the slice buffers are small enough that the
+        // documents span several slices.
+        static std::unique_ptr<ISimpleIndex> CreateIndex(IFileSystem & fileSystem,
+                                                         DocId maxDocId)
+        {
+            auto termTables = Factories::CreateTermTableCollection();
+            termTables->AddTermTable(
+                Factories::CreatePrimeFactorsTermTable(maxDocId, c_streamId));
+
+            auto schema = Factories::CreateDocumentDataSchema();
+            schema->RegisterPostingBlob();
+
+            auto index = Factories::CreateSimpleIndex(fileSystem);
+            index->SetTermTableCollection(std::move(termTables));
+            index->SetSchema(std::move(schema));
+            index->SetSliceBufferAllocator(
+                Factories::CreateSliceBufferAllocator(20000, 64));
+            index->ConfigureAsMock(1, false);
+            index->StartIndex();
+
+            return index;
+        }
+
+
+        static void AddDocument(ISimpleIndex & index, DocId id)
+        {
+            auto document =
+                Factories::CreatePrimeFactorsDocument(index.GetConfiguration(),
+                                                      id,
+                                                      c_maxDocId,
+                                                      c_streamId);
+            index.GetIngestor().Add(id, *document);
+        }
+
+
+        // Verifies that the document has the same bits in rows up to maxRank
+        // and the same posting blob in both indexes. Bits in higher rank rows
+        // are shared with neighboring columns, so they only match when the
+        // documents occupy the same columns.
+        static void VerifyDocument(ISimpleIndex const & expected,
+                                   ISimpleIndex const & actual,
+                                   DocId id,
+                                   Rank maxRank)
+        {
+            auto expectedHandle = expected.GetIngestor().GetHandle(id);
+            auto actualHandle = actual.GetIngestor().GetHandle(id);
+            EXPECT_EQ(actualHandle.GetDocId(), id);
+
+            for (size_t i = 0; Primes::c_primesBelow10000[i] <= c_maxDocId; ++i)
+            {
+                Term term(Term::ComputeRawHash(Primes::c_primesBelow10000Text[i].c_str()),
+                          c_streamId,
+                          0);
+                RowIdSequence rows(term, actual.GetTermTable());
+                for (auto row : rows)
+                {
+                    if (row.GetRank() <= maxRank)
+                    {
+                        EXPECT_EQ(actualHandle.GetBit(row), expectedHandle.GetBit(row));
+                    }
+                }
+            }
+
+            const VariableSizeBlobId blob =
+                actual.GetIngestor().GetDocumentDataSchema().GetPostingBlob();
+            void const * expectedBlob = expectedHandle.GetVariableSizeBlob(blob);
+            void const * actualBlob = actualHandle.GetVariableSizeBlob(blob);
+            ASSERT_NE(actualBlob, nullptr);
+            ASSERT_NE(actualBlob, expectedBlob);
+
+            const size_t postingCount = PostingBlob(expectedBlob).GetPostingCount();
+            ASSERT_EQ(PostingBlob(actualBlob).GetPostingCount(), postingCount);
+            EXPECT_EQ(memcmp(actualBlob,
+                             expectedBlob,
+                             PostingBlob::GetByteCount(postingCount)),
+                      0);
+        }
+
+
+        TEST(Snapshot, WriteAndLoad)
+        {
+            auto fileSystem = Factories::CreateFileSystem();
+            auto fileManager =
+                Factories::CreateFileManager(".", ".", ".", *fileSystem);
+            const std::string path = fileManager->IndexSnapshot(0).GetName();
+
+            auto original = CreateIndex(*fileSystem, c_maxDocId);
+            for (DocId id = 0; id <= c_maxDocId; ++id)
+            {
+                AddDocument(*original, id);
+            }
+            for (DocId id = 7; id <= c_maxDocId; id += 7)
+            {
+                ASSERT_TRUE(original->GetIngestor().Delete(id));
+            }
+
+            auto & originalShard = original->GetIngestor().GetShard(0);
+            ASSERT_GT(originalShard.GetSliceBuffers().size(), 1u);
+
+            original->GetIngestor().WriteSnapshot(*fileManager);
+
+            auto loaded = CreateIndex(*fileSystem, c_maxDocId);
+            loaded->GetIngestor().LoadSnapshot(*fileManager);
+
+            auto & loadedShard = loaded->GetIngestor().GetShard(0);
+            ASSERT_EQ(loadedShard.GetSliceBuffers().size(),
+                      originalShard.GetSliceBuffers().size());
+
+            for (DocId id = 0; id <= c_maxDocId; ++id)
+            {
+                const bool isActive = (id == 0) || (id % 7 != 0);
+                ASSERT_EQ(loaded->GetIngestor().Contains(id), isActive);
+                if (isActive)
+                {
+                    VerifyDocument(*original, *loaded, id, c_maxRankValue);
+                }
+            }
+
+            // The loaded index continues to ingest and delete documents.
+            for (DocId id = 7; id <= c_maxDocId; id += 7)
+            {
+                AddDocument(*loaded, id);
+            }
+            for (DocId id = 2; id <= c_maxDocId; id += 2)
+            {
+                ASSERT_TRUE(loaded->GetIngestor().Delete(id));
+            }
+
+            auto reference = CreateIndex(*fileSystem, c_maxDocId);
+            for (DocId id = 0; id <= c_maxDocId; ++id)
+            {
+                AddDocument(*reference, id);
+            }
+
+            for (DocId id = 0; id <= c_maxDocId; ++id)
+            {
+                const bool isActive = (id == 0) || (id % 2 != 0);
+                ASSERT_EQ(loaded->GetIngestor().Contains(id), isActive);
+                if (isActive)
+                {
+                    VerifyDocument(*reference, *loaded, id, 0);
+                }
+            }
+
+            // The snapshot cannot be loaded into a non-empty index.
+            EXPECT_THROW(loaded->GetIngestor().LoadSnapshot(*fileManager),
+                         RecoverableError);
+
+            // Changes to the mapped slices are not written back to the file.
+            auto reloaded = CreateIndex(*fileSystem, c_maxDocId);
+            reloaded->GetIngestor().LoadSnapshot(*fileManager);
+            for (DocId id = 0; id <= c_maxDocId; ++id)
+            {
+                const bool isActive = (id == 0) || (id % 7 != 0);
+                ASSERT_EQ(reloaded->GetIngestor().Contains(id), isActive);
+            }
+
+            EXPECT_EQ(std::remove(path.c_str()), 0);
+        }
+
+
+        TEST(Snapshot, IncompatibleTermTable)
+        {
+            auto fileSystem = Factories::CreateFileSystem();
+            auto fileManager =
+                Factories::CreateFileManager(".", ".", ".", *fileSystem);
+            const std::string path = fileManager->IndexSnapshot(0).GetName();
+
+            auto original = CreateIndex(*fileSystem, c_maxDocId);
+            for (DocId id = 0; id <= 100; ++id)
+            {
+                AddDocument(*original, id);
+            }
+            original->GetIngestor().WriteSnapshot(*fileManager);
+
+            // A PrimeFactors TermTable for a different range of documents
+            // has a different set of terms.
+            auto other = CreateIndex(*fileSystem, c_maxDocId / 2);
+            EXPECT_THROW(other->GetIngestor().LoadSnapshot(*fileManager),
+                         RecoverableError);
+            EXPECT_FALSE(other->GetIngestor().Contains(1));
+
+            EXPECT_EQ(std::remove(path.c_str()), 0);
+        }
+    }
+}
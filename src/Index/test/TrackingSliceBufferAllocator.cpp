@@ -32,7 +32,8 @@
 namespace BitFunnel
 {
     TrackingSliceBufferAllocator::TrackingSliceBufferAllocator(size_t blockSize)
-        : m_blockSize(blockSize)
+        : m_highWaterCount(0),
+          m_blockSize(blockSize)
     {
     }
 
@@ -45,7 +46,7 @@ namespace BitFunnel
     }
 
 
-    void* TrackingSliceBufferAllocator::Allocate(size_t byteSize)
+    void* TrackingSliceBufferAllocator::Allocate(size_t byteSize, size_t /*numaNode*/)
     {
         std::lock_guard<std::mutex> lock(m_lock);
 
@@ -53,11 +54,22 @@ namespace BitFunnel
 
         void* sliceBuffer = malloc(byteSize);
         m_allocatedBuffers.insert(sliceBuffer);
+        if (m_allocatedBuffers.size() > m_highWaterCount)
+        {
+            m_highWaterCount = m_allocatedBuffers.size();
+        }
 
         return sliceBuffer;
     }
 
 
+    void* TrackingSliceBufferAllocator::TryAllocate(size_t byteSize, size_t numaNode)
+    {
+        // Tracking allocator is never at capacity.
+        return Allocate(byteSize, numaNode);
+    }
+
+
     void TrackingSliceBufferAllocator::Release(void* buffer)
     {
         std::lock_guard<std::mutex> lock(m_lock);
@@ -75,4 +87,32 @@ namespace BitFunnel
     {
         return m_blockSize;
     }
+
+
+    size_t TrackingSliceBufferAllocator::GetAllocatedBufferCount() const
+    {
+        return GetInUseBuffersCount();
+    }
+
+
+    size_t TrackingSliceBufferAllocator::GetHighWaterBufferCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        return m_highWaterCount;
+    }
+
+
+    size_t TrackingSliceBufferAllocator::GetCommittedBufferCount() const
+    {
+        // Buffers are freed on release, so only allocated buffers hold
+        // memory.
+        return GetInUseBuffersCount();
+    }
+
+
+    size_t TrackingSliceBufferAllocator::GetNumaNodeCount() const
+    {
+        return 1;
+    }
 }
@@ -40,13 +40,19 @@ namespace BitFunnel
 
         size_t GetInUseBuffersCount() const;
 
-        virtual void* Allocate(size_t byteSize) override;
+        virtual void* Allocate(size_t byteSize, size_t numaNode) override;
+        virtual void* TryAllocate(size_t byteSize, size_t numaNode) override;
         virtual void Release(void* buffer) override;
         virtual size_t GetSliceBufferSize() const override;
+        virtual size_t GetAllocatedBufferCount() const override;
+        virtual size_t GetHighWaterBufferCount() const override;
+        virtual size_t GetCommittedBufferCount() const override;
+        virtual size_t GetNumaNodeCount() const override;
 
     private:
         mutable std::mutex m_lock;
         std::unordered_set<void*> m_allocatedBuffers;
+        size_t m_highWaterCount;
         const size_t m_blockSize;
     };
 }
@@ -20,6 +20,7 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>    // std::max().
 #include <iostream>     // TODO: Remove
 #include <string>
 
@@ -192,28 +193,47 @@ namespace BitFunnel
     std::unique_ptr<ISimpleIndex>
         Factories::CreatePrimeFactorsIndex(IFileSystem & fileSystem,
                                            DocId maxDocId,
-                                           Term::StreamId streamId)
+                                           Term::StreamId streamId,
+                                           ShardId shardCount)
     {
+        CHECK_GT(shardCount, 0u)
+            << "Index must have at least one shard.";
+
         // Create special PrimeFactors TermTables containing explicit,
         // private row mappings for terms "0", "1", and the text representation
-        // of primes less than or equal to maxDocId.
+        // of primes less than or equal to maxDocId. Each shard gets its own
+        // copy of the TermTable.
         auto termTableCollection =
             Factories::CreateTermTableCollection();
-        auto termTable =
-            Factories::CreatePrimeFactorsTermTable(maxDocId, streamId);
-        termTableCollection->AddTermTable(std::move(termTable));
+        for (ShardId shard = 0; shard < shardCount; ++shard)
+        {
+            auto termTable =
+                Factories::CreatePrimeFactorsTermTable(maxDocId, streamId);
+            termTableCollection->AddTermTable(std::move(termTable));
+        }
+
+        // Shard s holds documents with s + 1 postings. The last shard holds
+        // documents with shardCount or more postings.
+        auto shardDefinition = Factories::CreateShardDefinition();
+        for (ShardId shard = 0; shard + 1 < shardCount; ++shard)
+        {
+            shardDefinition->AddShard(shard + 1);
+        }
 
         // Need to create our own slice buffer allocator because matcher tests
         // are more comprehensive if there are at least two quadwords in every
         // RowTable row. The ISimpleIndex::CongigureAsMock() method creates an
         // allocator with the absolute minimum block size, which results in a
-        // single quadword per row.
+        // single quadword per row. Each prime has its own row, so the block
+        // size also grows with maxDocId in order to hold at least one rank 0
+        // quadword per row.
         //
         // TODO: Might want to add a check that rows have at least 2 quadwords.
         // Right now the hard-coded blocksize yields 13 quadwords at rank 0,
         // but this could change if the TermTable was configured to use higher
         // ranks.
-        size_t blockSize = 20000;
+        size_t blockSize = 20000 * (std::max)(static_cast<size_t>(1),
+                                              static_cast<size_t>(maxDocId / 1024));
         size_t blockCount = 512;
         auto sliceAllocator =
             Factories::CreateSliceBufferAllocator(blockSize,
@@ -221,6 +241,7 @@ namespace BitFunnel
 
         auto index = Factories::CreateSimpleIndex(fileSystem);
         index->SetTermTableCollection(std::move(termTableCollection));
+        index->SetShardDefinition(std::move(shardDefinition));
         index->SetSliceBufferAllocator(std::move(sliceAllocator));
 
         const Term::GramSize gramSize = 1;
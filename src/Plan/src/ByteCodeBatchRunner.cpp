@@ -0,0 +1,146 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "ByteCodeBatchRunner.h"
+#include "ByteCodeInterpreter.h"
+#include "LoggerInterfaces/Check.h"
+
+
+namespace BitFunnel
+{
+    ByteCodeBatchRunner::ByteCodeBatchRunner(size_t sliceCount,
+                                             char * const * sliceBuffers,
+                                             size_t blocksPerSlice)
+      : m_sliceCount(sliceCount),
+        m_sliceBuffers(sliceBuffers),
+        m_blocksPerSlice(blocksPerSlice)
+    {
+        CHECK_GT(blocksPerSlice, 0u)
+            << "A slice must have at least one block.";
+    }
+
+
+    ByteCodeBatchRunner::~ByteCodeBatchRunner()
+    {
+    }
+
+
+    size_t ByteCodeBatchRunner::AddQuery(ByteCodeGenerator const & code,
+                                         IResultsProcessor & resultsProcessor,
+                                         size_t iterationsPerSlice,
+                                         ptrdiff_t const * rowOffsets)
+    {
+        Query query;
+        query.m_interpreter.reset(
+            new ByteCodeInterpreter(code,
+                                    resultsProcessor,
+                                    m_sliceCount,
+                                    m_sliceBuffers,
+                                    iterationsPerSlice,
+                                    rowOffsets));
+        query.m_plan = nullptr;
+        query.m_matches = nullptr;
+        query.m_iterationsPerSlice = iterationsPerSlice;
+        query.m_terminated = false;
+
+        m_queries.push_back(std::move(query));
+        return m_queries.size() - 1;
+    }
+
+
+    size_t ByteCodeBatchRunner::AddQuery(ShardPlan const & plan,
+                                         std::vector<DocId> & matches)
+    {
+        Query query;
+        query.m_plan = &plan;
+        query.m_matches = &matches;
+        query.m_state.reset(new ShardPlan::MatcherState());
+        query.m_iterationsPerSlice = plan.GetIterationsPerSlice();
+        query.m_terminated = false;
+
+        m_queries.push_back(std::move(query));
+        return m_queries.size() - 1;
+    }
+
+
+    size_t ByteCodeBatchRunner::GetQueryCount() const
+    {
+        return m_queries.size();
+    }
+
+
+    bool ByteCodeBatchRunner::Run()
+    {
+        for (auto & query : m_queries)
+        {
+            query.m_terminated = false;
+        }
+        size_t activeCount = m_queries.size();
+
+        for (size_t slice = 0; slice < m_sliceCount && activeCount > 0; ++slice)
+        {
+            for (size_t block = 0; block < m_blocksPerSlice && activeCount > 0; ++block)
+            {
+                for (auto & query : m_queries)
+                {
+                    if (query.m_terminated)
+                    {
+                        continue;
+                    }
+
+                    // Block boundaries are rounded down, so the blocks
+                    // exactly cover the slice's iterations, even when a
+                    // query has fewer iterations than there are blocks.
+                    const size_t begin =
+                        block * query.m_iterationsPerSlice / m_blocksPerSlice;
+                    const size_t end =
+                        (block + 1) * query.m_iterationsPerSlice / m_blocksPerSlice;
+
+                    const bool terminate =
+                        (query.m_plan != nullptr) ?
+                            query.m_plan->ProcessIterations(slice,
+                                                            begin,
+                                                            end,
+                                                            m_sliceBuffers,
+                                                            m_sliceCount,
+                                                            *query.m_matches,
+                                                            nullptr,
+                                                            *query.m_state) :
+                            query.m_interpreter->ProcessIterations(slice, begin, end);
+                    if (terminate)
+                    {
+                        query.m_terminated = true;
+                        --activeCount;
+                    }
+                }
+            }
+        }
+
+        return !m_queries.empty() && activeCount == 0;
+    }
+
+
+    bool ByteCodeBatchRunner::TerminatedEarly(size_t query) const
+    {
+        return m_queries[query].m_terminated;
+    }
+}
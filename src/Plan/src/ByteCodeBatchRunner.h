@@ -0,0 +1,119 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                         // size_t, ptrdiff_t parameter.
+#include <memory>                           // std::unique_ptr embedded.
+#include <vector>                           // std::vector embedded.
+
+#include "BitFunnel/BitFunnelTypes.h"       // DocId parameter.
+#include "BitFunnel/NonCopyable.h"          // Base class.
+#include "ShardPlan.h"                      // ShardPlan::MatcherState embedded.
+
+
+namespace BitFunnel
+{
+    class ByteCodeGenerator;
+    class ByteCodeInterpreter;
+    class IResultsProcessor;
+
+    //*************************************************************************
+    //
+    // ByteCodeBatchRunner runs a batch of compiled queries over the same set
+    // of slices with a single pass over the slices. Running each query to
+    // completion would stream every slice through the cache once per query.
+    // Instead, ByteCodeBatchRunner divides each slice into blocks of
+    // documents and runs every query on a block before moving on to the
+    // next, so the rows of a block are loaded from memory once and stay in
+    // cache for the rest of the batch.
+    //
+    // A query is either byte code, which gets its own ByteCodeInterpreter
+    // and reports to its own IResultsProcessor, or a ShardPlan for the shard
+    // that owns the slices, which runs on the plan's own backend with the
+    // shard's row offsets and appends its matches to its own vector.
+    // Queries may start at different ranks; blocks are expressed as
+    // fractions of a slice so that they cover the same documents for every
+    // query. A query that terminates early is skipped for the rest of the
+    // run.
+    //
+    // For each query, the matches are the same, and in the same order, as
+    // if the query had been run alone by ByteCodeInterpreter::Run() or by
+    // ShardPlan::ProcessSlice() on each slice in turn.
+    //
+    //*************************************************************************
+    class ByteCodeBatchRunner : NonCopyable
+    {
+    public:
+        // Constructs an empty batch that will run over the slices in
+        // sliceBuffers. Each slice is divided into blocksPerSlice blocks.
+        ByteCodeBatchRunner(size_t sliceCount,
+                            char * const * sliceBuffers,
+                            size_t blocksPerSlice = c_defaultBlocksPerSlice);
+
+        ~ByteCodeBatchRunner();
+
+        // Adds a query to the batch and returns its index. The code,
+        // resultsProcessor, and rowOffsets must remain valid until the
+        // ByteCodeBatchRunner is destroyed.
+        size_t AddQuery(ByteCodeGenerator const & code,
+                        IResultsProcessor & resultsProcessor,
+                        size_t iterationsPerSlice,
+                        ptrdiff_t const * rowOffsets);
+
+        // Adds a plan to the batch and returns its index. The plan must
+        // have been compiled for the shard that owns the slices. The plan
+        // and matches must remain valid until the ByteCodeBatchRunner is
+        // destroyed.
+        size_t AddQuery(ShardPlan const & plan, std::vector<DocId> & matches);
+
+        size_t GetQueryCount() const;
+
+        // Runs every query in the batch over every slice. Returns true if
+        // every query terminated early.
+        bool Run();
+
+        // Returns true if the specified query terminated early during the
+        // last call to Run().
+        bool TerminatedEarly(size_t query) const;
+
+        static const size_t c_defaultBlocksPerSlice = 8;
+
+    private:
+        // Exactly one of m_interpreter and m_plan is non-null.
+        struct Query
+        {
+            std::unique_ptr<ByteCodeInterpreter> m_interpreter;
+            ShardPlan const * m_plan;
+            std::vector<DocId> * m_matches;
+            std::unique_ptr<ShardPlan::MatcherState> m_state;
+            size_t m_iterationsPerSlice;
+            bool m_terminated;
+        };
+
+        size_t m_sliceCount;
+        char * const * m_sliceBuffers;
+        size_t m_blocksPerSlice;
+
+        std::vector<Query> m_queries;
+    };
+}
@@ -27,6 +27,7 @@
 #include "BitFunnel/Plan/IResultsProcessor.h"
 #include "ByteCodeInterpreter.h"
 #include "LoggerInterfaces/Check.h"
+#include "WideWordInterpreter.h"
 
 
 namespace BitFunnel
@@ -38,7 +39,6 @@ Pass results processor callback.
 Mock row tables.
 For loop for slices.
 Unit tests.
-Replace std::vector with FixedCapacityVector.
 Review zero flag.
 Figure out how Rank0 instructions read rows.
 Address TODO comments.
@@ -63,18 +63,59 @@ Decide on type of Slices
         size_t sliceCount,
         char * const * sliceBuffers,
         size_t iterationsPerSlice,
-        ptrdiff_t const * rowOffsets)
+        ptrdiff_t const * rowOffsets,
+        bool allowWideWords)
       : m_code(code.GetCode()),
         m_jumpTable(code.GetJumpTable()),
+        m_operands(code.GetOperands()),
         m_resultsProcessor(resultsProcessor),
         m_sliceCount(sliceCount),
         m_sliceBuffers(sliceBuffers),
         m_iterationsPerSlice(iterationsPerSlice),
-        m_rowOffsets(rowOffsets)
+        m_rowOffsets(rowOffsets),
+        m_callStack(new Instruction const *[code.GetMaxCallStackDepth()]),
+        m_callStackTop(m_callStack.get()),
+        m_valueStack(new uint64_t[code.GetMaxValueStackDepth()]),
+        m_valueStackTop(m_valueStack.get())
+    {
+        if (allowWideWords && UsesWideWords(code, iterationsPerSlice))
+        {
+            m_wideWordInterpreter.reset(
+                new WideWordInterpreter(code,
+                                        resultsProcessor,
+                                        rowOffsets,
+                                        GetWideWordLaneCount(iterationsPerSlice)));
+        }
+    }
+
+
+    ByteCodeInterpreter::~ByteCodeInterpreter()
     {
     }
 
 
+    /* static */
+    bool ByteCodeInterpreter::UsesWideWords(ByteCodeGenerator const & code,
+                                            size_t iterationsPerSlice)
+    {
+        return GetWideWordLaneCount(iterationsPerSlice) >= 4 &&
+               WideWordInterpreter::IsCompatible(code);
+    }
+
+
+    /* static */
+    size_t ByteCodeInterpreter::GetWideWordLaneCount(size_t iterationsPerSlice)
+    {
+        // Use the widest supported words that fit in a slice.
+        size_t laneCount = WideWordInterpreter::GetSupportedLaneCount();
+        while (laneCount > iterationsPerSlice)
+        {
+            laneCount >>= 1;
+        }
+        return laneCount;
+    }
+
+
     bool ByteCodeInterpreter::Run()
     {
         for (size_t i = 0; i < m_sliceCount; ++i)
@@ -92,9 +133,32 @@ Decide on type of Slices
 
 
     bool ByteCodeInterpreter::ProcessOneSlice(size_t slice)
+    {
+        return ProcessIterations(slice, 0, m_iterationsPerSlice);
+    }
+
+
+    bool ByteCodeInterpreter::ProcessIterations(size_t slice,
+                                                size_t begin,
+                                                size_t end)
     {
         auto sliceBuffer = m_sliceBuffers[slice];
-        for (size_t i = 0; i < m_iterationsPerSlice; ++i)
+
+        size_t first = begin;
+        if (m_wideWordInterpreter.get() != nullptr)
+        {
+            bool terminate =
+                m_wideWordInterpreter->ProcessIterations(sliceBuffer,
+                                                         begin,
+                                                         end,
+                                                         first);
+            if (terminate)
+            {
+                return true;
+            }
+        }
+
+        for (size_t i = first; i < end; ++i)
         {
             bool terminate = RunOneIteration(sliceBuffer, i);
             if (terminate)
@@ -119,9 +183,15 @@ Decide on type of Slices
         while (m_ip->GetOpcode() != Opcode::End)
         {
             const Opcode opcode = m_ip->GetOpcode();
-            const unsigned row = m_ip->GetRow();
-            const unsigned delta = m_ip->GetDelta();
+            size_t row = m_ip->GetRow();
+            size_t delta = m_ip->GetDelta();
             const bool inverted = m_ip->IsInverted();
+            if (m_ip->IsExtended())
+            {
+                ExtendedOperand const & operand = m_operands[m_ip->GetOperandIndex()];
+                row = operand.m_row;
+                delta = operand.m_delta;
+            }
 
             switch (opcode)
             {
@@ -160,36 +230,36 @@ Decide on type of Slices
                 m_ip++;
                 break;
             case Opcode::Push:
-                m_valueStack.push_back(m_accumulator);
+                *m_valueStackTop++ = m_accumulator;
                 m_ip++;
                 break;
             case Opcode::Pop:
-                m_accumulator = m_valueStack.back();
-                m_valueStack.pop_back();
+                m_accumulator = *--m_valueStackTop;
                 m_ip++;
                 break;
             case Opcode::AndStack:
                 {
-                    m_accumulator &= m_valueStack.back();
-                    m_valueStack.pop_back();
+                    m_accumulator &= *--m_valueStackTop;
                     m_ip++;
                 }
                 break;
             case Opcode::Constant:
-                throw NotImplemented("Constant opcode not implemented.");
+                // The inverted bit selects all ones over zero.
+                m_accumulator = inverted ? ~0ull : 0ull;
+                m_ip++;
+                break;
             case Opcode::Not:
-                m_accumulator = !m_accumulator;
+                m_accumulator = ~m_accumulator;
                 m_ip++;
                 break;
             case Opcode::OrStack:
                 {
-                    m_accumulator |= m_valueStack.back();
-                    m_valueStack.pop_back();
+                    m_accumulator |= *--m_valueStackTop;
                     m_ip++;
                 }
                 break;
             case Opcode::UpdateFlags:
-                m_zeroFlag = (m_valueStack.back() == 0);
+                m_zeroFlag = (m_accumulator == 0);
                 m_ip++;
                 break;
             case Opcode::Report:
@@ -202,7 +272,7 @@ Decide on type of Slices
                 m_ip++;
                 break;
             case Opcode::Call:
-                m_callStack.push_back(m_ip + 1);
+                *m_callStackTop++ = m_ip + 1;
                 m_ip = m_jumpTable[row];
                 break;
             case Opcode::Jmp:
@@ -229,8 +299,7 @@ Decide on type of Slices
                 }
                 break;
             case Opcode::Return:
-                m_ip = m_callStack.back();
-                m_callStack.pop_back();
+                m_ip = *--m_callStackTop;
                 break;
             default:
                 RecoverableError error("ByteCodeInterpreter:: bad opcode.");
@@ -255,7 +324,9 @@ Decide on type of Slices
     //
     //*************************************************************************
     ByteCodeGenerator::ByteCodeGenerator()
-        : m_sealed(false)
+        : m_sealed(false),
+          m_maxValueStackDepth(0),
+          m_maxCallStackDepth(0)
     {
     }
 
@@ -280,6 +351,22 @@ Decide on type of Slices
             m_jumpTable.push_back(&m_code[0] + offset);
         }
 
+        // Size the value and call stacks. Always reserve at least one slot
+        // so that the stacks are never empty arrays.
+        m_maxValueStackDepth = 1;
+        m_maxCallStackDepth = 1;
+        for (auto const & instruction : m_code)
+        {
+            if (instruction.GetOpcode() == ByteCodeInterpreter::Opcode::Push)
+            {
+                ++m_maxValueStackDepth;
+            }
+            else if (instruction.GetOpcode() == ByteCodeInterpreter::Opcode::Call)
+            {
+                ++m_maxCallStackDepth;
+            }
+        }
+
         m_sealed = true;
     }
 
@@ -300,35 +387,71 @@ Decide on type of Slices
     }
 
 
+    std::vector<ByteCodeInterpreter::ExtendedOperand> const &
+        ByteCodeGenerator::GetOperands() const
+    {
+        EnsureSealed(true);
+        return m_operands;
+    }
+
+
+    size_t ByteCodeGenerator::GetRow(
+        ByteCodeInterpreter::Instruction const & instruction) const
+    {
+        return instruction.IsExtended() ?
+            m_operands[instruction.GetOperandIndex()].m_row :
+            instruction.GetRow();
+    }
+
+
+    size_t ByteCodeGenerator::GetDelta(
+        ByteCodeInterpreter::Instruction const & instruction) const
+    {
+        return instruction.IsExtended() ?
+            m_operands[instruction.GetOperandIndex()].m_delta :
+            instruction.GetDelta();
+    }
+
+
+    size_t ByteCodeGenerator::GetMaxValueStackDepth() const
+    {
+        EnsureSealed(true);
+        return m_maxValueStackDepth;
+    }
+
+
+    size_t ByteCodeGenerator::GetMaxCallStackDepth() const
+    {
+        EnsureSealed(true);
+        return m_maxCallStackDepth;
+    }
+
+
     void ByteCodeGenerator::AndRow(size_t row, bool inverted, size_t rankDelta)
     {
         EnsureSealed(false);
-        m_code.emplace_back(
-            ByteCodeInterpreter::Opcode::AndRow, row, rankDelta, inverted);
+        Emit(ByteCodeInterpreter::Opcode::AndRow, row, rankDelta, inverted);
     }
 
 
     void ByteCodeGenerator::LoadRow(size_t row, bool inverted, size_t rankDelta)
     {
         EnsureSealed(false);
-        m_code.emplace_back(
-            ByteCodeInterpreter::Opcode::LoadRow, row, rankDelta, inverted);
+        Emit(ByteCodeInterpreter::Opcode::LoadRow, row, rankDelta, inverted);
     }
 
 
     void ByteCodeGenerator::LeftShiftOffset(size_t shift)
     {
         EnsureSealed(false);
-        m_code.emplace_back(
-            ByteCodeInterpreter::Opcode::LeftShiftOffset, shift);
+        Emit(ByteCodeInterpreter::Opcode::LeftShiftOffset, shift, 0, false);
     }
 
 
     void ByteCodeGenerator::RightShiftOffset(size_t shift)
     {
         EnsureSealed(false);
-        m_code.emplace_back(
-            ByteCodeInterpreter::Opcode::RightShiftOffset, shift);
+        Emit(ByteCodeInterpreter::Opcode::RightShiftOffset, shift, 0, false);
     }
 
 
@@ -364,10 +487,15 @@ Decide on type of Slices
     }
 
 
-    void ByteCodeGenerator::Constant(int /*value*/)
+    void ByteCodeGenerator::Constant(int value)
     {
         EnsureSealed(false);
-        throw NotImplemented("Constant opcode not implemented.");
+        if (value != 0 && value != -1)
+        {
+            throw NotImplemented("ByteCodeGenerator supports only the constants 0 and -1.");
+        }
+        m_code.emplace_back(
+            ByteCodeInterpreter::Opcode::Constant, 0, 0, value != 0);
     }
 
 
@@ -431,8 +559,7 @@ Decide on type of Slices
         CHECK_LT(label, m_jumpOffsets.size())
             << "Call to unknown label " << label;
 
-        m_code.emplace_back(
-            ByteCodeInterpreter::Opcode::Call, label);
+        Emit(ByteCodeInterpreter::Opcode::Call, label, 0, false);
     }
 
 
@@ -442,8 +569,7 @@ Decide on type of Slices
         CHECK_LT(label, m_jumpOffsets.size())
             << "Jmp to unknown label " << label;
 
-        m_code.emplace_back(
-            ByteCodeInterpreter::Opcode::Jmp, label);
+        Emit(ByteCodeInterpreter::Opcode::Jmp, label, 0, false);
     }
 
 
@@ -453,8 +579,7 @@ Decide on type of Slices
         CHECK_LT(label, m_jumpOffsets.size())
             << "Jnz to unknown label " << label;
 
-        m_code.emplace_back(
-            ByteCodeInterpreter::Opcode::Jnz, label);
+        Emit(ByteCodeInterpreter::Opcode::Jnz, label, 0, false);
     }
 
 
@@ -464,8 +589,7 @@ Decide on type of Slices
         CHECK_LT(label, m_jumpOffsets.size())
             << "Jz to unknown label " << label;
 
-        m_code.emplace_back(
-            ByteCodeInterpreter::Opcode::Jz, label);
+        Emit(ByteCodeInterpreter::Opcode::Jz, label, 0, false);
     }
 
 
@@ -477,6 +601,26 @@ Decide on type of Slices
     }
 
 
+    void ByteCodeGenerator::Emit(ByteCodeInterpreter::Opcode opcode,
+                                 size_t row,
+                                 size_t delta,
+                                 bool inverted)
+    {
+        if (ByteCodeInterpreter::Instruction::IsCompact(row, delta))
+        {
+            m_code.emplace_back(opcode, row, delta, inverted);
+        }
+        else
+        {
+            m_code.push_back(
+                ByteCodeInterpreter::Instruction::Extended(opcode,
+                                                           m_operands.size(),
+                                                           inverted));
+            m_operands.push_back({ row, delta });
+        }
+    }
+
+
     void ByteCodeGenerator::EnsureSealed(bool sealed) const
     {
         CHECK_EQ(sealed, m_sealed)
@@ -24,6 +24,7 @@
 
 #include <stddef.h>                         // size_t, ptrdiff_t parameter.
 #include <stdint.h>                         // uint32_t embedded.
+#include <memory>                           // std::unique_ptr embedded.
 #include <vector>
 
 #include "BitFunnel/BitFunnelTypes.h"       // Rank parameter.
@@ -35,6 +36,7 @@ namespace BitFunnel
 {
     class ByteCodeGenerator;
     class IResultsProcessor;
+    class WideWordInterpreter;
 
     //*************************************************************************
     //
@@ -64,19 +66,47 @@ namespace BitFunnel
         // NOTE: This method is a work-in-progress. It will eventually take
         // some sort of IResultsProcessor callback and an array of Shard
         // buffer pointers.
+        //
+        // If allowWideWords is false, every iteration is run by the scalar
+        // interpreter, even when a WideWordInterpreter could be used.
         ByteCodeInterpreter(ByteCodeGenerator const & code,
                             IResultsProcessor & resultsProcessor,
                             size_t sliceCount,
                             char * const * sliceBuffers,
                             size_t iterationsPerSlice,
-                            ptrdiff_t const * rowOffsets);
+                            ptrdiff_t const * rowOffsets,
+                            bool allowWideWords = true);
+
+        ~ByteCodeInterpreter();
+
+        // Returns true if a ByteCodeInterpreter constructed with
+        // allowWideWords would run most iterations of the code with a
+        // WideWordInterpreter on this processor.
+        static bool UsesWideWords(ByteCodeGenerator const & code,
+                                  size_t iterationsPerSlice);
 
         // Runs the instruction sequence for a specified number of iterations.
         // Each iteration processes a single quadword of row data at the
         // highest rank in the plan.  Returns true to indicate early
         // termination.
+        //
+        // When the processor supports AVX2 or AVX-512 and the plan has no
+        // rank down operations, most iterations are instead run by a
+        // WideWordInterpreter, four or eight quadwords at a time.
         bool Run();
 
+        // Processes a single slice. Run() calls this method for each slice
+        // in turn. Callers that distribute slices across threads may call
+        // it directly, in any order. Returns true to indicate early
+        // termination.
+        bool ProcessOneSlice(size_t slice);
+
+        // Processes iterations [begin, end) of a single slice. Splitting a
+        // slice into ranges allows several matchers to take turns on the
+        // same part of a slice while it is in cache. Returns true to
+        // indicate early termination.
+        bool ProcessIterations(size_t slice, size_t begin, size_t end);
+
         // Virtual machine opcodes. With the exception of the End opcode,
         // these values have a 1:1 correspondance with the ICodeGenerator
         // methods.
@@ -104,6 +134,15 @@ namespace BitFunnel
             Last
         };
 
+        // Row and delta values that do not fit in the compact fields of an
+        // Instruction are kept in the ByteCodeGenerator's operand table. The
+        // row field also holds offset shifts and jump labels.
+        struct ExtendedOperand
+        {
+            size_t m_row;
+            size_t m_delta;
+        };
+
         // Instruction class represents a virtual machine instruction.
         // DESIGN GOALS:
         //   No virtual methods allow for compiler optimizations across calls.
@@ -111,6 +150,11 @@ namespace BitFunnel
         //   Fast member access.
         //   Fixed size.
         //   Small size (sizeof(Instruction) == sizeof(uint32_t).
+        //
+        // An instruction is either compact, holding its row and delta
+        // directly, or extended, holding the index of an ExtendedOperand.
+        // Extended instructions are only needed by plans with more than
+        // c_maxRowValue rows or labels, so the common case stays compact.
         class Instruction
         {
         private:
@@ -124,22 +168,63 @@ namespace BitFunnel
             static const uint32_t c_deltaBits = 4;
             static const size_t c_maxDeltaValue = (1ull << c_deltaBits) - 1;
 
+            // Bits that hold the high part of an extended operand index.
+            static const uint32_t c_operandHighBits =
+                32 - c_opCodeBits - c_rowBits - c_deltaBits - 2;
+            static const size_t c_maxOperandIndex =
+                (1ull << (c_rowBits + c_deltaBits + c_operandHighBits)) - 1;
+
+            // Rank deltas and offset shifts never exceed c_maxRankValue.
+            static_assert(c_maxRankValue <= c_maxDeltaValue,
+                          "Instruction::m_delta cannot hold every rank delta.");
+            static_assert(c_maxRankValue <= c_maxRowValue,
+                          "Instruction::m_row cannot hold every offset shift.");
+
         public:
             Instruction(Opcode opcode, size_t row = 0ul, size_t delta = 0ul, bool inverted = false)
               : m_opcode(static_cast<uint32_t>(opcode)),
                 m_row(static_cast<uint32_t>(row)),
                 m_delta(static_cast<uint32_t>(delta)),
-                m_inverted(inverted ? 1 : 0)
+                m_inverted(inverted ? 1 : 0),
+                m_extended(0),
+                m_operandHigh(0)
             {
                 CHECK_LT(opcode, Opcode::Last)
                     << "Unknown opcode " << opcode;
 
-                // TODO:
-                // CHECK_LE(row, c_maxRowValue)
-                //     << "row " << row << " out of range.";
+                // Values that do not fit would be silently truncated by the
+                // bit fields. Use Extended() for them instead.
+                CHECK_LE(row, static_cast<size_t>(c_maxRowValue))
+                    << "row " << row << " out of range.";
 
-                // CHECK_LE(delta, c_maxDeltaValue)
-                //     << "delta " << delta << " out of range.";
+                CHECK_LE(delta, static_cast<size_t>(c_maxDeltaValue))
+                    << "delta " << delta << " out of range.";
+            }
+
+            // Returns true if row and delta can be held by a compact
+            // instruction.
+            static bool IsCompact(size_t row, size_t delta)
+            {
+                return row <= c_maxRowValue && delta <= c_maxDeltaValue;
+            }
+
+            // Constructs an extended instruction whose row and delta are
+            // held by the ExtendedOperand at operandIndex.
+            static Instruction Extended(Opcode opcode,
+                                        size_t operandIndex,
+                                        bool inverted)
+            {
+                CHECK_LE(operandIndex, static_cast<size_t>(c_maxOperandIndex))
+                    << "operand index " << operandIndex << " out of range.";
+
+                Instruction instruction(opcode, 0, 0, inverted);
+                instruction.m_extended = 1;
+                instruction.m_row = static_cast<uint32_t>(operandIndex & c_maxRowValue);
+                instruction.m_delta =
+                    static_cast<uint32_t>((operandIndex >> c_rowBits) & c_maxDeltaValue);
+                instruction.m_operandHigh =
+                    static_cast<uint32_t>(operandIndex >> (c_rowBits + c_deltaBits));
+                return instruction;
             }
 
             Opcode GetOpcode() const
@@ -147,6 +232,8 @@ namespace BitFunnel
                 return static_cast<Opcode>(m_opcode);
             }
 
+            // GetRow() and GetDelta() are only meaningful for compact
+            // instructions.
             unsigned GetRow() const
             {
                 return m_row;
@@ -162,27 +249,44 @@ namespace BitFunnel
                 return m_inverted == 1ul;
             }
 
+            bool IsExtended() const
+            {
+                return m_extended == 1ul;
+            }
+
+            // Only meaningful for extended instructions.
+            size_t GetOperandIndex() const
+            {
+                return static_cast<size_t>(m_row)
+                    | (static_cast<size_t>(m_delta) << c_rowBits)
+                    | (static_cast<size_t>(m_operandHigh) << (c_rowBits + c_deltaBits));
+            }
+
         private:
             uint32_t m_opcode : c_opCodeBits;
             uint32_t m_row : c_rowBits;
             uint32_t m_delta : c_deltaBits;
             uint32_t m_inverted : 1;
+            uint32_t m_extended : 1;
+            uint32_t m_operandHigh : c_operandHighBits;
         };
 
     private:
-        //  Returns true to indicate early termination.
-        bool ProcessOneSlice(size_t slice);
-
         // Executes the instruction sequence for the specified iteration
         // number. Returns true to indicate early termination.
         bool RunOneIteration(char const * sliceBuffer, size_t iteration);
 
+        // Returns the number of quadwords in the widest words supported by
+        // the processor that fit in a slice.
+        static size_t GetWideWordLaneCount(size_t iterationsPerSlice);
+
         //
         // Cached constructor parameters.
         //
 
         std::vector<Instruction> const & m_code;
         std::vector<Instruction const *> const & m_jumpTable;
+        std::vector<ExtendedOperand> const & m_operands;
 
         IResultsProcessor & m_resultsProcessor;
 
@@ -192,6 +296,10 @@ namespace BitFunnel
 
         ptrdiff_t const * m_rowOffsets;
 
+        // Runs the plan several quadwords at a time. nullptr if the plan or
+        // processor does not support wide words.
+        std::unique_ptr<WideWordInterpreter> m_wideWordInterpreter;
+
 
         //
         // Virtual machine state.
@@ -209,10 +317,14 @@ namespace BitFunnel
         uint64_t m_accumulator;
 
         // Control flow call stack. Holds return addresses for calls.
-        std::vector<Instruction const *> m_callStack;
+        // Capacity is determined by ByteCodeGenerator::Seal().
+        std::unique_ptr<Instruction const *[]> m_callStack;
+        Instruction const * * m_callStackTop;
 
         // 64-bit value stack for Rank0 methods.
-        std::vector<uint64_t> m_valueStack;
+        // Capacity is determined by ByteCodeGenerator::Seal().
+        std::unique_ptr<uint64_t[]> m_valueStack;
+        uint64_t * m_valueStackTop;
 
         // TODO: Formalize definition and usage of zero flag.
         bool m_zeroFlag;
@@ -265,6 +377,27 @@ namespace BitFunnel
         // calling this method.
         std::vector<ByteCodeInterpreter::Instruction const *> const & GetJumpTable() const;
 
+        // Returns the operands referenced by extended instructions. Class
+        // must be sealed before calling this method.
+        std::vector<ByteCodeInterpreter::ExtendedOperand> const & GetOperands() const;
+
+        // Return the row and delta of an instruction in this generator's
+        // code, whether it is compact or extended. For shifts the row is the
+        // shift, and for jumps and calls it is the label.
+        size_t GetRow(ByteCodeInterpreter::Instruction const & instruction) const;
+        size_t GetDelta(ByteCodeInterpreter::Instruction const & instruction) const;
+
+        // Returns upper bounds on the depth of the value stack and the call
+        // stack during execution of the instructions. Class must be sealed
+        // before calling these methods.
+        //
+        // The bounds are derived from the number of Push and Call
+        // instructions in the code. This is sufficient because the code is
+        // free of recursion and backward jumps, and every subroutine leaves
+        // the value stack balanced.
+        size_t GetMaxValueStackDepth() const;
+        size_t GetMaxCallStackDepth() const;
+
         //
         // ICodeGenerator methods
         //
@@ -304,9 +437,19 @@ namespace BitFunnel
     private:
         void EnsureSealed(bool sealed) const;
 
+        // Appends a compact instruction when row and delta fit, and an
+        // extended instruction otherwise.
+        void Emit(ByteCodeInterpreter::Opcode opcode,
+                  size_t row,
+                  size_t delta,
+                  bool inverted);
+
         bool m_sealed;
         std::vector<ByteCodeInterpreter::Instruction> m_code;
+        std::vector<ByteCodeInterpreter::ExtendedOperand> m_operands;
         std::vector<size_t> m_jumpOffsets;
         std::vector<ByteCodeInterpreter::Instruction const *> m_jumpTable;
+        size_t m_maxValueStackDepth;
+        size_t m_maxCallStackDepth;
     };
 }
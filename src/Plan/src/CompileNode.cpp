@@ -48,6 +48,7 @@ namespace BitFunnel
 
         // RankZero nodes.
         "AndTree",
+        "Constant",
         "LoadRow",
         "Not",
         "OrTree"
@@ -116,6 +117,8 @@ namespace BitFunnel
             return &ParseNode<Report>(parser);
         case opAndTree:
             return &AndTree::Parse(parser);
+        case opConstant:
+            return &ParseNode<Constant>(parser);
         case opLoadRow:
             return &ParseNode<LoadRow>(parser);
         case opNot:
@@ -403,12 +406,24 @@ namespace BitFunnel
     }
 
 
-    void CompileNode::RankDown::Compile(ICodeGenerator & code) const
+    // Largest rank delta whose calls to the child are unrolled. Larger
+    // deltas are compiled as nested RankDowns, so that a rank 6 to rank 0
+    // transition emits 16 call sites instead of 64. The nesting visits the
+    // offsets in the same order.
+    static const Rank c_maxUnrolledRankDelta = 3;
+
+
+    static void CompileRankDown(ICodeGenerator & code,
+                                Rank delta,
+                                CompileNode const & child)
     {
-        code.LeftShiftOffset(m_delta);
+        const Rank unrolled =
+            (delta < c_maxUnrolledRankDelta) ? delta : c_maxUnrolledRankDelta;
+
+        code.LeftShiftOffset(unrolled);
         ICodeGenerator::Label label0 = code.AllocateLabel();
 
-        unsigned iterations = (1 << m_delta) - 1;
+        unsigned iterations = (1 << unrolled) - 1;
         for (unsigned i = 0; i < iterations; ++i)
         {
             code.Push();
@@ -420,10 +435,23 @@ namespace BitFunnel
         ICodeGenerator::Label label1 = code.AllocateLabel();
         code.Jmp(label1);
         code.PlaceLabel(label0);
-        m_child.Compile(code);
+        if (delta > unrolled)
+        {
+            CompileRankDown(code, delta - unrolled, child);
+        }
+        else
+        {
+            child.Compile(code);
+        }
         code.Return();
         code.PlaceLabel(label1);
-        code.RightShiftOffset(m_delta);
+        code.RightShiftOffset(unrolled);
+    }
+
+
+    void CompileNode::RankDown::Compile(ICodeGenerator & code) const
+    {
+        CompileRankDown(code, m_delta, m_child);
     }
 
 
@@ -554,6 +582,55 @@ namespace BitFunnel
     }
 
 
+    //*************************************************************************
+    //
+    // CompileNode::Constant
+    //
+    //*************************************************************************
+    const char* CompileNode::Constant::c_valueFieldName = "Value";
+
+
+    CompileNode::Constant::Constant(int value)
+        : m_value(value)
+    {
+    }
+
+
+    CompileNode::Constant::Constant(IObjectParser& parser)
+        : m_value((parser.OpenObject(),
+                   ParseObjectField<int>(parser, c_valueFieldName)))
+    {
+        parser.CloseObject();
+    }
+
+
+    void CompileNode::Constant::Format(IObjectFormatter& formatter) const
+    {
+        formatter.OpenObject(*this);
+        formatter.OpenObjectField(c_valueFieldName);
+        formatter.Format(m_value);
+        formatter.CloseObject();
+    }
+
+
+    void CompileNode::Constant::Compile(ICodeGenerator & code) const
+    {
+        code.Constant(m_value);
+    }
+
+
+    CompileNode::NodeType CompileNode::Constant::GetType() const
+    {
+        return CompileNode::opConstant;
+    }
+
+
+    int CompileNode::Constant::GetValue() const
+    {
+        return m_value;
+    }
+
+
     //*************************************************************************
     //
     // CompileNode::LoadRow
@@ -56,6 +56,7 @@ namespace BitFunnel
 
         // RankZero nodes
         class AndTree;
+        class Constant;
         class LoadRow;
         class Not;
         class OrTree;
@@ -77,6 +78,7 @@ namespace BitFunnel
 
             // RankZero operations
             opAndTree,
+            opConstant,
             opLoadRow,
             opNot,
             opOrTree,
@@ -271,6 +273,29 @@ namespace BitFunnel
     };
 
 
+    // Constant loads the accumulator with a fixed value. The planner emits
+    // it in place of a match tree that folds down to a constant, so that a
+    // query that can never match compiles to a program with no row reads.
+    class CompileNode::Constant : public CompileNode
+    {
+    public:
+        Constant(int value);
+        Constant(IObjectParser& parser);
+
+        void Format(IObjectFormatter& formatter) const;
+        void Compile(ICodeGenerator& codeGenerator) const;
+
+        NodeType GetType() const;
+
+        int GetValue() const;
+
+    private:
+        int m_value;
+
+        static char const * c_valueFieldName;
+    };
+
+
     class CompileNode::LoadRow : public CompileNode
     {
     public:
@@ -0,0 +1,224 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <new>                                  // Placement new.
+
+#include "BitFunnel/Allocators/IAllocator.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Plan/AbstractRow.h"
+#include "BitFunnel/Plan/IPlanRows.h"
+#include "ConstantFolder.h"
+#include "LoggerInterfaces/Logging.h"
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // ConstantFolder
+    //
+    //*************************************************************************
+    RowMatchNode const * ConstantFolder::Fold(RowMatchNode const & root,
+                                              IPlanRows const & planRows,
+                                              IAllocator & allocator)
+    {
+        ConstantFolder folder(planRows, allocator);
+
+        Value value;
+        RowMatchNode const & folded = folder.FoldNode(root, value);
+
+        return (value == MatchNone) ? nullptr : &folded;
+    }
+
+
+    ConstantFolder::ConstantFolder(IPlanRows const & planRows,
+                                   IAllocator & allocator)
+        : m_planRows(planRows),
+          m_allocator(allocator)
+    {
+        for (ShardId shard = 0; shard < planRows.GetShardCount(); ++shard)
+        {
+            ITermTable const & termTable = planRows.GetTermTable(shard);
+            RowIdSequence matchAll(termTable.GetMatchAllTerm(), termTable);
+            RowIdSequence matchNone(termTable.GetMatchNoneTerm(), termTable);
+
+            m_matchAllRows.push_back(*matchAll.begin());
+            m_matchNoneRows.push_back(*matchNone.begin());
+        }
+    }
+
+
+    RowMatchNode const & ConstantFolder::FoldNode(RowMatchNode const & node,
+                                                  Value & value)
+    {
+        switch (node.GetType())
+        {
+        case RowMatchNode::AndMatch:
+            return FoldAnd(dynamic_cast<RowMatchNode::And const &>(node), value);
+        case RowMatchNode::NotMatch:
+            return FoldNot(dynamic_cast<RowMatchNode::Not const &>(node), value);
+        case RowMatchNode::OrMatch:
+            return FoldOr(dynamic_cast<RowMatchNode::Or const &>(node), value);
+        case RowMatchNode::RowMatch:
+            value = Classify(dynamic_cast<RowMatchNode::Row const &>(node).GetRow());
+            return node;
+        default:
+            LogAbortB("ConstantFolder: invalid node type.");
+        }
+
+        // Unreachable.
+        value = Variable;
+        return node;
+    }
+
+
+    RowMatchNode const & ConstantFolder::FoldAnd(RowMatchNode::And const & node,
+                                                 Value & value)
+    {
+        Value leftValue;
+        RowMatchNode const & left = FoldNode(node.GetLeft(), leftValue);
+        Value rightValue;
+        RowMatchNode const & right = FoldNode(node.GetRight(), rightValue);
+
+        if (leftValue == MatchNone)
+        {
+            value = MatchNone;
+            return left;
+        }
+        else if (rightValue == MatchNone)
+        {
+            value = MatchNone;
+            return right;
+        }
+        else if (leftValue == MatchAll)
+        {
+            value = rightValue;
+            return right;
+        }
+        else if (rightValue == MatchAll)
+        {
+            value = leftValue;
+            return left;
+        }
+
+        value = Variable;
+        if (&left == &node.GetLeft() && &right == &node.GetRight())
+        {
+            return node;
+        }
+        return *new (m_allocator.Allocate(sizeof(RowMatchNode::And)))
+                    RowMatchNode::And(left, right);
+    }
+
+
+    RowMatchNode const & ConstantFolder::FoldNot(RowMatchNode::Not const & node,
+                                                 Value & value)
+    {
+        Value childValue;
+        RowMatchNode const & child = FoldNode(node.GetChild(), childValue);
+
+        value = (childValue == MatchAll) ? MatchNone :
+                (childValue == MatchNone) ? MatchAll : Variable;
+
+        // Builder folds Not(Not(x)) into x and Not(row) into an inverted row.
+        if (&child == &node.GetChild()
+            && child.GetType() != RowMatchNode::NotMatch
+            && child.GetType() != RowMatchNode::RowMatch)
+        {
+            return node;
+        }
+
+        RowMatchNode::Builder builder(RowMatchNode::NotMatch, m_allocator);
+        builder.AddChild(&child);
+        return *builder.Complete();
+    }
+
+
+    RowMatchNode const & ConstantFolder::FoldOr(RowMatchNode::Or const & node,
+                                                Value & value)
+    {
+        Value leftValue;
+        RowMatchNode const & left = FoldNode(node.GetLeft(), leftValue);
+        Value rightValue;
+        RowMatchNode const & right = FoldNode(node.GetRight(), rightValue);
+
+        if (leftValue == MatchAll)
+        {
+            value = MatchAll;
+            return left;
+        }
+        else if (rightValue == MatchAll)
+        {
+            value = MatchAll;
+            return right;
+        }
+        else if (leftValue == MatchNone)
+        {
+            value = rightValue;
+            return right;
+        }
+        else if (rightValue == MatchNone)
+        {
+            value = leftValue;
+            return left;
+        }
+
+        value = Variable;
+        if (&left == &node.GetLeft() && &right == &node.GetRight())
+        {
+            return node;
+        }
+        return *new (m_allocator.Allocate(sizeof(RowMatchNode::Or)))
+                    RowMatchNode::Or(left, right);
+    }
+
+
+    ConstantFolder::Value ConstantFolder::Classify(AbstractRow const & row) const
+    {
+        // A row is only constant if it is the same system row in every shard.
+        Value value = Variable;
+        for (ShardId shard = 0; shard < m_planRows.GetShardCount(); ++shard)
+        {
+            RowId const & physical = m_planRows.PhysicalRow(shard, row.GetId());
+
+            Value shardValue = (physical == m_matchAllRows[shard]) ? MatchAll :
+                               (physical == m_matchNoneRows[shard]) ? MatchNone :
+                               Variable;
+
+            if (shardValue == Variable
+                || (shard > 0 && shardValue != value))
+            {
+                return Variable;
+            }
+            value = shardValue;
+        }
+
+        if (row.IsInverted() && value != Variable)
+        {
+            value = (value == MatchAll) ? MatchNone : MatchAll;
+        }
+
+        return value;
+    }
+}
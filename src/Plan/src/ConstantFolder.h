@@ -0,0 +1,97 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <vector>                           // std::vector embedded.
+
+#include "BitFunnel/Index/RowId.h"          // RowId embedded.
+#include "BitFunnel/NonCopyable.h"          // Inherits from NonCopyable.
+#include "BitFunnel/Plan/RowMatchNode.h"    // RowMatchNode return value.
+
+
+namespace BitFunnel
+{
+    class AbstractRow;
+    class IAllocator;
+    class IPlanRows;
+
+    //*************************************************************************
+    //
+    // ConstantFolder simplifies a tree of RowMatchNodes by evaluating the
+    // system rows whose values are known in advance. A row is constant when
+    // it maps to the match-all or match-none row of the TermTable in every
+    // shard.
+    //
+    // The following rules are applied bottom up:
+    //   And with a match-all child reduces to the other child.
+    //   And with a match-none child reduces to match-none.
+    //   Or with a match-none child reduces to the other child.
+    //   Or with a match-all child reduces to match-all.
+    //   Not of a constant is the opposite constant.
+    //   Not of a Not reduces to the grandchild.
+    //
+    // Fold() is intended to run on the output of TermPlanConverter, before
+    // MatchTreeRewriter. The tree must not contain Report nodes.
+    //
+    //*************************************************************************
+    class ConstantFolder : NonCopyable
+    {
+    public:
+        // Returns the simplified tree, or nullptr if the tree can never
+        // match a document. A tree that matches every document reduces to a
+        // single match-all row. Nodes in the returned tree are shared with
+        // the input tree or created in memory from the allocator.
+        static RowMatchNode const * Fold(RowMatchNode const & root,
+                                         IPlanRows const & planRows,
+                                         IAllocator & allocator);
+
+    private:
+        enum Value
+        {
+            Variable,
+            MatchAll,
+            MatchNone
+        };
+
+        ConstantFolder(IPlanRows const & planRows, IAllocator & allocator);
+
+        // Returns the folded form of node and sets value to its value. The
+        // returned node is never nullptr. When value is MatchAll or
+        // MatchNone, the node is a witness that evaluates to that constant.
+        RowMatchNode const & FoldNode(RowMatchNode const & node, Value & value);
+
+        RowMatchNode const & FoldAnd(RowMatchNode::And const & node, Value & value);
+        RowMatchNode const & FoldNot(RowMatchNode::Not const & node, Value & value);
+        RowMatchNode const & FoldOr(RowMatchNode::Or const & node, Value & value);
+
+        Value Classify(AbstractRow const & row) const;
+
+        IPlanRows const & m_planRows;
+        IAllocator & m_allocator;
+
+        // RowIds of the match-all and match-none rows of each shard.
+        std::vector<RowId> m_matchAllRows;
+        std::vector<RowId> m_matchNoneRows;
+    };
+}
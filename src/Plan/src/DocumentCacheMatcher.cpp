@@ -0,0 +1,344 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>    // std::find(), std::sort()
+#include <memory>
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/IDocument.h"
+#include "BitFunnel/Index/IDocumentCache.h"
+#include "BitFunnel/Plan/Factories.h"
+#include "BitFunnel/Plan/TermMatchNode.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/ITaskProcessor.h"
+#include "BitFunnel/Utilities/IThreadPool.h"
+#include "DocumentCacheMatcher.h"
+#include "LoggerInterfaces/Check.h"
+#include "PhraseTerms.h"
+#include "SliceScheduler.h"
+
+
+namespace BitFunnel
+{
+    std::vector<DocId> Factories::MatchDocumentCache(
+        TermMatchNode const & tree,
+        IConfiguration const & configuration,
+        IDocumentCache const & cache,
+        size_t threadCount,
+        IThreadPool * threadPool)
+    {
+        DocumentCacheMatcher matcher(tree, configuration);
+        return matcher.Run(cache, threadCount, threadPool);
+    }
+
+
+    //*************************************************************************
+    //
+    // DocumentCacheTask matches the blocks handed to one worker by a
+    // SliceScheduler.
+    //
+    //*************************************************************************
+    class DocumentCacheTask : public ITaskProcessor, NonCopyable
+    {
+    public:
+        DocumentCacheTask(DocumentCacheMatcher const & matcher,
+                          std::vector<DocumentCacheMatcher::Entry> const & entries,
+                          SliceScheduler & scheduler);
+
+        std::vector<DocId> const & GetMatches() const;
+
+        //
+        // ITaskProcessor methods
+        //
+
+        virtual void ProcessTask(size_t taskId) override;
+        virtual void Finished() override;
+
+    private:
+        DocumentCacheMatcher const & m_matcher;
+        std::vector<DocumentCacheMatcher::Entry> const & m_entries;
+        SliceScheduler & m_scheduler;
+
+        // This worker's copy of the query's terms.
+        std::vector<Term> m_terms;
+
+        std::vector<DocId> m_matches;
+    };
+
+
+    DocumentCacheTask::DocumentCacheTask(
+        DocumentCacheMatcher const & matcher,
+        std::vector<DocumentCacheMatcher::Entry> const & entries,
+        SliceScheduler & scheduler)
+      : m_matcher(matcher),
+        m_entries(entries),
+        m_scheduler(scheduler),
+        m_terms(matcher.GetTerms())
+    {
+    }
+
+
+    std::vector<DocId> const & DocumentCacheTask::GetMatches() const
+    {
+        return m_matches;
+    }
+
+
+    void DocumentCacheTask::ProcessTask(size_t taskId)
+    {
+        const size_t blockSize = DocumentCacheMatcher::c_blockSize;
+
+        size_t block;
+        while (m_scheduler.TryGetSlice(taskId, block))
+        {
+            const size_t first = block * blockSize;
+            const size_t count = (std::min)(blockSize, m_entries.size() - first);
+
+            uint64_t matches = m_matcher.Match(m_entries.data() + first,
+                                               count,
+                                               m_terms);
+            for (size_t i = 0; matches != 0; ++i, matches >>= 1)
+            {
+                if (matches & 1ull)
+                {
+                    m_matches.push_back(m_entries[first + i].second);
+                }
+            }
+        }
+    }
+
+
+    void DocumentCacheTask::Finished()
+    {
+    }
+
+
+    //*************************************************************************
+    //
+    // DocumentCacheMatcher
+    //
+    //*************************************************************************
+    DocumentCacheMatcher::DocumentCacheMatcher(
+        TermMatchNode const & tree,
+        IConfiguration const & configuration)
+      : m_configuration(configuration)
+    {
+        Compile(tree);
+    }
+
+
+    std::vector<DocId> DocumentCacheMatcher::Run(IDocumentCache const & cache,
+                                                 size_t threadCount,
+                                                 IThreadPool * threadPool) const
+    {
+        // Snapshot the cache. Documents added after this point are not
+        // matched.
+        std::vector<Entry> entries;
+        for (auto entry : cache)
+        {
+            entries.push_back(Entry(&entry.first, entry.second));
+        }
+
+        const size_t blockCount = (entries.size() + c_blockSize - 1) / c_blockSize;
+
+        std::unique_ptr<IThreadPool> localThreadPool;
+        if (threadCount > 1 && threadPool == nullptr)
+        {
+            localThreadPool = Factories::CreateThreadPool(threadCount - 1);
+            threadPool = localThreadPool.get();
+        }
+
+        size_t workerCount = 1;
+        if (threadPool != nullptr)
+        {
+            workerCount = (std::min)(threadCount, threadPool->GetThreadCount() + 1);
+            workerCount = (std::max)((std::min)(workerCount, blockCount),
+                                     static_cast<size_t>(1));
+        }
+
+        SliceScheduler scheduler(blockCount, workerCount);
+
+        std::vector<std::unique_ptr<DocumentCacheTask>> processors;
+        std::vector<ITaskProcessor*> tasks;
+        for (size_t i = 0; i < workerCount; ++i)
+        {
+            processors.emplace_back(new DocumentCacheTask(*this, entries, scheduler));
+            tasks.push_back(processors.back().get());
+        }
+
+        if (workerCount == 1)
+        {
+            processors[0]->ProcessTask(0);
+        }
+        else
+        {
+            threadPool->Run(tasks);
+        }
+
+        std::vector<DocId> matches;
+        for (auto const & processor : processors)
+        {
+            auto const & workerMatches = processor->GetMatches();
+            matches.insert(matches.end(), workerMatches.begin(), workerMatches.end());
+        }
+        std::sort(matches.begin(), matches.end());
+
+        return matches;
+    }
+
+
+    uint64_t DocumentCacheMatcher::Match(Entry const * entries,
+                                         size_t count,
+                                         std::vector<Term> & terms) const
+    {
+        CHECK_LE(count, static_cast<size_t>(c_blockSize))
+            << "DocumentCacheMatcher::Match(): too many documents.";
+
+        std::vector<uint64_t> masks(terms.size(), 0);
+        for (size_t i = 0; i < count; ++i)
+        {
+            IDocument const & document = *entries[i].first;
+            for (size_t t = 0; t < terms.size(); ++t)
+            {
+                if (document.Contains(terms[t]))
+                {
+                    masks[t] |= (1ull << i);
+                }
+            }
+        }
+
+        std::vector<uint64_t> stack;
+        stack.reserve(m_program.size());
+        for (auto const & instruction : m_program)
+        {
+            switch (instruction.m_opcode)
+            {
+            case Opcode::Term:
+                stack.push_back(masks[instruction.m_term]);
+                break;
+            case Opcode::And:
+                {
+                    const uint64_t right = stack.back();
+                    stack.pop_back();
+                    stack.back() &= right;
+                }
+                break;
+            case Opcode::Not:
+                stack.back() = ~stack.back();
+                break;
+            case Opcode::Or:
+                {
+                    const uint64_t right = stack.back();
+                    stack.pop_back();
+                    stack.back() |= right;
+                }
+                break;
+            }
+        }
+
+        // Not sets the bits beyond the last document.
+        const uint64_t valid =
+            (count == c_blockSize) ? ~0ull : ((1ull << count) - 1);
+        return stack.back() & valid;
+    }
+
+
+    std::vector<Term> const & DocumentCacheMatcher::GetTerms() const
+    {
+        return m_terms;
+    }
+
+
+    //
+    // private methods
+    //
+
+    void DocumentCacheMatcher::Compile(TermMatchNode const & node)
+    {
+        switch (node.GetType())
+        {
+        case TermMatchNode::AndMatch:
+            {
+                auto const & andNode = dynamic_cast<const TermMatchNode::And&>(node);
+                Compile(andNode.GetLeft());
+                Compile(andNode.GetRight());
+                m_program.push_back({ Opcode::And, 0 });
+            }
+            break;
+        case TermMatchNode::NotMatch:
+            {
+                auto const & notNode = dynamic_cast<const TermMatchNode::Not&>(node);
+                Compile(notNode.GetChild());
+                m_program.push_back({ Opcode::Not, 0 });
+            }
+            break;
+        case TermMatchNode::OrMatch:
+            {
+                auto const & orNode = dynamic_cast<const TermMatchNode::Or&>(node);
+                Compile(orNode.GetLeft());
+                Compile(orNode.GetRight());
+                m_program.push_back({ Opcode::Or, 0 });
+            }
+            break;
+        case TermMatchNode::PhraseMatch:
+            {
+                // A document matches a phrase if it contains each of the
+                // phrase's n-grams.
+                auto const & phraseNode = dynamic_cast<const TermMatchNode::Phrase&>(node);
+                auto terms = GetPhraseTerms(phraseNode, m_configuration);
+                for (size_t i = 0; i < terms.size(); ++i)
+                {
+                    AddTerm(terms[i]);
+                    if (i > 0)
+                    {
+                        m_program.push_back({ Opcode::And, 0 });
+                    }
+                }
+            }
+            break;
+        case TermMatchNode::UnigramMatch:
+            {
+                auto const & unigramNode = dynamic_cast<const TermMatchNode::Unigram&>(node);
+                AddTerm(Term(unigramNode.GetText(),
+                             unigramNode.GetStreamId(),
+                             m_configuration));
+            }
+            break;
+        default:
+            RecoverableError error("DocumentCacheMatcher: Invalid node type.");
+            throw error;
+        }
+    }
+
+
+    void DocumentCacheMatcher::AddTerm(Term const & term)
+    {
+        auto it = std::find(m_terms.begin(), m_terms.end(), term);
+        const size_t index = static_cast<size_t>(it - m_terms.begin());
+        if (it == m_terms.end())
+        {
+            m_terms.push_back(term);
+        }
+        m_program.push_back({ Opcode::Term, index });
+    }
+}
@@ -0,0 +1,117 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#pragma once
+
+#include <stddef.h>                     // size_t parameter.
+#include <stdint.h>                     // uint64_t return value.
+#include <utility>                      // std::pair in typedef.
+#include <vector>                       // std::vector embedded.
+
+#include "BitFunnel/BitFunnelTypes.h"   // DocId return value.
+#include "BitFunnel/NonCopyable.h"      // Base class.
+#include "BitFunnel/Term.h"             // Term embedded.
+
+
+namespace BitFunnel
+{
+    class IConfiguration;
+    class IDocument;
+    class IDocumentCache;
+    class IThreadPool;
+    class TermMatchNode;
+
+
+    //*************************************************************************
+    //
+    // DocumentCacheMatcher finds the documents in an IDocumentCache that
+    // match a query. It computes the same result as applying
+    // TermMatchTreeEvaluator to each document, and is used as the ground
+    // truth when verifying the index.
+    //
+    // The query's terms, including the n-grams of its phrases, are
+    // constructed and hashed once, when the matcher is constructed. The tree
+    // is flattened into a postfix program over these terms. Documents are
+    // matched in blocks of 64. Each term is looked up once in each
+    // document's postings, giving one 64-bit mask per term, and the program
+    // combines the masks with bitwise operations, so that And, Or, and Not
+    // cost one instruction per block instead of one tree walk per document.
+    //
+    // The blocks are divided among up to threadCount threads (see
+    // SliceScheduler). If threadPool is nullptr and threadCount is greater
+    // than one, a pool is created for the duration of the call. The matches
+    // are returned in increasing DocId order.
+    //
+    //*************************************************************************
+    class DocumentCacheMatcher : NonCopyable
+    {
+    public:
+        typedef std::pair<IDocument const *, DocId> Entry;
+
+        DocumentCacheMatcher(TermMatchNode const & tree,
+                             IConfiguration const & configuration);
+
+        std::vector<DocId> Run(IDocumentCache const & cache,
+                               size_t threadCount = 1,
+                               IThreadPool * threadPool = nullptr) const;
+
+        // Returns a mask with bit i set if entries[i] matches. count must not
+        // exceed c_blockSize. terms is a copy of GetTerms(), owned by the
+        // calling thread, since IDocument::Contains() takes a non-const Term.
+        uint64_t Match(Entry const * entries,
+                       size_t count,
+                       std::vector<Term> & terms) const;
+
+        std::vector<Term> const & GetTerms() const;
+
+        static const size_t c_blockSize = 64;
+
+    private:
+        void Compile(TermMatchNode const & node);
+        void AddTerm(Term const & term);
+
+        enum class Opcode
+        {
+            Term,
+            And,
+            Not,
+            Or
+        };
+
+        struct Instruction
+        {
+            Opcode m_opcode;
+
+            // Index into m_terms for Opcode::Term.
+            size_t m_term;
+        };
+
+        IConfiguration const & m_configuration;
+
+        // Distinct terms of the query.
+        std::vector<Term> m_terms;
+
+        // Postfix program. Each instruction pushes or combines masks.
+        std::vector<Instruction> m_program;
+    };
+}
@@ -0,0 +1,845 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <cstring>      // std::memcpy().
+#include <limits>       // std::numeric_limits.
+#include <stddef.h>     // offsetof().
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Plan/IResultsProcessor.h"
+#include "LoggerInterfaces/Check.h"
+#include "NativeCodeGenerator.h"
+#include "RegisterAllocator.h"
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+#include <Windows.h>    // For VirtualAlloc/VirtualProtect/VirtualFree.
+#else
+#include <sys/mman.h>   // For mmap/mprotect/munmap.
+#endif
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // NativeCodeGenerator
+    //
+    // Register usage in the generated code:
+    //   RAX      accumulator.
+    //   RBX      slice buffer.
+    //   RCX      scratch.
+    //   RDX      quadword offset into the current row.
+    //   RBP      number of results written to Parameters::m_results.
+    //   RSI      scratch.
+    //   RDI      Parameters pointer.
+    //   R8..R15  row pointers for rows assigned by the RegisterAllocator.
+    //
+    // The value stack used by Push/Pop/AndStack/OrStack shares the machine
+    // stack with the return addresses for Call/Return. This is safe because
+    // the code produced by CompileNode leaves the stack balanced across each
+    // Call.
+    //
+    //*************************************************************************
+
+    // x64 opcodes used below.
+    static const uint8_t c_opAddRegToRm = 0x01;
+    static const uint8_t c_opOrRegToRm = 0x09;
+    static const uint8_t c_opAndRegToRm = 0x21;
+    static const uint8_t c_opAndRmToReg = 0x23;
+    static const uint8_t c_opXorRegToRm = 0x31;
+    static const uint8_t c_opCmpRmFromReg = 0x3b;
+    static const uint8_t c_opTestRegRm = 0x85;
+    static const uint8_t c_opMovRegToRm = 0x89;
+    static const uint8_t c_opMovRmToReg = 0x8b;
+    static const uint8_t c_opShiftImm = 0xc1;
+    static const uint8_t c_opMovImmToRm = 0xc7;
+    static const uint8_t c_opCall = 0xe8;
+    static const uint8_t c_opJmp = 0xe9;
+    static const uint8_t c_opGroup3 = 0xf7;
+    static const uint8_t c_opGroup5 = 0xff;
+
+    // Condition codes for Jcc (0x0f 0x80 + cc).
+    static const uint8_t c_conditionAE = 0x3;
+    static const uint8_t c_conditionZ = 0x4;
+    static const uint8_t c_conditionNZ = 0x5;
+
+    // Opcode extensions for the /digit forms.
+    static const unsigned c_extensionShl = 4;
+    static const unsigned c_extensionShr = 5;
+    static const unsigned c_extensionNot = 2;
+    static const unsigned c_extensionInc = 0;
+    static const unsigned c_extensionMov = 0;
+
+
+    template <typename T>
+    static int32_t FieldOffset(T offset)
+    {
+        return static_cast<int32_t>(offset);
+    }
+
+#define PARAMETER(field) FieldOffset(offsetof(NativeCodeGenerator::Parameters, field))
+
+
+    NativeCodeGenerator::NativeCodeGenerator(RegisterAllocator const & registers)
+      : m_registers(registers),
+        m_sealed(false),
+        m_executable(nullptr),
+        m_executableSize(0)
+    {
+        if (!IsSupported())
+        {
+            throw NotImplemented("NativeCodeGenerator requires an x64 processor.");
+        }
+
+        m_iterationLoop = AllocateLabel();
+        m_overflow = AllocateLabel();
+        m_done = AllocateLabel();
+
+        EmitPrologue();
+    }
+
+
+    NativeCodeGenerator::~NativeCodeGenerator()
+    {
+        if (m_executable != nullptr)
+        {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+            VirtualFree(m_executable, 0, MEM_RELEASE);
+#else
+            munmap(m_executable, m_executableSize);
+#endif
+        }
+    }
+
+
+    bool NativeCodeGenerator::IsSupported()
+    {
+#if defined(_M_X64) || defined(__x86_64__)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+
+    void NativeCodeGenerator::Seal()
+    {
+        EnsureSealed(false);
+
+        EmitEpilogue();
+
+        // Verify that all labels have been placed.
+        for (size_t i = 0; i < m_labels.size(); ++i)
+        {
+            CHECK_NE(m_labels[i], (std::numeric_limits<size_t>::max)())
+                << "Label " << i << " has not been placed.";
+        }
+
+        // Patch jump and call sites. Displacements are relative to the end
+        // of the 32-bit displacement field.
+        for (auto const & fixup : m_fixups)
+        {
+            const ptrdiff_t target = static_cast<ptrdiff_t>(m_labels[fixup.second]);
+            const ptrdiff_t source = static_cast<ptrdiff_t>(fixup.first + sizeof(int32_t));
+            const int32_t displacement = static_cast<int32_t>(target - source);
+            std::memcpy(&m_code[fixup.first], &displacement, sizeof(displacement));
+        }
+
+        m_executableSize = m_code.size();
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        m_executable = VirtualAlloc(nullptr,
+                                    m_executableSize,
+                                    MEM_COMMIT | MEM_RESERVE,
+                                    PAGE_READWRITE);
+        if (m_executable == nullptr)
+        {
+            throw FatalError("NativeCodeGenerator: VirtualAlloc() failed.");
+        }
+        std::memcpy(m_executable, m_code.data(), m_executableSize);
+        DWORD oldProtection;
+        if (!VirtualProtect(m_executable,
+                            m_executableSize,
+                            PAGE_EXECUTE_READ,
+                            &oldProtection))
+        {
+            throw FatalError("NativeCodeGenerator: VirtualProtect() failed.");
+        }
+        FlushInstructionCache(GetCurrentProcess(),
+                              m_executable,
+                              m_executableSize);
+#else
+        void * buffer = mmap(nullptr,
+                             m_executableSize,
+                             PROT_READ | PROT_WRITE,
+                             MAP_ANON | MAP_PRIVATE,
+                             -1,  // No file descriptor.
+                             0);
+        if (buffer == MAP_FAILED)
+        {
+            throw FatalError("NativeCodeGenerator: mmap() failed.");
+        }
+        m_executable = buffer;
+        std::memcpy(m_executable, m_code.data(), m_executableSize);
+        if (mprotect(m_executable, m_executableSize, PROT_READ | PROT_EXEC) != 0)
+        {
+            throw FatalError("NativeCodeGenerator: mprotect() failed.");
+        }
+#endif
+
+        m_sealed = true;
+    }
+
+
+    NativeCodeGenerator::Function NativeCodeGenerator::GetFunction() const
+    {
+        EnsureSealed(true);
+        return reinterpret_cast<Function>(m_executable);
+    }
+
+
+    size_t NativeCodeGenerator::GetCodeSize() const
+    {
+        return m_code.size();
+    }
+
+
+    void NativeCodeGenerator::AndRow(size_t row, bool inverted, size_t rankDelta)
+    {
+        EnsureSealed(false);
+
+        Register index;
+        Register base = EmitRowAddress(row, rankDelta, index);
+        if (inverted)
+        {
+            EmitRegMem(c_opMovRmToReg, RCX, base, index, 8, 0);
+            EmitRegReg(c_opGroup3, static_cast<Register>(c_extensionNot), RCX);
+            EmitRegReg(c_opAndRegToRm, RCX, RAX);
+        }
+        else
+        {
+            EmitRegMem(c_opAndRmToReg, RAX, base, index, 8, 0);
+        }
+    }
+
+
+    void NativeCodeGenerator::LoadRow(size_t row, bool inverted, size_t rankDelta)
+    {
+        EnsureSealed(false);
+
+        Register index;
+        Register base = EmitRowAddress(row, rankDelta, index);
+        EmitRegMem(c_opMovRmToReg, RAX, base, index, 8, 0);
+        if (inverted)
+        {
+            EmitRegReg(c_opGroup3, static_cast<Register>(c_extensionNot), RAX);
+        }
+    }
+
+
+    void NativeCodeGenerator::LeftShiftOffset(size_t shift)
+    {
+        EnsureSealed(false);
+        EmitShift(c_extensionShl, RDX, shift);
+    }
+
+
+    void NativeCodeGenerator::RightShiftOffset(size_t shift)
+    {
+        EnsureSealed(false);
+        EmitShift(c_extensionShr, RDX, shift);
+    }
+
+
+    void NativeCodeGenerator::IncrementOffset()
+    {
+        EnsureSealed(false);
+        EmitRegReg(c_opGroup5, static_cast<Register>(c_extensionInc), RDX);
+    }
+
+
+    void NativeCodeGenerator::Push()
+    {
+        EnsureSealed(false);
+        EmitPush(RAX);
+    }
+
+
+    void NativeCodeGenerator::Pop()
+    {
+        EnsureSealed(false);
+        EmitPop(RAX);
+    }
+
+
+    void NativeCodeGenerator::AndStack()
+    {
+        EnsureSealed(false);
+        EmitPop(RCX);
+        EmitRegReg(c_opAndRegToRm, RCX, RAX);
+    }
+
+
+    void NativeCodeGenerator::Constant(int value)
+    {
+        EnsureSealed(false);
+
+        // mov rax, imm32 sign extends the value to 64 bits.
+        EmitRegReg(c_opMovImmToRm, static_cast<Register>(c_extensionMov), RAX);
+        EmitInt32(value);
+    }
+
+
+    void NativeCodeGenerator::Not()
+    {
+        EnsureSealed(false);
+        EmitRegReg(c_opGroup3, static_cast<Register>(c_extensionNot), RAX);
+    }
+
+
+    void NativeCodeGenerator::OrStack()
+    {
+        EnsureSealed(false);
+        EmitPop(RCX);
+        EmitRegReg(c_opOrRegToRm, RCX, RAX);
+    }
+
+
+    void NativeCodeGenerator::UpdateFlags()
+    {
+        EnsureSealed(false);
+
+        // Jz and Jnz test the accumulator directly, so there are no flags
+        // to update. This matches ByteCodeInterpreter.
+    }
+
+
+    void NativeCodeGenerator::Report()
+    {
+        EnsureSealed(false);
+
+        Label skip = AllocateLabel();
+
+        // Nothing to report if the accumulator is zero.
+        EmitRegReg(c_opTestRegRm, RAX, RAX);
+        EmitConditionalJump(c_conditionZ, skip);
+
+        // Ensure there is room for this result and the end of iteration
+        // marker. Otherwise abandon the iteration and return to the caller.
+        EmitRegReg(c_opMovRegToRm, RBP, RCX);
+        EmitRegReg(c_opGroup5, static_cast<Register>(c_extensionInc), RCX);
+        EmitRegMem(c_opCmpRmFromReg, RCX, RDI, None, 1, PARAMETER(m_resultsCapacity));
+        EmitConditionalJump(c_conditionAE, m_overflow);
+
+        // m_results[count] = { accumulator, offset }.
+        EmitRegMem(c_opMovRmToReg, RSI, RDI, None, 1, PARAMETER(m_results));
+        EmitRegReg(c_opMovRegToRm, RBP, RCX);
+        EmitShift(c_extensionShl, RCX, 4);
+        EmitRegMem(c_opMovRegToRm, RAX, RSI, RCX, 1, 0);
+        EmitRegMem(c_opMovRegToRm, RDX, RSI, RCX, 1, 8);
+        EmitRegReg(c_opGroup5, static_cast<Register>(c_extensionInc), RBP);
+
+        PlaceLabel(skip);
+    }
+
+
+    ICodeGenerator::Label NativeCodeGenerator::AllocateLabel()
+    {
+        EnsureSealed(false);
+        Label label = static_cast<Label>(m_labels.size());
+
+        // Use std::numeric_limits<size_t>::max() to mark this label
+        // as allocated, but not placed.
+        m_labels.push_back((std::numeric_limits<size_t>::max)());
+        return label;
+    }
+
+
+    void NativeCodeGenerator::PlaceLabel(Label label)
+    {
+        EnsureSealed(false);
+        CHECK_EQ(m_labels.at(label), (std::numeric_limits<size_t>::max)())
+            << "Label " << label << " has already been placed.";
+
+        m_labels.at(label) = m_code.size();
+    }
+
+
+    void NativeCodeGenerator::Call(Label label)
+    {
+        EnsureSealed(false);
+        EmitJump(c_opCall, label);
+    }
+
+
+    void NativeCodeGenerator::Jmp(Label label)
+    {
+        EnsureSealed(false);
+        EmitJump(c_opJmp, label);
+    }
+
+
+    void NativeCodeGenerator::Jnz(Label label)
+    {
+        EnsureSealed(false);
+        EmitRegReg(c_opTestRegRm, RAX, RAX);
+        EmitConditionalJump(c_conditionNZ, label);
+    }
+
+
+    void NativeCodeGenerator::Jz(Label label)
+    {
+        EnsureSealed(false);
+        EmitRegReg(c_opTestRegRm, RAX, RAX);
+        EmitConditionalJump(c_conditionZ, label);
+    }
+
+
+    void NativeCodeGenerator::Return()
+    {
+        EnsureSealed(false);
+        EmitByte(0xc3);
+    }
+
+
+    //
+    // Private methods.
+    //
+
+    // Callee saved registers, in the order they are pushed by the prologue.
+    static const unsigned c_savedRegisterCount = 8;
+
+
+    void NativeCodeGenerator::EmitPrologue()
+    {
+        const Register saved[c_savedRegisterCount] =
+            { RBX, RBP, RSI, RDI, R12, R13, R14, R15 };
+        for (unsigned i = 0; i < c_savedRegisterCount; ++i)
+        {
+            EmitPush(saved[i]);
+        }
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        // Windows passes the first parameter in RCX.
+        EmitRegReg(c_opMovRegToRm, RCX, RDI);
+#endif
+
+        EmitRegMem(c_opMovRmToReg, RBX, RDI, None, 1, PARAMETER(m_sliceBuffer));
+
+        // Load row pointers for rows that were assigned registers.
+        EmitRegMem(c_opMovRmToReg, RSI, RDI, None, 1, PARAMETER(m_rowOffsets));
+        for (unsigned i = 0; i < m_registers.GetRegistersAllocated(); ++i)
+        {
+            const unsigned id = m_registers.GetRowIdFromRegister(i);
+            const unsigned reg = m_registers.GetRegister(id);
+            CHECK_GE(reg, static_cast<unsigned>(R8))
+                << "Register " << reg << " not available for rows.";
+            CHECK_LE(reg, static_cast<unsigned>(R15))
+                << "Register " << reg << " not available for rows.";
+
+            EmitRegMem(c_opMovRmToReg,
+                       reg,
+                       RSI,
+                       None,
+                       1,
+                       static_cast<int32_t>(id * sizeof(ptrdiff_t)));
+            EmitRegReg(c_opAddRegToRm, RBX, static_cast<Register>(reg));
+        }
+
+        EmitRegMem(c_opMovRmToReg, RBP, RDI, None, 1, PARAMETER(m_resultsCount));
+
+        // Top of the iteration loop.
+        PlaceLabel(m_iterationLoop);
+        EmitRegMem(c_opMovRmToReg, RDX, RDI, None, 1, PARAMETER(m_iteration));
+        EmitRegMem(c_opCmpRmFromReg, RDX, RDI, None, 1, PARAMETER(m_iterationCount));
+        EmitConditionalJump(c_conditionAE, m_done);
+
+        // Record the state needed to abandon this iteration on overflow.
+        EmitRegMem(c_opMovRegToRm, RSP, RDI, None, 1, PARAMETER(m_savedStackPointer));
+        EmitRegMem(c_opMovRegToRm, RBP, RDI, None, 1, PARAMETER(m_iterationResultsCount));
+
+        EmitRegReg(c_opXorRegToRm, RAX, RAX);
+    }
+
+
+    void NativeCodeGenerator::EmitEpilogue()
+    {
+        // If this iteration produced results, append an end of iteration
+        // marker { 0, iteration }.
+        Label next = AllocateLabel();
+        EmitRegMem(c_opCmpRmFromReg, RBP, RDI, None, 1, PARAMETER(m_iterationResultsCount));
+        EmitConditionalJump(c_conditionZ, next);
+        EmitRegMem(c_opMovRmToReg, RSI, RDI, None, 1, PARAMETER(m_results));
+        EmitRegReg(c_opMovRegToRm, RBP, RCX);
+        EmitShift(c_extensionShl, RCX, 4);
+        EmitRegMem(c_opMovImmToRm, c_extensionMov, RSI, RCX, 1, 0);
+        EmitInt32(0);
+        EmitRegMem(c_opMovRmToReg, RDX, RDI, None, 1, PARAMETER(m_iteration));
+        EmitRegMem(c_opMovRegToRm, RDX, RSI, RCX, 1, 8);
+        EmitRegReg(c_opGroup5, static_cast<Register>(c_extensionInc), RBP);
+        PlaceLabel(next);
+
+        // Advance to the next iteration.
+        EmitRegMem(c_opGroup5, c_extensionInc, RDI, None, 1, PARAMETER(m_iteration));
+        EmitJump(c_opJmp, m_iterationLoop);
+
+        // Results buffer is full. Discard the partial iteration and unwind
+        // any Call frames and values on the stack. Parameters::m_iteration
+        // still refers to the abandoned iteration, so the caller can resume
+        // there.
+        PlaceLabel(m_overflow);
+        EmitRegMem(c_opMovRmToReg, RSP, RDI, None, 1, PARAMETER(m_savedStackPointer));
+        EmitRegMem(c_opMovRmToReg, RBP, RDI, None, 1, PARAMETER(m_iterationResultsCount));
+
+        PlaceLabel(m_done);
+        EmitRegMem(c_opMovRegToRm, RBP, RDI, None, 1, PARAMETER(m_resultsCount));
+
+        const Register saved[c_savedRegisterCount] =
+            { RBX, RBP, RSI, RDI, R12, R13, R14, R15 };
+        for (unsigned i = c_savedRegisterCount; i > 0; --i)
+        {
+            EmitPop(saved[i - 1]);
+        }
+        EmitByte(0xc3);
+    }
+
+
+    NativeCodeGenerator::Register
+        NativeCodeGenerator::EmitRowAddress(size_t row,
+                                            size_t rankDelta,
+                                            Register & index)
+    {
+        Register base;
+        if (m_registers.IsRegister(static_cast<unsigned>(row)))
+        {
+            base = static_cast<Register>(
+                m_registers.GetRegister(static_cast<unsigned>(row)));
+        }
+        else
+        {
+            // RSI = sliceBuffer + rowOffsets[row].
+            EmitRegMem(c_opMovRmToReg, RSI, RDI, None, 1, PARAMETER(m_rowOffsets));
+            EmitRegMem(c_opMovRmToReg,
+                       RSI,
+                       RSI,
+                       None,
+                       1,
+                       static_cast<int32_t>(row * sizeof(ptrdiff_t)));
+            EmitRegReg(c_opAddRegToRm, RBX, RSI);
+            base = RSI;
+        }
+
+        if (rankDelta == 0)
+        {
+            index = RDX;
+        }
+        else
+        {
+            // RCX = offset >> rankDelta.
+            EmitRegReg(c_opMovRegToRm, RDX, RCX);
+            EmitShift(c_extensionShr, RCX, rankDelta);
+            index = RCX;
+        }
+
+        return base;
+    }
+
+
+    void NativeCodeGenerator::EmitByte(uint8_t value)
+    {
+        m_code.push_back(value);
+    }
+
+
+    void NativeCodeGenerator::EmitInt32(int32_t value)
+    {
+        uint8_t bytes[sizeof(value)];
+        std::memcpy(bytes, &value, sizeof(value));
+        m_code.insert(m_code.end(), bytes, bytes + sizeof(value));
+    }
+
+
+    void NativeCodeGenerator::EmitRex(bool wide,
+                                      unsigned reg,
+                                      unsigned index,
+                                      unsigned base)
+    {
+        uint8_t rex = 0x40;
+        if (wide)
+        {
+            rex |= 0x8;
+        }
+        if (reg & 0x8)
+        {
+            rex |= 0x4;
+        }
+        if (index & 0x8)
+        {
+            rex |= 0x2;
+        }
+        if (base & 0x8)
+        {
+            rex |= 0x1;
+        }
+
+        if (rex != 0x40)
+        {
+            EmitByte(rex);
+        }
+    }
+
+
+    void NativeCodeGenerator::EmitRegReg(uint8_t opcode, Register reg, Register rm)
+    {
+        EmitRex(true, reg, 0, rm);
+        EmitByte(opcode);
+        EmitByte(static_cast<uint8_t>(0xc0 | ((reg & 7) << 3) | (rm & 7)));
+    }
+
+
+    void NativeCodeGenerator::EmitRegMem(uint8_t opcode,
+                                         unsigned reg,
+                                         Register base,
+                                         Register index,
+                                         unsigned scale,
+                                         int32_t displacement)
+    {
+        EmitRex(true, reg, (index == None) ? 0 : index, base);
+        EmitByte(opcode);
+
+        // RBP and R13 cannot be encoded as a base without a displacement.
+        unsigned mod;
+        if (displacement == 0 && (base & 7) != RBP)
+        {
+            mod = 0;
+        }
+        else if (displacement >= -128 && displacement <= 127)
+        {
+            mod = 1;
+        }
+        else
+        {
+            mod = 2;
+        }
+
+        // RSP and R12 can only be encoded as a base with a SIB byte.
+        if (index == None && (base & 7) != RSP)
+        {
+            EmitByte(static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | (base & 7)));
+        }
+        else
+        {
+            CHECK_NE(index, RSP) << "RSP cannot be used as an index.";
+
+            unsigned scaleBits = 0;
+            switch (scale)
+            {
+            case 1:
+                scaleBits = 0;
+                break;
+            case 2:
+                scaleBits = 1;
+                break;
+            case 4:
+                scaleBits = 2;
+                break;
+            case 8:
+                scaleBits = 3;
+                break;
+            default:
+                CHECK_FAIL << "Invalid scale " << scale;
+            }
+
+            const unsigned indexBits = (index == None) ? RSP : (index & 7);
+            EmitByte(static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | RSP));
+            EmitByte(static_cast<uint8_t>((scaleBits << 6) | (indexBits << 3) | (base & 7)));
+        }
+
+        if (mod == 1)
+        {
+            EmitByte(static_cast<uint8_t>(static_cast<int8_t>(displacement)));
+        }
+        else if (mod == 2)
+        {
+            EmitInt32(displacement);
+        }
+    }
+
+
+    void NativeCodeGenerator::EmitPush(Register reg)
+    {
+        EmitRex(false, 0, 0, reg);
+        EmitByte(static_cast<uint8_t>(0x50 + (reg & 7)));
+    }
+
+
+    void NativeCodeGenerator::EmitPop(Register reg)
+    {
+        EmitRex(false, 0, 0, reg);
+        EmitByte(static_cast<uint8_t>(0x58 + (reg & 7)));
+    }
+
+
+    void NativeCodeGenerator::EmitShift(unsigned extension,
+                                        Register reg,
+                                        size_t shift)
+    {
+        if (shift != 0)
+        {
+            CHECK_LT(shift, 64u) << "Shift " << shift << " out of range.";
+            EmitRegReg(c_opShiftImm, static_cast<Register>(extension), reg);
+            EmitByte(static_cast<uint8_t>(shift));
+        }
+    }
+
+
+    void NativeCodeGenerator::EmitJump(uint8_t opcode, Label label)
+    {
+        CHECK_LT(label, m_labels.size())
+            << "Jump to unknown label " << label;
+
+        EmitByte(opcode);
+        m_fixups.push_back(std::make_pair(m_code.size(), label));
+        EmitInt32(0);
+    }
+
+
+    void NativeCodeGenerator::EmitConditionalJump(uint8_t condition, Label label)
+    {
+        CHECK_LT(label, m_labels.size())
+            << "Jump to unknown label " << label;
+
+        EmitByte(0x0f);
+        EmitByte(static_cast<uint8_t>(0x80 | condition));
+        m_fixups.push_back(std::make_pair(m_code.size(), label));
+        EmitInt32(0);
+    }
+
+
+    void NativeCodeGenerator::EnsureSealed(bool sealed) const
+    {
+        CHECK_EQ(sealed, m_sealed)
+            << (sealed ? "class must be sealed." :
+                         "class already sealed.");
+    }
+
+#undef PARAMETER
+
+
+    //*************************************************************************
+    //
+    // NativeCodeRunner
+    //
+    //*************************************************************************
+    NativeCodeRunner::NativeCodeRunner(
+        NativeCodeGenerator const & code,
+        IResultsProcessor & resultsProcessor,
+        size_t sliceCount,
+        char * const * sliceBuffers,
+        size_t iterationsPerSlice,
+        ptrdiff_t const * rowOffsets)
+      : m_function(code.GetFunction()),
+        m_resultsProcessor(resultsProcessor),
+        m_sliceCount(sliceCount),
+        m_sliceBuffers(sliceBuffers),
+        m_iterationsPerSlice(iterationsPerSlice),
+        m_rowOffsets(rowOffsets),
+        m_results(c_initialResultsCapacity)
+    {
+    }
+
+
+    bool NativeCodeRunner::Run()
+    {
+        for (size_t i = 0; i < m_sliceCount; ++i)
+        {
+            bool terminate = ProcessOneSlice(i);
+            if (terminate)
+            {
+                return true;
+            }
+        }
+
+        // false ==> ran to completion.
+        return false;
+    }
+
+
+    bool NativeCodeRunner::ProcessOneSlice(size_t slice)
+    {
+        return ProcessIterations(slice, 0, m_iterationsPerSlice);
+    }
+
+
+    bool NativeCodeRunner::ProcessIterations(size_t slice,
+                                             size_t begin,
+                                             size_t end)
+    {
+        char const * sliceBuffer = m_sliceBuffers[slice];
+
+        NativeCodeGenerator::Parameters parameters;
+        parameters.m_sliceBuffer = sliceBuffer;
+        parameters.m_rowOffsets = m_rowOffsets;
+        parameters.m_iteration = begin;
+        parameters.m_iterationCount = end;
+
+        while (parameters.m_iteration < end)
+        {
+            parameters.m_results = m_results.data();
+            parameters.m_resultsCount = 0;
+            parameters.m_resultsCapacity = m_results.size();
+
+            m_function(&parameters);
+
+            if (parameters.m_resultsCount == 0 &&
+                parameters.m_iteration < end)
+            {
+                // A single iteration produced more results than the buffer
+                // can hold. Grow the buffer and retry the iteration.
+                m_results.resize(m_results.size() * 2);
+                continue;
+            }
+
+            // Replay buffered results to the IResultsProcessor. A zero
+            // accumulator marks the end of an iteration.
+            for (size_t i = 0; i < parameters.m_resultsCount; ++i)
+            {
+                auto const & result = m_results[i];
+                if (result.m_accumulator == 0)
+                {
+                    if (m_resultsProcessor.FinishIteration(sliceBuffer))
+                    {
+                        return true;
+                    }
+                }
+                else
+                {
+                    m_resultsProcessor.AddResult(result.m_accumulator,
+                                                 result.m_offset);
+                }
+            }
+        }
+
+        // false ==> ran to completion.
+        return false;
+    }
+}
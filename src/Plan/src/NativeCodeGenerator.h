@@ -0,0 +1,268 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                         // size_t, ptrdiff_t parameter.
+#include <stdint.h>                         // uint8_t, uint64_t embedded.
+#include <vector>                           // std::vector embedded.
+
+#include "BitFunnel/NonCopyable.h"          // Base class.
+#include "BitFunnel/Plan/ICodeGenerator.h"  // Base class.
+
+
+namespace BitFunnel
+{
+    class IResultsProcessor;
+    class RegisterAllocator;
+
+    //*************************************************************************
+    //
+    // NativeCodeGenerator is an implementation of ICodeGenerator that emits
+    // x64 machine code for the matching primitives. The generated function
+    // processes a range of iterations over a single slice. Abstract rows that
+    // were assigned a register by the RegisterAllocator are loaded into
+    // R8..R15 once per slice. All other rows are addressed through the row
+    // offset table on each access.
+    //
+    // The generated code mirrors the semantics of ByteCodeInterpreter, which
+    // remains the reference implementation.
+    //
+    // Usage pattern:
+    //   Construct NativeCodeGenerator with a RegisterAllocator.
+    //   Invoke ICodeGenerator methods (typically via CompileNode::Compile()).
+    //   Invoke Seal() to copy the code into an executable buffer.
+    //   Pass the NativeCodeGenerator to a NativeCodeRunner.
+    //
+    //*************************************************************************
+    class NativeCodeGenerator : public ICodeGenerator, NonCopyable
+    {
+    public:
+        // A single call to Report() in the generated code. Results with an
+        // accumulator value of zero mark the end of an iteration. In this
+        // case m_offset holds the iteration number.
+        struct Result
+        {
+            uint64_t m_accumulator;
+            size_t m_offset;
+        };
+
+        // Parameter block shared by the generated code and NativeCodeRunner.
+        // WARNING: The generated code depends on the layout of this structure.
+        struct Parameters
+        {
+            char const * m_sliceBuffer;
+            ptrdiff_t const * m_rowOffsets;
+
+            // On entry, the first iteration to process. On return, the first
+            // iteration that has not been processed.
+            size_t m_iteration;
+            size_t m_iterationCount;
+
+            Result * m_results;
+            size_t m_resultsCount;
+            size_t m_resultsCapacity;
+
+            // Scratch space for the generated code.
+            size_t m_iterationResultsCount;
+            uintptr_t m_savedStackPointer;
+        };
+
+        typedef void (*Function)(Parameters * parameters);
+
+        // Constructs a NativeCodeGenerator that places rows in the registers
+        // chosen by the RegisterAllocator. Throws NotImplemented on platforms
+        // other than x64.
+        NativeCodeGenerator(RegisterAllocator const & registers);
+
+        ~NativeCodeGenerator();
+
+        // Returns true if native code generation is available on this
+        // platform.
+        static bool IsSupported();
+
+        // Call this method after filling with instructions and before passing
+        // the NativeCodeGenerator to the NativeCodeRunner. Seal() appends the
+        // function epilogue, resolves jump targets, and copies the code to an
+        // executable buffer. After the class has been sealed, calls to
+        // ICodeGenerator methods will throw an exception.
+        void Seal();
+
+        // Returns the entry point of the generated function. Class must be
+        // sealed before calling this method.
+        Function GetFunction() const;
+
+        // Returns the number of bytes of machine code generated.
+        size_t GetCodeSize() const;
+
+        //
+        // ICodeGenerator methods
+        //
+        // These methods will throw an exception if invoked after the class has
+        // been sealed.
+        //
+
+        // RankDown compiler primitives
+        virtual void AndRow(size_t row, bool inverted, size_t rankDelta) override;
+        virtual void LoadRow(size_t row, bool inverted, size_t rankDelta) override;
+
+        virtual void LeftShiftOffset(size_t shift) override;
+        virtual void RightShiftOffset(size_t shift) override;
+        virtual void IncrementOffset() override;
+
+        virtual void Push() override;
+        virtual void Pop() override;
+
+        // Stack machine primitives
+        virtual void AndStack() override;
+        virtual void Constant(int value) override;
+        virtual void Not() override;
+        virtual void OrStack() override;
+        virtual void UpdateFlags() override;
+
+        virtual void Report() override;
+
+        // Constrol flow primitives.
+        virtual ICodeGenerator::Label AllocateLabel() override;
+        virtual void PlaceLabel(Label label) override;
+        virtual void Call(Label label) override;
+        virtual void Jmp(Label label) override;
+        virtual void Jnz(Label label) override;
+        virtual void Jz(Label label) override;
+        virtual void Return() override;
+
+    private:
+        enum Register
+        {
+            RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+            R8, R9, R10, R11, R12, R13, R14, R15,
+            None
+        };
+
+        void EmitPrologue();
+        void EmitEpilogue();
+
+        // Emits the row access for AndRow() and LoadRow(). Returns the base
+        // register for the row and sets index to the register holding the
+        // quadword offset.
+        Register EmitRowAddress(size_t row, size_t rankDelta, Register & index);
+
+        //
+        // Instruction encoding helpers.
+        //
+        void EmitByte(uint8_t value);
+        void EmitInt32(int32_t value);
+        void EmitRex(bool wide, unsigned reg, unsigned index, unsigned base);
+
+        // Register to register instruction with a single byte opcode where
+        // the destination is encoded in the r/m field.
+        void EmitRegReg(uint8_t opcode, Register reg, Register rm);
+
+        // Instruction with a single byte opcode and a
+        // [base + index * scale + displacement] memory operand.
+        void EmitRegMem(uint8_t opcode,
+                        unsigned reg,
+                        Register base,
+                        Register index,
+                        unsigned scale,
+                        int32_t displacement);
+
+        void EmitPush(Register reg);
+        void EmitPop(Register reg);
+        void EmitShift(unsigned extension, Register reg, size_t shift);
+        void EmitJump(uint8_t opcode, Label label);
+        void EmitConditionalJump(uint8_t condition, Label label);
+
+        void EnsureSealed(bool sealed) const;
+
+        RegisterAllocator const & m_registers;
+
+        bool m_sealed;
+        std::vector<uint8_t> m_code;
+
+        // Code position of each label. Unplaced labels hold
+        // std::numeric_limits<size_t>::max().
+        std::vector<size_t> m_labels;
+
+        // Positions of 32-bit relative displacements to be patched with
+        // label addresses during Seal().
+        std::vector<std::pair<size_t, Label>> m_fixups;
+
+        Label m_iterationLoop;
+        Label m_overflow;
+        Label m_done;
+
+        void * m_executable;
+        size_t m_executableSize;
+    };
+
+
+    //*************************************************************************
+    //
+    // NativeCodeRunner executes the function generated by a
+    // NativeCodeGenerator over a set of slices, forwarding results to an
+    // IResultsProcessor. Its constructor parameters and the sequence of calls
+    // to the IResultsProcessor are the same as those of ByteCodeInterpreter.
+    //
+    //*************************************************************************
+    class NativeCodeRunner : NonCopyable
+    {
+    public:
+        NativeCodeRunner(NativeCodeGenerator const & code,
+                         IResultsProcessor & resultsProcessor,
+                         size_t sliceCount,
+                         char * const * sliceBuffers,
+                         size_t iterationsPerSlice,
+                         ptrdiff_t const * rowOffsets);
+
+        // Runs the generated code over every slice. Returns true to indicate
+        // early termination.
+        bool Run();
+
+        // Processes a single slice. Run() calls this method for each slice
+        // in turn. Callers that distribute slices across threads may call
+        // it directly, in any order. Returns true to indicate early
+        // termination.
+        bool ProcessOneSlice(size_t slice);
+
+        // Processes iterations [begin, end) of a single slice. See
+        // ByteCodeInterpreter::ProcessIterations(). Returns true to indicate
+        // early termination.
+        bool ProcessIterations(size_t slice, size_t begin, size_t end);
+
+    private:
+        NativeCodeGenerator::Function m_function;
+        IResultsProcessor & m_resultsProcessor;
+
+        size_t m_sliceCount;
+        char * const * m_sliceBuffers;
+        size_t m_iterationsPerSlice;
+
+        ptrdiff_t const * m_rowOffsets;
+
+        // Reports buffered by the generated code between calls to the
+        // IResultsProcessor.
+        std::vector<NativeCodeGenerator::Result> m_results;
+
+        static const size_t c_initialResultsCapacity = 1024;
+    };
+}
@@ -0,0 +1,61 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "BitFunnel/Index/IConfiguration.h"
+#include "LoggerInterfaces/Check.h"
+#include "PhraseTerms.h"
+#include "StringVector.h"
+
+
+namespace BitFunnel
+{
+    std::vector<Term> GetPhraseTerms(TermMatchNode::Phrase const & phrase,
+                                     IConfiguration const & configuration)
+    {
+        StringVector const & grams = phrase.GetGrams();
+        const size_t wordCount = grams.GetSize();
+        CHECK_GT(wordCount, 0u) << "Phrase has no words.";
+
+        std::vector<Term> words;
+        for (unsigned i = 0; i < wordCount; ++i)
+        {
+            words.push_back(Term(grams[i], phrase.GetStreamId(), configuration));
+        }
+
+        const size_t maxGramSize = configuration.GetMaxGramSize();
+        const size_t gramSize = (wordCount < maxGramSize) ? wordCount : maxGramSize;
+
+        std::vector<Term> terms;
+        for (size_t start = 0; start + gramSize <= wordCount; ++start)
+        {
+            // Combine words in the same order as Document::ProcessNGrams().
+            Term term(words[start]);
+            for (size_t n = 1; n < gramSize; ++n)
+            {
+                term.AddTerm(words[start + n], configuration);
+            }
+            terms.push_back(term);
+        }
+
+        return terms;
+    }
+}
@@ -0,0 +1,42 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <vector>                           // std::vector return value.
+
+#include "BitFunnel/Plan/TermMatchNode.h"   // TermMatchNode::Phrase parameter.
+#include "BitFunnel/Term.h"                 // Term return value.
+
+
+namespace BitFunnel
+{
+    class IConfiguration;
+
+    // Returns the n-gram Terms that Document posts for every occurrence of
+    // the phrase. A phrase of at most GetMaxGramSize() words is a single
+    // n-gram. A longer phrase is decomposed into its overlapping n-grams of
+    // GetMaxGramSize() words, e.g. "a b c d" with a maximum gram size of 2
+    // becomes "a b", "b c", and "c d".
+    std::vector<Term> GetPhraseTerms(TermMatchNode::Phrase const & phrase,
+                                     IConfiguration const & configuration);
+}
@@ -0,0 +1,266 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>    // std::sort()
+#include <sstream>
+
+#include "BitFunnel/Plan/Factories.h"
+#include "BitFunnel/Plan/TermMatchNode.h"
+#include "LoggerInterfaces/Check.h"
+#include "PlanCache.h"
+#include "ShardPlan.h"
+#include "StringVector.h"
+
+
+namespace BitFunnel
+{
+    std::unique_ptr<IPlanCache> Factories::CreatePlanCache(size_t capacity)
+    {
+        return std::unique_ptr<IPlanCache>(new PlanCache(capacity));
+    }
+
+
+    //*************************************************************************
+    //
+    // Canonical form of a TermMatchNode tree.
+    //
+    // Text is length-prefixed so that no choice of term text can make two
+    // different trees produce the same key.
+    //
+    //*************************************************************************
+    static void AppendCanonicalForm(TermMatchNode const & node,
+                                    std::ostream & out);
+
+
+    // Appends the canonical forms of the operands of a chain of nodes of the
+    // same type as node. For example, (a AND (b AND c)) has operands a, b,
+    // and c.
+    static void GatherOperands(TermMatchNode const & node,
+                               TermMatchNode::NodeType type,
+                               std::vector<std::string> & operands)
+    {
+        if (node.GetType() == type)
+        {
+            if (type == TermMatchNode::AndMatch)
+            {
+                auto const & andNode = dynamic_cast<TermMatchNode::And const &>(node);
+                GatherOperands(andNode.GetLeft(), type, operands);
+                GatherOperands(andNode.GetRight(), type, operands);
+            }
+            else
+            {
+                auto const & orNode = dynamic_cast<TermMatchNode::Or const &>(node);
+                GatherOperands(orNode.GetLeft(), type, operands);
+                GatherOperands(orNode.GetRight(), type, operands);
+            }
+        }
+        else
+        {
+            std::stringstream operand;
+            AppendCanonicalForm(node, operand);
+            operands.push_back(operand.str());
+        }
+    }
+
+
+    static void AppendText(char const * text, std::ostream & out)
+    {
+        std::string s(text);
+        out << s.size() << ':' << s;
+    }
+
+
+    static void AppendCanonicalForm(TermMatchNode const & node,
+                                    std::ostream & out)
+    {
+        switch (node.GetType())
+        {
+        case TermMatchNode::AndMatch:
+        case TermMatchNode::OrMatch:
+            {
+                std::vector<std::string> operands;
+                GatherOperands(node, node.GetType(), operands);
+                std::sort(operands.begin(), operands.end());
+
+                out << ((node.GetType() == TermMatchNode::AndMatch) ? 'A' : 'O')
+                    << '(';
+                for (auto const & operand : operands)
+                {
+                    out << operand << ',';
+                }
+                out << ')';
+            }
+            break;
+        case TermMatchNode::NotMatch:
+            {
+                auto const & notNode = dynamic_cast<TermMatchNode::Not const &>(node);
+                out << "N(";
+                AppendCanonicalForm(notNode.GetChild(), out);
+                out << ')';
+            }
+            break;
+        case TermMatchNode::PhraseMatch:
+            {
+                auto const & phrase = dynamic_cast<TermMatchNode::Phrase const &>(node);
+                out << 'P' << static_cast<unsigned>(phrase.GetStreamId()) << '(';
+                auto const & grams = phrase.GetGrams();
+                for (unsigned i = 0; i < grams.GetSize(); ++i)
+                {
+                    AppendText(grams[i], out);
+                    out << ',';
+                }
+                out << ')';
+            }
+            break;
+        case TermMatchNode::UnigramMatch:
+            {
+                auto const & unigram = dynamic_cast<TermMatchNode::Unigram const &>(node);
+                out << 'U' << static_cast<unsigned>(unigram.GetStreamId()) << '(';
+                AppendText(unigram.GetText(), out);
+                out << ')';
+            }
+            break;
+        case TermMatchNode::FactMatch:
+            {
+                auto const & fact = dynamic_cast<TermMatchNode::Fact const &>(node);
+                out << 'F' << fact.GetFact();
+            }
+            break;
+        default:
+            CHECK_FAIL << "Invalid node type.";
+        }
+    }
+
+
+    //*************************************************************************
+    //
+    // PlanCache
+    //
+    //*************************************************************************
+    PlanCache::PlanCache(size_t capacity)
+      : m_capacity(capacity),
+        m_hitCount(0),
+        m_missCount(0)
+    {
+        CHECK_GT(capacity, 0u) << "PlanCache capacity must be positive.";
+    }
+
+
+    std::string PlanCache::GetKey(TermMatchNode const & tree)
+    {
+        std::stringstream key;
+        AppendCanonicalForm(tree, key);
+        return key.str();
+    }
+
+
+    std::shared_ptr<PlanCache::ShardPlans const>
+        PlanCache::Find(std::string const & key,
+                        std::vector<uint64_t> const & shardGenerations)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto it = m_index.find(key);
+        if (it == m_index.end() || it->second->m_shardGenerations != shardGenerations)
+        {
+            ++m_missCount;
+            return nullptr;
+        }
+
+        // Move the entry to the front of the LRU list.
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+
+        ++m_hitCount;
+        return it->second->m_plans;
+    }
+
+
+    void PlanCache::Add(std::string const & key,
+                        std::vector<uint64_t> const & shardGenerations,
+                        std::shared_ptr<ShardPlans const> plans)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+
+        auto it = m_index.find(key);
+        if (it != m_index.end())
+        {
+            // Another thread compiled the same query, or the shards have
+            // been replaced. Keep the newer plans.
+            it->second->m_shardGenerations = shardGenerations;
+            it->second->m_plans = plans;
+            m_entries.splice(m_entries.begin(), m_entries, it->second);
+            return;
+        }
+
+        if (m_entries.size() == m_capacity)
+        {
+            m_index.erase(m_entries.back().m_key);
+            m_entries.pop_back();
+        }
+
+        m_entries.push_front(Entry { key, shardGenerations, plans });
+        m_index[key] = m_entries.begin();
+    }
+
+
+    size_t PlanCache::GetCapacity() const
+    {
+        return m_capacity;
+    }
+
+
+    size_t PlanCache::GetSize() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_entries.size();
+    }
+
+
+    size_t PlanCache::GetHitCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_hitCount;
+    }
+
+
+    size_t PlanCache::GetMissCount() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_missCount;
+    }
+
+
+    void PlanCache::ResetCounters()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_hitCount = 0;
+        m_missCount = 0;
+    }
+
+
+    void PlanCache::Clear()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_index.clear();
+        m_entries.clear();
+    }
+}
@@ -0,0 +1,102 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                         // size_t parameter.
+#include <stdint.h>                         // uint64_t parameter.
+#include <list>                             // std::list embedded.
+#include <memory>                           // std::shared_ptr embedded.
+#include <mutex>                            // std::mutex embedded.
+#include <string>                           // std::string embedded.
+#include <unordered_map>                    // std::unordered_map embedded.
+#include <vector>                           // std::vector embedded.
+
+#include "BitFunnel/Plan/IPlanCache.h"      // Base class.
+#include "BitFunnel/NonCopyable.h"          // Base class.
+
+
+namespace BitFunnel
+{
+    class ShardPlan;
+    class TermMatchNode;
+
+    //*************************************************************************
+    //
+    // PlanCache is the IPlanCache used by SimplePlanner. It holds a
+    // ShardPlan for each shard of the index, together with the generation
+    // (IShard::GetGeneration()) of each shard the plans were compiled for.
+    //
+    // Plans are handed out as std::shared_ptr, so a plan evicted while a
+    // query is running remains valid until the query completes.
+    //
+    //*************************************************************************
+    class PlanCache : public IPlanCache, NonCopyable
+    {
+    public:
+        explicit PlanCache(size_t capacity);
+
+        // Returns the cache key for a query. Nested AND and OR nodes are
+        // flattened and their operands sorted, so that equivalent trees
+        // have the same key.
+        static std::string GetKey(TermMatchNode const & tree);
+
+        //
+        // IPlanCache methods
+        //
+
+        virtual std::shared_ptr<ShardPlans const>
+            Find(std::string const & key,
+                 std::vector<uint64_t> const & shardGenerations) override;
+        virtual void Add(std::string const & key,
+                         std::vector<uint64_t> const & shardGenerations,
+                         std::shared_ptr<ShardPlans const> plans) override;
+        virtual size_t GetCapacity() const override;
+        virtual size_t GetSize() const override;
+        virtual size_t GetHitCount() const override;
+        virtual size_t GetMissCount() const override;
+        virtual void ResetCounters() override;
+        virtual void Clear() override;
+
+    private:
+        struct Entry
+        {
+            std::string m_key;
+            std::vector<uint64_t> m_shardGenerations;
+            std::shared_ptr<ShardPlans const> m_plans;
+        };
+
+        typedef std::list<Entry> EntryList;
+
+        const size_t m_capacity;
+
+        // Protects all of the members below.
+        mutable std::mutex m_lock;
+
+        // Entries in order from most to least recently used.
+        EntryList m_entries;
+        std::unordered_map<std::string, EntryList::iterator> m_index;
+
+        size_t m_hitCount;
+        size_t m_missCount;
+    };
+}
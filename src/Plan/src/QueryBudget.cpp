@@ -0,0 +1,73 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "BitFunnel/Plan/QueryLimits.h"
+#include "QueryBudget.h"
+
+
+namespace BitFunnel
+{
+    QueryBudget::QueryBudget(QueryLimits const & limits)
+      : m_maxMatches(limits.GetMaxMatches()),
+        m_timeLimit(limits.GetTimeLimit()),
+        m_matchCount(0),
+        m_exhausted(false)
+    {
+    }
+
+
+    bool QueryBudget::AddMatches(size_t matchCount)
+    {
+        // Avoid contention on m_matchCount when there is no match limit.
+        if (m_maxMatches != QueryLimits::c_unlimitedMatches && matchCount > 0)
+        {
+            const size_t total =
+                m_matchCount.fetch_add(matchCount, std::memory_order_relaxed) +
+                matchCount;
+            if (total >= m_maxMatches)
+            {
+                m_exhausted.store(true, std::memory_order_relaxed);
+                return true;
+            }
+        }
+
+        return IsExhausted();
+    }
+
+
+    bool QueryBudget::CheckTime()
+    {
+        if (m_timeLimit > 0.0 && m_stopwatch.ElapsedTime() >= m_timeLimit)
+        {
+            m_exhausted.store(true, std::memory_order_relaxed);
+            return true;
+        }
+
+        return IsExhausted();
+    }
+
+
+    bool QueryBudget::IsExhausted() const
+    {
+        return m_exhausted.load(std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,72 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                         // size_t parameter.
+#include <atomic>                           // std::atomic embedded.
+
+#include "BitFunnel/NonCopyable.h"          // Base class.
+#include "BitFunnel/Utilities/Stopwatch.h"  // Stopwatch embedded.
+
+
+namespace BitFunnel
+{
+    class QueryLimits;
+
+    //*************************************************************************
+    //
+    // QueryBudget tracks a query's progress against its QueryLimits. It is
+    // shared by all of the threads working on the query. Once either limit
+    // is reached, the budget is exhausted and stays exhausted.
+    //
+    // The time limit is only checked when CheckTime() is called, so callers
+    // should call it periodically, for example between slices.
+    //
+    // QueryBudget is thread safe.
+    //
+    //*************************************************************************
+    class QueryBudget : NonCopyable
+    {
+    public:
+        // Starts the clock for the time limit.
+        explicit QueryBudget(QueryLimits const & limits);
+
+        // Adds to the number of matches found by all threads. Returns true
+        // if the budget is exhausted.
+        bool AddMatches(size_t matchCount);
+
+        // Checks the time limit. Returns true if the budget is exhausted.
+        bool CheckTime();
+
+        bool IsExhausted() const;
+
+    private:
+        const size_t m_maxMatches;
+        const double m_timeLimit;
+
+        Stopwatch m_stopwatch;
+
+        std::atomic<size_t> m_matchCount;
+        std::atomic<bool> m_exhausted;
+    };
+}
@@ -39,7 +39,24 @@ namespace BitFunnel
     QueryParser::QueryParser(std::istream& input,
                              IStreamConfiguration const & streamConfiguration,
                              IAllocator& allocator)
-        : m_input(input),
+        : m_input(&input),
+          m_text(nullptr),
+          m_textLength(0),
+          m_streamConfiguration(streamConfiguration),
+          m_allocator(allocator),
+          m_currentPosition(0),
+          m_haveChar(false)
+    {
+    }
+
+
+    QueryParser::QueryParser(char const * text,
+                             size_t length,
+                             IStreamConfiguration const & streamConfiguration,
+                             IAllocator& allocator)
+        : m_input(nullptr),
+          m_text(text),
+          m_textLength(length),
           m_streamConfiguration(streamConfiguration),
           m_allocator(allocator),
           m_currentPosition(0),
@@ -293,7 +310,17 @@ namespace BitFunnel
     {
         if (!m_haveChar)
         {
-            int temp = m_input.get();
+            if (m_input == nullptr)
+            {
+                // Reading from a span. As with a stream, the end of the
+                // text reads as a NULL byte.
+                m_nextChar = (m_currentPosition < m_textLength) ?
+                    m_text[m_currentPosition] : '\0';
+                m_haveChar = true;
+                return m_nextChar;
+            }
+
+            int temp = m_input->get();
             // See https://github.com/BitFunnel/BitFunnel/issues/189.
             if (temp != -1)
             {
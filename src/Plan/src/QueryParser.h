@@ -22,6 +22,7 @@
 
 #pragma once
 
+#include <stddef.h>                 // size_t parameter.
 #include <iosfwd>                   // std::istream parameter.
 
 #include "BitFunnel/Exceptions.h"   // Base class.
@@ -52,6 +53,14 @@ namespace BitFunnel
                     IStreamConfiguration const & streamConfiguration,
                     IAllocator& allocator);
 
+        // Parses the length characters at text in place, without copying
+        // them into a stream. The text must remain valid until Parse()
+        // returns.
+        QueryParser(char const * text,
+                    size_t length,
+                    IStreamConfiguration const & streamConfiguration,
+                    IAllocator& allocator);
+
         TermMatchNode const * Parse();
 
         //
@@ -114,7 +123,12 @@ namespace BitFunnel
 
         Term::StreamId StreamIdFromText(char const * /*streamName*/) const;
 
-        std::istream& m_input;
+        // Source of characters. Exactly one of m_input and m_text is used.
+        // m_input is nullptr when parsing from the m_text span.
+        std::istream* m_input;
+        char const * m_text;
+        size_t m_textLength;
+
         IStreamConfiguration const & m_streamConfiguration;
         IAllocator& m_allocator;
 
@@ -20,10 +20,17 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-#include <sstream>
+#include <cstring>      // strlen.
 
 #include "Allocator.h"
+#include "BitFunnel/Index/IDocumentDataSchema.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/PostingBlob.h"
+#include "BitFunnel/Index/Token.h"
 #include "BitFunnel/Plan/QueryPipeline.h"
+#include "BitFunnel/Plan/TermMatchTreeEvaluator.h"
+#include "LoggerInterfaces/Check.h"
 #include "QueryParser.h"
 
 
@@ -39,8 +46,46 @@ namespace BitFunnel
     TermMatchNode const * QueryPipeline::ParseQuery(char const * query)
     {
         m_allocator->Reset();
-        std::stringstream s(query);
-        QueryParser parser(s, m_streamConfiguration, *m_allocator);
+        QueryParser parser(query,
+                           strlen(query),
+                           m_streamConfiguration,
+                           *m_allocator);
         return parser.Parse();
     }
+
+
+    size_t QueryPipeline::FilterMatches(TermMatchNode const & tree,
+                                        ISimpleIndex const & index,
+                                        std::vector<DocId> & matches) const
+    {
+        auto & ingestor = index.GetIngestor();
+        auto const & schema = ingestor.GetDocumentDataSchema();
+        CHECK_TRUE(schema.HasPostingBlob())
+            << "QueryPipeline::FilterMatches() requires a posting blob.";
+        const VariableSizeBlobId blob = schema.GetPostingBlob();
+
+        TermMatchTreeEvaluator evaluator(index.GetConfiguration());
+
+        // The token keeps the slices holding the posting blobs from being
+        // recycled.
+        auto token = ingestor.GetTokenManager().RequestToken();
+
+        size_t kept = 0;
+        for (auto id : matches)
+        {
+            if (ingestor.Contains(id))
+            {
+                PostingBlob postings(ingestor.GetHandle(id).GetVariableSizeBlob(blob));
+                if (evaluator.Evaluate(tree, postings))
+                {
+                    matches[kept++] = id;
+                }
+            }
+        }
+
+        const size_t removed = matches.size() - kept;
+        matches.resize(kept);
+
+        return removed;
+    }
 }
@@ -20,59 +20,121 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>                            // std::max().
+#include <new>                                  // Placement new.
+#include <vector>                               // std::vector embedded.
+
 #include "BitFunnel/Allocators/IAllocator.h"
-// #include "BitFunnel/CompiledFunction.h"
 #include "BitFunnel/IDiagnosticStream.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
 #include "BitFunnel/Plan/IPlanRows.h"
-// #include "BitFunnel/IThreadResources.h"
 #include "BitFunnel/Plan/QueryPlanner.h"
 #include "BitFunnel/Plan/RowPlan.h"
 #include "BitFunnel/Plan/TermMatchNode.h"
 #include "BitFunnel/Plan/TermPlan.h"
 #include "BitFunnel/Plan/TermPlanConverter.h"
+#include "BitFunnel/Term.h"
 #include "BitFunnel/Utilities/Factories.h"
 #include "BitFunnel/Utilities/IObjectFormatter.h"
+#include "BitFunnel/Utilities/Stopwatch.h"
 #include "CompileNode.h"
+#include "ConstantFolder.h"
 #include "LoggerInterfaces/Logging.h"
-// #include "MatchTreeCodeGenerator.h"
 #include "MatchTreeRewriter.h"
+#include "PhraseTerms.h"
 #include "RankDownCompiler.h"
 #include "RegisterAllocator.h"
 
 
 namespace BitFunnel
 {
-    // QueryPlanner::X64FunctionGeneratorWrapper::X64FunctionGeneratorWrapper(IThreadResources& threadResources)
-    //     : m_code(threadResources.AllocateFunctionGenerator()),
-    //       m_threadResources(threadResources)
-    // {
-    // }
+    unsigned const c_targetCrossProductTermCount = 180;
 
+    // Rewrites are tried until this many seconds have been spent on them.
+    // The first rewrite is always completed.
+    double const c_planningTimeBudget = 0.002;
 
-    // QueryPlanner::X64FunctionGeneratorWrapper::~X64FunctionGeneratorWrapper()
-    // {
-    //     m_threadResources.ReleaseFunctionGenerator(m_code);
-    // }
+    // Rank zero row density assumed for queries without terms.
+    double const c_defaultRowDensity = 0.1;
 
 
-    // QueryPlanner::X64FunctionGeneratorWrapper::operator X64::X64FunctionGenerator&() const
-    // {
-    //     return m_code;
-    // }
+    // Appends the frequency of each term in the tree to frequencies. Facts
+    // have no IDF and are skipped.
+    static void GetTermFrequencies(TermMatchNode const & node,
+                                   IConfiguration const & configuration,
+                                   std::vector<double> & frequencies)
+    {
+        switch (node.GetType())
+        {
+        case TermMatchNode::AndMatch:
+            {
+                auto const & andNode = dynamic_cast<TermMatchNode::And const &>(node);
+                GetTermFrequencies(andNode.GetLeft(), configuration, frequencies);
+                GetTermFrequencies(andNode.GetRight(), configuration, frequencies);
+            }
+            break;
+        case TermMatchNode::OrMatch:
+            {
+                auto const & orNode = dynamic_cast<TermMatchNode::Or const &>(node);
+                GetTermFrequencies(orNode.GetLeft(), configuration, frequencies);
+                GetTermFrequencies(orNode.GetRight(), configuration, frequencies);
+            }
+            break;
+        case TermMatchNode::NotMatch:
+            GetTermFrequencies(dynamic_cast<TermMatchNode::Not const &>(node).GetChild(),
+                               configuration,
+                               frequencies);
+            break;
+        case TermMatchNode::PhraseMatch:
+            for (auto const & term :
+                 GetPhraseTerms(dynamic_cast<TermMatchNode::Phrase const &>(node),
+                                configuration))
+            {
+                frequencies.push_back(Term::IdfX10ToFrequency(term.GetIdfMax()));
+            }
+            break;
+        case TermMatchNode::UnigramMatch:
+            {
+                auto const & unigram = dynamic_cast<TermMatchNode::Unigram const &>(node);
+                Term term(unigram.GetText(), unigram.GetStreamId(), configuration);
+                frequencies.push_back(Term::IdfX10ToFrequency(term.GetIdfMax()));
+            }
+            break;
+        default:
+            break;
+        }
+    }
 
 
-    unsigned const c_targetCrossProductTermCount = 180;
+    // Returns the expected fraction of bits set in the query's rank zero
+    // rows, estimated as the mean frequency of its terms. The TermPlan does
+    // not record which rows belong to which term, and rows shared with other
+    // terms are denser, so this is a lower bound used only to compare
+    // alternative plans.
+    static double EstimateRowDensity(TermMatchNode const & tree,
+                                     IConfiguration const & configuration)
+    {
+        std::vector<double> frequencies;
+        GetTermFrequencies(tree, configuration, frequencies);
+        if (frequencies.empty())
+        {
+            return c_defaultRowDensity;
+        }
+
+        double sum = 0.0;
+        for (double frequency : frequencies)
+        {
+            sum += frequency;
+        }
+        return sum / frequencies.size();
+    }
+
 
     QueryPlanner::QueryPlanner(TermPlan const & termPlan,
                                unsigned targetRowCount,
                                ISimpleIndex const & index,
-                               // IThreadResources& threadResources,
                                IAllocator& allocator,
                                IDiagnosticStream* diagnosticStream)
-                               // bool generateNonBodyPlan,
-                               // unsigned maxIterationsScannedBetweenTerminationChecks)
-    // : // m_x64FunctionGeneratorWrapper(threadResources),
-    //   m_maxIterationsScannedBetweenTerminationChecks(maxIterationsScannedBetweenTerminationChecks)
     {
         if (diagnosticStream != nullptr && diagnosticStream->IsEnabled("planning/term"))
         {
@@ -89,7 +151,6 @@ namespace BitFunnel
         RowPlan const & rowPlan =
             TermPlanConverter::BuildRowPlan(termPlan.GetMatchTree(),
                                             index,
-                                            // generateNonBodyPlan,
                                             allocator);
 
         if (diagnosticStream != nullptr && diagnosticStream->IsEnabled("planning/row"))
@@ -106,6 +167,20 @@ namespace BitFunnel
 
         m_planRows = &rowPlan.GetPlanRows();
 
+        // Start the plan at the highest rank in use rather than at
+        // c_maxRankValue, so that a plan without high rank rows does not
+        // pay for RankDowns through empty ranks. Abstract rows have the
+        // same rank in every shard.
+        m_maxRank = 0;
+        if (m_planRows->GetShardCount() > 0)
+        {
+            for (unsigned id = 0 ; id < m_planRows->GetRowCount(); ++id)
+            {
+                m_maxRank = (std::max)(m_maxRank,
+                                       m_planRows->PhysicalRow(0, id).GetRank());
+            }
+        }
+
         if (diagnosticStream != nullptr && diagnosticStream->IsEnabled("planning/planrows"))
         {
             std::ostream& out = diagnosticStream->GetStream();
@@ -128,30 +203,97 @@ namespace BitFunnel
             }
         }
 
-        // Rewrite match tree to optimal form for the RankDownCompiler.
-        RowMatchNode const & rewritten =
-            MatchTreeRewriter::Rewrite(rowPlan.GetMatchTree(),
-                                       targetRowCount,
-                                       c_targetCrossProductTermCount,
-                                       allocator);
-
+        // Evaluate the match-all and match-none rows. A tree that can never
+        // match compiles to a constant instead of a RankDown tree.
+        RowMatchNode const * folded =
+            ConstantFolder::Fold(rowPlan.GetMatchTree(),
+                                 rowPlan.GetPlanRows(),
+                                 allocator);
 
-        if (diagnosticStream != nullptr && diagnosticStream->IsEnabled("planning/rewrite"))
+        CompileNode const * compileTree = nullptr;
+        if (folded == nullptr)
         {
-            std::ostream& out = diagnosticStream->GetStream();
-            std::unique_ptr<IObjectFormatter>
-                formatter(Factories::CreateObjectFormatter(diagnosticStream->GetStream()));
-
-            out << "--------------------" << std::endl;
-            out << "Rewritten Plan:" << std::endl;
-            rewritten.Format(*formatter);
-            out << std::endl;
+            compileTree = new (allocator.Allocate(sizeof(CompileNode::Constant)))
+                              CompileNode::Constant(0);
         }
+        else
+        {
+            // Rewrite match tree to optimal form for the RankDownCompiler.
+            // The best row count and cross product limits depend on the
+            // length of the query and the density of its rows, so several
+            // settings are tried, starting with the defaults, and the
+            // compiled plan with the fewest expected row reads is kept.
+            struct RewriteSettings
+            {
+                unsigned m_targetRowCount;
+                unsigned m_crossProductTermCount;
+            };
+
+            RewriteSettings const candidates[] = {
+                { targetRowCount, c_targetCrossProductTermCount },
+                { targetRowCount, 0 },
+                { targetRowCount, c_targetCrossProductTermCount / 4 },
+                { (std::max)(targetRowCount / 2, 1u), c_targetCrossProductTermCount },
+                { targetRowCount * 2, c_targetCrossProductTermCount }
+            };
+
+            const double rowDensity =
+                EstimateRowDensity(termPlan.GetMatchTree(),
+                                   index.GetConfiguration());
+
+            Stopwatch stopwatch;
+            RowMatchNode const * rewritten = nullptr;
+            RewriteSettings chosen = candidates[0];
+            double rowReads = 0.0;
+            size_t candidateCount = 0;
+            for (auto const & settings : candidates)
+            {
+                if (candidateCount > 0
+                    && stopwatch.ElapsedTime() > c_planningTimeBudget)
+                {
+                    break;
+                }
+                ++candidateCount;
+
+                RowMatchNode const & candidate =
+                    MatchTreeRewriter::Rewrite(*folded,
+                                               settings.m_targetRowCount,
+                                               settings.m_crossProductTermCount,
+                                               allocator);
+
+                // Compile the match tree into CompileNodes.
+                RankDownCompiler compiler(allocator);
+                compiler.Compile(candidate);
+                CompileNode const & tree = compiler.CreateTree(m_maxRank);
+
+                double candidateRowReads =
+                    RankDownCompiler::EstimateRowReads(tree, rowDensity);
+                if (rewritten == nullptr || candidateRowReads < rowReads)
+                {
+                    rewritten = &candidate;
+                    compileTree = &tree;
+                    chosen = settings;
+                    rowReads = candidateRowReads;
+                }
+            }
 
-        // Compile the match tree into CompileNodes.
-        RankDownCompiler compiler(allocator);
-        compiler.Compile(rewritten);
-        CompileNode const & compileTree = compiler.CreateTree(c_maxRankValue);
+            if (diagnosticStream != nullptr && diagnosticStream->IsEnabled("planning/rewrite"))
+            {
+                std::ostream& out = diagnosticStream->GetStream();
+                std::unique_ptr<IObjectFormatter>
+                    formatter(Factories::CreateObjectFormatter(diagnosticStream->GetStream()));
+
+                out << "--------------------" << std::endl;
+                out << "Rewritten Plan:" << std::endl;
+                rewritten->Format(*formatter);
+                out << std::endl;
+                out << "Target row count: " << chosen.m_targetRowCount << std::endl;
+                out << "Cross product term count: " << chosen.m_crossProductTermCount << std::endl;
+                out << "Row density: " << rowDensity << std::endl;
+                out << "Estimated row reads: " << rowReads << std::endl;
+                out << "Settings tried: " << candidateCount << std::endl;
+            }
+        }
 
         if (diagnosticStream != nullptr && diagnosticStream->IsEnabled("planning/compile"))
         {
@@ -161,34 +303,27 @@ namespace BitFunnel
 
             out << "--------------------" << std::endl;
             out << "Compile Nodes:" << std::endl;
-            compileTree.Format(*formatter);
+            compileTree->Format(*formatter);
             out << std::endl;
         }
 
         // Perform register allocation on the compile tree.
-        RegisterAllocator const registers(compileTree,
+        RegisterAllocator const registers(*compileTree,
                                           rowPlan.GetPlanRows().GetRowCount(),
                                           c_registerBase,
                                           c_registerCount,
                                           allocator);
-
-        // Finally, translate compile tree to X64 machine code.
-        // MatchTreeCodeGenerator generator(registers,
-        //                                  m_x64FunctionGeneratorWrapper,
-        //                                  m_maxIterationsScannedBetweenTerminationChecks);
-        // generator.GenerateX64Code(compileTree);
     }
 
 
-//     const CompiledFunction QueryPlanner::GetMatchingFunction() const
-// OA    {
-//         // TODO: Don't like how call to GetMatchingFunction() finalizes jumps. This should be explicit.
-//         return CompiledFunction((X64::X64FunctionGenerator&)m_x64FunctionGeneratorWrapper);
-//     }
-
-
     IPlanRows const & QueryPlanner::GetPlanRows() const
     {
         return *m_planRows;
     }
+
+
+    Rank QueryPlanner::GetMaxRank() const
+    {
+        return m_maxRank;
+    }
 }
@@ -20,46 +20,172 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <algorithm>    // std::sort.
+#include <cmath>        // std::ceil.
 #include <ostream>
-#include <sstream>
 
 #include "Allocator.h"
 #include "BitFunnel/Configuration/Factories.h"
 #include "BitFunnel/Configuration/IStreamConfiguration.h"
 #include "BitFunnel/Plan/Factories.h"
+#include "BitFunnel/Plan/QueryLimits.h"
+#include "BitFunnel/Plan/QueryRunner.h"
 #include "BitFunnel/Utilities/Factories.h"
 #include "BitFunnel/Utilities/ITaskDistributor.h"
 #include "BitFunnel/Utilities/Stopwatch.h"
+#include "CsvTsv/Csv.h"
+#include "LoggerInterfaces/Check.h"
 #include "QueryParser.h"
-#include "QueryRunner.h"
 
 
 namespace BitFunnel
 {
+    // Arena size for the TermMatchNode tree of a single parsed query.
+    static const size_t c_allocatorSize = 4096;
+
+
+    //*************************************************************************
+    //
+    // QueryRunner::Statistics
+    //
+    //*************************************************************************
     QueryRunner::Statistics::Statistics(
         size_t threadCount,
-        size_t uniqueQueryCount,
-        size_t processedCount,
+        std::vector<std::string> const & queries,
+        std::vector<double> const & latencies,
+        std::vector<size_t> const & matchCounts,
         double elapsedTime)
       : m_threadCount(threadCount),
-        m_uniqueQueryCount(uniqueQueryCount),
-        m_processedCount(processedCount),
-        m_elapsedTime(elapsedTime)
+        m_queries(queries),
+        m_latencies(latencies),
+        m_matchCounts(matchCounts),
+        m_elapsedTime(elapsedTime),
+        m_sortedLatencies(latencies)
+    {
+        CHECK_EQ(m_latencies.size(), m_matchCounts.size())
+            << "Expected one match count per latency.";
+
+        std::sort(m_sortedLatencies.begin(), m_sortedLatencies.end());
+    }
+
+
+    size_t QueryRunner::Statistics::GetThreadCount() const
+    {
+        return m_threadCount;
+    }
+
+
+    size_t QueryRunner::Statistics::GetUniqueQueryCount() const
+    {
+        return m_queries.size();
+    }
+
+
+    size_t QueryRunner::Statistics::GetProcessedCount() const
+    {
+        return m_latencies.size();
+    }
+
+
+    double QueryRunner::Statistics::GetElapsedTime() const
     {
+        return m_elapsedTime;
     }
 
+
+    double QueryRunner::Statistics::GetQPS() const
+    {
+        if (m_elapsedTime <= 0.0)
+        {
+            return 0.0;
+        }
+        return GetProcessedCount() / m_elapsedTime;
+    }
+
+
+    double QueryRunner::Statistics::GetLatencyPercentile(double fraction) const
+    {
+        CHECK_GE(fraction, 0.0) << "Percentile out of range.";
+        CHECK_LE(fraction, 1.0) << "Percentile out of range.";
+
+        if (m_sortedLatencies.empty())
+        {
+            return 0.0;
+        }
+
+        // Nearest rank method.
+        size_t rank =
+            static_cast<size_t>(std::ceil(fraction * m_sortedLatencies.size()));
+        size_t index = (rank == 0) ? 0 : rank - 1;
+        return m_sortedLatencies[index];
+    }
+
+
+    size_t QueryRunner::Statistics::GetTotalMatchCount() const
+    {
+        size_t total = 0;
+        for (auto count : m_matchCounts)
+        {
+            total += count;
+        }
+        return total;
+    }
+
+
     void QueryRunner::Statistics::Print(std::ostream& out) const
     {
-        out << "Print" << std::endl;
+        out << "Thread count: " << m_threadCount << std::endl
+            << "Unique queries: " << GetUniqueQueryCount() << std::endl
+            << "Queries processed: " << GetProcessedCount() << std::endl
+            << "Elapsed time: " << m_elapsedTime << "s" << std::endl
+            << "QPS: " << GetQPS() << std::endl
+            << "Total matches: " << GetTotalMatchCount() << std::endl;
+
+        if (!m_sortedLatencies.empty())
+        {
+            out << "Latency (ms):"
+                << " p50 = " << GetLatencyPercentile(0.5) * 1e3
+                << ", p90 = " << GetLatencyPercentile(0.9) * 1e3
+                << ", p99 = " << GetLatencyPercentile(0.99) * 1e3
+                << ", max = " << m_sortedLatencies.back() * 1e3
+                << std::endl;
+        }
     }
 
 
-    //QueryRunner::QueryRunner(ISimpleIndex const & index,
-    //                         size_t threadCount)
-    //    : m_index(index),
-    //      m_threadCount(threadCount)
-    //{
-    //}
+    void QueryRunner::Statistics::WriteCsv(std::ostream& out) const
+    {
+        CsvTsv::CsvTableFormatter formatter(out);
+        CsvTsv::TableWriter writer(formatter);
+
+        CsvTsv::OutputColumn<std::string> query(
+            "query",
+            "Query text.");
+
+        CsvTsv::OutputColumn<double> latency(
+            "latency",
+            "Time to parse, plan, and match the query, in seconds.");
+
+        CsvTsv::OutputColumn<size_t> matches(
+            "matches",
+            "Number of matching documents.");
+
+        writer.DefineColumn(query);
+        writer.DefineColumn(latency);
+        writer.DefineColumn(matches);
+
+        writer.WritePrologue();
+
+        for (size_t i = 0; i < m_latencies.size(); ++i)
+        {
+            query = m_queries[i % m_queries.size()];
+            latency = m_latencies[i];
+            matches = m_matchCounts[i];
+            writer.WriteDataRow();
+        }
+
+        writer.WriteEpilogue();
+    }
 
 
     //*************************************************************************
@@ -72,7 +198,11 @@ namespace BitFunnel
     public:
         QueryProcessor(ISimpleIndex const & index,
                        IStreamConfiguration const & config,
-                       std::vector<std::string> const & queries);
+                       std::vector<std::string> const & queries,
+                       std::vector<double> & latencies,
+                       std::vector<size_t> & matchCounts,
+                       IPlanCache * planCache,
+                       size_t batchSize);
 
         //
         // ITaskProcessor methods
@@ -82,6 +212,10 @@ namespace BitFunnel
         virtual void Finished() override;
 
     private:
+        // Runs executions [begin, end) together and records the latency of
+        // the batch for each of them.
+        void ProcessBatch(size_t begin, size_t end);
+
         //
         // constructor parameters
         //
@@ -89,37 +223,112 @@ namespace BitFunnel
         IStreamConfiguration const & m_config;
         std::vector<std::string> const & m_queries;
 
-        std::unique_ptr<IAllocator> m_allocator;
+        // Results, indexed by execution. Each task writes only the slots of
+        // its own executions, so no synchronization is required.
+        std::vector<double> & m_latencies;
+        std::vector<size_t> & m_matchCounts;
+
+        // nullptr if plans are not cached.
+        IPlanCache * m_planCache;
+
+        // Number of executions processed by each task.
+        size_t m_batchSize;
 
-        static const size_t c_allocatorSize = 4096;
+        std::unique_ptr<IAllocator> m_allocator;
     };
 
     QueryProcessor::QueryProcessor(ISimpleIndex const & index,
                                    IStreamConfiguration const & config,
-                                   std::vector<std::string> const & queries)
+                                   std::vector<std::string> const & queries,
+                                   std::vector<double> & latencies,
+                                   std::vector<size_t> & matchCounts,
+                                   IPlanCache * planCache,
+                                   size_t batchSize)
       : m_index(index),
         m_config(config),
         m_queries(queries),
-        m_allocator(new Allocator(c_allocatorSize))
+        m_latencies(latencies),
+        m_matchCounts(matchCounts),
+        m_planCache(planCache),
+        m_batchSize(batchSize),
+        m_allocator(new Allocator(c_allocatorSize * batchSize))
     {
     }
 
 
     void QueryProcessor::ProcessTask(size_t taskId)
     {
+        if (m_batchSize > 1)
+        {
+            const size_t begin = taskId * m_batchSize;
+            const size_t end = (std::min)(begin + m_batchSize, m_latencies.size());
+            ProcessBatch(begin, end);
+            return;
+        }
+
+        Stopwatch stopwatch;
+
         m_allocator->Reset();
 
         size_t queryId = taskId % m_queries.size();
 
-        // TODO: Shouldn't use an std::stringstream here.
-        // Just causes an extra copy and allocation per query.
-        std::stringstream s(m_queries[queryId]);
-        QueryParser parser(s, m_config, *m_allocator);
+        std::string const & query = m_queries[queryId];
+        QueryParser parser(query.c_str(), query.size(), m_config, *m_allocator);
         auto tree = parser.Parse();
 
+        size_t matchCount = 0;
         if (tree != nullptr)
         {
-            auto observed = Factories::RunSimplePlanner(*tree, m_index);
+            bool terminatedEarly;
+            auto observed = Factories::RunSimplePlanner(*tree,
+                                                        m_index,
+                                                        QueryLimits(),
+                                                        terminatedEarly,
+                                                        1,
+                                                        nullptr,
+                                                        m_planCache);
+            matchCount = observed.size();
+        }
+
+        m_latencies[taskId] = stopwatch.ElapsedTime();
+        m_matchCounts[taskId] = matchCount;
+    }
+
+
+    void QueryProcessor::ProcessBatch(size_t begin, size_t end)
+    {
+        Stopwatch stopwatch;
+
+        m_allocator->Reset();
+
+        // Queries without terms have no tree and no matches.
+        std::vector<TermMatchNode const *> trees;
+        std::vector<size_t> executions;
+        for (size_t execution = begin; execution < end; ++execution)
+        {
+            std::string const & query = m_queries[execution % m_queries.size()];
+            QueryParser parser(query.c_str(), query.size(), m_config, *m_allocator);
+            auto tree = parser.Parse();
+            if (tree != nullptr)
+            {
+                trees.push_back(tree);
+                executions.push_back(execution);
+            }
+            m_matchCounts[execution] = 0;
+        }
+
+        auto observed = Factories::RunSimplePlannerBatch(trees,
+                                                         m_index,
+                                                         m_planCache);
+        for (size_t i = 0; i < executions.size(); ++i)
+        {
+            m_matchCounts[executions[i]] = observed[i].size();
+        }
+
+        const double latency = stopwatch.ElapsedTime();
+        for (size_t execution = begin; execution < end; ++execution)
+        {
+            m_latencies[execution] = latency;
         }
     }
 
@@ -128,6 +337,7 @@ namespace BitFunnel
     {
     }
 
+
     //*************************************************************************
     //
     // QueryRunner
@@ -137,24 +347,69 @@ namespace BitFunnel
         ISimpleIndex const & index,
         size_t threadCount,
         std::vector<std::string> const & queries,
-        size_t iterations)
+        size_t iterations,
+        IPlanCache * planCache,
+        size_t batchSize)
     {
+        CHECK_GT(threadCount, 0u) << "QueryRunner requires at least one thread.";
+        CHECK_GT(batchSize, 0u) << "QueryRunner requires a batch size of at least one.";
+
         auto config = Factories::CreateStreamConfiguration();
 
+        // Process each query once, untimed, before starting the workers.
+        // This warms the processor caches and ensures that queries which
+        // fail to parse or plan throw on the caller's thread. The plan cache
+        // is not used here, so that the timed runs include the cost of
+        // compiling each plan the first time it is seen.
+        {
+            Allocator allocator(c_allocatorSize);
+            for (auto const & query : queries)
+            {
+                allocator.Reset();
+                QueryParser parser(query.c_str(), query.size(), *config, allocator);
+                auto tree = parser.Parse();
+                if (tree != nullptr)
+                {
+                    bool terminatedEarly;
+                    Factories::RunSimplePlanner(*tree,
+                                                index,
+                                                QueryLimits(),
+                                                terminatedEarly,
+                                                1,
+                                                nullptr,
+                                                nullptr);
+                }
+            }
+        }
+
+        const size_t executionCount = queries.size() * iterations;
+        std::vector<double> latencies(executionCount, 0.0);
+        std::vector<size_t> matchCounts(executionCount, 0);
+        const size_t taskCount = (executionCount + batchSize - 1) / batchSize;
+
         std::vector<std::unique_ptr<ITaskProcessor>> processors;
         for (size_t i = 0; i < threadCount; ++i) {
             processors.push_back(
                 std::unique_ptr<ITaskProcessor>(
-                    new QueryProcessor(index, *config, queries)));
+                    new QueryProcessor(index,
+                                       *config,
+                                       queries,
+                                       latencies,
+                                       matchCounts,
+                                       planCache,
+                                       batchSize)));
         }
 
-        auto distributor =
-            Factories::CreateTaskDistributor(processors,
-                                             queries.size() * iterations);
-
         Stopwatch stopwatch;
+
+        auto distributor =
+            Factories::CreateTaskDistributor(processors, taskCount);
         distributor->WaitForCompletion();
 
-        return QueryRunner::Statistics(0, 0, 0, stopwatch.ElapsedTime());
+        return QueryRunner::Statistics(threadCount,
+                                       queries,
+                                       latencies,
+                                       matchCounts,
+                                       stopwatch.ElapsedTime());
     }
 }
@@ -21,6 +21,7 @@
 // THE SOFTWARE.
 
 #include <algorithm>    // For std::max.
+#include <cmath>        // std::pow().
 #include <new>
 #include <stddef.h>
 
@@ -35,6 +36,191 @@
 
 namespace BitFunnel
 {
+    // Appends the operands of a tree of And nodes to operands, in order.
+    static void FlattenAnd(RowMatchNode const & node,
+                           std::vector<RowMatchNode const *> & operands)
+    {
+        if (node.GetType() == RowMatchNode::AndMatch)
+        {
+            RowMatchNode::And const & andNode = dynamic_cast<RowMatchNode::And const &>(node);
+            FlattenAnd(andNode.GetLeft(), operands);
+            FlattenAnd(andNode.GetRight(), operands);
+        }
+        else
+        {
+            operands.push_back(&node);
+        }
+    }
+
+
+    // Appends the operands of a tree of Or nodes to operands, in order.
+    static void FlattenOr(RowMatchNode const & node,
+                          std::vector<RowMatchNode const *> & operands)
+    {
+        if (node.GetType() == RowMatchNode::OrMatch)
+        {
+            RowMatchNode::Or const & orNode = dynamic_cast<RowMatchNode::Or const &>(node);
+            FlattenOr(orNode.GetLeft(), operands);
+            FlattenOr(orNode.GetRight(), operands);
+        }
+        else
+        {
+            operands.push_back(&node);
+        }
+    }
+
+
+    static bool SameRow(RowMatchNode const & a, RowMatchNode const & b)
+    {
+        AbstractRow const & rowA = dynamic_cast<RowMatchNode::Row const &>(a).GetRow();
+        AbstractRow const & rowB = dynamic_cast<RowMatchNode::Row const &>(b).GetRow();
+
+        return rowA.GetId() == rowB.GetId()
+            && rowA.GetRank() == rowB.GetRank()
+            && rowA.GetRankDelta() == rowB.GetRankDelta()
+            && rowA.IsInverted() == rowB.IsInverted();
+    }
+
+
+    // Returns the number of leading operands that are rows with the same rank
+    // as the first operand. These rows may be evaluated in any order.
+    static size_t GetLeadingRunLength(std::vector<RowMatchNode const *> const & operands)
+    {
+        size_t length = 0;
+        while (length < operands.size()
+               && operands[length]->GetType() == RowMatchNode::RowMatch)
+        {
+            Rank rank = dynamic_cast<RowMatchNode::Row const &>(*operands[length]).GetRow().GetRank();
+            if (length > 0
+                && rank != dynamic_cast<RowMatchNode::Row const &>(*operands[0]).GetRow().GetRank())
+            {
+                break;
+            }
+            ++length;
+        }
+        return length;
+    }
+
+
+    // Returns the position of row in the leading run of operands, or
+    // operands.size() if it is not there.
+    static size_t FindInLeadingRun(std::vector<RowMatchNode const *> const & operands,
+                                   RowMatchNode const & row)
+    {
+        const size_t length = GetLeadingRunLength(operands);
+        for (size_t i = 0; i < length; ++i)
+        {
+            if (SameRow(*operands[i], row))
+            {
+                return i;
+            }
+        }
+        return operands.size();
+    }
+
+
+    // Returns true if the operands match every document, i.e. there are none
+    // or there is only a Report with no child.
+    static bool MatchesAll(std::vector<RowMatchNode const *> const & operands)
+    {
+        return operands.empty()
+            || (operands.size() == 1
+                && operands[0]->GetType() == RowMatchNode::ReportMatch
+                && dynamic_cast<RowMatchNode::Report const &>(*operands[0]).GetChild() == nullptr);
+    }
+
+
+    // Returns the expected fraction of bits set in a row. A bit at rank r
+    // covers 2^r rank zero bits, each set with probability rowDensity.
+    static double GetRowDensity(AbstractRow const & row, double rowDensity)
+    {
+        const double bits =
+            static_cast<double>(1ull << (row.GetRank() + row.GetRankDelta()));
+        const double density = 1.0 - std::pow(1.0 - rowDensity, bits);
+        return row.IsInverted() ? 1.0 - density : density;
+    }
+
+
+    // Returns the probability that a quadword with the specified fraction of
+    // bits set is non-zero, i.e. that a Jz falls through.
+    static double GetPassProbability(double density)
+    {
+        return 1.0 - std::pow(1.0 - density,
+                              static_cast<double>(c_bitsPerQuadword));
+    }
+
+
+    // accumulatorDensity is the expected fraction of bits set in the
+    // accumulator on entry to node.
+    static double EstimateRowReadsInternal(CompileNode const & node,
+                                           double accumulatorDensity,
+                                           double rowDensity)
+    {
+        switch (node.GetType())
+        {
+        case CompileNode::opAndRowJz:
+            {
+                CompileNode::AndRowJz const & andRow = dynamic_cast<CompileNode::AndRowJz const &>(node);
+                const double density =
+                    accumulatorDensity * GetRowDensity(andRow.GetRow(), rowDensity);
+                return 1.0 + GetPassProbability(density) *
+                    EstimateRowReadsInternal(andRow.GetChild(), density, rowDensity);
+            }
+        case CompileNode::opLoadRowJz:
+            {
+                CompileNode::LoadRowJz const & loadRow = dynamic_cast<CompileNode::LoadRowJz const &>(node);
+                const double density = GetRowDensity(loadRow.GetRow(), rowDensity);
+                return 1.0 + GetPassProbability(density) *
+                    EstimateRowReadsInternal(loadRow.GetChild(), density, rowDensity);
+            }
+        case CompileNode::opOr:
+        case CompileNode::opOrTree:
+            {
+                CompileNode::Binary const & binary = dynamic_cast<CompileNode::Binary const &>(node);
+                return EstimateRowReadsInternal(binary.GetLeft(), accumulatorDensity, rowDensity)
+                    + EstimateRowReadsInternal(binary.GetRight(), accumulatorDensity, rowDensity);
+            }
+        case CompileNode::opRankDown:
+            {
+                // The accumulator density is carried down unchanged. This
+                // overestimates the density at the lower rank, but rows
+                // read there are sparser.
+                CompileNode::RankDown const & rankDown = dynamic_cast<CompileNode::RankDown const &>(node);
+                return (1ull << rankDown.GetDelta())
+                    * EstimateRowReadsInternal(rankDown.GetChild(), accumulatorDensity, rowDensity);
+            }
+        case CompileNode::opReport:
+            {
+                CompileNode const * child = dynamic_cast<CompileNode::Report const &>(node).GetChild();
+                return (child == nullptr) ?
+                    0.0 :
+                    EstimateRowReadsInternal(*child, accumulatorDensity, rowDensity);
+            }
+        case CompileNode::opAndTree:
+            {
+                // Rank zero trees are costed as if the right side runs
+                // whenever the accumulator is non-zero on entry.
+                CompileNode::Binary const & binary = dynamic_cast<CompileNode::Binary const &>(node);
+                return EstimateRowReadsInternal(binary.GetLeft(), accumulatorDensity, rowDensity)
+                    + GetPassProbability(accumulatorDensity)
+                      * EstimateRowReadsInternal(binary.GetRight(), accumulatorDensity, rowDensity);
+            }
+        case CompileNode::opConstant:
+            return 0.0;
+        case CompileNode::opLoadRow:
+            return 1.0;
+        case CompileNode::opNot:
+            return EstimateRowReadsInternal(dynamic_cast<CompileNode::Not const &>(node).GetChild(),
+                                            accumulatorDensity,
+                                            rowDensity);
+        default:
+            LogAbortB("Bad CompileNode type.");
+        }
+
+        return 0.0;
+    }
+
+
     RankDownCompiler::RankDownCompiler(IAllocator& allocator)
         : m_allocator(allocator),
           m_currentRank(0),
@@ -45,16 +231,19 @@ namespace BitFunnel
 
     void RankDownCompiler::Compile(RowMatchNode const & root)
     {
-        CompileInternal(root, true);
+        CompileInternal(FactorPrefixes(root), true, nullptr, 0);
     }
 
 
-    void RankDownCompiler::CompileInternal(RowMatchNode const & root, bool leftMostChild)
+    void RankDownCompiler::CompileInternal(RowMatchNode const & root,
+                                           bool leftMostChild,
+                                           CompileNode const * continuation,
+                                           Rank continuationRank)
     {
         // Initialize m_currentRank and m_accumulator here so that CompileInternal()
         // can be called multiple times.
-        m_currentRank = 0;
-        m_accumulator = nullptr;
+        m_currentRank = continuationRank;
+        m_accumulator = continuation;
         CompileTraversal(root, leftMostChild);
     }
 
@@ -75,6 +264,187 @@ namespace BitFunnel
     }
 
 
+    double RankDownCompiler::EstimateRowReads(CompileNode const & tree,
+                                              double rowDensity)
+    {
+        return EstimateRowReadsInternal(tree, 1.0, rowDensity);
+    }
+
+
+    RowMatchNode const & RankDownCompiler::FactorPrefixes(RowMatchNode const & node)
+    {
+        switch (node.GetType())
+        {
+        case RowMatchNode::AndMatch:
+            {
+                RowMatchNode::And const & andNode = dynamic_cast<RowMatchNode::And const &>(node);
+                RowMatchNode const & left = FactorPrefixes(andNode.GetLeft());
+                RowMatchNode const & right = FactorPrefixes(andNode.GetRight());
+                if (&left == &andNode.GetLeft() && &right == &andNode.GetRight())
+                {
+                    return node;
+                }
+                return *new (m_allocator.Allocate(sizeof(RowMatchNode::And)))
+                            RowMatchNode::And(left, right);
+            }
+        case RowMatchNode::OrMatch:
+            {
+                Operands leaves;
+                FlattenOr(node, leaves);
+
+                std::vector<Operands> branches(leaves.size());
+                bool shared = false;
+                for (size_t i = 0; i < leaves.size(); ++i)
+                {
+                    FlattenAnd(*leaves[i], branches[i]);
+                    const size_t length = GetLeadingRunLength(branches[i]);
+                    for (size_t j = 0; j < i && !shared; ++j)
+                    {
+                        for (size_t k = 0; k < length && !shared; ++k)
+                        {
+                            shared = FindInLeadingRun(branches[j], *branches[i][k])
+                                < branches[j].size();
+                        }
+                    }
+                }
+
+                if (shared)
+                {
+                    return FactorBranches(branches);
+                }
+
+                // Nothing to factor at this level. Keep the shape of the tree
+                // so that the order of the branches is unchanged.
+                RowMatchNode::Or const & orNode = dynamic_cast<RowMatchNode::Or const &>(node);
+                RowMatchNode const & left = FactorPrefixes(orNode.GetLeft());
+                RowMatchNode const & right = FactorPrefixes(orNode.GetRight());
+                if (&left == &orNode.GetLeft() && &right == &orNode.GetRight())
+                {
+                    return node;
+                }
+                return *new (m_allocator.Allocate(sizeof(RowMatchNode::Or)))
+                            RowMatchNode::Or(left, right);
+            }
+        default:
+            return node;
+        }
+    }
+
+
+    RowMatchNode const & RankDownCompiler::FactorBranches(std::vector<Operands> & branches)
+    {
+        Operands terms;
+
+        while (!branches.empty())
+        {
+            // Find the row that appears in the leading runs of the most
+            // branches.
+            RowMatchNode const * best = nullptr;
+            size_t bestCount = 1;
+            for (auto const & branch : branches)
+            {
+                const size_t length = GetLeadingRunLength(branch);
+                for (size_t i = 0; i < length; ++i)
+                {
+                    size_t count = 0;
+                    for (auto const & other : branches)
+                    {
+                        if (FindInLeadingRun(other, *branch[i]) < other.size())
+                        {
+                            ++count;
+                        }
+                    }
+
+                    if (count > bestCount)
+                    {
+                        best = branch[i];
+                        bestCount = count;
+                    }
+                }
+            }
+
+            if (best == nullptr)
+            {
+                for (auto const & branch : branches)
+                {
+                    terms.push_back(&CreateAnd(branch, 0));
+                }
+                break;
+            }
+
+            // Remove the row from the branches that share it.
+            std::vector<Operands> group;
+            std::vector<Operands> others;
+            for (auto & branch : branches)
+            {
+                const size_t position = FindInLeadingRun(branch, *best);
+                if (position < branch.size())
+                {
+                    branch.erase(branch.begin() + position);
+                    group.push_back(std::move(branch));
+                }
+                else
+                {
+                    others.push_back(std::move(branch));
+                }
+            }
+
+            // A branch with nothing left after the shared row matches
+            // whenever the row does, which makes the rest of the group
+            // redundant, i.e. a + ab = a.
+            RowMatchNode const * rest = nullptr;
+            for (auto const & branch : group)
+            {
+                if (MatchesAll(branch))
+                {
+                    rest = branch.empty() ? best : &CreateAnd(branch, 0);
+                    break;
+                }
+            }
+
+            if (rest == best)
+            {
+                terms.push_back(best);
+            }
+            else
+            {
+                if (rest == nullptr)
+                {
+                    rest = &FactorBranches(group);
+                }
+                terms.push_back(new (m_allocator.Allocate(sizeof(RowMatchNode::And)))
+                                    RowMatchNode::And(*best, *rest));
+            }
+
+            branches.swap(others);
+        }
+
+        RowMatchNode const * tree = terms.back();
+        for (size_t i = terms.size() - 1; i > 0; --i)
+        {
+            tree = new (m_allocator.Allocate(sizeof(RowMatchNode::Or)))
+                       RowMatchNode::Or(*terms[i - 1], *tree);
+        }
+        return *tree;
+    }
+
+
+    RowMatchNode const & RankDownCompiler::CreateAnd(Operands const & operands,
+                                                     size_t start)
+    {
+        LogAssertB(start < operands.size(), "No operands.");
+
+        RowMatchNode const & first = FactorPrefixes(*operands[start]);
+        if (start + 1 == operands.size())
+        {
+            return first;
+        }
+
+        return *new (m_allocator.Allocate(sizeof(RowMatchNode::And)))
+                    RowMatchNode::And(first, CreateAnd(operands, start + 1));
+    }
+
+
     void RankDownCompiler::CompileTraversal(RowMatchNode const & node, bool leftmostChild)
     {
         switch (node.GetType())
@@ -90,10 +460,18 @@ namespace BitFunnel
             {
                 RowMatchNode::Or const & orNode = dynamic_cast<RowMatchNode::Or const &>(node);
 
+                // Each branch is followed by the code already compiled for
+                // the rest of the And, i.e. (a + b)c compiles as ac + bc.
                 RankDownCompiler left(m_allocator);
-                left.CompileInternal(orNode.GetLeft(), leftmostChild);
+                left.CompileInternal(orNode.GetLeft(),
+                                     leftmostChild,
+                                     m_accumulator,
+                                     m_currentRank);
                 RankDownCompiler right(m_allocator);
-                right.CompileInternal(orNode.GetRight(), leftmostChild);
+                right.CompileInternal(orNode.GetRight(),
+                                      leftmostChild,
+                                      m_accumulator,
+                                      m_currentRank);
 
                 Rank rank = (std::max)(left.m_currentRank,
                                        right.m_currentRank);
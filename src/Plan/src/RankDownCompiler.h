@@ -22,6 +22,8 @@
 
 #pragma once
 
+#include <vector>                         // std::vector parameter.
+
 #include "BitFunnel/BitFunnelTypes.h"     // Rank used as a parameter.
 #include "BitFunnel/NonCopyable.h"        // Inherits from NonCopyable.
 
@@ -37,6 +39,19 @@ namespace BitFunnel
     class RowMatchNode;
 
 
+    //*************************************************************************
+    //
+    // RankDownCompiler converts a tree of RowMatchNodes, in the form produced
+    // by MatchTreeRewriter, into a tree of CompileNodes.
+    //
+    // Before compiling, rows shared by several branches of an Or are
+    // factored out, e.g. (ab + ac + d) is compiled as a(b + c) + d. The
+    // shared row is loaded once and the CompileNode::Or restores the
+    // accumulator with Push/Pop before each branch. Only rows in the leading
+    // run of equal rank rows of each branch are candidates, since the order
+    // of rows with the same rank does not matter.
+    //
+    //*************************************************************************
     class RankDownCompiler : NonCopyable
     {
     public:
@@ -53,14 +68,42 @@ namespace BitFunnel
 
         CompileNode const & CreateTree(Rank initialRank);
 
+        // Returns the expected number of rows read by one iteration of a
+        // CompileNode tree at its initial rank. rowDensity is the expected
+        // fraction of bits set in a rank zero row. Higher rank rows are
+        // denser, so a row guarded by a Jz is discounted by the probability
+        // that the quadwords ANDed before it are non-zero, and a RankDown by
+        // delta runs its child 2^delta times. Used to choose between
+        // alternative plans for the same query.
+        static double EstimateRowReads(CompileNode const & tree,
+                                       double rowDensity);
+
     private:
-        void CompileInternal(RowMatchNode const & root, bool leftMostChild);
+        // Compiles root ahead of the CompileNodes in continuation, which
+        // must be at rank continuationRank.
+        void CompileInternal(RowMatchNode const & root,
+                             bool leftMostChild,
+                             CompileNode const * continuation,
+                             Rank continuationRank);
 
         void CompileTraversal(RowMatchNode const & node,
                               bool leftMostChild);
 
         CompileNode const & RankUp(CompileNode const & node);
 
+        // Returns node with rows shared by branches of its Or nodes factored
+        // out.
+        RowMatchNode const & FactorPrefixes(RowMatchNode const & node);
+
+        // Builds an Or of the branches, each of which is a sequence of And
+        // operands. Factors out the row found in the leading runs of the
+        // most branches, then recurses on the remaining operands.
+        typedef std::vector<RowMatchNode const *> Operands;
+        RowMatchNode const & FactorBranches(std::vector<Operands> & branches);
+
+        RowMatchNode const & CreateAnd(Operands const & operands,
+                                       size_t start);
+
         IAllocator& m_allocator;
         Rank m_currentRank;
         CompileNode const * m_accumulator;
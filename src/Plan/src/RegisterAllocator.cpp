@@ -210,6 +210,9 @@ namespace BitFunnel
                 CollectRows(node.GetRight(), depth + 1, uses);
             }
             break;
+        case CompileNode::opConstant:
+            // Constants read no rows.
+            break;
         case CompileNode::opLoadRow:
             {
                 CompileNode::LoadRow const & node =
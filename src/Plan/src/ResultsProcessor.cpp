@@ -0,0 +1,148 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifdef _MSC_VER
+#include <intrin.h>         // _BitScanForward64(), __popcnt64().
+#endif
+
+#include "LoggerInterfaces/Check.h"
+#include "QueryBudget.h"
+#include "ResultsProcessor.h"
+
+
+namespace BitFunnel
+{
+    // Returns the index of the lowest set bit. value must not be zero.
+    static unsigned CountTrailingZeros(uint64_t value)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctzll(value));
+#endif
+    }
+
+
+    static size_t PopulationCount(uint64_t value)
+    {
+#ifdef _MSC_VER
+        return static_cast<size_t>(__popcnt64(value));
+#else
+        return static_cast<size_t>(__builtin_popcountll(value));
+#endif
+    }
+
+
+    ResultsProcessor::ResultsProcessor(std::vector<DocId> & matches,
+                                       ptrdiff_t docIdOffset,
+                                       size_t docIdStride,
+                                       QueryBudget * budget)
+      : m_matches(matches),
+        m_docIdOffset(docIdOffset),
+        m_docIdStride(docIdStride),
+        m_budget(budget),
+        m_timeCheckCountdown(c_timeCheckInterval),
+        m_slotCount(0)
+    {
+        for (size_t i = 0; i < c_slotCount; ++i)
+        {
+            m_accumulators[i] = 0;
+        }
+    }
+
+
+    void ResultsProcessor::AddResult(uint64_t accumulator,
+                                     size_t offset)
+    {
+        if (accumulator == 0)
+        {
+            return;
+        }
+
+        const size_t slot = offset & c_slotMask;
+        if (m_accumulators[slot] == 0)
+        {
+            m_slots[m_slotCount++] = slot;
+            m_offsets[slot] = offset;
+        }
+        else
+        {
+            CHECK_EQ(m_offsets[slot], offset)
+                << "Offsets in one iteration span more than "
+                << c_slotCount << " quadwords.";
+        }
+        m_accumulators[slot] |= accumulator;
+    }
+
+
+    bool ResultsProcessor::FinishIteration(void const * sliceBuffer)
+    {
+        char const * docIds =
+            static_cast<char const *>(sliceBuffer) + m_docIdOffset;
+        const size_t initialMatchCount = m_matches.size();
+
+        for (size_t i = 0; i < m_slotCount; ++i)
+        {
+            const size_t slot = m_slots[i];
+            uint64_t accumulator = m_accumulators[slot];
+            m_accumulators[slot] = 0;
+
+            const DocIndex base = m_offsets[slot] * c_bitsPerQuadword;
+
+            size_t position = m_matches.size();
+            m_matches.resize(position + PopulationCount(accumulator));
+
+            while (accumulator != 0)
+            {
+                const DocIndex index = base + CountTrailingZeros(accumulator);
+                m_matches[position++] = *reinterpret_cast<DocId const *>(
+                    docIds + index * m_docIdStride);
+
+                // Clear the lowest set bit.
+                accumulator &= accumulator - 1;
+            }
+        }
+        m_slotCount = 0;
+
+        if (m_budget == nullptr)
+        {
+            return false;
+        }
+
+        bool exhausted =
+            m_budget->AddMatches(m_matches.size() - initialMatchCount);
+        if (!exhausted && --m_timeCheckCountdown == 0)
+        {
+            m_timeCheckCountdown = c_timeCheckInterval;
+            exhausted = m_budget->CheckTime();
+        }
+        return exhausted;
+    }
+
+
+    bool ResultsProcessor::TerminatedEarly() const
+    {
+        return m_budget != nullptr && m_budget->IsExhausted();
+    }
+}
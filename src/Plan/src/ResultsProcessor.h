@@ -0,0 +1,105 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                             // size_t, ptrdiff_t parameter.
+#include <stdint.h>                             // uint64_t embedded.
+#include <vector>                               // std::vector parameter.
+
+#include "BitFunnel/BitFunnelTypes.h"           // c_maxRankValue, DocId.
+#include "BitFunnel/NonCopyable.h"              // Base class.
+#include "BitFunnel/Plan/IResultsProcessor.h"   // Base class.
+
+
+namespace BitFunnel
+{
+    class QueryBudget;
+
+    //*************************************************************************
+    //
+    // ResultsProcessor is an IResultsProcessor that appends the DocIds of
+    // matching documents to a caller-supplied vector.
+    //
+    // AddResult() stores each accumulator in a fixed-capacity buffer with one
+    // slot per rank 0 quadword offset. All of the offsets reported in a
+    // single iteration lie in one aligned block of at most 2^c_maxRankValue
+    // quadwords, so the low bits of the offset select a unique slot. Offsets
+    // that are reported more than once, for example by different branches of
+    // a RankDown, are deduped by or-ing their accumulators.
+    //
+    // FinishIteration() visits the set bits of each accumulator with a count
+    // trailing zeros loop and reads DocIds directly from the slice buffer's
+    // DocTable, using the layout returned by IShard::GetDocIdOffset() and
+    // IShard::GetDocIdStride().
+    //
+    // When a QueryBudget is supplied, the matches are counted against it and
+    // its time limit is checked every c_timeCheckInterval iterations.
+    // FinishIteration() returns true once the budget is exhausted, so that
+    // the matcher stops.
+    //
+    // ResultsProcessor does not allocate memory, except when growing the
+    // vector of matches.
+    //
+    //*************************************************************************
+    class ResultsProcessor : public IResultsProcessor, NonCopyable
+    {
+    public:
+        ResultsProcessor(std::vector<DocId> & matches,
+                         ptrdiff_t docIdOffset,
+                         size_t docIdStride,
+                         QueryBudget * budget = nullptr);
+
+        //
+        // IResultsProcessor methods.
+        //
+
+        virtual void AddResult(uint64_t accumulator,
+                               size_t offset) override;
+        virtual bool FinishIteration(void const * sliceBuffer) override;
+        virtual bool TerminatedEarly() const override;
+
+    private:
+        static const size_t c_slotCount = 1ull << c_maxRankValue;
+        static const size_t c_slotMask = c_slotCount - 1;
+
+        static const size_t c_timeCheckInterval = 64;
+
+        std::vector<DocId> & m_matches;
+        ptrdiff_t m_docIdOffset;
+        size_t m_docIdStride;
+
+        QueryBudget * m_budget;
+        size_t m_timeCheckCountdown;
+
+        // Accumulators and offsets for the current iteration, indexed by
+        // the low bits of the offset. Slots not used by the current
+        // iteration have zero accumulators.
+        uint64_t m_accumulators[c_slotCount];
+        size_t m_offsets[c_slotCount];
+
+        // Slots used by the current iteration, in the order of their first
+        // call to AddResult().
+        size_t m_slots[c_slotCount];
+        size_t m_slotCount;
+    };
+}
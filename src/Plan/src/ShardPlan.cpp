@@ -0,0 +1,328 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>    // std::stable_sort()
+#include <new>
+#include <ostream>        // IShard.h requires std::ostream.
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>             // __popcnt64().
+#endif
+
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Index/RowIdSequence.h"
+#include "ByteCodeInterpreter.h"
+#include "CompileNode.h"
+#include "LoggerInterfaces/Check.h"
+#include "NativeCodeGenerator.h"
+#include "RegisterAllocator.h"
+#include "ResultsProcessor.h"
+#include "ShardPlan.h"
+#include "ThreadedCodeInterpreter.h"
+
+
+namespace BitFunnel
+{
+    static size_t PopulationCount(uint64_t value)
+    {
+#ifdef _MSC_VER
+        return static_cast<size_t>(__popcnt64(value));
+#else
+        return static_cast<size_t>(__builtin_popcountll(value));
+#endif
+    }
+
+
+    //*************************************************************************
+    //
+    // ShardPlan
+    //
+    //*************************************************************************
+    ShardPlan::MatcherState::MatcherState()
+    {
+    }
+
+
+    ShardPlan::MatcherState::~MatcherState()
+    {
+    }
+
+
+    ShardPlan::ShardPlan(IShard const & shard, std::vector<Term> const & terms)
+      : m_docIdOffset(shard.GetDocIdOffset()),
+        m_docIdStride(shard.GetDocIdStride()),
+        m_allocator(c_allocatorSize),
+        m_useWideWords(false)
+    {
+        // Within each rank, intersect the sparsest rows first, so that the
+        // Jz after each AndRow is taken as early as possible. The density
+        // of a row is sampled from the shard's slices. The frequency of the
+        // row's term, which is a lower bound on the density, breaks ties
+        // and orders rows when the shard has no slices to sample.
+        struct Candidate
+        {
+            RowId m_row;
+            double m_density;
+            double m_frequency;
+        };
+
+        std::vector<Candidate> candidates;
+        for (auto const & term : terms)
+        {
+            const double frequency = Term::IdfX10ToFrequency(term.GetIdfMax());
+            RowIdSequence rows(term, shard.GetTermTable());
+            for (auto row : rows)
+            {
+                candidates.push_back({ row, SampleDensity(shard, row), frequency });
+            }
+        }
+
+        std::stable_sort(candidates.begin(),
+                         candidates.end(),
+                         [](Candidate const & a, Candidate const & b)
+        {
+            // Sorts by decreasing rank, then increasing density.
+            if (a.m_row.GetRank() != b.m_row.GetRank())
+            {
+                return a.m_row.GetRank() > b.m_row.GetRank();
+            }
+            if (a.m_density != b.m_density)
+            {
+                return a.m_density < b.m_density;
+            }
+            return a.m_frequency < b.m_frequency;
+        });
+
+        for (auto const & candidate : candidates)
+        {
+            m_rows.push_back(candidate.m_row);
+        }
+
+        CHECK_GT(m_rows.size(), 0u);
+        Rank rank = m_rows[0].GetRank();
+        CompileNode const & compileTree = Compile();
+
+        // Iterations per slice calculation.
+        m_iterationsPerSlice = shard.GetSliceCapacity() >> 6 >> rank;
+
+        // Get Row offsets.
+        for (auto row : m_rows)
+        {
+            m_rowOffsets.push_back(shard.GetRowOffset(row));
+        }
+
+        // Wide words are fastest for plans they can run, which are those
+        // without RankDown. Otherwise native code is fastest, followed by
+        // the ThreadedCodeInterpreter. See the benchmark in
+        // ThreadedCodeInterpreterTest.cpp.
+        m_byteCode.reset(new ByteCodeGenerator());
+        compileTree.Compile(*m_byteCode);
+        m_byteCode->Seal();
+
+        m_useWideWords =
+            ByteCodeInterpreter::UsesWideWords(*m_byteCode, m_iterationsPerSlice);
+
+        if (!m_useWideWords && NativeCodeGenerator::IsSupported())
+        {
+            m_byteCode.reset();
+
+            m_registers.reset(
+                new RegisterAllocator(compileTree,
+                                      static_cast<unsigned>(m_rows.size()),
+                                      c_registerBase,
+                                      c_registerCount,
+                                      m_allocator));
+
+            m_nativeCode.reset(new NativeCodeGenerator(*m_registers));
+            compileTree.Compile(*m_nativeCode);
+            m_nativeCode->Seal();
+        }
+    }
+
+
+    ShardPlan::~ShardPlan()
+    {
+    }
+
+
+    std::vector<RowId> const & ShardPlan::GetRows() const
+    {
+        return m_rows;
+    }
+
+
+    size_t ShardPlan::GetIterationsPerSlice() const
+    {
+        return m_iterationsPerSlice;
+    }
+
+
+    double ShardPlan::SampleDensity(IShard const & shard, RowId row)
+    {
+        auto const & sliceBuffers = shard.GetSliceBuffers();
+        if (sliceBuffers.empty())
+        {
+            return 0.0;
+        }
+
+        const ptrdiff_t rowOffset = shard.GetRowOffset(row);
+        const size_t quadwordsPerSlice =
+            shard.GetSliceCapacity() >> 6 >> row.GetRank();
+
+        // Sample evenly spaced quadwords from evenly spaced slices.
+        const size_t sliceCount =
+            (sliceBuffers.size() < c_densitySampleSlices) ?
+                sliceBuffers.size() : c_densitySampleSlices;
+        const size_t quadwordCount =
+            (quadwordsPerSlice < c_densitySampleQuadwords) ?
+                quadwordsPerSlice : c_densitySampleQuadwords;
+
+        size_t bitCount = 0;
+        for (size_t i = 0; i < sliceCount; ++i)
+        {
+            char const * sliceBuffer = static_cast<char const *>(
+                sliceBuffers[i * sliceBuffers.size() / sliceCount]);
+            uint64_t const * quadwords =
+                reinterpret_cast<uint64_t const *>(sliceBuffer + rowOffset);
+
+            for (size_t j = 0; j < quadwordCount; ++j)
+            {
+                bitCount += PopulationCount(quadwords[j * quadwordsPerSlice / quadwordCount]);
+            }
+        }
+
+        return static_cast<double>(bitCount) / (sliceCount * quadwordCount * 64);
+    }
+
+
+    bool ShardPlan::ProcessSlice(size_t slice,
+                                 char * const * sliceBuffers,
+                                 size_t sliceCount,
+                                 std::vector<DocId> & matches,
+                                 QueryBudget * budget,
+                                 MatcherState & state) const
+    {
+        return ProcessIterations(slice,
+                                 0,
+                                 m_iterationsPerSlice,
+                                 sliceBuffers,
+                                 sliceCount,
+                                 matches,
+                                 budget,
+                                 state);
+    }
+
+
+    bool ShardPlan::ProcessIterations(size_t slice,
+                                      size_t begin,
+                                      size_t end,
+                                      char * const * sliceBuffers,
+                                      size_t sliceCount,
+                                      std::vector<DocId> & matches,
+                                      QueryBudget * budget,
+                                      MatcherState & state) const
+    {
+        if (state.m_resultsProcessor.get() == nullptr)
+        {
+            state.m_resultsProcessor.reset(
+                new ResultsProcessor(matches,
+                                     m_docIdOffset,
+                                     m_docIdStride,
+                                     budget));
+        }
+        ResultsProcessor & resultsProcessor = *state.m_resultsProcessor;
+
+        if (m_nativeCode.get() != nullptr)
+        {
+            if (state.m_runner.get() == nullptr)
+            {
+                state.m_runner.reset(
+                    new NativeCodeRunner(*m_nativeCode,
+                                         resultsProcessor,
+                                         sliceCount,
+                                         sliceBuffers,
+                                         m_iterationsPerSlice,
+                                         m_rowOffsets.data()));
+            }
+            return state.m_runner->ProcessIterations(slice, begin, end);
+        }
+        else if (m_useWideWords)
+        {
+            if (state.m_interpreter.get() == nullptr)
+            {
+                state.m_interpreter.reset(
+                    new ByteCodeInterpreter(*m_byteCode,
+                                            resultsProcessor,
+                                            sliceCount,
+                                            sliceBuffers,
+                                            m_iterationsPerSlice,
+                                            m_rowOffsets.data()));
+            }
+            return state.m_interpreter->ProcessIterations(slice, begin, end);
+        }
+        else
+        {
+            if (state.m_threadedInterpreter.get() == nullptr)
+            {
+                state.m_threadedInterpreter.reset(
+                    new ThreadedCodeInterpreter(*m_byteCode,
+                                                resultsProcessor,
+                                                sliceCount,
+                                                sliceBuffers,
+                                                m_iterationsPerSlice,
+                                                m_rowOffsets.data()));
+            }
+            return state.m_threadedInterpreter->ProcessIterations(slice, begin, end);
+        }
+    }
+
+
+    CompileNode const & ShardPlan::Compile()
+    {
+        // Build the tree from the leaf up, starting with the Report node.
+        CompileNode const * node =
+            new (m_allocator.Allocate(sizeof(CompileNode::Report)))
+                CompileNode::Report(nullptr);
+
+        for (size_t pos = m_rows.size() - 1; pos > 0; --pos)
+        {
+            Rank rank = m_rows[pos].GetRank();
+            AbstractRow row(static_cast<unsigned>(pos), rank, false);
+            node = new (m_allocator.Allocate(sizeof(CompileNode::AndRowJz)))
+                       CompileNode::AndRowJz(row, *node);
+
+            Rank previousRank = m_rows[pos - 1].GetRank();
+            if (previousRank > rank)
+            {
+                node = new (m_allocator.Allocate(sizeof(CompileNode::RankDown)))
+                           CompileNode::RankDown(previousRank - rank, *node);
+            }
+        }
+
+        AbstractRow row(0u, m_rows[0].GetRank(), false);
+        node = new (m_allocator.Allocate(sizeof(CompileNode::LoadRowJz)))
+                   CompileNode::LoadRowJz(row, *node);
+
+        return *node;
+    }
+}
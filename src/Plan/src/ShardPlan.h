@@ -0,0 +1,154 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                         // size_t, ptrdiff_t embedded.
+#include <memory>                           // std::unique_ptr embedded.
+#include <vector>                           // std::vector embedded.
+
+#include "Allocator.h"                      // Allocator embedded.
+#include "BitFunnel/BitFunnelTypes.h"       // DocId parameter.
+#include "BitFunnel/Index/RowId.h"          // RowId embedded.
+#include "BitFunnel/NonCopyable.h"          // Base class.
+#include "BitFunnel/Term.h"                 // Term parameter.
+
+
+namespace BitFunnel
+{
+    class ByteCodeGenerator;
+    class ByteCodeInterpreter;
+    class CompileNode;
+    class IShard;
+    class NativeCodeGenerator;
+    class NativeCodeRunner;
+    class QueryBudget;
+    class RegisterAllocator;
+    class ResultsProcessor;
+    class ThreadedCodeInterpreter;
+
+    //*************************************************************************
+    //
+    // ShardPlan holds the rows, row offsets, and compiled matching code for
+    // a conjunction of terms on one shard. It does not hold on to the
+    // shard's slices, so it is read-only after construction and may be
+    // shared by all of the threads scanning the shard and by later queries
+    // with the same terms (see PlanCache). The per-thread matcher state
+    // lives in a MatcherState owned by each thread.
+    //
+    //*************************************************************************
+    class ShardPlan : NonCopyable
+    {
+    public:
+        struct MatcherState
+        {
+            MatcherState();
+            ~MatcherState();
+
+            std::unique_ptr<ResultsProcessor> m_resultsProcessor;
+            std::unique_ptr<NativeCodeRunner> m_runner;
+            std::unique_ptr<ByteCodeInterpreter> m_interpreter;
+            std::unique_ptr<ThreadedCodeInterpreter> m_threadedInterpreter;
+        };
+
+        // Compiles a plan for the conjunction of terms. Within each rank,
+        // rows are ordered by increasing density, as sampled from the
+        // shard's slices. The caller must hold a Token.
+        ShardPlan(IShard const & shard, std::vector<Term> const & terms);
+
+        ~ShardPlan();
+
+        // Returns the rows in the order in which they are intersected.
+        std::vector<RowId> const & GetRows() const;
+
+        // Returns the number of iterations needed to scan a slice at the
+        // plan's highest rank.
+        size_t GetIterationsPerSlice() const;
+
+        // Returns the fraction of bits set in a sample of the row's
+        // quadwords, or 0.0 if the shard has no slices. The caller must
+        // hold a Token.
+        static double SampleDensity(IShard const & shard, RowId row);
+
+        // Scans one slice, appending the DocIds of matches to matches. The
+        // matcher in state is created on first use and must always be used
+        // with the same slice buffers, matches vector, and budget. The
+        // caller must hold a Token for as long as the slice buffers are in
+        // use. Returns true to indicate early termination.
+        bool ProcessSlice(size_t slice,
+                          char * const * sliceBuffers,
+                          size_t sliceCount,
+                          std::vector<DocId> & matches,
+                          QueryBudget * budget,
+                          MatcherState & state) const;
+
+        // Scans iterations [begin, end) of one slice with the same matcher
+        // as ProcessSlice(), so that several plans can take turns on the
+        // part of a slice that is in cache (see ByteCodeBatchRunner). The
+        // same requirements apply to state. Returns true to indicate early
+        // termination.
+        bool ProcessIterations(size_t slice,
+                               size_t begin,
+                               size_t end,
+                               char * const * sliceBuffers,
+                               size_t sliceCount,
+                               std::vector<DocId> & matches,
+                               QueryBudget * budget,
+                               MatcherState & state) const;
+
+    private:
+        // Builds a chain of LoadRowJz/AndRowJz nodes that intersects
+        // m_rows, inserting a RankDown node wherever the rank decreases.
+        CompileNode const & Compile();
+
+        // Rows for the terms, sorted by decreasing rank.
+        std::vector<RowId> m_rows;
+        std::vector<ptrdiff_t> m_rowOffsets;
+
+        size_t m_iterationsPerSlice;
+
+        ptrdiff_t m_docIdOffset;
+        size_t m_docIdStride;
+
+        // Storage for the CompileNode tree and RegisterAllocator.
+        Allocator m_allocator;
+
+        // Exactly one of m_nativeCode and m_byteCode is non-null. The byte
+        // code is run with wide words if m_useWideWords is true, and by a
+        // ThreadedCodeInterpreter otherwise.
+        std::unique_ptr<RegisterAllocator> m_registers;
+        std::unique_ptr<NativeCodeGenerator> m_nativeCode;
+        std::unique_ptr<ByteCodeGenerator> m_byteCode;
+        bool m_useWideWords;
+
+        static const size_t c_allocatorSize = 16384;
+
+        // Row densities are sampled from up to c_densitySampleSlices slices,
+        // reading up to c_densitySampleQuadwords quadwords of each.
+        static const size_t c_densitySampleSlices = 4;
+        static const size_t c_densitySampleQuadwords = 64;
+
+        // Row pointers stored in the eight registers R8..R15.
+        static const unsigned c_registerBase = 8;
+        static const unsigned c_registerCount = 8;
+    };
+}
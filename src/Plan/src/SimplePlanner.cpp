@@ -20,92 +20,282 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
-#include <algorithm>    // std::sort()
-#include <iostream>
+#include <algorithm>    // std::upper_bound()
+#include <memory>
 
-#include "BitFunnel/Index/Factories.h"
 #include "BitFunnel/Index/IIngestor.h"
 #include "BitFunnel/Index/IShard.h"
 #include "BitFunnel/Index/ISimpleIndex.h"
 #include "BitFunnel/Index/ITermTable.h"
-#include "BitFunnel/Index/RowIdSequence.h"
 #include "BitFunnel/Index/Token.h"
+#include "BitFunnel/NonCopyable.h"
 #include "BitFunnel/Plan/Factories.h"
-#include "BitFunnel/Plan/IResultsProcessor.h"
 #include "BitFunnel/Plan/TermMatchNode.h"
-#include "BitFunnel/Term.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/ITaskProcessor.h"
+#include "BitFunnel/Utilities/IThreadPool.h"
+#include "ByteCodeBatchRunner.h"
 #include "LoggerInterfaces/Check.h"
+#include "PhraseTerms.h"
+#include "PlanCache.h"
+#include "QueryBudget.h"
+#include "ShardPlan.h"
 #include "SimplePlanner.h"
+#include "SliceScheduler.h"
 
 
 namespace BitFunnel
 {
     std::vector<DocId> Factories::RunSimplePlanner(TermMatchNode const & tree,
-                                                   ISimpleIndex const & index)
+                                                   ISimpleIndex const & index,
+                                                   size_t threadCount,
+                                                   IThreadPool * threadPool)
     {
-        SimplePlanner simplePlanner(tree, index);
+        SimplePlanner simplePlanner(tree, index, threadCount, threadPool);
         return simplePlanner.GetMatches();
     }
 
 
+    std::vector<DocId> Factories::RunSimplePlanner(TermMatchNode const & tree,
+                                                   ISimpleIndex const & index,
+                                                   QueryLimits const & limits,
+                                                   bool & terminatedEarly,
+                                                   size_t threadCount,
+                                                   IThreadPool * threadPool,
+                                                   IPlanCache * planCache)
+    {
+        SimplePlanner simplePlanner(tree,
+                                    index,
+                                    threadCount,
+                                    threadPool,
+                                    limits,
+                                    planCache);
+        terminatedEarly = simplePlanner.TerminatedEarly();
+        return simplePlanner.GetMatches();
+    }
+
+
+    std::vector<std::vector<DocId>>
+        Factories::RunSimplePlannerBatch(std::vector<TermMatchNode const *> const & trees,
+                                         ISimpleIndex const & index,
+                                         IPlanCache * planCache)
+    {
+        return SimplePlanner::RunBatch(trees, index, planCache);
+    }
+
+
     //*************************************************************************
     //
-    // SimplePlanner
+    // SliceProcessor scans the slices handed to one worker by a
+    // SliceScheduler. Slices are numbered consecutively across shards. The
+    // task id passed to ProcessTask() is the worker number. The worker stops
+    // taking slices once the QueryBudget is exhausted.
     //
     //*************************************************************************
-    SimplePlanner::SimplePlanner(TermMatchNode const & tree,
-                                 ISimpleIndex const & index)
-        : m_index(index)
+    class SliceProcessor : public ITaskProcessor, NonCopyable
+    {
+    public:
+        SliceProcessor(PlanCache::ShardPlans const & plans,
+                       std::vector<char * const *> const & sliceBuffers,
+                       std::vector<size_t> const & firstSlices,
+                       SliceScheduler & scheduler,
+                       QueryBudget * budget);
+
+        std::vector<DocId> const & GetMatches() const;
+
+        //
+        // ITaskProcessor methods
+        //
 
+        virtual void ProcessTask(size_t taskId) override;
+        virtual void Finished() override;
+
+    private:
+        PlanCache::ShardPlans const & m_plans;
+
+        // Slice buffers of each shard.
+        std::vector<char * const *> const & m_sliceBuffers;
+
+        // Number of the first slice of each shard, followed by the total
+        // number of slices.
+        std::vector<size_t> const & m_firstSlices;
+
+        SliceScheduler & m_scheduler;
+
+        // nullptr if the query has no limits.
+        QueryBudget * m_budget;
+
+        // Matcher state for each shard.
+        std::vector<ShardPlan::MatcherState> m_states;
+
+        std::vector<DocId> m_matches;
+    };
+
+
+    SliceProcessor::SliceProcessor(
+        PlanCache::ShardPlans const & plans,
+        std::vector<char * const *> const & sliceBuffers,
+        std::vector<size_t> const & firstSlices,
+        SliceScheduler & scheduler,
+        QueryBudget * budget)
+      : m_plans(plans),
+        m_sliceBuffers(sliceBuffers),
+        m_firstSlices(firstSlices),
+        m_scheduler(scheduler),
+        m_budget(budget),
+        m_states(plans.size())
     {
-        ExtractRowIds(tree);
-        struct
+    }
+
+
+    std::vector<DocId> const & SliceProcessor::GetMatches() const
+    {
+        return m_matches;
+    }
+
+
+    void SliceProcessor::ProcessTask(size_t taskId)
+    {
+        size_t slice;
+        while (m_scheduler.TryGetSlice(taskId, slice))
         {
-            bool operator() (RowId a, RowId b)
+            if (m_budget != nullptr && m_budget->CheckTime())
+            {
+                break;
+            }
+
+            // Find the shard that contains the slice. Empty shards have the
+            // same first slice as their successor, so upper_bound is needed.
+            const size_t shard =
+                static_cast<size_t>(std::upper_bound(m_firstSlices.begin(),
+                                                     m_firstSlices.end(),
+                                                     slice)
+                                    - m_firstSlices.begin()) - 1;
+
+            bool terminate =
+                m_plans[shard]->ProcessSlice(slice - m_firstSlices[shard],
+                                             m_sliceBuffers[shard],
+                                             m_firstSlices[shard + 1] - m_firstSlices[shard],
+                                             m_matches,
+                                             m_budget,
+                                             m_states[shard]);
+            if (terminate)
             {
-                // Sorts by decreasing rank.
-                return a.GetRank() > b.GetRank();
+                break;
             }
-        } compare;
+        }
+    }
+
+
+    void SliceProcessor::Finished()
+    {
+    }
+
 
-        // Sort RowIds by decreasing Rank.
-        std::sort(m_rows.begin(), m_rows.end(), compare);
+    //*************************************************************************
+    //
+    // SimplePlanner
+    //
+    //*************************************************************************
+    SimplePlanner::SimplePlanner(TermMatchNode const & tree,
+                                 ISimpleIndex const & index,
+                                 size_t threadCount,
+                                 IThreadPool * threadPool,
+                                 QueryLimits const & limits,
+                                 IPlanCache * planCache)
+        : m_index(index),
+          m_terminatedEarly(false)
+    {
+        // Start the clock for the time limit before compiling.
+        std::unique_ptr<QueryBudget> budget;
+        if (!limits.IsUnlimited())
+        {
+            budget.reset(new QueryBudget(limits));
+        }
 
-        CHECK_GT(m_rows.size(), 0u);
-        Rank rank = m_rows[0].GetRank();
-        m_code.LoadRow(0u, false, 0u);
-        Compile(1u, rank);
-        m_code.Seal();
+        auto & ingestor = m_index.GetIngestor();
+        const size_t shardCount = ingestor.GetShardCount();
 
-        // Get token before we GetSliceBuffers.
+        std::unique_ptr<IThreadPool> localThreadPool;
+        if (threadCount > 1 && threadPool == nullptr)
         {
-            auto token = m_index.GetIngestor().GetTokenManager().RequestToken();
+            localThreadPool = Factories::CreateThreadPool(threadCount - 1);
+            threadPool = localThreadPool.get();
+        }
 
-            const size_t c_shardId = 0u;
-            auto & shard = m_index.GetIngestor().GetShard(c_shardId);
-            auto & sliceBuffers = shard.GetSliceBuffers();
-            size_t sliceCount = sliceBuffers.size();
+        // Get token before we GetSliceBuffers. The token also covers
+        // compilation, which samples row densities from the slices.
+        {
+            auto token = ingestor.GetTokenManager().RequestToken();
 
-            // Iterations per slice calculation.
-            auto iterationsPerSlice = shard.GetSliceCapacity() >> 6 >> rank;
+            auto plans = GetPlans(tree, m_index, planCache);
 
-            // Get Row offsets.
-            std::vector<ptrdiff_t> rowOffsets;
-            for (auto row : m_rows)
-                {
-                    rowOffsets.push_back(shard.GetRowOffset(row));
-                }
+            std::vector<char * const *> sliceBuffers;
+            std::vector<size_t> firstSlices(1, 0);
+            for (ShardId shard = 0; shard < shardCount; ++shard)
+            {
+                auto & buffers = ingestor.GetShard(shard).GetSliceBuffers();
+                sliceBuffers.push_back(reinterpret_cast<char * const *>(buffers.data()));
+                firstSlices.push_back(firstSlices.back() + buffers.size());
+            }
+            const size_t sliceCount = firstSlices.back();
+
+            size_t workerCount = 1;
+            if (threadPool != nullptr)
+            {
+                workerCount = (std::min)(threadCount, threadPool->GetThreadCount() + 1);
+                workerCount = (std::max)((std::min)(workerCount, sliceCount),
+                                         static_cast<size_t>(1));
+            }
 
-            ByteCodeInterpreter intepreter(m_code,
-                                           *this,
-                                           sliceCount,
-                                           reinterpret_cast<char* const *>(sliceBuffers.data()),
-                                           iterationsPerSlice,
-                                           rowOffsets.data());
+            SliceScheduler scheduler(sliceCount, workerCount);
 
-            intepreter.Run();
+            std::vector<std::unique_ptr<SliceProcessor>> processors;
+            std::vector<ITaskProcessor*> tasks;
+            for (size_t i = 0; i < workerCount; ++i)
+            {
+                processors.emplace_back(new SliceProcessor(*plans,
+                                                           sliceBuffers,
+                                                           firstSlices,
+                                                           scheduler,
+                                                           budget.get()));
+                tasks.push_back(processors.back().get());
+            }
 
+            if (workerCount == 1)
+            {
+                processors[0]->ProcessTask(0);
+            }
+            else
+            {
+                threadPool->Run(tasks);
+            }
+
+            // Merge the per-thread results.
+            size_t matchCount = 0;
+            for (auto const & processor : processors)
+            {
+                matchCount += processor->GetMatches().size();
+            }
+            m_matches.reserve(matchCount);
+            for (auto const & processor : processors)
+            {
+                auto const & matches = processor->GetMatches();
+                m_matches.insert(m_matches.end(), matches.begin(), matches.end());
+            }
         } // End of token lifetime.
+
+        if (budget.get() != nullptr && budget->IsExhausted())
+        {
+            m_terminatedEarly = true;
+
+            // Threads may overshoot the limit by the matches from their
+            // last iteration.
+            if (m_matches.size() > limits.GetMaxMatches())
+            {
+                m_matches.resize(limits.GetMaxMatches());
+            }
+        }
     }
 
 
@@ -115,48 +305,50 @@ namespace BitFunnel
     }
 
 
-    //
-    // IResultProcessor methods
-    //
-
-    void SimplePlanner::AddResult(uint64_t accumulator,
-                                  size_t offset)
+    bool SimplePlanner::TerminatedEarly() const
     {
-        m_addResultValues.push_back(std::make_pair(accumulator, offset));
+        return m_terminatedEarly;
     }
 
 
-    bool SimplePlanner::FinishIteration(void const * sliceBuffer)
+    std::vector<std::vector<DocId>>
+        SimplePlanner::RunBatch(std::vector<TermMatchNode const *> const & trees,
+                                ISimpleIndex const & index,
+                                IPlanCache * planCache)
     {
-        for (auto const & result : m_addResultValues)
+        std::vector<std::vector<DocId>> matches(trees.size());
+
+        auto & ingestor = index.GetIngestor();
+        const size_t shardCount = ingestor.GetShardCount();
+
+        // Get token before we GetSliceBuffers. The token also covers
+        // compilation, which samples row densities from the slices.
         {
-            uint64_t acc = result.first;
-            size_t offset = result.second;
+            auto token = ingestor.GetTokenManager().RequestToken();
 
-            size_t bitPos = 0;
-            while (acc != 0)
+            std::vector<std::shared_ptr<IPlanCache::ShardPlans const>> plans;
+            for (auto tree : trees)
             {
-                if (acc & 1)
-                {
-                    DocIndex docIndex = offset * c_bitsPerQuadword + bitPos;
-                    DocumentHandle handle =
-                        Factories::CreateDocumentHandle(const_cast<void*>(sliceBuffer), docIndex);
-                    m_matches.push_back(handle.GetDocId());
-                }
-                acc >>= 1;
-                ++bitPos;
+                plans.push_back(GetPlans(*tree, index, planCache));
             }
-        }
-        m_addResultValues.clear();
 
-        // TODO: don't always return false.
-        return false;
-    }
+            for (ShardId shard = 0; shard < shardCount; ++shard)
+            {
+                auto & buffers = ingestor.GetShard(shard).GetSliceBuffers();
+                ByteCodeBatchRunner batch(
+                    buffers.size(),
+                    reinterpret_cast<char * const *>(buffers.data()));
 
+                for (size_t query = 0; query < trees.size(); ++query)
+                {
+                    batch.AddQuery(*(*plans[query])[shard], matches[query]);
+                }
 
-    bool SimplePlanner::TerminatedEarly() const
-    {
-        return false;
+                batch.Run();
+            }
+        } // End of token lifetime.
+
+        return matches;
     }
 
 
@@ -164,73 +356,81 @@ namespace BitFunnel
     // private methods
     //
 
-    void SimplePlanner::Compile(size_t pos, Rank rank)
+    std::shared_ptr<IPlanCache::ShardPlans const>
+        SimplePlanner::GetPlans(TermMatchNode const & tree,
+                                ISimpleIndex const & index,
+                                IPlanCache * planCache)
     {
-        if (pos == m_rows.size())
+        auto & ingestor = index.GetIngestor();
+        const size_t shardCount = ingestor.GetShardCount();
+
+        // The compiled plans depend only on the query and on each shard's
+        // TermTable, so they may come from the plan cache. The cache checks
+        // shard generations rather than addresses, which a new index may
+        // reuse. The row order of a cached plan reflects the row densities
+        // when it was compiled, but any order gives the same matches.
+        std::vector<uint64_t> shardGenerations;
+        for (ShardId shard = 0; shard < shardCount; ++shard)
+        {
+            shardGenerations.push_back(ingestor.GetShard(shard).GetGeneration());
+        }
+
+        std::string key;
+        std::shared_ptr<IPlanCache::ShardPlans const> plans;
+        if (planCache != nullptr)
         {
-            m_code.Report();
+            key = PlanCache::GetKey(tree);
+            plans = planCache->Find(key, shardGenerations);
         }
-        else
+
+        if (plans.get() == nullptr)
         {
-            auto row = m_rows[pos];
-            if (row.GetRank() < rank)
+            std::vector<Term> terms;
+            ExtractTerms(tree, index.GetConfiguration(), terms);
+
+            std::shared_ptr<IPlanCache::ShardPlans> newPlans(new IPlanCache::ShardPlans());
+            for (ShardId shard = 0; shard < shardCount; ++shard)
             {
-                RankDown(pos, rank);
-                rank = row.GetRank();
+                newPlans->emplace_back(new ShardPlan(ingestor.GetShard(shard), terms));
             }
-            else
+            plans = newPlans;
+
+            if (planCache != nullptr)
             {
-                m_code.AndRow(pos, false, 0);
-                Compile(pos + 1, rank);
+                planCache->Add(key, shardGenerations, plans);
             }
         }
-    }
-
-    void SimplePlanner::RankDown(size_t pos, Rank rank)
-    {
-        size_t delta = rank - m_rows[pos].GetRank();
-        m_code.LeftShiftOffset(delta);
-        ICodeGenerator::Label label0 = m_code.AllocateLabel();
 
-        unsigned iterations = (1 << delta) - 1;
-        for (unsigned i = 0; i < iterations; ++i)
-        {
-            m_code.Push();
-            m_code.Call(label0);
-            m_code.Pop();
-            m_code.IncrementOffset();
-        }
-        m_code.Call(label0);
-        ICodeGenerator::Label label1 = m_code.AllocateLabel();
-        m_code.Jmp(label1);
-        m_code.PlaceLabel(label0);
-        Compile(pos, m_rows[pos].GetRank());
-        m_code.Return();
-        m_code.PlaceLabel(label1);
-        m_code.RightShiftOffset(delta);
+        return plans;
     }
 
 
-    void SimplePlanner::ExtractRowIds(TermMatchNode const & node)
+    void SimplePlanner::ExtractTerms(TermMatchNode const & node,
+                                     IConfiguration const & configuration,
+                                     std::vector<Term> & terms)
     {
         switch (node.GetType())
         {
         case TermMatchNode::AndMatch:
             {
                 auto const & andNode = dynamic_cast<const TermMatchNode::And&>(node);
-                ExtractRowIds(andNode.GetLeft());
-                ExtractRowIds(andNode.GetRight());
+                ExtractTerms(andNode.GetLeft(), configuration, terms);
+                ExtractTerms(andNode.GetRight(), configuration, terms);
+            }
+            break;
+        case TermMatchNode::PhraseMatch:
+            {
+                auto const & phraseNode = dynamic_cast<const TermMatchNode::Phrase&>(node);
+                auto phraseTerms = GetPhraseTerms(phraseNode, configuration);
+                terms.insert(terms.end(), phraseTerms.begin(), phraseTerms.end());
             }
             break;
         case TermMatchNode::UnigramMatch:
             {
                 auto const & unigramNode = dynamic_cast<const TermMatchNode::Unigram&>(node);
-                Term term(unigramNode.GetText(), unigramNode.GetStreamId(), m_index.GetConfiguration());
-                RowIdSequence rows(term, m_index.GetTermTable());
-                for (auto row : rows)
-                {
-                    m_rows.push_back(row);
-                }
+                terms.push_back(Term(unigramNode.GetText(),
+                                     unigramNode.GetStreamId(),
+                                     configuration));
             }
             break;
         default:
@@ -22,46 +22,97 @@
 
 #pragma once
 
-#include <vector>
-
-#include "ByteCodeInterpreter.h"
-#include "BitFunnel/Index/RowId.h"
-#include "BitFunnel/Plan/IResultsProcessor.h"
+#include <stddef.h>                 // size_t parameter.
+#include <memory>                   // std::shared_ptr return value.
+#include <vector>                   // std::vector embedded.
 
+#include "BitFunnel/BitFunnelTypes.h"   // DocId embedded.
+#include "BitFunnel/Plan/IPlanCache.h"  // IPlanCache::ShardPlans return value.
+#include "BitFunnel/Plan/QueryLimits.h" // QueryLimits default parameter.
+#include "BitFunnel/Term.h"             // Term parameter.
 
 
 namespace BitFunnel
 {
+    class IConfiguration;
+    class ISimpleIndex;
+    class IThreadPool;
     class TermMatchNode;
 
 
-    class SimplePlanner : public IResultsProcessor
+    //*************************************************************************
+    //
+    // SimplePlanner evaluates a conjunction of terms and phrases against
+    // every shard in an index. Each phrase contributes the rows of its
+    // n-grams (see GetPhraseTerms()). Each shard has its own TermTable, so
+    // the rows for the terms, their row offsets, and the compiled matching
+    // code are generated separately for each shard.
+    //
+    // The slices of all shards are scanned by up to threadCount threads. Each
+    // thread starts with a contiguous range of slices and steals slices from
+    // the other ranges when its own range is exhausted (see SliceScheduler).
+    // Each thread has its own matcher state and match list, and the lists are
+    // concatenated once all slices have been scanned. With one thread, the
+    // matches are in shard and slice order; otherwise the order is
+    // unspecified.
+    //
+    // Threads other than the calling thread come from threadPool. If
+    // threadPool is nullptr and threadCount is greater than one, a pool is
+    // created for the duration of the query.
+    //
+    // Matching stops early when the query reaches one of its QueryLimits.
+    // All threads stop at their next iteration with matches or their next
+    // slice. At most limits.GetMaxMatches() matches are returned, and
+    // TerminatedEarly() returns true.
+    //
+    // If planCache is supplied, the compiled per-shard plans are looked up
+    // in, or added to, the cache instead of being rebuilt for every query.
+    //
+    // RunBatch() evaluates several queries together on the calling thread.
+    // For each shard, a ByteCodeBatchRunner runs every query's plan for
+    // the shard on each block of a slice before moving on to the next
+    // block, so the shard's rows are read from memory once per batch
+    // rather than once per query.
+    //
+    //*************************************************************************
+    class SimplePlanner
     {
     public:
-        SimplePlanner(TermMatchNode const & tree, ISimpleIndex const & index);
+        SimplePlanner(TermMatchNode const & tree,
+                      ISimpleIndex const & index,
+                      size_t threadCount = 1,
+                      IThreadPool * threadPool = nullptr,
+                      QueryLimits const & limits = QueryLimits(),
+                      IPlanCache * planCache = nullptr);
 
         std::vector<DocId> const & GetMatches() const;
 
-        //
-        // IResultsProcessor methods.
-        //
-        virtual void AddResult(uint64_t accumulator,
-                               size_t offset) override;
-        virtual bool FinishIteration(void const * sliceBuffer) override;
-        virtual bool TerminatedEarly() const override;
+        // Returns true if matching stopped because the query reached one of
+        // its QueryLimits. In this case, GetMatches() returns a subset of the
+        // matches.
+        bool TerminatedEarly() const;
+
+        // Returns the matches of each query, in the order of trees. Within
+        // each query, the matches are in shard and slice order.
+        static std::vector<std::vector<DocId>>
+            RunBatch(std::vector<TermMatchNode const *> const & trees,
+                     ISimpleIndex const & index,
+                     IPlanCache * planCache = nullptr);
 
     private:
-        void Compile(size_t pos, Rank rank);
-        void RankDown(size_t pos, Rank rank);
-        void ExtractRowIds(TermMatchNode const & node);
+        // Returns the plans for tree on every shard, taken from planCache if
+        // possible. The caller must hold a Token.
+        static std::shared_ptr<IPlanCache::ShardPlans const>
+            GetPlans(TermMatchNode const & tree,
+                     ISimpleIndex const & index,
+                     IPlanCache * planCache);
 
-        std::vector<RowId> m_rows;
-        ISimpleIndex const & m_index;
-        ByteCodeGenerator m_code;
+        static void ExtractTerms(TermMatchNode const & node,
+                                 IConfiguration const & configuration,
+                                 std::vector<Term> & terms);
 
-        // accumulator:offset pair.
-        std::vector<std::pair<uint64_t, size_t>> m_addResultValues;
-        std::vector<size_t> m_matches;
+        ISimpleIndex const & m_index;
+        std::vector<DocId> m_matches;
+        bool m_terminatedEarly;
     };
-
 }
@@ -0,0 +1,126 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "LoggerInterfaces/Check.h"
+#include "SliceScheduler.h"
+
+
+namespace BitFunnel
+{
+    SliceScheduler::SliceScheduler(size_t sliceCount, size_t workerCount)
+      : m_workerCount(workerCount),
+        m_ranges(new std::atomic<uint64_t>[workerCount])
+    {
+        CHECK_GT(workerCount, 0u)
+            << "SliceScheduler requires at least one worker.";
+        CHECK_LT(sliceCount, 1ull << 32)
+            << "Too many slices.";
+
+        for (size_t i = 0; i < workerCount; ++i)
+        {
+            const uint64_t begin = sliceCount * i / workerCount;
+            const uint64_t end = sliceCount * (i + 1) / workerCount;
+            m_ranges[i].store(Pack(begin, end));
+        }
+    }
+
+
+    bool SliceScheduler::TryGetSlice(size_t worker, size_t & slice)
+    {
+        if (TryTakeFront(worker, slice))
+        {
+            return true;
+        }
+
+        // Own range is exhausted. Steal from the others, starting with the
+        // next worker so that thieves spread out.
+        for (size_t i = 1; i < m_workerCount; ++i)
+        {
+            if (TryTakeBack((worker + i) % m_workerCount, slice))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+
+    bool SliceScheduler::TryTakeFront(size_t range, size_t & slice)
+    {
+        uint64_t current = m_ranges[range].load();
+        for (;;)
+        {
+            const size_t begin = GetBegin(current);
+            const size_t end = GetEnd(current);
+            if (begin == end)
+            {
+                return false;
+            }
+
+            if (m_ranges[range].compare_exchange_weak(current, Pack(begin + 1, end)))
+            {
+                slice = begin;
+                return true;
+            }
+        }
+    }
+
+
+    bool SliceScheduler::TryTakeBack(size_t range, size_t & slice)
+    {
+        uint64_t current = m_ranges[range].load();
+        for (;;)
+        {
+            const size_t begin = GetBegin(current);
+            const size_t end = GetEnd(current);
+            if (begin == end)
+            {
+                return false;
+            }
+
+            if (m_ranges[range].compare_exchange_weak(current, Pack(begin, end - 1)))
+            {
+                slice = end - 1;
+                return true;
+            }
+        }
+    }
+
+
+    uint64_t SliceScheduler::Pack(uint64_t begin, uint64_t end)
+    {
+        return begin | (end << 32);
+    }
+
+
+    size_t SliceScheduler::GetBegin(uint64_t range)
+    {
+        return static_cast<size_t>(range & 0xffffffff);
+    }
+
+
+    size_t SliceScheduler::GetEnd(uint64_t range)
+    {
+        return static_cast<size_t>(range >> 32);
+    }
+}
@@ -0,0 +1,76 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                     // size_t parameter.
+#include <stdint.h>                     // uint64_t embedded.
+#include <atomic>                       // std::atomic embedded.
+#include <memory>                       // std::unique_ptr embedded.
+
+#include "BitFunnel/NonCopyable.h"      // Base class.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // SliceScheduler hands out the numbers 0..sliceCount-1 to a fixed set of
+    // workers running in parallel, with work stealing.
+    //
+    // The slices are divided into one contiguous range per worker. A worker
+    // takes slices from the front of its own range, which preserves locality
+    // and keeps the order of slices within a range. When its range is empty,
+    // the worker steals slices, one at a time, from the back of the other
+    // ranges. Each slice is handed out exactly once.
+    //
+    // Each range is stored in a single atomic word, so that the owner and
+    // thieves can update it with compare and swap, without locks.
+    //
+    // Ranges are not matched to the NUMA nodes of the shards' slice
+    // buffers, and workers are not bound to nodes.
+    //
+    //*************************************************************************
+    class SliceScheduler : NonCopyable
+    {
+    public:
+        SliceScheduler(size_t sliceCount, size_t workerCount);
+
+        // Sets slice to the next slice for the specified worker and returns
+        // true. Returns false when every slice has been handed out.
+        bool TryGetSlice(size_t worker, size_t & slice);
+
+    private:
+        bool TryTakeFront(size_t range, size_t & slice);
+        bool TryTakeBack(size_t range, size_t & slice);
+
+        static uint64_t Pack(uint64_t begin, uint64_t end);
+        static size_t GetBegin(uint64_t range);
+        static size_t GetEnd(uint64_t range);
+
+        size_t m_workerCount;
+
+        // Half-open range [begin, end) for each worker, packed into 64 bits
+        // with begin in the low half.
+        std::unique_ptr<std::atomic<uint64_t>[]> m_ranges;
+    };
+}
@@ -33,10 +33,9 @@
 #include "BitFunnel/Plan/RowMatchNode.h"
 #include "BitFunnel/Term.h"
 #include "BitFunnel/Utilities/TextObjectFormatter.h"
-#include "BitFunnel/Utilities/RingBuffer.h"
 #include "LoggerInterfaces/Logging.h"
+#include "PhraseTerms.h"
 #include "PlanRows.h"
-#include "StringVector.h"
 #include "TermMatchTreeConverter.h"
 
 
@@ -160,23 +159,12 @@ namespace BitFunnel
     const RowMatchNode* TermMatchTreeConverter::BuildMatchTree(const TermMatchNode::Phrase& node)
     {
         RowMatchNode::Builder builder(RowMatchNode::AndMatch, m_allocator);
-        RingBuffer<Term, Term::c_log2MaxGramSize + 1> termBuffer;
 
-        StringVector const & stringVector = node.GetGrams();
-        for (unsigned i = 0; i < stringVector.GetSize(); ++i)
+        // The rows of the phrase's n-grams, which were posted at ingestion
+        // time, stand in for the phrase.
+        for (auto const & term : GetPhraseTerms(node, m_index.GetConfiguration()))
         {
-            *termBuffer.PushBack() = GetUnigramTerm(stringVector[i],
-                                                    node.GetStreamId());
-
-            if (termBuffer.GetCount() == Term::c_maxGramSize)
-            {
-                ProcessNGramBuffer(builder, termBuffer);
-            }
-        }
-
-        while (!termBuffer.IsEmpty())
-        {
-            ProcessNGramBuffer(builder, termBuffer);
+            AppendTermRows(builder, term);
         }
 
         return builder.Complete();
@@ -216,23 +204,6 @@ namespace BitFunnel
     }
 
 
-    void TermMatchTreeConverter::ProcessNGramBuffer(RowMatchNode::Builder& builder,
-                                                    RingBuffer<Term, Term::c_log2MaxGramSize + 1>& gramBuffer)
-    {
-        const size_t count = gramBuffer.GetCount();
-        LogAssertB(count > 0, "must have non-empty gram.");
-
-        Term term(gramBuffer[0]);
-        AppendTermRows(builder, term);
-        for (size_t n = 1; n < count; ++n)
-        {
-            term.AddTerm(gramBuffer[n], m_index.GetConfiguration());
-            AppendTermRows(builder, term);
-        }
-        gramBuffer.PopFront();
-    }
-
-
     void TermMatchTreeConverter::AppendTermRows(RowMatchNode::Builder& builder, const Term& term)
     {
         // The m_planRows.IsFull() check is an optimization to avoid unnecessary work for the rows
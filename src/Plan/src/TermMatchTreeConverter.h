@@ -25,7 +25,7 @@
 #include "BitFunnel/NonCopyable.h"
 #include "BitFunnel/Plan/RowMatchNode.h"
 #include "BitFunnel/Plan/TermMatchNode.h"
-#include "BitFunnel/Term.h"  // needed for maxGramSize.
+#include "BitFunnel/Term.h"
 // #include "BitFunnel/Stream.h"
 
 
@@ -34,8 +34,6 @@ namespace BitFunnel
     class IAllocator;
     class ISimpleIndex;
     class PlanRows;
-    template <typename T, size_t LOG2_CAPACITY>
-    class RingBuffer;
 
     class TermMatchTreeConverter : NonCopyable
     {
@@ -61,8 +59,6 @@ namespace BitFunnel
         const RowMatchNode* BuildDocumentActiveMatchNode();
 
         const Term GetUnigramTerm(char const * text, Term::StreamId streamId) const;
-        void ProcessNGramBuffer(RowMatchNode::Builder& builder,
-                                RingBuffer<Term, Term::c_log2MaxGramSize + 1>& termBuffer);
         void AppendTermRows(RowMatchNode::Builder& builder, const Term& term);
         void AppendTermRows(RowMatchNode::Builder& builder, const FactHandle& fact);
 
@@ -22,8 +22,10 @@
 
 #include "BitFunnel/Exceptions.h"
 #include "BitFunnel/Index/IDocument.h"
+#include "BitFunnel/Index/PostingBlob.h"
 #include "BitFunnel/Plan/TermMatchTreeEvaluator.h"
 #include "BitFunnel/Term.h"
+#include "PhraseTerms.h"
 
 
 namespace BitFunnel
@@ -36,8 +38,25 @@ namespace BitFunnel
 
 
     bool TermMatchTreeEvaluator::Evaluate(
-        TermMatchNode const & node,
+        TermMatchNode const & root,
         IDocument const & document)
+    {
+        return EvaluateNode(root, document);
+    }
+
+
+    bool TermMatchTreeEvaluator::Evaluate(
+        TermMatchNode const & root,
+        PostingBlob const & postings)
+    {
+        return EvaluateNode(root, postings);
+    }
+
+
+    template <typename DOCUMENT>
+    bool TermMatchTreeEvaluator::EvaluateNode(
+        TermMatchNode const & node,
+        DOCUMENT const & document)
     {
         switch (node.GetType())
         {
@@ -47,8 +66,8 @@ namespace BitFunnel
             return Evaluate(dynamic_cast<const TermMatchNode::Not&>(node), document);
         case TermMatchNode::OrMatch:
             return Evaluate(dynamic_cast<const TermMatchNode::Or&>(node), document);
-        //case TermMatchNode::PhraseMatch:
-        //    return Evaluate(dynamic_cast<const TermMatchNode::Phrase&>(node), document);
+        case TermMatchNode::PhraseMatch:
+            return Evaluate(dynamic_cast<const TermMatchNode::Phrase&>(node), document);
         case TermMatchNode::UnigramMatch:
             return Evaluate(dynamic_cast<const TermMatchNode::Unigram&>(node), document);
         default:
@@ -57,35 +76,56 @@ namespace BitFunnel
         }
     }
 
+
+    template <typename DOCUMENT>
     bool TermMatchTreeEvaluator::Evaluate(
         TermMatchNode::And const & tree,
-        IDocument const & document)
+        DOCUMENT const & document)
     {
-        return Evaluate(tree.GetLeft(), document)
-            && Evaluate(tree.GetRight(), document);
+        return EvaluateNode(tree.GetLeft(), document)
+            && EvaluateNode(tree.GetRight(), document);
     }
 
 
+    template <typename DOCUMENT>
     bool TermMatchTreeEvaluator::Evaluate(
         TermMatchNode::Not const & tree,
-        IDocument const & document)
+        DOCUMENT const & document)
     {
-        return !Evaluate(tree.GetChild(), document);
+        return !EvaluateNode(tree.GetChild(), document);
     }
 
 
+    template <typename DOCUMENT>
     bool TermMatchTreeEvaluator::Evaluate(
         TermMatchNode::Or const & tree,
-        IDocument const & document)
+        DOCUMENT const & document)
     {
-        return Evaluate(tree.GetLeft(), document)
-            || Evaluate(tree.GetRight(), document);
+        return EvaluateNode(tree.GetLeft(), document)
+            || EvaluateNode(tree.GetRight(), document);
     }
 
 
+    template <typename DOCUMENT>
+    bool TermMatchTreeEvaluator::Evaluate(
+        TermMatchNode::Phrase const & tree,
+        DOCUMENT const & document)
+    {
+        for (auto & term : GetPhraseTerms(tree, m_configuration))
+        {
+            if (!document.Contains(term))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+
+    template <typename DOCUMENT>
     bool TermMatchTreeEvaluator::Evaluate(
         TermMatchNode::Unigram const & tree,
-        IDocument const & document)
+        DOCUMENT const & document)
     {
         Term term(tree.GetText(), tree.GetStreamId(), m_configuration);
         return document.Contains(term);
@@ -0,0 +1,389 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <vector>
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Plan/IResultsProcessor.h"
+#include "LoggerInterfaces/Check.h"
+#include "ThreadedCodeInterpreter.h"
+
+
+// GCC and Clang support taking the address of a label, which allows each
+// handler to jump directly to the next handler.
+#if defined(__GNUC__)
+#define BITFUNNEL_COMPUTED_GOTO
+#endif
+
+
+namespace BitFunnel
+{
+    typedef ByteCodeInterpreter::Opcode Opcode;
+
+
+    ThreadedCodeInterpreter::ThreadedCodeInterpreter(
+        ByteCodeGenerator const & code,
+        IResultsProcessor & resultsProcessor,
+        size_t sliceCount,
+        char * const * sliceBuffers,
+        size_t iterationsPerSlice,
+        ptrdiff_t const * rowOffsets)
+      : m_code(code),
+        m_resultsProcessor(resultsProcessor),
+        m_sliceCount(sliceCount),
+        m_sliceBuffers(sliceBuffers),
+        m_iterationsPerSlice(iterationsPerSlice),
+        m_rowOffsets(rowOffsets),
+        m_decoded(false),
+        m_callStack(new Operation const *[code.GetMaxCallStackDepth()]),
+        m_valueStack(new uint64_t[code.GetMaxValueStackDepth()])
+    {
+    }
+
+
+    bool ThreadedCodeInterpreter::Run()
+    {
+        for (size_t i = 0; i < m_sliceCount; ++i)
+        {
+            bool terminate = ProcessOneSlice(i);
+            if (terminate)
+            {
+                return true;
+            }
+        }
+
+        // false ==> ran to completion.
+        return false;
+    }
+
+
+    void ThreadedCodeInterpreter::Decode(void * const * handlers)
+    {
+        auto const & code = m_code.GetCode();
+        auto const & jumpTable = m_code.GetJumpTable();
+
+        m_operations.reset(new Operation[code.size()]);
+
+        // An instruction that is the target of a jump cannot be fused with
+        // the instruction before it.
+        std::vector<bool> isJumpTarget(code.size() + 1, false);
+        for (auto target : jumpTable)
+        {
+            isJumpTarget[static_cast<size_t>(target - code.data())] = true;
+        }
+
+        for (size_t i = 0; i < code.size(); ++i)
+        {
+            auto const & instruction = code[i];
+            Operation & operation = m_operations[i];
+
+            const Opcode opcode = instruction.GetOpcode();
+            CHECK_LT(opcode, Opcode::Last)
+                << "Unknown opcode " << opcode;
+
+            operation.m_handlerIndex = static_cast<unsigned>(opcode);
+            operation.m_rowOffset = 0;
+            operation.m_delta = 0;
+            operation.m_invertMask = 0;
+            operation.m_target = nullptr;
+
+            switch (opcode)
+            {
+            case Opcode::AndRow:
+            case Opcode::LoadRow:
+                operation.m_rowOffset = m_rowOffsets[m_code.GetRow(instruction)];
+                operation.m_delta = static_cast<unsigned>(m_code.GetDelta(instruction));
+                operation.m_invertMask = instruction.IsInverted() ? ~0ull : 0ull;
+                break;
+            case Opcode::LeftShiftOffset:
+            case Opcode::RightShiftOffset:
+                operation.m_delta = static_cast<unsigned>(m_code.GetRow(instruction));
+                break;
+            case Opcode::Call:
+            case Opcode::Jmp:
+            case Opcode::Jnz:
+            case Opcode::Jz:
+                operation.m_target =
+                    m_operations.get() +
+                    (jumpTable[m_code.GetRow(instruction)] - code.data());
+                break;
+            case Opcode::Constant:
+                // m_invertMask holds the constant.
+                operation.m_invertMask = instruction.IsInverted() ? ~0ull : 0ull;
+                break;
+            default:
+                break;
+            }
+
+            // The Jz is decoded on its own as well, but it is skipped when
+            // the fused operation does not jump.
+            if ((opcode == Opcode::AndRow || opcode == Opcode::LoadRow) &&
+                i + 1 < code.size() &&
+                code[i + 1].GetOpcode() == Opcode::Jz &&
+                !isJumpTarget[i + 1])
+            {
+                operation.m_handlerIndex =
+                    (opcode == Opcode::AndRow) ? c_andRowJz : c_loadRowJz;
+                operation.m_target =
+                    m_operations.get() +
+                    (jumpTable[m_code.GetRow(code[i + 1])] - code.data());
+            }
+
+            operation.m_handler =
+                (handlers == nullptr) ?
+                nullptr :
+                handlers[operation.m_handlerIndex];
+        }
+
+        m_decoded = true;
+    }
+
+
+    bool ThreadedCodeInterpreter::ProcessOneSlice(size_t slice)
+    {
+        return ProcessIterations(slice, 0, m_iterationsPerSlice);
+    }
+
+
+    bool ThreadedCodeInterpreter::ProcessIterations(size_t slice,
+                                                    size_t begin,
+                                                    size_t end)
+    {
+#ifdef BITFUNNEL_COMPUTED_GOTO
+        // Handler addresses, indexed by Opcode.
+        static void * const c_handlers[] =
+        {
+            &&AndRow,
+            &&LoadRow,
+            &&LeftShiftOffset,
+            &&RightShiftOffset,
+            &&IncrementOffset,
+            &&Push,
+            &&Pop,
+            &&AndStack,
+            &&Constant,
+            &&Not,
+            &&OrStack,
+            &&UpdateFlags,
+            &&Report,
+            &&Call,
+            &&Jmp,
+            &&Jnz,
+            &&Jz,
+            &&Return,
+            &&End,
+            &&AndRowJz,
+            &&LoadRowJz
+        };
+        static_assert(sizeof(c_handlers) / sizeof(c_handlers[0]) ==
+                      c_handlerCount,
+                      "c_handlers must have one entry per handler index.");
+
+#define DISPATCH() goto *ip->m_handler
+#else
+        void * const * c_handlers = nullptr;
+
+#define DISPATCH() goto Dispatch
+#endif
+
+        if (!m_decoded)
+        {
+            Decode(c_handlers);
+        }
+
+        char const * sliceBuffer = m_sliceBuffers[slice];
+        Operation const * const start = m_operations.get();
+        Operation const * * const callStack = m_callStack.get();
+        uint64_t * const valueStack = m_valueStack.get();
+
+        for (size_t iteration = begin; iteration < end; ++iteration)
+        {
+            Operation const * ip = start;
+            Operation const * * callTop = callStack;
+            uint64_t * valueTop = valueStack;
+            size_t offset = iteration;
+            uint64_t accumulator = 0;
+            bool calledAddResult = false;
+
+            DISPATCH();
+
+#ifndef BITFUNNEL_COMPUTED_GOTO
+        Dispatch:
+            switch (ip->m_handlerIndex)
+            {
+            case static_cast<unsigned>(Opcode::AndRow):
+                goto AndRow;
+            case static_cast<unsigned>(Opcode::LoadRow):
+                goto LoadRow;
+            case static_cast<unsigned>(Opcode::LeftShiftOffset):
+                goto LeftShiftOffset;
+            case static_cast<unsigned>(Opcode::RightShiftOffset):
+                goto RightShiftOffset;
+            case static_cast<unsigned>(Opcode::IncrementOffset):
+                goto IncrementOffset;
+            case static_cast<unsigned>(Opcode::Push):
+                goto Push;
+            case static_cast<unsigned>(Opcode::Pop):
+                goto Pop;
+            case static_cast<unsigned>(Opcode::AndStack):
+                goto AndStack;
+            case static_cast<unsigned>(Opcode::Constant):
+                goto Constant;
+            case static_cast<unsigned>(Opcode::Not):
+                goto Not;
+            case static_cast<unsigned>(Opcode::OrStack):
+                goto OrStack;
+            case static_cast<unsigned>(Opcode::UpdateFlags):
+                goto UpdateFlags;
+            case static_cast<unsigned>(Opcode::Report):
+                goto Report;
+            case static_cast<unsigned>(Opcode::Call):
+                goto Call;
+            case static_cast<unsigned>(Opcode::Jmp):
+                goto Jmp;
+            case static_cast<unsigned>(Opcode::Jnz):
+                goto Jnz;
+            case static_cast<unsigned>(Opcode::Jz):
+                goto Jz;
+            case static_cast<unsigned>(Opcode::Return):
+                goto Return;
+            case static_cast<unsigned>(Opcode::End):
+                goto End;
+            case c_andRowJz:
+                goto AndRowJz;
+            case c_loadRowJz:
+                goto LoadRowJz;
+            default:
+                RecoverableError error("ThreadedCodeInterpreter:: bad opcode.");
+                throw error;
+            }
+#endif
+
+        AndRow:
+            {
+                uint64_t const * row =
+                    reinterpret_cast<uint64_t const *>(sliceBuffer + ip->m_rowOffset);
+                accumulator &= row[offset >> ip->m_delta] ^ ip->m_invertMask;
+                ++ip;
+                DISPATCH();
+            }
+        LoadRow:
+            {
+                uint64_t const * row =
+                    reinterpret_cast<uint64_t const *>(sliceBuffer + ip->m_rowOffset);
+                accumulator = row[offset >> ip->m_delta] ^ ip->m_invertMask;
+                ++ip;
+                DISPATCH();
+            }
+        AndRowJz:
+            {
+                uint64_t const * row =
+                    reinterpret_cast<uint64_t const *>(sliceBuffer + ip->m_rowOffset);
+                accumulator &= row[offset >> ip->m_delta] ^ ip->m_invertMask;
+                ip = (accumulator == 0) ? ip->m_target : ip + 2;
+                DISPATCH();
+            }
+        LoadRowJz:
+            {
+                uint64_t const * row =
+                    reinterpret_cast<uint64_t const *>(sliceBuffer + ip->m_rowOffset);
+                accumulator = row[offset >> ip->m_delta] ^ ip->m_invertMask;
+                ip = (accumulator == 0) ? ip->m_target : ip + 2;
+                DISPATCH();
+            }
+        LeftShiftOffset:
+            offset <<= ip->m_delta;
+            ++ip;
+            DISPATCH();
+        RightShiftOffset:
+            offset >>= ip->m_delta;
+            ++ip;
+            DISPATCH();
+        IncrementOffset:
+            ++offset;
+            ++ip;
+            DISPATCH();
+        Push:
+            *valueTop++ = accumulator;
+            ++ip;
+            DISPATCH();
+        Pop:
+            accumulator = *--valueTop;
+            ++ip;
+            DISPATCH();
+        AndStack:
+            accumulator &= *--valueTop;
+            ++ip;
+            DISPATCH();
+        Constant:
+            accumulator = ip->m_invertMask;
+            ++ip;
+            DISPATCH();
+        Not:
+            accumulator = ~accumulator;
+            ++ip;
+            DISPATCH();
+        OrStack:
+            accumulator |= *--valueTop;
+            ++ip;
+            DISPATCH();
+        UpdateFlags:
+            // Jz and Jnz test the accumulator directly.
+            ++ip;
+            DISPATCH();
+        Report:
+            if (accumulator != 0)
+            {
+                m_resultsProcessor.AddResult(accumulator, offset);
+                calledAddResult = true;
+            }
+            ++ip;
+            DISPATCH();
+        Call:
+            *callTop++ = ip + 1;
+            ip = ip->m_target;
+            DISPATCH();
+        Jmp:
+            ip = ip->m_target;
+            DISPATCH();
+        Jnz:
+            ip = (accumulator != 0) ? ip->m_target : ip + 1;
+            DISPATCH();
+        Jz:
+            ip = (accumulator == 0) ? ip->m_target : ip + 1;
+            DISPATCH();
+        Return:
+            ip = *--callTop;
+            DISPATCH();
+        End:
+            if (calledAddResult && m_resultsProcessor.FinishIteration(sliceBuffer))
+            {
+                return true;
+            }
+        }
+
+#undef DISPATCH
+
+        // false ==> ran to completion.
+        return false;
+    }
+}
@@ -0,0 +1,385 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+#include <intrin.h>                             // __cpuid, _xgetbv.
+#endif
+
+#include <vector>                               // std::vector local.
+
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Plan/IResultsProcessor.h"
+#include "LoggerInterfaces/Check.h"
+#include "WideWordInterpreter.h"
+
+
+namespace BitFunnel
+{
+    typedef ByteCodeInterpreter::Opcode Opcode;
+
+
+    static size_t DetectLaneCount()
+    {
+#ifdef BITFUNNEL_PLATFORM_WINDOWS
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+        {
+            return 1;
+        }
+
+        // The operating system must save the YMM (and for AVX-512, the
+        // opmask and ZMM) state on context switches.
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        if (!osxsave)
+        {
+            return 1;
+        }
+        const unsigned long long xcr0 = _xgetbv(0);
+
+        __cpuidex(info, 7, 0);
+        const bool avx512 = ((info[1] & (1 << 16)) != 0) && ((xcr0 & 0xe6) == 0xe6);
+        const bool avx2 = ((info[1] & (1 << 5)) != 0) && ((xcr0 & 0x6) == 0x6);
+#else
+        // __builtin_cpu_supports() also checks operating system support.
+        __builtin_cpu_init();
+        const bool avx512 = __builtin_cpu_supports("avx512f") != 0;
+        const bool avx2 = __builtin_cpu_supports("avx2") != 0;
+#endif
+
+        if (avx512)
+        {
+            return 8;
+        }
+        else if (avx2)
+        {
+            return 4;
+        }
+        else
+        {
+            return 1;
+        }
+    }
+
+
+    size_t WideWordInterpreter::GetSupportedLaneCount()
+    {
+        static const size_t c_laneCount = DetectLaneCount();
+        return c_laneCount;
+    }
+
+
+    bool WideWordInterpreter::IsCompatible(ByteCodeGenerator const & code)
+    {
+        // A wide Jz only jumps when every lane of the accumulator is zero,
+        // so the lanes that scalar code would skip run the code up to the
+        // jump target. This is harmless if, in those lanes, every Report
+        // sees a zero accumulator, and the accumulator is zero again at the
+        // target with the stack as it was at the Jz.
+        //
+        // The code is checked by tracking, for the accumulator and each
+        // stack entry, the set of enclosing Jz accumulators (guards) that
+        // the value is known to be ANDed with. Bit i of a set stands for
+        // the guard of the i-th enclosing Jz. Jz regions must nest and jumps
+        // must go forward, which is the case for the code generated by
+        // CompileNode without RankDown.
+        struct Region
+        {
+            size_t m_target;
+            size_t m_stackDepth;
+        };
+
+        auto const & instructions = code.GetCode();
+        auto const & jumpTable = code.GetJumpTable();
+
+        std::vector<Region> regions;
+        std::vector<uint64_t> stack;
+        uint64_t accumulator = 0;
+
+        for (size_t i = 0; i <= instructions.size(); ++i)
+        {
+            // Leave the regions of the Jz instructions that jump here.
+            while (!regions.empty() && regions.back().m_target == i)
+            {
+                const uint64_t guard = 1ull << (regions.size() - 1);
+                if ((accumulator & guard) == 0 ||
+                    stack.size() != regions.back().m_stackDepth)
+                {
+                    return false;
+                }
+                regions.pop_back();
+
+                // The bit will stand for the guard of another Jz.
+                accumulator &= ~guard;
+                for (auto & entry : stack)
+                {
+                    entry &= ~guard;
+                }
+            }
+
+            if (i == instructions.size())
+            {
+                break;
+            }
+
+            auto const & instruction = instructions[i];
+            const uint64_t guards = (1ull << regions.size()) - 1;
+            const size_t minStackDepth =
+                regions.empty() ? 0 : regions.back().m_stackDepth;
+
+            switch (instruction.GetOpcode())
+            {
+            case Opcode::AndRow:
+                if (code.GetDelta(instruction) != 0)
+                {
+                    return false;
+                }
+                break;
+            case Opcode::LoadRow:
+                if (code.GetDelta(instruction) != 0)
+                {
+                    return false;
+                }
+                accumulator = 0;
+                break;
+            case Opcode::Push:
+                stack.push_back(accumulator);
+                break;
+            case Opcode::Pop:
+            case Opcode::AndStack:
+            case Opcode::OrStack:
+                if (stack.size() <= minStackDepth)
+                {
+                    return false;
+                }
+                if (instruction.GetOpcode() == Opcode::Pop)
+                {
+                    accumulator = stack.back();
+                }
+                else if (instruction.GetOpcode() == Opcode::AndStack)
+                {
+                    accumulator |= stack.back();
+                }
+                else
+                {
+                    accumulator &= stack.back();
+                }
+                stack.pop_back();
+                break;
+            case Opcode::Not:
+                accumulator = 0;
+                break;
+            case Opcode::UpdateFlags:
+            case Opcode::End:
+                break;
+            case Opcode::Report:
+                if ((accumulator & guards) != guards)
+                {
+                    return false;
+                }
+                break;
+            case Opcode::Jz:
+                {
+                    const size_t target = static_cast<size_t>(
+                        jumpTable[code.GetRow(instruction)] - instructions.data());
+                    if (target <= i ||
+                        (!regions.empty() && target > regions.back().m_target) ||
+                        regions.size() == 63)
+                    {
+                        return false;
+                    }
+
+                    // The accumulator is the new guard.
+                    accumulator |= 1ull << regions.size();
+                    regions.push_back(Region { target, stack.size() });
+                }
+                break;
+            default:
+                // Rank down operations, subroutines, Jmp, Jnz, and Constant
+                // are not supported.
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+
+    WideWordInterpreter::WideWordInterpreter(
+        ByteCodeGenerator const & code,
+        IResultsProcessor & resultsProcessor,
+        ptrdiff_t const * rowOffsets,
+        size_t laneCount)
+      : m_resultsProcessor(resultsProcessor),
+        m_laneCount(laneCount)
+    {
+        CHECK_TRUE(IsCompatible(code))
+            << "Code cannot be run by WideWordInterpreter.";
+        CHECK_TRUE((laneCount == 4 || laneCount == 8)
+                   && laneCount <= GetSupportedLaneCount())
+            << "Unsupported lane count " << laneCount;
+
+        auto const & instructions = code.GetCode();
+        auto const & jumpTable = code.GetJumpTable();
+
+        m_operations.reset(new WideWordOperation[instructions.size()]);
+
+        size_t reportCount = 0;
+        for (size_t i = 0; i < instructions.size(); ++i)
+        {
+            auto const & instruction = instructions[i];
+            WideWordOperation & operation = m_operations[i];
+
+            operation.m_rowOffset = 0;
+            operation.m_invertMask = 0;
+            operation.m_target = nullptr;
+
+            switch (instruction.GetOpcode())
+            {
+            case Opcode::AndRow:
+            case Opcode::LoadRow:
+                operation.m_opcode =
+                    instruction.GetOpcode() == Opcode::AndRow ?
+                    WideWordOperation::AndRow : WideWordOperation::LoadRow;
+                operation.m_rowOffset = rowOffsets[code.GetRow(instruction)];
+                operation.m_invertMask = instruction.IsInverted() ? ~0ull : 0ull;
+                break;
+            case Opcode::Push:
+                operation.m_opcode = WideWordOperation::Push;
+                break;
+            case Opcode::Pop:
+                operation.m_opcode = WideWordOperation::Pop;
+                break;
+            case Opcode::AndStack:
+                operation.m_opcode = WideWordOperation::AndStack;
+                break;
+            case Opcode::Not:
+                operation.m_opcode = WideWordOperation::Not;
+                break;
+            case Opcode::OrStack:
+                operation.m_opcode = WideWordOperation::OrStack;
+                break;
+            case Opcode::Report:
+                operation.m_opcode = WideWordOperation::Report;
+                ++reportCount;
+                break;
+            case Opcode::Jz:
+                operation.m_opcode = WideWordOperation::Jz;
+                operation.m_target =
+                    m_operations.get() +
+                    (jumpTable[code.GetRow(instruction)] - instructions.data());
+                break;
+            case Opcode::End:
+                operation.m_opcode = WideWordOperation::End;
+                break;
+            default:
+                // UpdateFlags. Other opcodes are rejected by IsCompatible().
+                operation.m_opcode = WideWordOperation::Nop;
+                break;
+            }
+        }
+
+        m_valueStack.reset(new uint64_t[code.GetMaxValueStackDepth() * m_laneCount]);
+        m_reports.reset(new uint64_t[(reportCount + 1) * m_laneCount]);
+
+        m_program.m_operations = m_operations.get();
+        m_program.m_valueStack = m_valueStack.get();
+        m_program.m_reports = m_reports.get();
+        m_program.m_flushReports = &WideWordInterpreter::FlushReports;
+        m_program.m_context = this;
+    }
+
+
+    size_t WideWordInterpreter::GetLaneCount() const
+    {
+        return m_laneCount;
+    }
+
+
+    bool WideWordInterpreter::ProcessOneSlice(char const * sliceBuffer,
+                                              size_t iterationCount,
+                                              size_t & iterationsProcessed)
+    {
+        return ProcessIterations(sliceBuffer,
+                                 0,
+                                 iterationCount,
+                                 iterationsProcessed);
+    }
+
+
+    bool WideWordInterpreter::ProcessIterations(char const * sliceBuffer,
+                                                size_t begin,
+                                                size_t end,
+                                                size_t & next)
+    {
+        next = end - ((end - begin) % m_laneCount);
+
+        if (m_laneCount == 8)
+        {
+            return ProcessWideAvx512(m_program, sliceBuffer, begin, next);
+        }
+        else
+        {
+            return ProcessWideAvx2(m_program, sliceBuffer, begin, next);
+        }
+    }
+
+
+    bool WideWordInterpreter::FlushReports(void * context,
+                                           char const * sliceBuffer,
+                                           size_t offset,
+                                           size_t reportCount)
+    {
+        return static_cast<WideWordInterpreter *>(context)->FlushReports(
+            sliceBuffer,
+            offset,
+            reportCount);
+    }
+
+
+    bool WideWordInterpreter::FlushReports(char const * sliceBuffer,
+                                           size_t offset,
+                                           size_t reportCount)
+    {
+        for (size_t lane = 0; lane < m_laneCount; ++lane)
+        {
+            bool calledAddResult = false;
+            for (size_t i = 0; i < reportCount; ++i)
+            {
+                const uint64_t accumulator = m_reports[i * m_laneCount + lane];
+                if (accumulator != 0)
+                {
+                    m_resultsProcessor.AddResult(accumulator, offset + lane);
+                    calledAddResult = true;
+                }
+            }
+
+            if (calledAddResult && m_resultsProcessor.FinishIteration(sliceBuffer))
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,130 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <stddef.h>                         // size_t, ptrdiff_t parameter.
+#include <stdint.h>                         // uint64_t embedded.
+#include <memory>                           // std::unique_ptr embedded.
+
+#include "BitFunnel/NonCopyable.h"          // Base class.
+#include "ByteCodeInterpreter.h"            // ByteCodeGenerator parameter.
+#include "WideWordProgram.h"                // WideWordProgram embedded.
+
+
+namespace BitFunnel
+{
+    class IResultsProcessor;
+
+    //*************************************************************************
+    //
+    // WideWordInterpreter runs a ByteCodeGenerator instruction sequence over
+    // several consecutive quadwords of each row per iteration, using AVX2
+    // (four quadwords) or AVX-512 (eight quadwords) loads and logical
+    // operations. The instruction set is selected at runtime through CPUID.
+    //
+    // Only plans whose rows all have the same rank and that contain no rank
+    // down operations can be run wide. A wide Jz jumps only when all lanes
+    // are zero, so IsCompatible() also requires every Report and the end of
+    // every Jz to see an accumulator ANDed with the accumulator at the Jz.
+    // Taking the jump only when all lanes are zero then does not change the
+    // results.
+    //
+    // Reports are buffered for the duration of an iteration and then passed
+    // to the IResultsProcessor one lane at a time, in lane order. The
+    // sequence of calls to AddResult() and FinishIteration() is therefore
+    // identical to the one made by ByteCodeInterpreter.
+    //
+    // ByteCodeInterpreter uses this class when it is supported and falls
+    // back to scalar code for incompatible plans and for the iterations left
+    // over at the end of each slice.
+    //
+    //*************************************************************************
+    class WideWordInterpreter : NonCopyable
+    {
+    public:
+        // Returns the number of quadwords processed per iteration by the
+        // widest instruction set supported by the processor and operating
+        // system. Returns 1 if neither AVX2 nor AVX-512 is available.
+        static size_t GetSupportedLaneCount();
+
+        // Returns true if the instruction sequence in code can be run wide.
+        static bool IsCompatible(ByteCodeGenerator const & code);
+
+        // The code must be compatible and laneCount must be 4 or 8 and no
+        // greater than GetSupportedLaneCount().
+        WideWordInterpreter(ByteCodeGenerator const & code,
+                            IResultsProcessor & resultsProcessor,
+                            ptrdiff_t const * rowOffsets,
+                            size_t laneCount);
+
+        size_t GetLaneCount() const;
+
+        // Processes the largest multiple of GetLaneCount() iterations that
+        // does not exceed iterationCount, starting with iteration 0, and
+        // stores that number in iterationsProcessed. Returns true to indicate
+        // early termination.
+        bool ProcessOneSlice(char const * sliceBuffer,
+                             size_t iterationCount,
+                             size_t & iterationsProcessed);
+
+        // Processes the largest multiple of GetLaneCount() iterations in
+        // [begin, end), starting with iteration begin, and stores the first
+        // unprocessed iteration in next. Returns true to indicate early
+        // termination.
+        bool ProcessIterations(char const * sliceBuffer,
+                               size_t begin,
+                               size_t end,
+                               size_t & next);
+
+    private:
+        // Calls FlushReports() on the WideWordInterpreter passed as context.
+        static bool FlushReports(void * context,
+                                 char const * sliceBuffer,
+                                 size_t offset,
+                                 size_t reportCount);
+
+        // Passes reportCount buffered reports for the iteration starting at
+        // offset to the IResultsProcessor. Returns true to indicate early
+        // termination.
+        bool FlushReports(char const * sliceBuffer,
+                          size_t offset,
+                          size_t reportCount);
+
+        IResultsProcessor & m_resultsProcessor;
+        size_t m_laneCount;
+
+        std::unique_ptr<WideWordOperation[]> m_operations;
+
+        // Value stack, GetLaneCount() quadwords per entry.
+        std::unique_ptr<uint64_t[]> m_valueStack;
+
+        // Accumulators passed to Report during the current iteration,
+        // GetLaneCount() quadwords per entry. Each Report instruction runs at
+        // most once per iteration.
+        std::unique_ptr<uint64_t[]> m_reports;
+
+        // Raw pointers to the above, for ProcessWideAvx2() and
+        // ProcessWideAvx512().
+        WideWordProgram m_program;
+    };
+}
@@ -0,0 +1,87 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+//
+// This file is compiled with AVX-512 enabled. See CMakeLists.txt.
+//
+
+#include <immintrin.h>                  // AVX-512 intrinsics.
+
+#include "WideWordLoop.h"
+
+
+namespace BitFunnel
+{
+    namespace
+    {
+        struct Avx512Word
+        {
+            typedef __m512i Type;
+
+            static const size_t c_laneCount = 8;
+
+            static Type Load(void const * address)
+            {
+                return _mm512_loadu_si512(static_cast<Type const *>(address));
+            }
+
+            static void Store(void * address, Type value)
+            {
+                _mm512_storeu_si512(static_cast<Type *>(address), value);
+            }
+
+            static Type Broadcast(uint64_t value)
+            {
+                return _mm512_set1_epi64(static_cast<long long>(value));
+            }
+
+            static Type And(Type a, Type b)
+            {
+                return _mm512_and_si512(a, b);
+            }
+
+            static Type Or(Type a, Type b)
+            {
+                return _mm512_or_si512(a, b);
+            }
+
+            static Type Xor(Type a, Type b)
+            {
+                return _mm512_xor_si512(a, b);
+            }
+
+            static bool IsZero(Type value)
+            {
+                return _mm512_test_epi64_mask(value, value) == 0;
+            }
+        };
+    }
+
+
+    bool ProcessWideAvx512(WideWordProgram const & program,
+                           char const * sliceBuffer,
+                           size_t begin,
+                           size_t end)
+    {
+        return ProcessWide<Avx512Word>(program, sliceBuffer, begin, end);
+    }
+}
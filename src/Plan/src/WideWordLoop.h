@@ -0,0 +1,138 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+//
+// This file is included only by the translation units that are compiled with
+// AVX2 or AVX-512 enabled. It must not use library code that could be
+// instantiated with those instruction sets and then shared with code that
+// runs on processors without them. The loop therefore works on the raw
+// pointers in WideWordProgram rather than on WideWordInterpreter.
+//
+
+#include "WideWordProgram.h"
+
+
+namespace BitFunnel
+{
+    // Shared implementation of ProcessWideAvx2() and ProcessWideAvx512().
+    // WORD supplies the vector type and operations.
+    template <typename WORD>
+    bool ProcessWide(WideWordProgram const & program,
+                     char const * sliceBuffer,
+                     size_t begin,
+                     size_t end)
+    {
+        typedef typename WORD::Type Word;
+        typedef WideWordOperation Opcode;
+
+        const size_t laneCount = WORD::c_laneCount;
+        const Word ones = WORD::Broadcast(~0ull);
+
+        WideWordOperation const * const start = program.m_operations;
+        uint64_t * const valueStack = program.m_valueStack;
+        uint64_t * const reports = program.m_reports;
+
+        for (size_t offset = begin; offset < end; offset += laneCount)
+        {
+            char const * quadwords = sliceBuffer + offset * sizeof(uint64_t);
+            WideWordOperation const * ip = start;
+            uint64_t * valueStackTop = valueStack;
+            size_t reportCount = 0;
+            Word accumulator = WORD::Broadcast(0);
+
+            while (ip->m_opcode != Opcode::End)
+            {
+                switch (ip->m_opcode)
+                {
+                case Opcode::AndRow:
+                    accumulator =
+                        WORD::And(accumulator,
+                                  WORD::Xor(WORD::Load(quadwords + ip->m_rowOffset),
+                                            WORD::Broadcast(ip->m_invertMask)));
+                    ++ip;
+                    break;
+                case Opcode::LoadRow:
+                    accumulator =
+                        WORD::Xor(WORD::Load(quadwords + ip->m_rowOffset),
+                                  WORD::Broadcast(ip->m_invertMask));
+                    ++ip;
+                    break;
+                case Opcode::Push:
+                    WORD::Store(valueStackTop, accumulator);
+                    valueStackTop += laneCount;
+                    ++ip;
+                    break;
+                case Opcode::Pop:
+                    valueStackTop -= laneCount;
+                    accumulator = WORD::Load(valueStackTop);
+                    ++ip;
+                    break;
+                case Opcode::AndStack:
+                    valueStackTop -= laneCount;
+                    accumulator = WORD::And(accumulator, WORD::Load(valueStackTop));
+                    ++ip;
+                    break;
+                case Opcode::Not:
+                    accumulator = WORD::Xor(accumulator, ones);
+                    ++ip;
+                    break;
+                case Opcode::OrStack:
+                    valueStackTop -= laneCount;
+                    accumulator = WORD::Or(accumulator, WORD::Load(valueStackTop));
+                    ++ip;
+                    break;
+                case Opcode::Report:
+                    if (!WORD::IsZero(accumulator))
+                    {
+                        WORD::Store(reports + reportCount * laneCount, accumulator);
+                        ++reportCount;
+                    }
+                    ++ip;
+                    break;
+                case Opcode::Jz:
+                    // Jump only if every lane is zero. See the class comment
+                    // for why this is safe.
+                    ip = WORD::IsZero(accumulator) ? ip->m_target : ip + 1;
+                    break;
+                default:
+                    // Nop.
+                    ++ip;
+                    break;
+                }
+            }
+
+            if (reportCount > 0 &&
+                program.m_flushReports(program.m_context,
+                                       sliceBuffer,
+                                       offset,
+                                       reportCount))
+            {
+                return true;
+            }
+        }
+
+        // false ==> ran to completion.
+        return false;
+    }
+}
@@ -0,0 +1,111 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+
+#pragma once
+
+//
+// This file is included by the translation units that are compiled with AVX2
+// or AVX-512 enabled. Like WideWordLoop.h, it must not include headers with
+// inline library code, which could be compiled with those instruction sets
+// and then shared with code that runs on processors without them.
+//
+
+#include <stddef.h>                         // size_t, ptrdiff_t embedded.
+#include <stdint.h>                         // uint64_t embedded.
+
+
+namespace BitFunnel
+{
+    //*************************************************************************
+    //
+    // WideWordOperation is an instruction of a WideWordProgram. It is built
+    // by WideWordInterpreter from a ByteCodeInterpreter instruction.
+    //
+    //*************************************************************************
+    struct WideWordOperation
+    {
+        enum Opcode
+        {
+            AndRow,
+            LoadRow,
+            Push,
+            Pop,
+            AndStack,
+            Not,
+            OrStack,
+            Report,
+            Jz,
+            Nop,
+            End
+        };
+
+        Opcode m_opcode;
+
+        // Row offset from the start of the slice buffer for AndRow and
+        // LoadRow.
+        ptrdiff_t m_rowOffset;
+
+        // All ones for inverted rows, zero otherwise.
+        uint64_t m_invertMask;
+
+        // Jump target for Jz.
+        WideWordOperation const * m_target;
+    };
+
+
+    //*************************************************************************
+    //
+    // WideWordProgram holds what the wide word loops need from
+    // WideWordInterpreter, as raw pointers.
+    //
+    //*************************************************************************
+    struct WideWordProgram
+    {
+        WideWordOperation const * m_operations;
+
+        // Value stack and buffered reports, c_laneCount quadwords per entry.
+        uint64_t * m_valueStack;
+        uint64_t * m_reports;
+
+        // Passes reportCount buffered reports for the iteration starting at
+        // offset to the IResultsProcessor. Returns true to indicate early
+        // termination.
+        bool (*m_flushReports)(void * context,
+                               char const * sliceBuffer,
+                               size_t offset,
+                               size_t reportCount);
+        void * m_context;
+    };
+
+
+    // Run the program over the iterations in [begin, end), which must be a
+    // multiple of the lane count in length. Return true to indicate early
+    // termination. Defined in WideWordInterpreterAvx2.cpp and
+    // WideWordInterpreterAvx512.cpp, which are compiled with the
+    // corresponding instruction sets enabled.
+    bool ProcessWideAvx2(WideWordProgram const & program,
+                         char const * sliceBuffer,
+                         size_t begin,
+                         size_t end);
+    bool ProcessWideAvx512(WideWordProgram const & program,
+                           char const * sliceBuffer,
+                           size_t begin,
+                           size_t end);
+}
@@ -0,0 +1,443 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <stdint.h>     // SIZE_MAX.
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "Allocator.h"
+#include "BitFunnel/Plan/IResultsProcessor.h"
+#include "BitFunnel/Utilities/Stopwatch.h"
+#include "ByteCodeBatchRunner.h"
+#include "ByteCodeInterpreter.h"
+#include "CompileNode.h"
+#include "TextObjectParser.h"
+
+
+namespace BitFunnel
+{
+    namespace ByteCodeBatchRunnerTest
+    {
+        static const size_t c_rowCount = 6;
+        static const size_t c_allocatorSize = 16384;
+
+        struct Plan
+        {
+            char const * m_text;
+
+            // The plan processes quadwordsPerRow >> m_initialRank iterations
+            // per slice.
+            size_t m_initialRank;
+        };
+
+        static const Plan c_plans[] =
+        {
+            // And with inverted row.
+            {
+                "LoadRowJz {"
+                "  Row: Row(0, 0, 0, false),"
+                "  Child: AndRowJz {"
+                "    Row: Row(1, 0, 0, false),"
+                "    Child: AndRowJz {"
+                "      Row: Row(2, 0, 0, true),"
+                "      Child: Report {"
+                "        Child: "
+                "      }"
+                "    }"
+                "  }"
+                "}",
+                0
+            },
+
+            // Or of two And chains.
+            {
+                "Or {"
+                "  Children: ["
+                "    LoadRowJz {"
+                "      Row: Row(0, 0, 0, false),"
+                "      Child: AndRowJz {"
+                "        Row: Row(3, 0, 0, false),"
+                "        Child: Report {"
+                "          Child: "
+                "        }"
+                "      }"
+                "    },"
+                "    LoadRowJz {"
+                "      Row: Row(4, 0, 0, true),"
+                "      Child: AndRowJz {"
+                "        Row: Row(5, 0, 0, false),"
+                "        Child: Report {"
+                "          Child: "
+                "        }"
+                "      }"
+                "    }"
+                "  ]"
+                "}",
+                0
+            },
+
+            // Rank down from rank 2.
+            {
+                "RankDown {"
+                "  Delta: 2,"
+                "  Child: LoadRowJz {"
+                "    Row: Row(3, 0, 0, false),"
+                "    Child: AndRowJz {"
+                "      Row: Row(4, 0, 1, false),"
+                "      Child: AndRowJz {"
+                "        Row: Row(5, 0, 2, false),"
+                "        Child: Report {"
+                "          Child: "
+                "        }"
+                "      }"
+                "    }"
+                "  }"
+                "}",
+                2
+            }
+        };
+
+
+        //*********************************************************************
+        //
+        // RecordingResultsProcessor records the sequence of calls to
+        // AddResult() and FinishIteration(). Calls to FinishIteration() are
+        // recorded as entries with a zero accumulator. FinishIteration()
+        // requests early termination after a specified number of calls.
+        //
+        //*********************************************************************
+        class RecordingResultsProcessor : public IResultsProcessor
+        {
+        public:
+            RecordingResultsProcessor(size_t iterationLimit = SIZE_MAX)
+              : m_iterationLimit(iterationLimit),
+                m_iterationCount(0)
+            {
+            }
+
+            void AddResult(uint64_t accumulator, size_t offset) override
+            {
+                m_calls.push_back(std::make_pair(accumulator, offset));
+            }
+
+            bool FinishIteration(void const * sliceBuffer) override
+            {
+                m_calls.push_back(std::make_pair(
+                    0ull,
+                    reinterpret_cast<size_t>(sliceBuffer)));
+                return ++m_iterationCount >= m_iterationLimit;
+            }
+
+            bool TerminatedEarly() const override
+            {
+                return m_iterationCount >= m_iterationLimit;
+            }
+
+            std::vector<std::pair<uint64_t, size_t>> const & GetCalls() const
+            {
+                return m_calls;
+            }
+
+        private:
+            size_t m_iterationLimit;
+            size_t m_iterationCount;
+            std::vector<std::pair<uint64_t, size_t>> m_calls;
+        };
+
+
+        //*********************************************************************
+        //
+        // SyntheticSlices holds slices of sparse random rows.
+        //
+        //*********************************************************************
+        class SyntheticSlices
+        {
+        public:
+            SyntheticSlices(size_t sliceCount, size_t quadwordsPerRow)
+              : m_data(sliceCount * c_rowCount * quadwordsPerRow)
+            {
+                std::mt19937_64 random(12345);
+                for (auto & quadword : m_data)
+                {
+                    quadword = random() & random();
+                }
+
+                for (size_t slice = 0; slice < sliceCount; ++slice)
+                {
+                    m_sliceBuffers.push_back(reinterpret_cast<char *>(
+                        m_data.data() + slice * c_rowCount * quadwordsPerRow));
+                }
+
+                for (size_t row = 0; row < c_rowCount; ++row)
+                {
+                    m_rowOffsets.push_back(static_cast<ptrdiff_t>(
+                        row * quadwordsPerRow * sizeof(uint64_t)));
+                }
+            }
+
+            size_t GetSliceCount() const
+            {
+                return m_sliceBuffers.size();
+            }
+
+            char * const * GetSliceBuffers() const
+            {
+                return m_sliceBuffers.data();
+            }
+
+            ptrdiff_t const * GetRowOffsets() const
+            {
+                return m_rowOffsets.data();
+            }
+
+        private:
+            std::vector<uint64_t> m_data;
+            std::vector<char *> m_sliceBuffers;
+            std::vector<ptrdiff_t> m_rowOffsets;
+        };
+
+
+        // Compiles each plan in c_plans, repeated until there are
+        // queryCount programs.
+        static std::vector<std::unique_ptr<ByteCodeGenerator>>
+            CompilePlans(size_t queryCount)
+        {
+            std::vector<std::unique_ptr<ByteCodeGenerator>> programs;
+            for (size_t i = 0; i < queryCount; ++i)
+            {
+                Allocator allocator(c_allocatorSize);
+                std::stringstream input(c_plans[i % 3].m_text);
+                TextObjectParser parser(input, allocator, &CompileNode::GetType);
+                CompileNode const & node = CompileNode::Parse(parser);
+
+                programs.emplace_back(new ByteCodeGenerator());
+                node.Compile(*programs.back());
+                programs.back()->Seal();
+            }
+            return programs;
+        }
+
+
+        // Each query in a batch must make the same calls to its
+        // IResultsProcessor as when run alone, for any number of blocks,
+        // including more blocks than a query has iterations.
+        TEST(ByteCodeBatchRunner, MatchesByteCodeInterpreter)
+        {
+            static const size_t c_quadwordsPerRow = 16;
+            static const size_t c_queryCount = 6;
+            SyntheticSlices slices(3, c_quadwordsPerRow);
+            auto programs = CompilePlans(c_queryCount);
+
+            std::vector<RecordingResultsProcessor> expected(c_queryCount);
+            for (size_t i = 0; i < c_queryCount; ++i)
+            {
+                ByteCodeInterpreter interpreter(
+                    *programs[i],
+                    expected[i],
+                    slices.GetSliceCount(),
+                    slices.GetSliceBuffers(),
+                    c_quadwordsPerRow >> c_plans[i % 3].m_initialRank,
+                    slices.GetRowOffsets());
+                EXPECT_FALSE(interpreter.Run());
+                EXPECT_GT(expected[i].GetCalls().size(), 0u);
+            }
+
+            for (size_t blocksPerSlice = 1; blocksPerSlice <= 32; blocksPerSlice *= 2)
+            {
+                std::vector<RecordingResultsProcessor> observed(c_queryCount);
+                ByteCodeBatchRunner batch(slices.GetSliceCount(),
+                                          slices.GetSliceBuffers(),
+                                          blocksPerSlice);
+                for (size_t i = 0; i < c_queryCount; ++i)
+                {
+                    EXPECT_EQ(batch.AddQuery(*programs[i],
+                                             observed[i],
+                                             c_quadwordsPerRow >> c_plans[i % 3].m_initialRank,
+                                             slices.GetRowOffsets()),
+                              i);
+                }
+                EXPECT_EQ(batch.GetQueryCount(), c_queryCount);
+
+                EXPECT_FALSE(batch.Run());
+
+                for (size_t i = 0; i < c_queryCount; ++i)
+                {
+                    EXPECT_FALSE(batch.TerminatedEarly(i));
+                    EXPECT_EQ(observed[i].GetCalls(), expected[i].GetCalls())
+                        << "blocksPerSlice = " << blocksPerSlice
+                        << ", query = " << i;
+                }
+            }
+        }
+
+
+        // A query that terminates early stops receiving calls, while the
+        // other queries run to completion.
+        TEST(ByteCodeBatchRunner, EarlyTermination)
+        {
+            static const size_t c_quadwordsPerRow = 16;
+            SyntheticSlices slices(3, c_quadwordsPerRow);
+            auto programs = CompilePlans(2);
+
+            RecordingResultsProcessor expectedComplete;
+            RecordingResultsProcessor expectedTerminated(5);
+            RecordingResultsProcessor observedComplete;
+            RecordingResultsProcessor observedTerminated(5);
+
+            ByteCodeInterpreter complete(*programs[0],
+                                         expectedComplete,
+                                         slices.GetSliceCount(),
+                                         slices.GetSliceBuffers(),
+                                         c_quadwordsPerRow,
+                                         slices.GetRowOffsets());
+            EXPECT_FALSE(complete.Run());
+
+            ByteCodeInterpreter terminated(*programs[1],
+                                           expectedTerminated,
+                                           slices.GetSliceCount(),
+                                           slices.GetSliceBuffers(),
+                                           c_quadwordsPerRow,
+                                           slices.GetRowOffsets());
+            EXPECT_TRUE(terminated.Run());
+
+            ByteCodeBatchRunner batch(slices.GetSliceCount(),
+                                      slices.GetSliceBuffers(),
+                                      4);
+            batch.AddQuery(*programs[0],
+                           observedComplete,
+                           c_quadwordsPerRow,
+                           slices.GetRowOffsets());
+            batch.AddQuery(*programs[1],
+                           observedTerminated,
+                           c_quadwordsPerRow,
+                           slices.GetRowOffsets());
+
+            EXPECT_FALSE(batch.Run());
+            EXPECT_FALSE(batch.TerminatedEarly(0));
+            EXPECT_TRUE(batch.TerminatedEarly(1));
+            EXPECT_EQ(observedComplete.GetCalls(), expectedComplete.GetCalls());
+            EXPECT_EQ(observedTerminated.GetCalls(), expectedTerminated.GetCalls());
+        }
+
+
+        //*********************************************************************
+        //
+        // CountingResultsProcessor counts calls to AddResult() so that
+        // benchmark timings are not dominated by result handling.
+        //
+        //*********************************************************************
+        class CountingResultsProcessor : public IResultsProcessor
+        {
+        public:
+            CountingResultsProcessor()
+              : m_resultCount(0)
+            {
+            }
+
+            void AddResult(uint64_t /*accumulator*/, size_t /*offset*/) override
+            {
+                ++m_resultCount;
+            }
+
+            bool FinishIteration(void const * /*sliceBuffer*/) override
+            {
+                return false;
+            }
+
+            bool TerminatedEarly() const override
+            {
+                return false;
+            }
+
+            size_t GetResultCount() const
+            {
+                return m_resultCount;
+            }
+
+        private:
+            size_t m_resultCount;
+        };
+
+
+        // Compares running a batch of queries one after another with running
+        // them with ByteCodeBatchRunner over slices that are much larger than
+        // the cache. This test is disabled by default. Run it with
+        //   PlanTest --gtest_also_run_disabled_tests
+        //            --gtest_filter=*BatchBenchmark*
+        TEST(ByteCodeBatchRunner, DISABLED_BatchBenchmark)
+        {
+            static const size_t c_quadwordsPerRow = 16384;
+            static const size_t c_sliceCount = 64;
+            static const size_t c_queryCount = 48;
+
+            SyntheticSlices slices(c_sliceCount, c_quadwordsPerRow);
+            auto programs = CompilePlans(c_queryCount);
+
+            std::vector<CountingResultsProcessor> sequentialResults(c_queryCount);
+            Stopwatch sequentialStopwatch;
+            for (size_t i = 0; i < c_queryCount; ++i)
+            {
+                ByteCodeInterpreter interpreter(
+                    *programs[i],
+                    sequentialResults[i],
+                    c_sliceCount,
+                    slices.GetSliceBuffers(),
+                    c_quadwordsPerRow >> c_plans[i % 3].m_initialRank,
+                    slices.GetRowOffsets());
+                interpreter.Run();
+            }
+            const double sequentialTime = sequentialStopwatch.ElapsedTime();
+
+            std::vector<CountingResultsProcessor> batchResults(c_queryCount);
+            ByteCodeBatchRunner batch(c_sliceCount, slices.GetSliceBuffers());
+            for (size_t i = 0; i < c_queryCount; ++i)
+            {
+                batch.AddQuery(*programs[i],
+                               batchResults[i],
+                               c_quadwordsPerRow >> c_plans[i % 3].m_initialRank,
+                               slices.GetRowOffsets());
+            }
+            Stopwatch batchStopwatch;
+            batch.Run();
+            const double batchTime = batchStopwatch.ElapsedTime();
+
+            for (size_t i = 0; i < c_queryCount; ++i)
+            {
+                EXPECT_EQ(batchResults[i].GetResultCount(),
+                          sequentialResults[i].GetResultCount());
+            }
+
+            std::cout << "Sequential: "
+                      << sequentialTime * 1e6 / c_queryCount
+                      << "us/query" << std::endl;
+            std::cout << "Batched:    "
+                      << batchTime * 1e6 / c_queryCount
+                      << "us/query" << std::endl;
+        }
+    }
+}
@@ -22,6 +22,7 @@
 
 #include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -31,6 +32,7 @@
 #include "BitFunnel/Index/ISimpleIndex.h"
 #include "BitFunnel/Mocks/Factories.h"
 #include "BitFunnel/Term.h"                     // Only needed for streamId
+#include "ByteCodeInterpreter.h"
 #include "ByteCodeVerifier.h"
 #include "Primes.h"
 
@@ -539,6 +541,76 @@ namespace BitFunnel
     }
 
 
+    // Uses more rows than there are row pointer registers, so some rows
+    // must be addressed through the row offset table.
+    TEST(ByteCodeInterpreter, AndRowJzManyRows)
+    {
+        char const * text =
+            "LoadRowJz {"
+            "  Row: Row(0, 0, 0, false),"
+            "  Child: AndRowJz {"
+            "    Row: Row(1, 0, 0, true),"
+            "    Child: AndRowJz {"
+            "      Row: Row(2, 0, 0, true),"
+            "      Child: AndRowJz {"
+            "        Row: Row(3, 0, 0, true),"
+            "        Child: AndRowJz {"
+            "          Row: Row(4, 0, 0, true),"
+            "          Child: AndRowJz {"
+            "            Row: Row(5, 0, 0, true),"
+            "            Child: AndRowJz {"
+            "              Row: Row(6, 0, 0, true),"
+            "              Child: AndRowJz {"
+            "                Row: Row(7, 0, 0, true),"
+            "                Child: AndRowJz {"
+            "                  Row: Row(8, 0, 0, true),"
+            "                  Child: AndRowJz {"
+            "                    Row: Row(9, 0, 0, true),"
+            "                    Child: Report {"
+            "                      Child: "
+            "                    }"
+            "                  }"
+            "                }"
+            "              }"
+            "            }"
+            "          }"
+            "        }"
+            "      }"
+            "    }"
+            "  }"
+            "}";
+
+        const Rank initialRank = 0;
+        ByteCodeVerifier verifier(GetIndex(), initialRank);
+
+        verifier.DeclareRow("2");
+        verifier.DeclareRow("3");
+        verifier.DeclareRow("5");
+        verifier.DeclareRow("7");
+        verifier.DeclareRow("11");
+        verifier.DeclareRow("13");
+        verifier.DeclareRow("17");
+        verifier.DeclareRow("19");
+        verifier.DeclareRow("23");
+        verifier.DeclareRow("29");
+
+        for (auto iteration : verifier.GetIterations())
+        {
+            const size_t slice = verifier.GetSliceNumber(iteration);
+            const size_t offset = verifier.GetOffset(iteration);
+
+            uint64_t expected = verifier.GetRowData(0, offset, slice);
+            for (size_t row = 1; row < 10; ++row)
+            {
+                expected &= ~verifier.GetRowData(row, offset, slice);
+            }
+            verifier.ExpectResult(expected, offset, slice);
+        }
+
+        verifier.Verify(text);
+    }
+
+
     //*************************************************************************
     //
     // Or test cases
@@ -586,6 +658,76 @@ namespace BitFunnel
     }
 
 
+    //*************************************************************************
+    //
+    // Constant test cases
+    //
+    //*************************************************************************
+    TEST(ByteCodeInterpreter, ConstantMatchAll)
+    {
+        char const * text =
+            "LoadRowJz {"
+            "  Row: Row(0, 0, 0, false),"
+            "  Child: Report {"
+            "    Child: OrTree {"
+            "      Children: ["
+            "        LoadRow(1, 0, 0, false),"
+            "        Constant {"
+            "          Value: -1"
+            "        }"
+            "      ]"
+            "    }"
+            "  }"
+            "}";
+
+        const Rank initialRank = 0;
+        ByteCodeVerifier verifier(GetIndex(), initialRank);
+
+        verifier.DeclareRow("2");
+        verifier.DeclareRow("3");
+
+        for (auto iteration : verifier.GetIterations())
+        {
+            const size_t slice = verifier.GetSliceNumber(iteration);
+            const size_t offset = verifier.GetOffset(iteration);
+
+            const uint64_t row0 = verifier.GetRowData(0, offset, slice);
+            verifier.ExpectResult(row0, offset, slice);
+        }
+
+        verifier.Verify(text);
+    }
+
+
+    TEST(ByteCodeInterpreter, ConstantMatchNone)
+    {
+        char const * text =
+            "LoadRowJz {"
+            "  Row: Row(0, 0, 0, false),"
+            "  Child: Report {"
+            "    Child: AndTree {"
+            "      Children: ["
+            "        LoadRow(1, 0, 0, false),"
+            "        Constant {"
+            "          Value: 0"
+            "        }"
+            "      ]"
+            "    }"
+            "  }"
+            "}";
+
+        const Rank initialRank = 0;
+        ByteCodeVerifier verifier(GetIndex(), initialRank);
+
+        verifier.DeclareRow("2");
+        verifier.DeclareRow("3");
+
+        verifier.ExpectNoResults();
+
+        verifier.Verify(text);
+    }
+
+
     //*************************************************************************
     //
     // Out-of-order test cases
@@ -640,6 +782,121 @@ namespace BitFunnel
         verifier.Verify(text);
     }
 
+    //*************************************************************************
+    //
+    // Instruction encoding
+    //
+    //*************************************************************************
+    TEST(ByteCodeInterpreter, InstructionRange)
+    {
+        typedef ByteCodeInterpreter::Instruction Instruction;
+        typedef ByteCodeInterpreter::Opcode Opcode;
+
+        Instruction largest(Opcode::AndRow, 1023, 15, true);
+        EXPECT_EQ(largest.GetRow(), 1023u);
+        EXPECT_EQ(largest.GetDelta(), 15u);
+        EXPECT_TRUE(largest.IsInverted());
+
+        EXPECT_ANY_THROW(Instruction(Opcode::AndRow, 1024, 0));
+        EXPECT_ANY_THROW(Instruction(Opcode::AndRow, 0, 16));
+    }
+
+
+    TEST(ByteCodeInterpreter, ExtendedInstructions)
+    {
+        ByteCodeGenerator code;
+        auto label = code.AllocateLabel();
+        code.AndRow(1023, false, 15);
+        code.AndRow(1024, true, 0);
+        code.LoadRow(7, false, 16);
+        code.LeftShiftOffset(3);
+        code.Jz(label);
+        code.PlaceLabel(label);
+        code.Seal();
+
+        auto const & instructions = code.GetCode();
+
+        // Values that fit stay in the compact form.
+        EXPECT_FALSE(instructions[0].IsExtended());
+        EXPECT_EQ(code.GetRow(instructions[0]), 1023u);
+        EXPECT_EQ(code.GetDelta(instructions[0]), 15u);
+
+        EXPECT_TRUE(instructions[1].IsExtended());
+        EXPECT_EQ(code.GetRow(instructions[1]), 1024u);
+        EXPECT_EQ(code.GetDelta(instructions[1]), 0u);
+        EXPECT_TRUE(instructions[1].IsInverted());
+
+        EXPECT_TRUE(instructions[2].IsExtended());
+        EXPECT_EQ(code.GetRow(instructions[2]), 7u);
+        EXPECT_EQ(code.GetDelta(instructions[2]), 16u);
+
+        EXPECT_FALSE(instructions[3].IsExtended());
+        EXPECT_FALSE(instructions[4].IsExtended());
+        EXPECT_EQ(code.GetOperands().size(), 2u);
+
+        // Operand indices use the row, delta, and high bits.
+        typedef ByteCodeInterpreter::Instruction Instruction;
+        const size_t index = (1ull << 25) - 1;
+        Instruction extended =
+            Instruction::Extended(ByteCodeInterpreter::Opcode::Jmp, index, false);
+        EXPECT_TRUE(extended.IsExtended());
+        EXPECT_EQ(extended.GetOperandIndex(), index);
+        EXPECT_ANY_THROW(
+            Instruction::Extended(ByteCodeInterpreter::Opcode::Jmp, index + 1, false));
+    }
+
+
+    //
+    // Plans with more rows and labels than the compact instruction format
+    // can address.
+    //
+    static void VerifyLongAndRowChain(size_t rowCount)
+    {
+        std::stringstream text;
+        text << "LoadRowJz { Row: Row(0, 0, 0, false), Child: ";
+        for (size_t row = 1; row < rowCount; ++row)
+        {
+            text << "AndRowJz { Row: Row(" << row << ", 0, 0, false), Child: ";
+        }
+        text << "Report { Child: }";
+        for (size_t row = 0; row < rowCount; ++row)
+        {
+            text << "}";
+        }
+
+        const Rank initialRank = 0;
+        ByteCodeVerifier verifier(GetIndex(), initialRank);
+
+        for (size_t row = 0; row < rowCount; ++row)
+        {
+            verifier.DeclareRow((row % 2 == 0) ? "2" : "3");
+        }
+
+        for (auto iteration : verifier.GetIterations())
+        {
+            const size_t slice = verifier.GetSliceNumber(iteration);
+            const size_t offset = verifier.GetOffset(iteration);
+
+            const uint64_t row0 = verifier.GetRowData(0, offset, slice);
+            const uint64_t row1 = verifier.GetRowData(1, offset, slice);
+            verifier.ExpectResult(row0 & row1, offset, slice);
+        }
+
+        verifier.Verify(text.str().c_str());
+    }
+
+
+    TEST(ByteCodeInterpreter, PlanSizeBoundary)
+    {
+        // The largest row and label that fit in a compact instruction.
+        VerifyLongAndRowChain(1024);
+
+        // Crosses into extended instructions.
+        VerifyLongAndRowChain(1025);
+        VerifyLongAndRowChain(3000);
+    }
+
+
     ////*************************************************************************
     ////
     //// RankDown test cases
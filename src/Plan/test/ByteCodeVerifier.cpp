@@ -34,7 +34,10 @@
 #include "ByteCodeInterpreter.h"
 #include "ByteCodeVerifier.h"
 #include "CompileNode.h"
+#include "NativeCodeGenerator.h"
+#include "RegisterAllocator.h"
 #include "TextObjectParser.h"
+#include "ThreadedCodeInterpreter.h"
 
 
 namespace BitFunnel
@@ -43,6 +46,10 @@ namespace BitFunnel
     static const Term::StreamId c_streamId = 0;
     static const size_t c_allocatorBufferSize = 1000000;
 
+    // Row pointer registers used by the NativeCodeGenerator (R8..R15).
+    static const unsigned c_registerBase = 8;
+    static const unsigned c_registerCount = 8;
+
 
     ByteCodeVerifier::ByteCodeVerifier(ISimpleIndex const & index,
                                        Rank initialRank)
@@ -260,27 +267,82 @@ namespace BitFunnel
                 "ExpectResult() passed an empty accumulator.";
         }
 
-        ByteCodeGenerator code;
-        GenerateCode(codeText, code);
-        code.Seal();
+        std::stringstream rowPlan(codeText);
+        Allocator allocator(c_allocatorBufferSize);
+        TextObjectParser parser(rowPlan, allocator, &CompileNode::GetType);
+        CompileNode const & node = CompileNode::Parse(parser);
 
         auto & shard = m_index.GetIngestor().GetShard(c_shardId);
         auto & sliceBuffers = shard.GetSliceBuffers();
         auto iterationsPerSlice = GetIterationsPerSlice();
 
-        ByteCodeInterpreter interpreter(
-            code,
-            *this,
-            sliceBuffers.size(),
-            reinterpret_cast<char* const *>(sliceBuffers.data()),
-            iterationsPerSlice,
-            m_rowOffsets.data());
-
-        interpreter.Run();
+        {
+            ByteCodeGenerator code;
+            node.Compile(code);
+            code.Seal();
+
+            ByteCodeInterpreter interpreter(
+                code,
+                *this,
+                sliceBuffers.size(),
+                reinterpret_cast<char* const *>(sliceBuffers.data()),
+                iterationsPerSlice,
+                m_rowOffsets.data());
+
+            interpreter.Run();
+
+            // This check is necessary to detect the case where the final call
+            // to FinishIteration is missing.
+            EXPECT_EQ(m_resultsCount, m_expectedResults.size());
+
+            // The ThreadedCodeInterpreter runs the same byte code and must
+            // produce exactly the same sequence of calls.
+            m_resultsCount = 0;
+            m_observed.clear();
+
+            ThreadedCodeInterpreter threaded(
+                code,
+                *this,
+                sliceBuffers.size(),
+                reinterpret_cast<char* const *>(sliceBuffers.data()),
+                iterationsPerSlice,
+                m_rowOffsets.data());
+
+            threaded.Run();
+
+            EXPECT_EQ(m_resultsCount, m_expectedResults.size());
+        }
 
-        // This check is necessary to detect the case where the final call
-        // to FinishIteration is missing.
-        EXPECT_EQ(m_resultsCount, m_expectedResults.size());
+        // The native code must produce exactly the same sequence of calls to
+        // the IResultsProcessor as the ByteCodeInterpreter.
+        if (NativeCodeGenerator::IsSupported())
+        {
+            m_resultsCount = 0;
+            m_observed.clear();
+
+            RegisterAllocator registers(
+                node,
+                static_cast<unsigned>(m_rowOffsets.size()),
+                c_registerBase,
+                c_registerCount,
+                allocator);
+
+            NativeCodeGenerator code(registers);
+            node.Compile(code);
+            code.Seal();
+
+            NativeCodeRunner runner(
+                code,
+                *this,
+                sliceBuffers.size(),
+                reinterpret_cast<char* const *>(sliceBuffers.data()),
+                iterationsPerSlice,
+                m_rowOffsets.data());
+
+            runner.Run();
+
+            EXPECT_EQ(m_resultsCount, m_expectedResults.size());
+        }
     }
 
 
@@ -288,20 +350,6 @@ namespace BitFunnel
     // static methods
     //
 
-    void ByteCodeVerifier::GenerateCode(char const * rowPlanText,
-                                        ByteCodeGenerator& code)
-    {
-        std::stringstream rowPlan(rowPlanText);
-
-        Allocator allocator(c_allocatorBufferSize);
-        TextObjectParser parser(rowPlan, allocator, &CompileNode::GetType);
-
-        CompileNode const & node = CompileNode::Parse(parser);
-
-        node.Compile(code);
-    }
-
-
     RowId ByteCodeVerifier::GetFirstRow(ITermTable const & termTable,
                                         Term term)
     {
@@ -32,7 +32,6 @@
 
 namespace BitFunnel
 {
-    class ByteCodeGenerator;
     class IShard;
     class ISimpleIndex;
 
@@ -111,10 +110,6 @@ namespace BitFunnel
 
 
     private:
-        static void GenerateCode(char const * rowPlanText,
-                                 ByteCodeGenerator& code);
-
-
         static RowId GetFirstRow(ITermTable const & termTable,
                                  Term term);
 
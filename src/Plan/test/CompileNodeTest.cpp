@@ -156,6 +156,18 @@ namespace BitFunnel
             "}",
 
 
+            //
+            // Constant
+            //
+            "Constant {\n"
+            "  Value: 0\n"
+            "}",
+
+            "Constant {\n"
+            "  Value: -1\n"
+            "}",
+
+
             //
             // LoadRow
             //
@@ -278,6 +290,62 @@ namespace BitFunnel
                 "    RightShiftOffset(1)\n"
             },
 
+            // RankDown with a delta above 3 nests a RankDown of the
+            // remaining delta inside an unrolled RankDown of 3.
+            {
+                "RankDown {"
+                "  Delta: 4,"
+                "  Child: LoadRow(1, 2, 0, false)"
+                "}",
+                "    LeftShiftOffset(3)\n"
+                "    Push()\n"
+                "    Call(0)\n"
+                "    Pop()\n"
+                "    IncrementOffset()\n"
+                "    Push()\n"
+                "    Call(0)\n"
+                "    Pop()\n"
+                "    IncrementOffset()\n"
+                "    Push()\n"
+                "    Call(0)\n"
+                "    Pop()\n"
+                "    IncrementOffset()\n"
+                "    Push()\n"
+                "    Call(0)\n"
+                "    Pop()\n"
+                "    IncrementOffset()\n"
+                "    Push()\n"
+                "    Call(0)\n"
+                "    Pop()\n"
+                "    IncrementOffset()\n"
+                "    Push()\n"
+                "    Call(0)\n"
+                "    Pop()\n"
+                "    IncrementOffset()\n"
+                "    Push()\n"
+                "    Call(0)\n"
+                "    Pop()\n"
+                "    IncrementOffset()\n"
+                "    Call(0)\n"
+                "    Jmp(1)\n"
+                "L0:\n"
+                "    LeftShiftOffset(1)\n"
+                "    Push()\n"
+                "    Call(2)\n"
+                "    Pop()\n"
+                "    IncrementOffset()\n"
+                "    Call(2)\n"
+                "    Jmp(3)\n"
+                "L2:\n"
+                "    LoadRow(1, false, 0)\n"
+                "    Return()\n"
+                "L3:\n"
+                "    RightShiftOffset(1)\n"
+                "    Return()\n"
+                "L1:\n"
+                "    RightShiftOffset(3)\n"
+            },
+
             // Report with no child.
             // RankDown algorithm does Jz around Report().
             {
@@ -319,6 +387,13 @@ namespace BitFunnel
                 "L0:\n"
             },
 
+            {
+                "Constant {\n"
+                "  Value: -1\n"
+                "}",
+                "    Constant(-1)\n"
+            },
+
             {
                 "Not {\n"
                 "  Child: LoadRow(0, 6, 0, false)\n"
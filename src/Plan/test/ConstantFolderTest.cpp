@@ -0,0 +1,301 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "Allocator.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Plan/IPlanRows.h"
+#include "BitFunnel/Plan/RowMatchNode.h"
+#include "BitFunnel/Utilities/TextObjectFormatter.h"
+#include "ConstantFolder.h"
+#include "LoggerInterfaces/Check.h"
+#include "SameExceptForWhitespace.h"
+#include "TextObjectParser.h"
+
+
+namespace BitFunnel
+{
+    namespace ConstantFolderUnitTest
+    {
+        //*********************************************************************
+        //
+        // PlanRows for a single shard. Row 0 is the match-all row, row 1 is
+        // the match-none row and rows 2 and 3 are ordinary rows.
+        //
+        //*********************************************************************
+        class SystemPlanRows : public IPlanRows
+        {
+        public:
+            SystemPlanRows()
+              : m_termTable(Factories::CreateTermTable())
+            {
+                const RowIndex explicitRowCount = 100;
+                m_termTable->SetRowCounts(0, explicitRowCount, 1);
+                m_termTable->Seal();
+
+                RowIdSequence matchAll(m_termTable->GetMatchAllTerm(), *m_termTable);
+                RowIdSequence matchNone(m_termTable->GetMatchNoneTerm(), *m_termTable);
+                m_rows.push_back(*matchAll.begin());
+                m_rows.push_back(*matchNone.begin());
+
+                // Ordinary rows well clear of the system rows.
+                m_rows.push_back(RowId(0, 0, explicitRowCount - 2));
+                m_rows.push_back(RowId(0, 0, explicitRowCount - 1));
+            }
+
+            ShardId GetShardCount() const override
+            {
+                return 1;
+            }
+
+            unsigned GetRowCount() const override
+            {
+                return static_cast<unsigned>(m_rows.size());
+            }
+
+            const ITermTable& GetTermTable(ShardId /*shard*/) const override
+            {
+                return *m_termTable;
+            }
+
+            bool IsFull() const override
+            {
+                return true;
+            }
+
+            AbstractRow AddRow(Rank /*rank*/) override
+            {
+                CHECK_FAIL << "Not implemented.";
+            }
+
+            RowId const & PhysicalRow(ShardId /*shard*/, unsigned id) const override
+            {
+                return m_rows[id];
+            }
+
+            RowId& PhysicalRow(ShardId /*shard*/, unsigned id) override
+            {
+                return m_rows[id];
+            }
+
+            void Write(std::ostream& /*stream*/) const override
+            {
+                CHECK_FAIL << "Not implemented.";
+            }
+
+        private:
+            std::unique_ptr<ITermTable> m_termTable;
+            std::vector<RowId> m_rows;
+        };
+
+
+        struct InputOutput
+        {
+        public:
+            char const * m_input;
+
+            // nullptr if the tree folds to match-none.
+            char const * m_output;
+        };
+
+
+        const InputOutput c_foldCases[] =
+        {
+            // Ordinary rows are left unchanged.
+            {
+                "And {"
+                "  Children: ["
+                "    Row(2, 0, 0, false),"
+                "    Row(3, 0, 0, false)"
+                "  ]"
+                "}",
+                "And {"
+                "  Children: ["
+                "    Row(2, 0, 0, false),"
+                "    Row(3, 0, 0, false)"
+                "  ]"
+                "}"
+            },
+
+            // And with match-all reduces to the other child.
+            {
+                "And {"
+                "  Children: ["
+                "    Row(0, 0, 0, false),"
+                "    Row(2, 0, 0, false)"
+                "  ]"
+                "}",
+                "Row(2, 0, 0, false)"
+            },
+
+            // And with match-none matches nothing.
+            {
+                "And {"
+                "  Children: ["
+                "    Row(2, 0, 0, false),"
+                "    Row(1, 0, 0, false)"
+                "  ]"
+                "}",
+                nullptr
+            },
+
+            // An inverted match-all row is match-none.
+            {
+                "And {"
+                "  Children: ["
+                "    Row(2, 0, 0, false),"
+                "    Row(0, 0, 0, true)"
+                "  ]"
+                "}",
+                nullptr
+            },
+
+            // Or with match-none reduces to the other child.
+            {
+                "Or {"
+                "  Children: ["
+                "    Row(1, 0, 0, false),"
+                "    Row(3, 0, 0, false)"
+                "  ]"
+                "}",
+                "Row(3, 0, 0, false)"
+            },
+
+            // Or with match-all matches everything.
+            {
+                "And {"
+                "  Children: ["
+                "    Or {"
+                "      Children: ["
+                "        Row(2, 0, 0, false),"
+                "        Row(0, 0, 0, false)"
+                "      ]"
+                "    },"
+                "    Row(3, 0, 0, false)"
+                "  ]"
+                "}",
+                "Row(3, 0, 0, false)"
+            },
+
+            // Not of match-none is match-all.
+            {
+                "And {"
+                "  Children: ["
+                "    Not {"
+                "      Child: Row(1, 0, 0, false)"
+                "    },"
+                "    Row(2, 0, 0, false)"
+                "  ]"
+                "}",
+                "Row(2, 0, 0, false)"
+            },
+
+            // Double Not reduces to the grandchild.
+            {
+                "Not {"
+                "  Child: Not {"
+                "    Child: Or {"
+                "      Children: ["
+                "        Row(2, 0, 0, false),"
+                "        Row(3, 0, 0, false)"
+                "      ]"
+                "    }"
+                "  }"
+                "}",
+                "Or {"
+                "  Children: ["
+                "    Row(2, 0, 0, false),"
+                "    Row(3, 0, 0, false)"
+                "  ]"
+                "}"
+            },
+
+            // Not of a row becomes an inverted row.
+            {
+                "Not {"
+                "  Child: Row(2, 0, 0, false)"
+                "}",
+                "Row(2, 0, 0, true)"
+            },
+
+            // A tree that matches everything reduces to a match-all row.
+            {
+                "Or {"
+                "  Children: ["
+                "    Row(2, 0, 0, false),"
+                "    Not {"
+                "      Child: Row(1, 0, 0, false)"
+                "    }"
+                "  ]"
+                "}",
+                "Row(1, 0, 0, true)"
+            },
+        };
+
+
+        void VerifyCase(InputOutput const & testCase)
+        {
+            SystemPlanRows planRows;
+
+            std::stringstream input(testCase.m_input);
+
+            Allocator allocator(1024*4);
+            TextObjectParser parser(input, allocator, &RowPlanBase::GetType);
+            RowMatchNode const & root = RowMatchNode::Parse(parser);
+
+            RowMatchNode const * folded =
+                ConstantFolder::Fold(root, planRows, allocator);
+
+            if (testCase.m_output == nullptr)
+            {
+                EXPECT_EQ(folded, nullptr);
+            }
+            else
+            {
+                ASSERT_NE(folded, nullptr);
+
+                std::stringstream output;
+                TextObjectFormatter formatter(output);
+                folded->Format(formatter);
+
+                EXPECT_TRUE(SameExceptForWhitespace(output.str().c_str(),
+                                                    testCase.m_output))
+                    << output.str();
+            }
+        }
+
+
+        TEST(ConstantFolder, Basic)
+        {
+            for (unsigned i = 0; i < sizeof(c_foldCases) / sizeof(InputOutput); ++i)
+            {
+                VerifyCase(c_foldCases[i]);
+            }
+        }
+    }
+}
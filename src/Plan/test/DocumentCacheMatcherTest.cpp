@@ -0,0 +1,137 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Configuration/IStreamConfiguration.h"
+#include "BitFunnel/Index/IDocument.h"
+#include "BitFunnel/Index/IDocumentCache.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Plan/Factories.h"
+#include "BitFunnel/Plan/QueryPipeline.h"
+#include "BitFunnel/Plan/TermMatchTreeEvaluator.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/IThreadPool.h"
+
+
+namespace BitFunnel
+{
+    namespace DocumentCacheMatcherTest
+    {
+        static const Term::StreamId c_streamId = 0;
+
+        // Not a multiple of the block size, so the last block is partial.
+        static const DocId c_maxDocId = 1000;
+
+
+        // Returns the DocIds in cache that match tree, found by evaluating
+        // tree against one document at a time.
+        static std::vector<DocId> EvaluateEach(TermMatchNode const & tree,
+                                               IConfiguration const & configuration,
+                                               IDocumentCache const & cache)
+        {
+            TermMatchTreeEvaluator evaluator(configuration);
+            std::vector<DocId> matches;
+            for (auto entry : cache)
+            {
+                if (evaluator.Evaluate(tree, entry.first))
+                {
+                    matches.push_back(entry.second);
+                }
+            }
+            std::sort(matches.begin(), matches.end());
+            return matches;
+        }
+
+
+        TEST(DocumentCacheMatcher, MatchesEvaluator)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId);
+            auto const & configuration = index->GetConfiguration();
+            auto & cache = index->GetIngestor().GetDocumentCache();
+            for (DocId id = 1; id <= c_maxDocId; ++id)
+            {
+                cache.Add(Factories::CreatePrimeFactorsDocument(configuration,
+                                                                id,
+                                                                c_maxDocId,
+                                                                c_streamId),
+                          id);
+            }
+
+            auto threadPool = Factories::CreateThreadPool(3);
+
+            auto streamConfiguration = Factories::CreateStreamConfiguration();
+            QueryPipeline pipeline(*streamConfiguration);
+
+            char const * queries[] = {
+                "2",
+                "2 3",
+                "2 | 3",
+                "2 -3",
+                "-2",
+                "(5 | 7) -2 -(3 11)",
+                "2 2 -5",
+                "997",
+                "1009"
+            };
+
+            for (auto query : queries)
+            {
+                auto tree = pipeline.ParseQuery(query);
+                auto expected = EvaluateEach(*tree, configuration, cache);
+
+                EXPECT_EQ(Factories::MatchDocumentCache(*tree,
+                                                        configuration,
+                                                        cache),
+                          expected) << query;
+
+                EXPECT_EQ(Factories::MatchDocumentCache(*tree,
+                                                        configuration,
+                                                        cache,
+                                                        4,
+                                                        threadPool.get()),
+                          expected) << query;
+            }
+
+            // Spot check the ground truth itself.
+            auto tree = pipeline.ParseQuery("2 3");
+            auto matches = Factories::MatchDocumentCache(*tree, configuration, cache);
+            ASSERT_EQ(matches.size(), c_maxDocId / 6);
+            for (auto id : matches)
+            {
+                EXPECT_EQ(id % 6, 0u);
+            }
+        }
+    }
+}
@@ -0,0 +1,215 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <cstring>
+
+#include "gtest/gtest.h"
+
+#include "Allocator.h"
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Configuration/IStreamConfiguration.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Plan/Factories.h"
+#include "BitFunnel/Plan/QueryLimits.h"
+#include "PlanCache.h"
+#include "QueryParser.h"
+#include "ShardPlan.h"
+
+
+namespace BitFunnel
+{
+    namespace PlanCacheTest
+    {
+        static const size_t c_allocatorSize = 4096;
+
+
+        static std::string GetKey(char const * query)
+        {
+            auto config = Factories::CreateStreamConfiguration();
+            config->AddMapping("body", { 0 });
+            config->AddMapping("title", { 1 });
+            Allocator allocator(c_allocatorSize);
+            QueryParser parser(query, strlen(query), *config, allocator);
+            return PlanCache::GetKey(*parser.Parse());
+        }
+
+
+        static std::shared_ptr<PlanCache::ShardPlans const> MakePlans()
+        {
+            return std::make_shared<PlanCache::ShardPlans>();
+        }
+
+
+        TEST(PlanCache, CanonicalKey)
+        {
+            // Operand order and grouping of AND and OR do not matter.
+            EXPECT_EQ(GetKey("one two"), GetKey("two one"));
+            EXPECT_EQ(GetKey("one (two three)"), GetKey("(three one) two"));
+            EXPECT_EQ(GetKey("one | two"), GetKey("two | one"));
+            EXPECT_EQ(GetKey("-(one two)"), GetKey("-(two one)"));
+
+            // Everything else does.
+            EXPECT_NE(GetKey("one two"), GetKey("one | two"));
+            EXPECT_NE(GetKey("one two"), GetKey("one -two"));
+            EXPECT_NE(GetKey("one"), GetKey("title:one"));
+            EXPECT_NE(GetKey("one (two | three)"), GetKey("(one two) | three"));
+            EXPECT_NE(GetKey("\"one two\""), GetKey("\"two one\""));
+            EXPECT_NE(GetKey("onetwo"), GetKey("one two"));
+        }
+
+
+        TEST(PlanCache, LeastRecentlyUsed)
+        {
+            PlanCache cache(2);
+            std::vector<uint64_t> generations;
+
+            EXPECT_EQ(cache.Find("a", generations), nullptr);
+            cache.Add("a", generations, MakePlans());
+            cache.Add("b", generations, MakePlans());
+            EXPECT_EQ(cache.GetSize(), 2u);
+
+            // Touch "a" so that "b" is the least recently used.
+            auto a = cache.Find("a", generations);
+            EXPECT_NE(a, nullptr);
+
+            cache.Add("c", generations, MakePlans());
+            EXPECT_EQ(cache.GetSize(), 2u);
+            EXPECT_EQ(cache.Find("a", generations), a);
+            EXPECT_EQ(cache.Find("b", generations), nullptr);
+            EXPECT_NE(cache.Find("c", generations), nullptr);
+
+            EXPECT_EQ(cache.GetHitCount(), 3u);
+            EXPECT_EQ(cache.GetMissCount(), 2u);
+
+            cache.ResetCounters();
+            EXPECT_EQ(cache.GetHitCount(), 0u);
+            EXPECT_EQ(cache.GetMissCount(), 0u);
+
+            cache.Clear();
+            EXPECT_EQ(cache.GetSize(), 0u);
+            EXPECT_EQ(cache.Find("a", generations), nullptr);
+        }
+
+
+        TEST(PlanCache, ShardGenerationChange)
+        {
+            PlanCache cache(4);
+
+            std::vector<uint64_t> oldGenerations(1, 1);
+            std::vector<uint64_t> newGenerations(1, 2);
+
+            cache.Add("a", oldGenerations, MakePlans());
+            EXPECT_NE(cache.Find("a", oldGenerations), nullptr);
+            EXPECT_EQ(cache.Find("a", newGenerations), nullptr);
+
+            auto plans = MakePlans();
+            cache.Add("a", newGenerations, plans);
+            EXPECT_EQ(cache.GetSize(), 1u);
+            EXPECT_EQ(cache.Find("a", newGenerations), plans);
+            EXPECT_EQ(cache.Find("a", oldGenerations), nullptr);
+        }
+
+
+        TEST(PlanCache, SimplePlanner)
+        {
+            static const DocId c_maxDocId = 1000;
+            static const ShardId c_shardCount = 2;
+
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            0,
+                                                            c_shardCount);
+            auto config = Factories::CreateStreamConfiguration();
+            auto planCache = Factories::CreatePlanCache(8);
+
+            char const * queries[] = { "2 3", "3 2", "5", "2 3" };
+
+            for (auto query : queries)
+            {
+                Allocator allocator(c_allocatorSize);
+                QueryParser parser(query, strlen(query), *config, allocator);
+                auto tree = parser.Parse();
+
+                auto expected = Factories::RunSimplePlanner(*tree, *index);
+
+                bool terminatedEarly;
+                auto observed = Factories::RunSimplePlanner(*tree,
+                                                            *index,
+                                                            QueryLimits(),
+                                                            terminatedEarly,
+                                                            1,
+                                                            nullptr,
+                                                            planCache.get());
+                std::sort(expected.begin(), expected.end());
+                std::sort(observed.begin(), observed.end());
+                EXPECT_EQ(observed, expected) << query;
+            }
+
+            // "2 3" and "3 2" share a plan.
+            EXPECT_EQ(planCache->GetSize(), 2u);
+            EXPECT_EQ(planCache->GetMissCount(), 2u);
+            EXPECT_EQ(planCache->GetHitCount(), 2u);
+        }
+
+
+        TEST(PlanCache, ReplacedIndex)
+        {
+            static const DocId c_maxDocId = 1000;
+
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto config = Factories::CreateStreamConfiguration();
+            auto planCache = Factories::CreatePlanCache(8);
+
+            char const * query = "2 3";
+            Allocator allocator(c_allocatorSize);
+            QueryParser parser(query, strlen(query), *config, allocator);
+            auto tree = parser.Parse();
+
+            // Each index is destroyed before the next one is built, so the
+            // second may reuse the addresses of the first. Its plans must
+            // still be compiled afresh.
+            for (unsigned i = 0; i < 2; ++i)
+            {
+                auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                                c_maxDocId,
+                                                                0,
+                                                                1);
+                bool terminatedEarly;
+                Factories::RunSimplePlanner(*tree,
+                                            *index,
+                                            QueryLimits(),
+                                            terminatedEarly,
+                                            1,
+                                            nullptr,
+                                            planCache.get());
+            }
+
+            EXPECT_EQ(planCache->GetMissCount(), 2u);
+            EXPECT_EQ(planCache->GetHitCount(), 0u);
+            EXPECT_EQ(planCache->GetSize(), 1u);
+        }
+    }
+}
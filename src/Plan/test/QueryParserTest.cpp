@@ -461,6 +461,19 @@ namespace BitFunnel
 
         std::cout << "output: \"" << parsedOutput.str() << "\"" << std::endl;
         EXPECT_EQ(expected, parsedOutput.str());
+
+        // Parsing directly from the characters should give the same tree.
+        QueryParser spanParser(input.c_str(),
+                               input.size(),
+                               *streamConfiguration,
+                               allocator);
+        auto spanResult = spanParser.Parse();
+        ASSERT_NE(nullptr, spanResult);
+
+        std::stringstream spanOutput;
+        TextObjectFormatter spanFormatter(spanOutput);
+        spanResult->Format(spanFormatter);
+        EXPECT_EQ(expected, spanOutput.str());
     }
 
 
@@ -473,4 +486,22 @@ namespace BitFunnel
             VerifyQueryParser(c_testData[i].m_expected, c_testData[i].m_input, allocator);
         }
     }
+
+
+    // The span constructor must not read beyond the specified length.
+    TEST(QueryParser, SpanLength)
+    {
+        Allocator allocator(4096);
+        auto streamConfiguration = Factories::CreateStreamConfiguration();
+
+        char const * text = "one two";
+        QueryParser parser(text, 3, *streamConfiguration, allocator);
+        auto result = parser.Parse();
+        ASSERT_NE(nullptr, result);
+
+        std::stringstream output;
+        TextObjectFormatter formatter(output);
+        result->Format(formatter);
+        EXPECT_EQ("Unigram(\"one\", 0)", output.str());
+    }
 }
@@ -0,0 +1,160 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Configuration/IStreamConfiguration.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/IDocument.h"
+#include "BitFunnel/Index/IDocumentDataSchema.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/ITermTableCollection.h"
+#include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Plan/Factories.h"
+#include "BitFunnel/Plan/QueryPipeline.h"
+#include "BitFunnel/Term.h"
+
+
+namespace BitFunnel
+{
+    namespace QueryPipelineTest
+    {
+        static const Term::StreamId c_streamId = 0;
+        static const DocId c_maxDocId = 200;
+
+
+        // Creates an index of prime factors documents in which the terms
+        // "2" and "3" share a row, so that every multiple of 3 is a false
+        // positive for the query "2". The remaining primes use the adhoc
+        // row. The schema stores a posting blob for each document.
+        static std::unique_ptr<ISimpleIndex> CreateIndex(IFileSystem & fileSystem)
+        {
+            RowIndex explicitRowCount = ITermTable::SystemTerm::Count;
+            const RowIndex sharedRow = explicitRowCount++;
+
+            auto termTable = Factories::CreateTermTable();
+            for (auto text : { "2", "3" })
+            {
+                termTable->OpenTerm();
+                termTable->AddRowId(RowId(0, 0, sharedRow));
+                termTable->CloseTerm(Term::ComputeRawHash(text));
+            }
+            termTable->SetRowCounts(0, explicitRowCount, 1);
+            termTable->Seal();
+
+            auto termTables = Factories::CreateTermTableCollection();
+            termTables->AddTermTable(std::move(termTable));
+
+            auto schema = Factories::CreateDocumentDataSchema();
+            schema->RegisterPostingBlob();
+
+            auto index = Factories::CreateSimpleIndex(fileSystem);
+            index->SetTermTableCollection(std::move(termTables));
+            index->SetSchema(std::move(schema));
+            index->ConfigureAsMock(1, false);
+            index->StartIndex();
+
+            for (DocId id = 1; id <= c_maxDocId; ++id)
+            {
+                auto document =
+                    Factories::CreatePrimeFactorsDocument(index->GetConfiguration(),
+                                                          id,
+                                                          c_maxDocId,
+                                                          c_streamId);
+                index->GetIngestor().Add(id, *document);
+            }
+
+            return index;
+        }
+
+
+        TEST(QueryPipeline, FilterMatches)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = CreateIndex(*fileSystem);
+
+            auto streamConfiguration = Factories::CreateStreamConfiguration();
+            QueryPipeline pipeline(*streamConfiguration);
+
+            std::vector<DocId> expected;
+            for (DocId id = 2; id <= c_maxDocId; id += 2)
+            {
+                expected.push_back(id);
+            }
+
+            auto tree = pipeline.ParseQuery("2");
+            auto matches = Factories::RunSimplePlanner(*tree, *index);
+            std::sort(matches.begin(), matches.end());
+
+            // The bit-sliced match includes the multiples of 3.
+            ASSERT_TRUE(std::binary_search(matches.begin(), matches.end(), 3u));
+            ASSERT_TRUE(std::includes(matches.begin(), matches.end(),
+                                      expected.begin(), expected.end()));
+
+            const size_t falsePositiveCount = matches.size() - expected.size();
+            EXPECT_EQ(pipeline.FilterMatches(*tree, *index, matches),
+                      falsePositiveCount);
+            EXPECT_EQ(matches, expected);
+
+            // Documents that are no longer in the index are removed.
+            ASSERT_TRUE(index->GetIngestor().Delete(4));
+            std::vector<DocId> candidates = { 6, 4, 9, 8 };
+            EXPECT_EQ(pipeline.FilterMatches(*tree, *index, candidates), 2u);
+            EXPECT_EQ(candidates, std::vector<DocId>({ 6, 8 }));
+        }
+
+
+        TEST(QueryPipeline, FilterMatchesNot)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = CreateIndex(*fileSystem);
+
+            auto streamConfiguration = Factories::CreateStreamConfiguration();
+            QueryPipeline pipeline(*streamConfiguration);
+
+            std::vector<DocId> candidates;
+            for (DocId id = 1; id <= c_maxDocId; ++id)
+            {
+                candidates.push_back(id);
+            }
+
+            auto tree = pipeline.ParseQuery("3 -2");
+            pipeline.FilterMatches(*tree, *index, candidates);
+
+            std::vector<DocId> expected;
+            for (DocId id = 3; id <= c_maxDocId; id += 6)
+            {
+                expected.push_back(id);
+            }
+            EXPECT_EQ(candidates, expected);
+        }
+    }
+}
@@ -0,0 +1,361 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "Allocator.h"
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/IDiagnosticStream.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/ITermTableCollection.h"
+#include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Plan/QueryPlanner.h"
+#include "BitFunnel/Plan/RowPlan.h"
+#include "BitFunnel/Plan/TermMatchNode.h"
+#include "BitFunnel/Plan/TermPlan.h"
+#include "BitFunnel/Plan/TermPlanConverter.h"
+#include "BitFunnel/Term.h"
+#include "CompileNode.h"
+#include "ConstantFolder.h"
+#include "MatchTreeRewriter.h"
+#include "RankDownCompiler.h"
+#include "SameExceptForWhitespace.h"
+#include "TextObjectParser.h"
+
+
+namespace BitFunnel
+{
+    // TermPlan holds references to an IScoringEngine and QueryPreferences,
+    // which QueryPlanner does not use. Neither class is defined elsewhere.
+    class IScoringEngine
+    {
+    };
+
+
+    class QueryPreferences
+    {
+    };
+
+
+    namespace QueryPlannerTest
+    {
+        static const Term::StreamId c_streamId = 0;
+        static const DocId c_maxDocId = 1000;
+        static const size_t c_allocatorSize = 1 << 20;
+        static const unsigned c_targetRowCount = 500;
+
+        // Must match c_targetCrossProductTermCount in QueryPlanner.cpp.
+        static const unsigned c_crossProductTermCount = 180;
+
+
+        //*********************************************************************
+        //
+        // DiagnosticStream writes the diagnostics enabled by Enable() to a
+        // std::stringstream.
+        //
+        //*********************************************************************
+        class DiagnosticStream : public IDiagnosticStream
+        {
+        public:
+            void Enable(char const * prefix) override
+            {
+                m_prefixes.push_back(prefix);
+            }
+
+            void Disable(char const * prefix) override
+            {
+                for (auto it = m_prefixes.begin(); it != m_prefixes.end(); ++it)
+                {
+                    if (*it == prefix)
+                    {
+                        m_prefixes.erase(it);
+                        break;
+                    }
+                }
+            }
+
+            bool IsEnabled(char const * diagnostic) const override
+            {
+                for (auto const & prefix : m_prefixes)
+                {
+                    if (std::strncmp(diagnostic, prefix.c_str(), prefix.size()) == 0)
+                    {
+                        return true;
+                    }
+                }
+                return false;
+            }
+
+            std::ostream& GetStream() override
+            {
+                return m_stream;
+            }
+
+            std::string GetOutput() const
+            {
+                return m_stream.str();
+            }
+
+        private:
+            std::vector<std::string> m_prefixes;
+            std::stringstream m_stream;
+        };
+
+
+        // Returns the value printed after label on a line of output.
+        static double GetValue(std::string const & output, char const * label)
+        {
+            const size_t start = output.find(label);
+            EXPECT_NE(start, std::string::npos) << "Missing " << label;
+            if (start == std::string::npos)
+            {
+                return 0.0;
+            }
+
+            std::istringstream line(output.substr(start + std::strlen(label)));
+            double value = 0.0;
+            line >> value;
+            return value;
+        }
+
+
+        static TermMatchNode const & ParseTree(char const * text,
+                                               IAllocator & allocator)
+        {
+            std::stringstream input(text);
+            TextObjectParser parser(input, allocator, &TermMatchNode::GetType);
+            return TermMatchNode::Parse(parser);
+        }
+
+
+        // Returns the expected row reads for the tree rewritten with the
+        // given settings, computed in the same way as QueryPlanner.
+        static double EstimateRowReads(TermMatchNode const & tree,
+                                       ISimpleIndex const & index,
+                                       unsigned targetRowCount,
+                                       unsigned crossProductTermCount,
+                                       Rank maxRank,
+                                       double rowDensity,
+                                       IAllocator & allocator)
+        {
+            RowPlan const & rowPlan =
+                TermPlanConverter::BuildRowPlan(tree, index, allocator);
+            RowMatchNode const * folded =
+                ConstantFolder::Fold(rowPlan.GetMatchTree(),
+                                     rowPlan.GetPlanRows(),
+                                     allocator);
+            EXPECT_NE(folded, nullptr);
+
+            RowMatchNode const & rewritten =
+                MatchTreeRewriter::Rewrite(*folded,
+                                           targetRowCount,
+                                           crossProductTermCount,
+                                           allocator);
+            RankDownCompiler compiler(allocator);
+            compiler.Compile(rewritten);
+            return RankDownCompiler::EstimateRowReads(compiler.CreateTree(maxRank),
+                                                      rowDensity);
+        }
+
+
+        // The planning/rewrite diagnostic reports the settings chosen by the
+        // adaptive rewrite and their estimated row reads. The estimate must
+        // be the one for the chosen settings, and better than the estimate
+        // for the default settings whenever another candidate was tried
+        // within the planning time budget.
+        TEST(QueryPlanner, RewriteEstimate)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId);
+
+            // Without cross products, the rewrite of this tree is expected
+            // to read slightly fewer rows than with the default settings.
+            char const * text =
+                "And {"
+                "  Children: ["
+                "    Unigram(\"2\", 0),"
+                "    Or {"
+                "      Children: ["
+                "        Unigram(\"3\", 0),"
+                "        Unigram(\"5\", 0),"
+                "        Unigram(\"7\", 0)"
+                "      ]"
+                "    },"
+                "    Or {"
+                "      Children: ["
+                "        Unigram(\"11\", 0),"
+                "        Unigram(\"13\", 0),"
+                "        Unigram(\"17\", 0)"
+                "      ]"
+                "    }"
+                "  ]"
+                "}";
+
+            Allocator allocator(c_allocatorSize);
+            TermMatchNode const & tree = ParseTree(text, allocator);
+
+            IScoringEngine scoringEngine;
+            QueryPreferences queryPreferences;
+            TermPlan const & termPlan =
+                *new (allocator.Allocate(sizeof(TermPlan)))
+                    TermPlan(tree, scoringEngine, queryPreferences);
+
+            DiagnosticStream diagnostics;
+            diagnostics.Enable("planning/rewrite");
+
+            QueryPlanner planner(termPlan,
+                                 c_targetRowCount,
+                                 *index,
+                                 allocator,
+                                 &diagnostics);
+
+            // Primes have rows at ranks 0, 1, and 2.
+            EXPECT_EQ(planner.GetMaxRank(), 2u);
+
+            const std::string output = diagnostics.GetOutput();
+            ASSERT_NE(output.find("Rewritten Plan:"), std::string::npos);
+
+            const double settingsTried = GetValue(output, "Settings tried:");
+            EXPECT_GE(settingsTried, 1.0);
+            EXPECT_LE(settingsTried, 5.0);
+
+            // The default settings are tried first and the second candidate
+            // disables cross products. Later candidates are no better, and
+            // ties keep the earlier candidate.
+            const unsigned targetRowCount =
+                static_cast<unsigned>(GetValue(output, "Target row count:"));
+            const unsigned crossProductTermCount =
+                static_cast<unsigned>(GetValue(output, "Cross product term count:"));
+            EXPECT_EQ(targetRowCount, c_targetRowCount);
+            if (settingsTried >= 2.0)
+            {
+                EXPECT_EQ(crossProductTermCount, 0u);
+            }
+            else
+            {
+                EXPECT_EQ(crossProductTermCount, c_crossProductTermCount);
+            }
+
+            const double rowDensity = GetValue(output, "Row density:");
+            EXPECT_GT(rowDensity, 0.0);
+            EXPECT_LE(rowDensity, 1.0);
+
+            const double rowReads = GetValue(output, "Estimated row reads:");
+            EXPECT_GT(rowReads, 0.0);
+
+            const double expected = EstimateRowReads(tree,
+                                                     *index,
+                                                     targetRowCount,
+                                                     crossProductTermCount,
+                                                     planner.GetMaxRank(),
+                                                     rowDensity,
+                                                     allocator);
+            EXPECT_NEAR(rowReads, expected, expected * 1e-5);
+
+            const double defaultRowReads = EstimateRowReads(tree,
+                                                            *index,
+                                                            c_targetRowCount,
+                                                            c_crossProductTermCount,
+                                                            planner.GetMaxRank(),
+                                                            rowDensity,
+                                                            allocator);
+            if (settingsTried >= 2.0)
+            {
+                EXPECT_LT(expected, defaultRowReads);
+            }
+        }
+
+
+        // A tree that can never match compiles to Constant(0) rather than
+        // to a RankDown tree, and skips the rewrite. The PrimeFactors
+        // TermTable has no terms on the system rows, so this test uses a
+        // TermTable that maps the term "none" to the match-none row.
+        TEST(QueryPlanner, MatchNoneIsConstant)
+        {
+            auto termTable = Factories::CreateTermTable();
+            RowIdSequence matchNone(termTable->GetMatchNoneTerm(), *termTable);
+            termTable->OpenTerm();
+            termTable->AddRowId(*matchNone.begin());
+            termTable->CloseTerm(Term::ComputeRawHash("none"));
+            termTable->SetRowCounts(0, ITermTable::SystemTerm::Count, 1);
+            termTable->Seal();
+
+            auto termTables = Factories::CreateTermTableCollection();
+            termTables->AddTermTable(std::move(termTable));
+
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreateSimpleIndex(*fileSystem);
+            index->SetTermTableCollection(std::move(termTables));
+            index->ConfigureAsMock(1, false);
+            index->StartIndex();
+
+            char const * text =
+                "And {"
+                "  Children: ["
+                "    Unigram(\"none\", 0),"
+                "    Unigram(\"other\", 0)"
+                "  ]"
+                "}";
+
+            Allocator allocator(c_allocatorSize);
+            TermMatchNode const & tree = ParseTree(text, allocator);
+
+            IScoringEngine scoringEngine;
+            QueryPreferences queryPreferences;
+            TermPlan const & termPlan =
+                *new (allocator.Allocate(sizeof(TermPlan)))
+                    TermPlan(tree, scoringEngine, queryPreferences);
+
+            DiagnosticStream diagnostics;
+            diagnostics.Enable("planning/rewrite");
+            diagnostics.Enable("planning/compile");
+
+            QueryPlanner planner(termPlan,
+                                 c_targetRowCount,
+                                 *index,
+                                 allocator,
+                                 &diagnostics);
+
+            char const * expected =
+                "--------------------"
+                "Compile Nodes:"
+                "Constant {"
+                "  Value: 0"
+                "}";
+
+            EXPECT_TRUE(SameExceptForWhitespace(diagnostics.GetOutput().c_str(),
+                                                expected))
+                << diagnostics.GetOutput();
+        }
+    }
+}
@@ -0,0 +1,247 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <iostream>
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+#include "Allocator.h"
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Configuration/IStreamConfiguration.h"
+#include "BitFunnel/Exceptions.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Plan/Factories.h"
+#include "BitFunnel/Plan/IPlanCache.h"
+#include "BitFunnel/Plan/QueryRunner.h"
+#include "QueryParser.h"
+
+
+namespace BitFunnel
+{
+    namespace QueryRunnerTest
+    {
+        static const Term::StreamId c_streamId = 0;
+        static const DocId c_maxDocId = 1664;
+        static const size_t c_allocatorSize = 4096;
+
+
+        // Returns the number of matches for a single run of the query.
+        static size_t MatchCount(ISimpleIndex const & index, char const * query)
+        {
+            auto config = Factories::CreateStreamConfiguration();
+            Allocator allocator(c_allocatorSize);
+            std::stringstream input(query);
+            QueryParser parser(input, *config, allocator);
+            auto tree = parser.Parse();
+            return Factories::RunSimplePlanner(*tree, index).size();
+        }
+
+
+        TEST(QueryRunner, Statistics)
+        {
+            std::vector<std::string> queries = { "a", "b" };
+            std::vector<double> latencies = { 0.004, 0.001, 0.003, 0.002 };
+            std::vector<size_t> matchCounts = { 5, 7, 5, 7 };
+
+            QueryRunner::Statistics statistics(3,
+                                               queries,
+                                               latencies,
+                                               matchCounts,
+                                               2.0);
+
+            EXPECT_EQ(statistics.GetThreadCount(), 3u);
+            EXPECT_EQ(statistics.GetUniqueQueryCount(), 2u);
+            EXPECT_EQ(statistics.GetProcessedCount(), 4u);
+            EXPECT_EQ(statistics.GetTotalMatchCount(), 24u);
+            EXPECT_DOUBLE_EQ(statistics.GetQPS(), 2.0);
+
+            EXPECT_DOUBLE_EQ(statistics.GetLatencyPercentile(0.0), 0.001);
+            EXPECT_DOUBLE_EQ(statistics.GetLatencyPercentile(0.5), 0.002);
+            EXPECT_DOUBLE_EQ(statistics.GetLatencyPercentile(0.75), 0.003);
+            EXPECT_DOUBLE_EQ(statistics.GetLatencyPercentile(0.99), 0.004);
+            EXPECT_DOUBLE_EQ(statistics.GetLatencyPercentile(1.0), 0.004);
+
+            std::stringstream csv;
+            statistics.WriteCsv(csv);
+
+            std::vector<std::string> lines;
+            std::string line;
+            while (std::getline(csv, line))
+            {
+                lines.push_back(line);
+            }
+            ASSERT_EQ(lines.size(), 5u);
+            EXPECT_EQ(lines[0], "query,latency,matches");
+            EXPECT_EQ(lines[2].substr(0, 2), "b,");
+            EXPECT_EQ(lines[2].substr(lines[2].size() - 2), ",7");
+        }
+
+
+        TEST(QueryRunner, Run)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId);
+
+            std::vector<std::string> queries = { "2 3", "5", "7 11" };
+            size_t expected = 0;
+            for (auto const & query : queries)
+            {
+                expected += MatchCount(*index, query.c_str());
+            }
+
+            const size_t c_iterations = 3;
+            for (size_t threadCount = 1; threadCount <= 4; ++threadCount)
+            {
+                auto statistics = QueryRunner::Run(*index,
+                                                   threadCount,
+                                                   queries,
+                                                   c_iterations);
+
+                EXPECT_EQ(statistics.GetThreadCount(), threadCount);
+                EXPECT_EQ(statistics.GetUniqueQueryCount(), queries.size());
+                EXPECT_EQ(statistics.GetProcessedCount(),
+                          queries.size() * c_iterations);
+                EXPECT_EQ(statistics.GetTotalMatchCount(),
+                          expected * c_iterations);
+                EXPECT_GT(statistics.GetElapsedTime(), 0.0);
+                EXPECT_LE(statistics.GetLatencyPercentile(0.5),
+                          statistics.GetLatencyPercentile(0.99));
+            }
+        }
+
+
+        TEST(QueryRunner, PlanCache)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId);
+            auto planCache = Factories::CreatePlanCache(8);
+
+            std::vector<std::string> queries = { "2 3", "5", "7 11" };
+            const size_t c_iterations = 3;
+            QueryRunner::Run(*index, 1, queries, c_iterations, planCache.get());
+
+            // The untimed run does not warm the plan cache.
+            EXPECT_EQ(planCache->GetMissCount(), queries.size());
+            EXPECT_EQ(planCache->GetHitCount(),
+                      queries.size() * (c_iterations - 1));
+        }
+
+
+        // The number of executions is not a multiple of the batch size, so
+        // the last batch of each run is partial.
+        TEST(QueryRunner, Batch)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            2);
+            auto planCache = Factories::CreatePlanCache(8);
+
+            std::vector<std::string> queries = { "2 3", "5", "7 11" };
+            size_t expected = 0;
+            for (auto const & query : queries)
+            {
+                expected += MatchCount(*index, query.c_str());
+            }
+
+            const size_t c_iterations = 3;
+            const size_t c_batchSize = 4;
+            for (size_t threadCount = 1; threadCount <= 3; ++threadCount)
+            {
+                auto statistics = QueryRunner::Run(*index,
+                                                   threadCount,
+                                                   queries,
+                                                   c_iterations,
+                                                   planCache.get(),
+                                                   c_batchSize);
+
+                EXPECT_EQ(statistics.GetProcessedCount(),
+                          queries.size() * c_iterations);
+                EXPECT_EQ(statistics.GetTotalMatchCount(),
+                          expected * c_iterations);
+                EXPECT_GT(statistics.GetLatencyPercentile(0.0), 0.0);
+            }
+            EXPECT_EQ(planCache->GetMissCount(), queries.size());
+        }
+
+
+        // Reports single threaded QPS and batch latency as a function of
+        // batch size. A batch reads each row from memory once, however many
+        // of its queries use the row. This test is disabled by default. Run
+        // it with
+        //   PlanTest --gtest_also_run_disabled_tests
+        //            --gtest_filter=*BatchBenchmark*
+        TEST(QueryRunner, DISABLED_BatchBenchmark)
+        {
+            static const DocId c_benchmarkMaxDocId = 10000;
+            static const size_t c_iterations = 20;
+
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_benchmarkMaxDocId,
+                                                            c_streamId);
+            auto planCache = Factories::CreatePlanCache(64);
+
+            std::vector<std::string> queries = {
+                "2 3", "5", "7 11", "2 5", "3 7", "13", "2 3 5", "17",
+                "2 11", "3 5", "19", "2 7", "23", "3 11", "2 13", "29"
+            };
+
+            for (size_t batchSize = 1; batchSize <= queries.size(); batchSize *= 4)
+            {
+                auto statistics = QueryRunner::Run(*index,
+                                                   1,
+                                                   queries,
+                                                   c_iterations,
+                                                   planCache.get(),
+                                                   batchSize);
+
+                std::cout << "batch size = " << batchSize
+                          << ", QPS = " << statistics.GetQPS()
+                          << ", p50 = "
+                          << statistics.GetLatencyPercentile(0.5) * 1e6 << "us"
+                          << std::endl;
+            }
+        }
+
+
+        TEST(QueryRunner, MalformedQuery)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId);
+
+            std::vector<std::string> queries = { "2 3", "(2 3" };
+            EXPECT_THROW(QueryRunner::Run(*index, 2, queries, 1),
+                         RecoverableError);
+        }
+    }
+}
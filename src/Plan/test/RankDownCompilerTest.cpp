@@ -20,6 +20,8 @@
 // OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
 // THE SOFTWARE.
 
+#include <cmath>        // std::pow().
+
 #include "gtest/gtest.h"
 
 #include "Allocator.h"
@@ -521,6 +523,187 @@ namespace BitFunnel
                 "  }"
                 "}"
             },
+
+
+            //
+            // Factoring
+            //
+
+            // Or of two branches that share a rank 6 row, and a third
+            // branch. Expect the shared row to be loaded once, ahead of an
+            // Or of the rows that differ.
+            {
+                "Or {"
+                "  Children: ["
+                "    And {"
+                "      Children: ["
+                "        Row(0, 6, 0, false),"
+                "        Row(1, 6, 0, false)"
+                "      ]"
+                "    },"
+                "    And {"
+                "      Children: ["
+                "        Row(2, 6, 0, false),"
+                "        Row(0, 6, 0, false)"
+                "      ]"
+                "    },"
+                "    Row(3, 6, 0, false)"
+                "  ]"
+                "}",
+                "Or {"
+                "  Children: ["
+                "    LoadRowJz {"
+                "      Row: Row(0, 6, 0, false),"
+                "      Child: Or {"
+                "        Children: ["
+                "          AndRowJz {"
+                "            Row: Row(1, 6, 0, false),"
+                "            Child: RankDown {"
+                "              Delta: 6,"
+                "              Child: Report {"
+                "                Child: "
+                "              }"
+                "            }"
+                "          },"
+                "          AndRowJz {"
+                "            Row: Row(2, 6, 0, false),"
+                "            Child: RankDown {"
+                "              Delta: 6,"
+                "              Child: Report {"
+                "                Child: "
+                "              }"
+                "            }"
+                "          }"
+                "        ]"
+                "      }"
+                "    },"
+                "    LoadRowJz {"
+                "      Row: Row(3, 6, 0, false),"
+                "      Child: RankDown {"
+                "        Delta: 6,"
+                "        Child: Report {"
+                "          Child: "
+                "        }"
+                "      }"
+                "    }"
+                "  ]"
+                "}"
+            },
+
+            // A branch that is just the shared row absorbs the others,
+            // i.e. ab + a = a.
+            {
+                "Or {"
+                "  Children: ["
+                "    And {"
+                "      Children: ["
+                "        Row(0, 0, 0, false),"
+                "        Row(1, 0, 0, false)"
+                "      ]"
+                "    },"
+                "    Row(0, 0, 0, false)"
+                "  ]"
+                "}",
+                "RankDown {"
+                "  Delta: 6,"
+                "  Child: LoadRowJz {"
+                "    Row: Row(0, 0, 0, false),"
+                "    Child: Report {"
+                "      Child: "
+                "    }"
+                "  }"
+                "}"
+            },
+
+            // Rows of different ranks are not reordered, so the rank 0 row
+            // shared by the branches is not factored out.
+            {
+                "Or {"
+                "  Children: ["
+                "    And {"
+                "      Children: ["
+                "        Row(1, 6, 0, false),"
+                "        Row(0, 0, 0, false)"
+                "      ]"
+                "    },"
+                "    And {"
+                "      Children: ["
+                "        Row(2, 6, 0, false),"
+                "        Row(0, 0, 0, false)"
+                "      ]"
+                "    }"
+                "  ]"
+                "}",
+                "Or {"
+                "  Children: ["
+                "    LoadRowJz {"
+                "      Row: Row(1, 6, 0, false),"
+                "      Child: RankDown {"
+                "        Delta: 6,"
+                "        Child: AndRowJz {"
+                "          Row: Row(0, 0, 0, false),"
+                "          Child: Report {"
+                "            Child: "
+                "          }"
+                "        }"
+                "      }"
+                "    },"
+                "    LoadRowJz {"
+                "      Row: Row(2, 6, 0, false),"
+                "      Child: RankDown {"
+                "        Delta: 6,"
+                "        Child: AndRowJz {"
+                "          Row: Row(0, 0, 0, false),"
+                "          Child: Report {"
+                "            Child: "
+                "          }"
+                "        }"
+                "      }"
+                "    }"
+                "  ]"
+                "}"
+            },
+
+            // Or followed by a row. Expect the row to follow each branch of
+            // the Or.
+            {
+                "And {"
+                "  Children: ["
+                "    Or {"
+                "      Children: ["
+                "        Row(0, 0, 0, false),"
+                "        Row(1, 0, 0, false)"
+                "      ]"
+                "    },"
+                "    Row(2, 0, 0, false)"
+                "  ]"
+                "}",
+                "RankDown {"
+                "  Delta: 6,"
+                "  Child: Or {"
+                "    Children: ["
+                "      LoadRowJz {"
+                "        Row: Row(0, 0, 0, false),"
+                "        Child: AndRowJz {"
+                "          Row: Row(2, 0, 0, false),"
+                "          Child: Report {"
+                "            Child: "
+                "          }"
+                "        }"
+                "      },"
+                "      LoadRowJz {"
+                "        Row: Row(1, 0, 0, false),"
+                "        Child: AndRowJz {"
+                "          Row: Row(2, 0, 0, false),"
+                "          Child: Report {"
+                "            Child: "
+                "          }"
+                "        }"
+                "      }"
+                "    ]"
+                "  }"
+                "}"
+            },
         };
 
 
@@ -543,7 +726,7 @@ namespace BitFunnel
         {
             std::stringstream input(testCase.m_input);
 
-            Allocator allocator(512);
+            Allocator allocator(4096);
             TextObjectParser parser(input, allocator, &RowPlanBase::GetType);
             RowMatchNode const & root = RowMatchNode::Parse(parser);
 
@@ -579,5 +762,56 @@ namespace BitFunnel
                 VerifyCase(c_cases[i]);
             }
         }
+
+
+        TEST(RankDownCompiler, EstimateRowReads)
+        {
+            char const * text =
+                "Or {"
+                "  Children: ["
+                "    And {"
+                "      Children: ["
+                "        Row(0, 6, 0, false),"
+                "        Row(1, 6, 0, false)"
+                "      ]"
+                "    },"
+                "    And {"
+                "      Children: ["
+                "        Row(0, 6, 0, false),"
+                "        Row(2, 6, 0, false)"
+                "      ]"
+                "    }"
+                "  ]"
+                "}";
+
+            std::stringstream input(text);
+
+            Allocator allocator(4096);
+            TextObjectParser parser(input, allocator, &RowPlanBase::GetType);
+            RowMatchNode const & root = RowMatchNode::Parse(parser);
+
+            RankDownCompiler compiler(allocator);
+            compiler.Compile(root);
+            CompileNode const & compiled = compiler.CreateTree(6);
+
+            // Factored as a(b + c). With empty rows only a is read. With
+            // full rows all three rows are read. Without factoring, a would
+            // be read twice.
+            EXPECT_EQ(1.0, RankDownCompiler::EstimateRowReads(compiled, 0.0));
+            EXPECT_EQ(3.0, RankDownCompiler::EstimateRowReads(compiled, 1.0));
+
+            // A rank 6 row with rank zero density 0.001 has density
+            // 1 - 0.999^64, about 0.062, so a quadword of a is non-zero with
+            // probability 1 - (1 - 0.062)^64, about 0.98.
+            double d6 = 1.0 - std::pow(0.999, 64.0);
+            double pass = 1.0 - std::pow(1.0 - d6, 64.0);
+            EXPECT_NEAR(1.0 + 2.0 * pass,
+                        RankDownCompiler::EstimateRowReads(compiled, 0.001),
+                        1e-9);
+
+            // Sparser rows are cheaper.
+            EXPECT_LT(RankDownCompiler::EstimateRowReads(compiled, 0.00001),
+                      RankDownCompiler::EstimateRowReads(compiled, 0.001));
+        }
     }
 }
@@ -0,0 +1,185 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Plan/QueryLimits.h"
+#include "QueryBudget.h"
+#include "ResultsProcessor.h"
+
+
+namespace BitFunnel
+{
+    namespace ResultsProcessorTest
+    {
+        // A slice buffer whose DocTable starts at c_docIdOffset and has
+        // c_docIdStride bytes per document. The DocId for DocIndex i is
+        // c_firstDocId + i.
+        static const ptrdiff_t c_docIdOffset = 64;
+        static const size_t c_docIdStride = 24;
+        static const DocIndex c_capacity = 16384;
+        static const DocId c_firstDocId = 1000;
+
+        class SyntheticSlice
+        {
+        public:
+            SyntheticSlice()
+              : m_buffer(c_docIdOffset + c_capacity * c_docIdStride)
+            {
+                for (DocIndex i = 0; i < c_capacity; ++i)
+                {
+                    *reinterpret_cast<DocId *>(
+                        m_buffer.data() + c_docIdOffset + i * c_docIdStride) =
+                            c_firstDocId + i;
+                }
+            }
+
+            void const * GetSliceBuffer() const
+            {
+                return m_buffer.data();
+            }
+
+        private:
+            std::vector<char> m_buffer;
+        };
+
+
+        TEST(ResultsProcessor, ExtractsDocIds)
+        {
+            SyntheticSlice slice;
+            std::vector<DocId> matches;
+            ResultsProcessor results(matches, c_docIdOffset, c_docIdStride);
+
+            results.AddResult(0x8000000000000005ull, 2);
+            results.AddResult(0x1ull, 3);
+            EXPECT_FALSE(results.FinishIteration(slice.GetSliceBuffer()));
+
+            std::vector<DocId> expected = {
+                c_firstDocId + 128,
+                c_firstDocId + 130,
+                c_firstDocId + 191,
+                c_firstDocId + 192
+            };
+            EXPECT_EQ(matches, expected);
+            EXPECT_FALSE(results.TerminatedEarly());
+        }
+
+
+        // Offsets reported more than once in an iteration, as happens with
+        // RankDown, produce each DocId once. Empty accumulators produce
+        // nothing.
+        TEST(ResultsProcessor, Dedupe)
+        {
+            SyntheticSlice slice;
+            std::vector<DocId> matches;
+            ResultsProcessor results(matches, c_docIdOffset, c_docIdStride);
+
+            results.AddResult(0x3ull, 8);
+            results.AddResult(0x0ull, 9);
+            results.AddResult(0x6ull, 8);
+            results.AddResult(0x1ull, 9);
+            results.AddResult(0x2ull, 9);
+            EXPECT_FALSE(results.FinishIteration(slice.GetSliceBuffer()));
+
+            std::vector<DocId> expected = {
+                c_firstDocId + 512,
+                c_firstDocId + 513,
+                c_firstDocId + 514,
+                c_firstDocId + 576,
+                c_firstDocId + 577
+            };
+            EXPECT_EQ(matches, expected);
+
+            // The buffer is empty after FinishIteration(). Matches from the
+            // next iteration are appended.
+            EXPECT_FALSE(results.FinishIteration(slice.GetSliceBuffer()));
+            EXPECT_EQ(matches, expected);
+
+            results.AddResult(0x1ull, 8);
+            EXPECT_FALSE(results.FinishIteration(slice.GetSliceBuffer()));
+            expected.push_back(c_firstDocId + 512);
+            EXPECT_EQ(matches, expected);
+        }
+
+
+        // FinishIteration() requests termination once the matches from all
+        // ResultsProcessors sharing a QueryBudget reach the limit.
+        TEST(ResultsProcessor, MatchLimit)
+        {
+            SyntheticSlice slice;
+            QueryBudget budget(QueryLimits(5));
+            std::vector<DocId> matches1;
+            std::vector<DocId> matches2;
+            ResultsProcessor results1(matches1, c_docIdOffset, c_docIdStride, &budget);
+            ResultsProcessor results2(matches2, c_docIdOffset, c_docIdStride, &budget);
+
+            results1.AddResult(0x3ull, 0);
+            EXPECT_FALSE(results1.FinishIteration(slice.GetSliceBuffer()));
+            EXPECT_FALSE(results1.TerminatedEarly());
+
+            results2.AddResult(0x7ull, 1);
+            EXPECT_TRUE(results2.FinishIteration(slice.GetSliceBuffer()));
+            EXPECT_TRUE(results2.TerminatedEarly());
+
+            // The other ResultsProcessor stops at its next iteration.
+            EXPECT_TRUE(results1.FinishIteration(slice.GetSliceBuffer()));
+            EXPECT_TRUE(results1.TerminatedEarly());
+
+            EXPECT_EQ(matches1.size(), 2u);
+            EXPECT_EQ(matches2.size(), 3u);
+        }
+
+
+        // An iteration at the maximum rank reports every offset in its
+        // block of quadwords.
+        TEST(ResultsProcessor, MaxRankIteration)
+        {
+            static const size_t c_offsetCount = 1ull << c_maxRankValue;
+
+            SyntheticSlice slice;
+            std::vector<DocId> matches;
+            ResultsProcessor results(matches, c_docIdOffset, c_docIdStride);
+
+            // Offsets of the second block, reported twice in reverse order.
+            for (size_t pass = 0; pass < 2; ++pass)
+            {
+                for (size_t i = 0; i < c_offsetCount; ++i)
+                {
+                    results.AddResult(1ull << pass,
+                                      2 * c_offsetCount - 1 - i);
+                }
+            }
+            EXPECT_FALSE(results.FinishIteration(slice.GetSliceBuffer()));
+
+            ASSERT_EQ(matches.size(), 2 * c_offsetCount);
+            for (size_t i = 0; i < c_offsetCount; ++i)
+            {
+                const DocIndex base =
+                    (2 * c_offsetCount - 1 - i) * c_bitsPerQuadword;
+                EXPECT_EQ(matches[2 * i], c_firstDocId + base);
+                EXPECT_EQ(matches[2 * i + 1], c_firstDocId + base + 1);
+            }
+        }
+    }
+}
@@ -0,0 +1,525 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <stdint.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Index/Factories.h"
+#include "BitFunnel/Index/IDocument.h"
+#include "BitFunnel/Index/IDocumentFrequencyTable.h"
+#include "BitFunnel/Index/IFactSet.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Index/ISliceBufferAllocator.h"
+#include "BitFunnel/Index/ITermTable.h"
+#include "BitFunnel/Index/ITermTableBuilder.h"
+#include "BitFunnel/Index/ITermTableCollection.h"
+#include "BitFunnel/Index/ITermTreatment.h"
+#include "BitFunnel/Index/RowIdSequence.h"
+#include "BitFunnel/Index/Token.h"
+#include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Utilities/Stopwatch.h"
+#include "ByteCodeBatchRunner.h"
+#include "Primes.h"
+#include "ShardPlan.h"
+
+
+namespace BitFunnel
+{
+    namespace ShardPlanTest
+    {
+        static const Term::StreamId c_streamId = 0;
+
+
+        static std::vector<Term> GetTerms(ISimpleIndex const & index,
+                                          std::vector<char const *> const & texts)
+        {
+            std::vector<Term> terms;
+            for (auto text : texts)
+            {
+                terms.push_back(Term(text, c_streamId, index.GetConfiguration()));
+            }
+            return terms;
+        }
+
+
+        // Returns the number of rows the matching code reads for one
+        // iteration, given that rows are intersected in the order specified
+        // and that a row is skipped once the accumulator is zero. A RankDown
+        // between rows of rank r and r - d runs the rest of the plan 2^d
+        // times.
+        static size_t CountRowsTouched(IShard const & shard,
+                                       char const * sliceBuffer,
+                                       std::vector<RowId> const & rows,
+                                       size_t position,
+                                       Rank rank,
+                                       size_t offset,
+                                       uint64_t accumulator)
+        {
+            if (position == rows.size())
+            {
+                return 0;
+            }
+
+            RowId row = rows[position];
+            if (row.GetRank() < rank)
+            {
+                const Rank delta = rank - row.GetRank();
+                size_t count = 0;
+                for (size_t i = 0; i < (1ull << delta); ++i)
+                {
+                    count += CountRowsTouched(shard,
+                                              sliceBuffer,
+                                              rows,
+                                              position,
+                                              row.GetRank(),
+                                              (offset << delta) + i,
+                                              accumulator);
+                }
+                return count;
+            }
+
+            uint64_t const * quadwords = reinterpret_cast<uint64_t const *>(
+                sliceBuffer + shard.GetRowOffset(row));
+            accumulator &= quadwords[offset];
+            if (accumulator == 0)
+            {
+                return 1;
+            }
+            return 1 + CountRowsTouched(shard,
+                                        sliceBuffer,
+                                        rows,
+                                        position + 1,
+                                        rank,
+                                        offset,
+                                        accumulator);
+        }
+
+
+        // Returns the average number of rows read per iteration over every
+        // slice in the shard.
+        static double RowsTouchedPerIteration(IShard const & shard,
+                                              std::vector<RowId> const & rows)
+        {
+            const Rank rank = rows[0].GetRank();
+            const size_t iterationsPerSlice = shard.GetSliceCapacity() >> 6 >> rank;
+
+            size_t touched = 0;
+            size_t iterations = 0;
+            for (auto buffer : shard.GetSliceBuffers())
+            {
+                for (size_t i = 0; i < iterationsPerSlice; ++i)
+                {
+                    touched += CountRowsTouched(shard,
+                                                static_cast<char const *>(buffer),
+                                                rows,
+                                                0,
+                                                rank,
+                                                i,
+                                                ~0ull);
+                    ++iterations;
+                }
+            }
+            return static_cast<double>(touched) / iterations;
+        }
+
+
+        // Returns an index of PrimeFactors documents 1..maxDocId whose
+        // TermTable was built by TermTableBuilder with the specified
+        // treatment. The document frequency of prime p is about 1 / p.
+        static std::unique_ptr<ISimpleIndex>
+            CreateTreatmentIndex(IFileSystem & fileSystem,
+                                 ITermTreatment const & treatment,
+                                 DocId maxDocId)
+        {
+            std::stringstream frequencies;
+            frequencies << "hash,gramSize,streamId,frequency,text" << std::endl;
+            for (size_t i = 0; i < Primes::c_primesBelow10000.size(); ++i)
+            {
+                const size_t p = Primes::c_primesBelow10000[i];
+                if (p > maxDocId)
+                {
+                    break;
+                }
+                auto const & text = Primes::c_primesBelow10000Text[i];
+                frequencies
+                    << std::hex << Term::ComputeRawHash(text.c_str()) << std::dec
+                    << ",1," << static_cast<unsigned>(c_streamId)
+                    << "," << static_cast<double>(maxDocId / p) / maxDocId
+                    << "," << text << std::endl;
+            }
+
+            auto documentFrequencies =
+                Factories::CreateDocumentFrequencyTable(frequencies);
+            auto facts = Factories::CreateFactSet();
+            auto termTable = Factories::CreateTermTable();
+            auto builder =
+                Factories::CreateTermTableBuilder(0.1,
+                                                  0.001,
+                                                  treatment,
+                                                  *documentFrequencies,
+                                                  *facts,
+                                                  *termTable);
+
+            auto termTables = Factories::CreateTermTableCollection();
+            termTables->AddTermTable(std::move(termTable));
+
+            // Large enough for several thousand documents per slice when
+            // c_maxRankValue is used and the slice capacity must be a
+            // multiple of 64 << c_maxRankValue.
+            const size_t blockSize = 1ull << 23;
+            const size_t blockCount = 64;
+
+            auto index = Factories::CreateSimpleIndex(fileSystem);
+            index->SetTermTableCollection(std::move(termTables));
+            index->SetSliceBufferAllocator(
+                Factories::CreateSliceBufferAllocator(blockSize, blockCount));
+            index->ConfigureAsMock(1, false);
+            index->StartIndex();
+
+            for (DocId docId = 1; docId <= maxDocId; ++docId)
+            {
+                auto document =
+                    Factories::CreatePrimeFactorsDocument(index->GetConfiguration(),
+                                                          docId,
+                                                          maxDocId,
+                                                          c_streamId);
+                index->GetIngestor().Add(docId, *document);
+            }
+
+            return index;
+        }
+
+
+        // Runs the plan over every slice of the shard and returns the
+        // sorted matches. The caller must hold a Token.
+        static std::vector<DocId> RunPlan(IShard const & shard,
+                                          ShardPlan const & plan)
+        {
+            auto const & buffers = shard.GetSliceBuffers();
+            char * const * sliceBuffers =
+                reinterpret_cast<char * const *>(buffers.data());
+
+            std::vector<DocId> matches;
+            ShardPlan::MatcherState state;
+            for (size_t slice = 0; slice < buffers.size(); ++slice)
+            {
+                plan.ProcessSlice(slice,
+                                  sliceBuffers,
+                                  buffers.size(),
+                                  matches,
+                                  nullptr,
+                                  state);
+            }
+            std::sort(matches.begin(), matches.end());
+            return matches;
+        }
+
+
+        // Returns the rows ordered by decreasing rank only, as they were
+        // before ShardPlan considered row density.
+        static std::vector<RowId> RankOrder(IShard const & shard,
+                                            std::vector<Term> const & terms)
+        {
+            std::vector<RowId> rows;
+            for (auto const & term : terms)
+            {
+                RowIdSequence sequence(term, shard.GetTermTable());
+                for (auto row : sequence)
+                {
+                    rows.push_back(row);
+                }
+            }
+            std::stable_sort(rows.begin(), rows.end(), [](RowId a, RowId b)
+            {
+                return a.GetRank() > b.GetRank();
+            });
+            return rows;
+        }
+
+
+        TEST(ShardPlan, SparsestRowsFirst)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            1000,
+                                                            c_streamId);
+            auto & ingestor = index->GetIngestor();
+            auto token = ingestor.GetTokenManager().RequestToken();
+            IShard const & shard = ingestor.GetShard(0);
+
+            auto terms = GetTerms(*index, { "2", "97", "3" });
+            ShardPlan plan(shard, terms);
+
+            auto const & rows = plan.GetRows();
+            ASSERT_EQ(rows.size(), 9u);
+
+            for (size_t i = 1; i < rows.size(); ++i)
+            {
+                ASSERT_GE(rows[i - 1].GetRank(), rows[i].GetRank());
+                if (rows[i - 1].GetRank() == rows[i].GetRank())
+                {
+                    EXPECT_LE(ShardPlan::SampleDensity(shard, rows[i - 1]),
+                              ShardPlan::SampleDensity(shard, rows[i]));
+                }
+            }
+
+            // At rank 0, the row for "97" is the sparsest and "2" the
+            // densest.
+            RowIdSequence rows97(terms[1], shard.GetTermTable());
+            RowIdSequence rows2(terms[0], shard.GetTermTable());
+            RowId row97 = *rows97.begin();
+            RowId row2 = *rows2.begin();
+            ASSERT_EQ(row97.GetRank(), 0u);
+            ASSERT_EQ(row2.GetRank(), 0u);
+            EXPECT_EQ(rows[6], row97);
+            EXPECT_EQ(rows[8], row2);
+
+            EXPECT_LE(RowsTouchedPerIteration(shard, rows),
+                      RowsTouchedPerIteration(shard, RankOrder(shard, terms)));
+        }
+
+
+        // Compares the rows read per iteration with and without density
+        // ordering, over a log of random conjunctions of primes with a
+        // range of densities.
+        TEST(ShardPlan, DISABLED_RowOrderBenchmark)
+        {
+            static const DocId c_maxDocId = 10000;
+            static const size_t c_queryCount = 200;
+
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId);
+            auto & ingestor = index->GetIngestor();
+            auto token = ingestor.GetTokenManager().RequestToken();
+            IShard const & shard = ingestor.GetShard(0);
+
+            std::vector<char const *> primes =
+                { "2", "3", "5", "7", "11", "13", "17", "19", "23", "29",
+                  "31", "37", "41", "43", "47", "53", "59", "61", "67", "71" };
+
+            std::mt19937 random(12345);
+            std::uniform_int_distribution<size_t> termCount(2, 4);
+
+            double rankOrderTotal = 0;
+            double densityOrderTotal = 0;
+            for (size_t q = 0; q < c_queryCount; ++q)
+            {
+                std::shuffle(primes.begin(), primes.end(), random);
+                std::vector<char const *> texts(primes.begin(),
+                                                primes.begin() + termCount(random));
+                auto terms = GetTerms(*index, texts);
+
+                ShardPlan plan(shard, terms);
+                rankOrderTotal += RowsTouchedPerIteration(shard, RankOrder(shard, terms));
+                densityOrderTotal += RowsTouchedPerIteration(shard, plan.GetRows());
+            }
+
+            std::cout
+                << "Rows touched per iteration, averaged over "
+                << c_queryCount << " queries:" << std::endl
+                << "  rank order:    " << rankOrderTotal / c_queryCount << std::endl
+                << "  density order: " << densityOrderTotal / c_queryCount << std::endl;
+
+            EXPECT_LE(densityOrderTotal, rankOrderTotal);
+        }
+
+
+        // Plans for terms with rows at rank N start at rank N and rank
+        // down to rank 0. Every document that contains all of the terms
+        // must match. Shared rows may add false positives.
+        TEST(ShardPlan, HigherRankRows)
+        {
+            static const DocId c_maxDocId = 10000;
+            std::vector<std::vector<char const *>> queries = {
+                { "13" },
+                { "11", "13" },
+                { "3", "47" },
+                { "2", "5", "101" },
+                { "97", "101" }
+            };
+
+            for (Rank rank = 1; rank <= c_maxRankValue; ++rank)
+            {
+                auto treatment =
+                    Factories::CreateTreatmentPrivateSharedRank0AndN(0.1, 10, rank);
+                auto fileSystem = Factories::CreateRAMFileSystem();
+                auto index = CreateTreatmentIndex(*fileSystem,
+                                                  *treatment,
+                                                  c_maxDocId);
+                auto & ingestor = index->GetIngestor();
+                auto token = ingestor.GetTokenManager().RequestToken();
+                IShard const & shard = ingestor.GetShard(0);
+
+                for (auto const & query : queries)
+                {
+                    auto terms = GetTerms(*index, query);
+                    ShardPlan plan(shard, terms);
+                    EXPECT_EQ(plan.GetRows()[0].GetRank(), rank);
+
+                    size_t product = 1;
+                    for (auto text : query)
+                    {
+                        product *= std::stoul(text);
+                    }
+
+                    auto matches = RunPlan(shard, plan);
+                    for (DocId docId = product; docId <= c_maxDocId; docId += product)
+                    {
+                        EXPECT_TRUE(std::binary_search(matches.begin(),
+                                                       matches.end(),
+                                                       docId))
+                            << "Rank " << rank << ", DocId " << docId;
+                    }
+                }
+            }
+        }
+
+
+        // ByteCodeBatchRunner runs each plan on one block of iterations at a
+        // time. Plans that rank down from rank N run as native code where it
+        // is supported, and must find the same matches from a sequence of
+        // blocks as from whole slices.
+        TEST(ShardPlan, BatchRunner)
+        {
+            static const DocId c_maxDocId = 10000;
+            static const Rank c_rank = 3;
+            std::vector<std::vector<char const *>> queries = {
+                { "13" },
+                { "11", "13" },
+                { "3", "47" },
+                { "2", "5", "101" },
+                { "97", "101" }
+            };
+
+            auto treatment =
+                Factories::CreateTreatmentPrivateSharedRank0AndN(0.1, 10, c_rank);
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = CreateTreatmentIndex(*fileSystem,
+                                              *treatment,
+                                              c_maxDocId);
+            auto & ingestor = index->GetIngestor();
+            auto token = ingestor.GetTokenManager().RequestToken();
+            IShard const & shard = ingestor.GetShard(0);
+
+            auto const & buffers = shard.GetSliceBuffers();
+            ByteCodeBatchRunner batch(buffers.size(),
+                                      reinterpret_cast<char * const *>(buffers.data()));
+
+            std::vector<std::unique_ptr<ShardPlan>> plans;
+            std::vector<std::vector<DocId>> matches(queries.size());
+            for (size_t i = 0; i < queries.size(); ++i)
+            {
+                plans.emplace_back(new ShardPlan(shard, GetTerms(*index, queries[i])));
+                EXPECT_EQ(plans.back()->GetRows()[0].GetRank(), c_rank);
+                batch.AddQuery(*plans.back(), matches[i]);
+            }
+
+            EXPECT_FALSE(batch.Run());
+
+            for (size_t i = 0; i < queries.size(); ++i)
+            {
+                std::sort(matches[i].begin(), matches[i].end());
+                EXPECT_EQ(matches[i], RunPlan(shard, *plans[i]))
+                    << "Query " << i;
+            }
+        }
+
+
+        // Compares the rows read and the time taken by random conjunctions
+        // when terms have rank 0 rows only and when they also have rows at
+        // each higher rank. Rows read are counted per rank 0 quadword, so a
+        // plan that skips 2^N quadwords with one rank N read scores below
+        // one row per quadword.
+        TEST(ShardPlan, DISABLED_TreatmentRankBenchmark)
+        {
+            static const DocId c_maxDocId = 10000;
+            static const size_t c_queryCount = 200;
+
+            std::vector<char const *> primes =
+                { "11", "13", "17", "19", "23", "29", "31", "37", "41", "43",
+                  "47", "53", "59", "61", "67", "71", "73", "79", "83", "89",
+                  "97", "101", "103", "107", "109", "113", "127", "131" };
+
+            std::cout
+                << std::setw(8) << "rank"
+                << std::setw(16) << "rows/quadword"
+                << std::setw(16) << "us/query" << std::endl;
+
+            for (Rank rank = 0; rank <= c_maxRankValue; ++rank)
+            {
+                auto treatment = (rank == 0) ?
+                    Factories::CreateTreatmentPrivateSharedRank0(0.1, 10) :
+                    Factories::CreateTreatmentPrivateSharedRank0AndN(0.1, 10, rank);
+                auto fileSystem = Factories::CreateRAMFileSystem();
+                auto index = CreateTreatmentIndex(*fileSystem,
+                                                  *treatment,
+                                                  c_maxDocId);
+                auto & ingestor = index->GetIngestor();
+                auto token = ingestor.GetTokenManager().RequestToken();
+                IShard const & shard = ingestor.GetShard(0);
+
+                std::mt19937 random(12345);
+                std::uniform_int_distribution<size_t> termCount(2, 3);
+
+                double rowsPerQuadword = 0;
+                double seconds = 0;
+                for (size_t q = 0; q < c_queryCount; ++q)
+                {
+                    std::shuffle(primes.begin(), primes.end(), random);
+                    std::vector<char const *> texts(primes.begin(),
+                                                    primes.begin() + termCount(random));
+                    auto terms = GetTerms(*index, texts);
+
+                    ShardPlan plan(shard, terms);
+                    const Rank planRank = plan.GetRows()[0].GetRank();
+                    rowsPerQuadword +=
+                        RowsTouchedPerIteration(shard, plan.GetRows())
+                        / (1ull << planRank);
+
+                    Stopwatch stopwatch;
+                    RunPlan(shard, plan);
+                    seconds += stopwatch.ElapsedTime();
+                }
+
+                std::cout
+                    << std::setw(8) << rank
+                    << std::setw(16) << rowsPerQuadword / c_queryCount
+                    << std::setw(16) << seconds * 1e6 / c_queryCount << std::endl;
+            }
+        }
+    }
+}
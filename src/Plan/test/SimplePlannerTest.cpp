@@ -0,0 +1,361 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "Allocator.h"
+#include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
+#include "BitFunnel/Configuration/IStreamConfiguration.h"
+#include "BitFunnel/Index/IIngestor.h"
+#include "BitFunnel/Index/IShard.h"
+#include "BitFunnel/Index/ISimpleIndex.h"
+#include "BitFunnel/Mocks/Factories.h"
+#include "BitFunnel/Plan/Factories.h"
+#include "BitFunnel/Plan/IPlanCache.h"
+#include "BitFunnel/Plan/QueryLimits.h"
+#include "BitFunnel/Plan/TermMatchNode.h"
+#include "BitFunnel/Utilities/Factories.h"
+#include "BitFunnel/Utilities/IThreadPool.h"
+#include "BitFunnel/Utilities/Stopwatch.h"
+#include "QueryParser.h"
+#include "TextObjectParser.h"
+
+
+namespace BitFunnel
+{
+    namespace SimplePlannerTest
+    {
+        static const Term::StreamId c_streamId = 0;
+        static const DocId c_maxDocId = 1664;
+        static const size_t c_allocatorSize = 4096;
+
+
+        // Returns the sorted DocIds in [1, c_maxDocId] divisible by all of
+        // the factors.
+        static std::vector<DocId> Expected(std::vector<DocId> const & factors)
+        {
+            std::vector<DocId> expected;
+            for (DocId id = 1; id <= c_maxDocId; ++id)
+            {
+                bool matches = true;
+                for (auto factor : factors)
+                {
+                    matches &= (id % factor) == 0;
+                }
+                if (matches)
+                {
+                    expected.push_back(id);
+                }
+            }
+            return expected;
+        }
+
+
+        static std::vector<DocId> RunQuery(ISimpleIndex const & index,
+                                           char const * query,
+                                           size_t threadCount,
+                                           IThreadPool * threadPool = nullptr)
+        {
+            std::stringstream input(query);
+            Allocator allocator(c_allocatorSize);
+            TextObjectParser parser(input, allocator, &TermMatchNode::GetType);
+            TermMatchNode const & tree = TermMatchNode::Parse(parser);
+
+            auto observed = Factories::RunSimplePlanner(tree,
+                                                         index,
+                                                         threadCount,
+                                                         threadPool);
+            std::sort(observed.begin(), observed.end());
+
+            // DocId 0 has no prime factors, but has an all-ones row for the
+            // purposes of other tests. Ignore it.
+            observed.erase(std::remove(observed.begin(), observed.end(), 0u),
+                           observed.end());
+            return observed;
+        }
+
+
+        static char const * c_query =
+            "And {\n"
+            "  Children: [\n"
+            "    Unigram(\"2\", 0),\n"
+            "    Unigram(\"3\", 0)\n"
+            "  ]\n"
+            "}";
+
+
+        TEST(SimplePlanner, MultipleShards)
+        {
+            static const ShardId c_shardCount = 3;
+
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            c_shardCount);
+
+            // Every shard must hold documents for this test to be useful.
+            auto & ingestor = index->GetIngestor();
+            ASSERT_EQ(ingestor.GetShardCount(), c_shardCount);
+            for (ShardId shard = 0; shard < c_shardCount; ++shard)
+            {
+                EXPECT_GT(ingestor.GetShard(shard).GetSliceBuffers().size(), 0u);
+            }
+
+            auto expected = Expected({ 2, 3 });
+
+            for (size_t threadCount = 1; threadCount <= c_shardCount + 1; ++threadCount)
+            {
+                EXPECT_EQ(RunQuery(*index, c_query, threadCount), expected)
+                    << "threadCount = " << threadCount;
+            }
+        }
+
+
+        // A batch runs each query's plan for a shard on that shard's slices,
+        // so it must find the same matches, in the same order, as running
+        // each query alone on one thread. The queries have rows of
+        // different ranks, so they run on different backends and divide
+        // slices into different numbers of iterations.
+        TEST(SimplePlanner, Batch)
+        {
+            // Large enough for slices with more iterations than a batch has
+            // blocks.
+            static const DocId c_batchMaxDocId = 10000;
+
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_batchMaxDocId,
+                                                            c_streamId,
+                                                            3);
+            auto config = Factories::CreateStreamConfiguration();
+            Allocator allocator(c_allocatorSize);
+
+            std::vector<char const *> queries =
+                { "2 3", "5", "7 11", "2 3 5 7", "13" };
+            std::vector<TermMatchNode const *> trees;
+            for (auto query : queries)
+            {
+                std::stringstream input(query);
+                QueryParser parser(input, *config, allocator);
+                trees.push_back(parser.Parse());
+            }
+
+            // The second batch takes every plan from the cache.
+            auto planCache = Factories::CreatePlanCache(queries.size());
+            for (size_t run = 0; run < 2; ++run)
+            {
+                auto observed = Factories::RunSimplePlannerBatch(trees,
+                                                                 *index,
+                                                                 planCache.get());
+                ASSERT_EQ(observed.size(), trees.size());
+                for (size_t i = 0; i < trees.size(); ++i)
+                {
+                    EXPECT_EQ(observed[i],
+                              Factories::RunSimplePlanner(*trees[i], *index))
+                        << "query = " << queries[i];
+                }
+            }
+            EXPECT_EQ(planCache->GetMissCount(), queries.size());
+            EXPECT_EQ(planCache->GetHitCount(), queries.size());
+        }
+
+
+        // Reuses one IThreadPool across queries. The degree of parallelism
+        // is limited by both threadCount and the size of the pool.
+        TEST(SimplePlanner, SharedThreadPool)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            2);
+            auto threadPool = Factories::CreateThreadPool(3);
+            auto expected = Expected({ 2, 3 });
+
+            for (size_t run = 0; run < 20; ++run)
+            {
+                const size_t threadCount = 1 + run % 6;
+                EXPECT_EQ(RunQuery(*index, c_query, threadCount, threadPool.get()),
+                          expected)
+                    << "threadCount = " << threadCount;
+            }
+        }
+
+
+        // Parses c_query and runs it with limits.
+        static std::vector<DocId> RunLimitedQuery(ISimpleIndex const & index,
+                                                  QueryLimits const & limits,
+                                                  size_t threadCount,
+                                                  bool & terminatedEarly)
+        {
+            std::stringstream input(c_query);
+            Allocator allocator(c_allocatorSize);
+            TextObjectParser parser(input, allocator, &TermMatchNode::GetType);
+            TermMatchNode const & tree = TermMatchNode::Parse(parser);
+
+            auto observed = Factories::RunSimplePlanner(tree,
+                                                        index,
+                                                        limits,
+                                                        terminatedEarly,
+                                                        threadCount);
+            std::sort(observed.begin(), observed.end());
+            observed.erase(std::remove(observed.begin(), observed.end(), 0u),
+                           observed.end());
+            return observed;
+        }
+
+
+        TEST(SimplePlanner, MatchLimit)
+        {
+            static const size_t c_maxMatches = 20;
+
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            3);
+            auto expected = Expected({ 2, 3 });
+            ASSERT_GT(expected.size(), c_maxMatches);
+
+            for (size_t threadCount = 1; threadCount <= 3; ++threadCount)
+            {
+                bool terminatedEarly = false;
+                auto observed = RunLimitedQuery(*index,
+                                                QueryLimits(c_maxMatches),
+                                                threadCount,
+                                                terminatedEarly);
+                EXPECT_TRUE(terminatedEarly);
+
+                // DocId 0 may be one of the matches.
+                EXPECT_GE(observed.size(), c_maxMatches - 1);
+                EXPECT_LE(observed.size(), c_maxMatches);
+                EXPECT_TRUE(std::includes(expected.begin(), expected.end(),
+                                          observed.begin(), observed.end()));
+                EXPECT_TRUE(std::adjacent_find(observed.begin(), observed.end())
+                            == observed.end());
+
+                // A limit above the number of matches does not truncate.
+                observed = RunLimitedQuery(*index,
+                                           QueryLimits(expected.size() + 10),
+                                           threadCount,
+                                           terminatedEarly);
+                EXPECT_FALSE(terminatedEarly);
+                EXPECT_EQ(observed, expected);
+            }
+        }
+
+
+        TEST(SimplePlanner, TimeLimit)
+        {
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_maxDocId,
+                                                            c_streamId,
+                                                            3);
+            auto expected = Expected({ 2, 3 });
+
+            for (size_t threadCount = 1; threadCount <= 3; ++threadCount)
+            {
+                // The time limit expires before the first slice.
+                bool terminatedEarly = false;
+                auto observed = RunLimitedQuery(
+                    *index,
+                    QueryLimits(QueryLimits::c_unlimitedMatches, 1e-12),
+                    threadCount,
+                    terminatedEarly);
+                EXPECT_TRUE(terminatedEarly);
+                EXPECT_TRUE(observed.empty());
+
+                observed = RunLimitedQuery(
+                    *index,
+                    QueryLimits(QueryLimits::c_unlimitedMatches, 1000.0),
+                    threadCount,
+                    terminatedEarly);
+                EXPECT_FALSE(terminatedEarly);
+                EXPECT_EQ(observed, expected);
+            }
+        }
+
+
+        // Reports p50 and p99 query latency as a function of the number of
+        // threads scanning slices. This test is disabled by default. Run it
+        // with
+        //   PlanTest --gtest_also_run_disabled_tests
+        //            --gtest_filter=*ParallelLatencyBenchmark*
+        TEST(SimplePlanner, DISABLED_ParallelLatencyBenchmark)
+        {
+            static const DocId c_benchmarkMaxDocId = 10000;
+            static const ShardId c_shardCount = 2;
+            static const size_t c_runCount = 200;
+
+            auto fileSystem = Factories::CreateRAMFileSystem();
+            auto index = Factories::CreatePrimeFactorsIndex(*fileSystem,
+                                                            c_benchmarkMaxDocId,
+                                                            c_streamId,
+                                                            c_shardCount);
+
+            std::stringstream input(c_query);
+            Allocator allocator(c_allocatorSize);
+            TextObjectParser parser(input, allocator, &TermMatchNode::GetType);
+            TermMatchNode const & tree = TermMatchNode::Parse(parser);
+
+            size_t expectedCount = 0;
+            for (size_t threadCount = 1; threadCount <= 8; threadCount *= 2)
+            {
+                auto threadPool = Factories::CreateThreadPool(threadCount - 1);
+
+                std::vector<double> latencies;
+                for (size_t run = 0; run < c_runCount; ++run)
+                {
+                    Stopwatch stopwatch;
+                    auto matches = Factories::RunSimplePlanner(tree,
+                                                               *index,
+                                                               threadCount,
+                                                               threadPool.get());
+                    latencies.push_back(stopwatch.ElapsedTime());
+
+                    if (expectedCount == 0)
+                    {
+                        expectedCount = matches.size();
+                    }
+                    EXPECT_EQ(matches.size(), expectedCount);
+                }
+
+                std::sort(latencies.begin(), latencies.end());
+                std::cout << "threads = " << threadCount
+                          << ", p50 = "
+                          << latencies[latencies.size() / 2] * 1e6 << "us"
+                          << ", p99 = "
+                          << latencies[latencies.size() * 99 / 100] * 1e6 << "us"
+                          << std::endl;
+            }
+        }
+    }
+}
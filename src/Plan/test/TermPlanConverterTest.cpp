@@ -363,11 +363,13 @@ namespace BitFunnel
         }
 
 
-        TEST(TermPlanConverter,Phrase)
+        // Creates an index whose TermTable has rows for "foo", "bar", "baz",
+        // and the phrases "foo bar", "bar baz", and "foo bar baz".
+        static std::unique_ptr<ISimpleIndex> CreatePhraseIndex(IFileSystem & fileSystem,
+                                                               size_t gramSize)
         {
             // MockIndexConfiguration index(s_defaultShardCapacities);
-            auto filesystem = Factories::CreateFileSystem();
-            auto index = Factories::CreateSimpleIndex(*filesystem);
+            auto index = Factories::CreateSimpleIndex(fileSystem);
 
             auto termTable = Factories::CreateTermTable();
             const size_t adhocRowCount = 4;
@@ -433,40 +435,65 @@ namespace BitFunnel
             termTableCollection->AddTermTable(std::move(termTable));
 
             index->SetTermTableCollection(std::move(termTableCollection));
-            index->ConfigureAsMock(3, false);
+            index->ConfigureAsMock(gramSize, false);
             index->StartIndex();
 
-            // 13 is the stream.  TODO: figure out what stream it should be when
-            // we have real StreamId support.
-            char const * input =
-                "Phrase {\n"
-                "  StreamId: 13,\n"
-                "  Grams: [\n"
-                "    \"foo\",\n"
-                "    \"bar\",\n"
-                "    \"baz\"\n"
-                "  ]\n"
+            return index;
+        }
+
+
+        static char const * c_phraseInput =
+            "Phrase {\n"
+            "  StreamId: 13,\n"
+            "  Grams: [\n"
+            "    \"foo\",\n"
+            "    \"bar\",\n"
+            "    \"baz\"\n"
+            "  ]\n"
+            "}";
+
+
+        // A phrase no longer than the maximum gram size uses the rows of
+        // the whole phrase.
+        TEST(TermPlanConverter,Phrase)
+        {
+            auto fileSystem = Factories::CreateFileSystem();
+            auto index = CreatePhraseIndex(*fileSystem, 3);
+
+            char const * expectedFullQueryPlan =
+                "RowPlan {\n"
+                "  Match: And {\n"
+                "    Children: [\n"
+                // foo bar baz
+                "      Row(1, 0, 0, false),\n"
+
+                // Soft-deleted row.
+                "      Row(0, 0, 0, false)\n"
+                "    ]\n"
+                "  }\n"
                 "}";
 
+            // Generate full query plan.
+            VerifyTermPlanConverterCase(c_phraseInput,
+                                        expectedFullQueryPlan,
+                                        *index);
+        }
+
+
+        // A phrase longer than the maximum gram size uses the rows of its
+        // overlapping n-grams.
+        TEST(TermPlanConverter,PhraseLongerThanMaxGram)
+        {
+            auto fileSystem = Factories::CreateFileSystem();
+            auto index = CreatePhraseIndex(*fileSystem, 2);
+
             char const * expectedFullQueryPlan =
                 "RowPlan {\n"
                 "  Match: And {\n"
                 "    Children: [\n"
-                // One row per sub-phrase.
-                "      Row(12, 0, 0, false),\n"
-                "      Row(11, 0, 0, false),\n"
-                "      Row(10, 0, 0, false),\n"
-                // baz
-                "      Row(9, 0, 0, false),\n"
-                "      Row(8, 0, 0, false),\n"
-                "      Row(7, 0, 0, false),\n"
-                "      Row(6, 0, 0, false),\n"
-                // bar
-                "      Row(5, 0, 0, false),\n"
-                "      Row(4, 0, 0, false),\n"
-                "      Row(3, 0, 0, false),\n"
-                // foo
+                // bar baz
                 "      Row(2, 0, 0, false),\n"
+                // foo bar
                 "      Row(1, 0, 0, false),\n"
 
                 // Soft-deleted row.
@@ -476,7 +503,7 @@ namespace BitFunnel
                 "}";
 
             // Generate full query plan.
-            VerifyTermPlanConverterCase(input,
+            VerifyTermPlanConverterCase(c_phraseInput,
                                         expectedFullQueryPlan,
                                         *index);
         }
@@ -0,0 +1,257 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <bitset>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "Allocator.h"
+#include "BitFunnel/Plan/IResultsProcessor.h"
+#include "BitFunnel/Utilities/Stopwatch.h"
+#include "ByteCodeInterpreter.h"
+#include "CompileNode.h"
+#include "TextObjectParser.h"
+#include "ThreadedCodeInterpreter.h"
+
+
+namespace BitFunnel
+{
+    namespace ThreadedCodeInterpreterTest
+    {
+        //*********************************************************************
+        //
+        // CountingResultsProcessor counts the matches reported by a matcher
+        // without recording them, so that timings reflect the cost of
+        // dispatch and row access rather than result handling.
+        //
+        //*********************************************************************
+        class CountingResultsProcessor : public IResultsProcessor
+        {
+        public:
+            CountingResultsProcessor()
+              : m_matchCount(0)
+            {
+            }
+
+            void AddResult(uint64_t accumulator, size_t /*offset*/) override
+            {
+                m_matchCount += std::bitset<64>(accumulator).count();
+            }
+
+            bool FinishIteration(void const * /*sliceBuffer*/) override
+            {
+                return false;
+            }
+
+            bool TerminatedEarly() const override
+            {
+                return false;
+            }
+
+            size_t GetMatchCount() const
+            {
+                return m_matchCount;
+            }
+
+        private:
+            size_t m_matchCount;
+        };
+
+
+        template <typename MATCHER>
+        static double TimeRuns(MATCHER & matcher, size_t runCount)
+        {
+            Stopwatch stopwatch;
+            for (size_t i = 0; i < runCount; ++i)
+            {
+                matcher.Run();
+            }
+            return stopwatch.ElapsedTime();
+        }
+
+
+        // Times each matcher on a synthetic index, for a plan whose
+        // iterations run at the given rank.
+        static void RunMatchers(char const * text, Rank rank)
+        {
+            static const size_t c_rowCount = 6;
+            static const size_t c_quadwordsPerRow = 1024;
+            static const size_t c_sliceCount = 64;
+            static const size_t c_runCount = 50;
+            static const size_t c_allocatorSize = 16384;
+            const size_t iterationsPerSlice = c_quadwordsPerRow >> rank;
+
+            // Rows are filled with random bits so that roughly half of the
+            // quadwords survive each AndRowJz.
+            std::mt19937_64 random(12345);
+            std::vector<uint64_t> data(c_sliceCount * c_rowCount * c_quadwordsPerRow);
+            for (auto & quadword : data)
+            {
+                quadword = random() | random();
+            }
+
+            std::vector<char *> sliceBuffers;
+            for (size_t slice = 0; slice < c_sliceCount; ++slice)
+            {
+                sliceBuffers.push_back(reinterpret_cast<char *>(
+                    data.data() + slice * c_rowCount * c_quadwordsPerRow));
+            }
+
+            std::vector<ptrdiff_t> rowOffsets;
+            for (size_t row = 0; row < c_rowCount; ++row)
+            {
+                rowOffsets.push_back(static_cast<ptrdiff_t>(
+                    row * c_quadwordsPerRow * sizeof(uint64_t)));
+            }
+
+            std::stringstream input(text);
+            Allocator allocator(c_allocatorSize);
+            TextObjectParser parser(input, allocator, &CompileNode::GetType);
+            CompileNode const & node = CompileNode::Parse(parser);
+
+            ByteCodeGenerator code;
+            node.Compile(code);
+            code.Seal();
+
+            const double iterations =
+                static_cast<double>(c_runCount * c_sliceCount * iterationsPerSlice);
+
+            CountingResultsProcessor interpreterResults;
+            ByteCodeInterpreter interpreter(code,
+                                            interpreterResults,
+                                            c_sliceCount,
+                                            sliceBuffers.data(),
+                                            iterationsPerSlice,
+                                            rowOffsets.data(),
+                                            false);
+            const double interpreterTime = TimeRuns(interpreter, c_runCount);
+
+            CountingResultsProcessor threadedResults;
+            ThreadedCodeInterpreter threaded(code,
+                                             threadedResults,
+                                             c_sliceCount,
+                                             sliceBuffers.data(),
+                                             iterationsPerSlice,
+                                             rowOffsets.data());
+            const double threadedTime = TimeRuns(threaded, c_runCount);
+
+            EXPECT_EQ(threadedResults.GetMatchCount(),
+                      interpreterResults.GetMatchCount());
+
+            std::cout << "ByteCodeInterpreter:     "
+                      << interpreterTime * 1e9 / iterations
+                      << "ns/iteration" << std::endl;
+            std::cout << "ThreadedCodeInterpreter: "
+                      << threadedTime * 1e9 / iterations
+                      << "ns/iteration" << std::endl;
+
+            CountingResultsProcessor wideResults;
+            ByteCodeInterpreter wide(code,
+                                     wideResults,
+                                     c_sliceCount,
+                                     sliceBuffers.data(),
+                                     iterationsPerSlice,
+                                     rowOffsets.data());
+            const double wideTime = TimeRuns(wide, c_runCount);
+
+            EXPECT_EQ(wideResults.GetMatchCount(),
+                      interpreterResults.GetMatchCount());
+
+            std::cout << "Wide words:              "
+                      << wideTime * 1e9 / iterations
+                      << "ns/iteration" << std::endl;
+        }
+
+
+        // Compares the scalar ByteCodeInterpreter, ThreadedCodeInterpreter,
+        // and, where available, ByteCodeInterpreter with wide words on a
+        // synthetic index. The ThreadedCodeInterpreter replaces the scalar
+        // switch dispatch, so the first two lines are the like-for-like
+        // comparison. Wide words cannot run the second plan, which has a
+        // RankDown. This test is disabled by default. Run it with
+        //   PlanTest --gtest_also_run_disabled_tests
+        //            --gtest_filter=*ThreadedCodeBenchmark*
+        TEST(ThreadedCodeInterpreter, DISABLED_ThreadedCodeBenchmark)
+        {
+            char const * text =
+                "Or {"
+                "  Children: ["
+                "    LoadRowJz {"
+                "      Row: Row(0, 0, 0, false),"
+                "      Child: AndRowJz {"
+                "        Row: Row(1, 0, 0, false),"
+                "        Child: AndRowJz {"
+                "          Row: Row(2, 0, 0, true),"
+                "          Child: Report {"
+                "            Child: "
+                "          }"
+                "        }"
+                "      }"
+                "    },"
+                "    LoadRowJz {"
+                "      Row: Row(3, 0, 0, false),"
+                "      Child: AndRowJz {"
+                "        Row: Row(4, 0, 0, false),"
+                "        Child: AndRowJz {"
+                "          Row: Row(5, 0, 0, false),"
+                "          Child: Report {"
+                "            Child: "
+                "          }"
+                "        }"
+                "      }"
+                "    }"
+                "  ]"
+                "}";
+
+
+            std::cout << "Rank 0 plan:" << std::endl;
+            RunMatchers(text, 0);
+
+            char const * rankDownText =
+                "LoadRowJz {"
+                "  Row: Row(0, 2, 0, false),"
+                "  Child: AndRowJz {"
+                "    Row: Row(1, 2, 0, false),"
+                "    Child: RankDown {"
+                "      Delta: 2,"
+                "      Child: AndRowJz {"
+                "        Row: Row(2, 0, 0, false),"
+                "        Child: AndRowJz {"
+                "          Row: Row(3, 0, 0, true),"
+                "          Child: Report {"
+                "            Child: "
+                "          }"
+                "        }"
+                "      }"
+                "    }"
+                "  }"
+                "}";
+
+            std::cout << "RankDown plan:" << std::endl;
+            RunMatchers(rankDownText, 2);
+        }
+    }
+}
@@ -0,0 +1,491 @@
+// The MIT License (MIT)
+
+// Copyright (c) 2016, Microsoft
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "Allocator.h"
+#include "BitFunnel/Plan/IResultsProcessor.h"
+#include "BitFunnel/Utilities/Stopwatch.h"
+#include "ByteCodeInterpreter.h"
+#include "CompileNode.h"
+#include "TextObjectParser.h"
+#include "ThreadedCodeInterpreter.h"
+#include "WideWordInterpreter.h"
+
+
+namespace BitFunnel
+{
+    namespace WideWordInterpreterTest
+    {
+        static const size_t c_rowCount = 6;
+        static const size_t c_sliceCount = 3;
+        static const size_t c_allocatorSize = 16384;
+
+        // Plans with rank 0 rows and no rank down operations.
+        static char const * c_plans[] =
+        {
+            // And with inverted row.
+            "LoadRowJz {"
+            "  Row: Row(0, 0, 0, false),"
+            "  Child: AndRowJz {"
+            "    Row: Row(1, 0, 0, false),"
+            "    Child: AndRowJz {"
+            "      Row: Row(2, 0, 0, true),"
+            "      Child: Report {"
+            "        Child: "
+            "      }"
+            "    }"
+            "  }"
+            "}",
+
+            // Or of two And chains.
+            "Or {"
+            "  Children: ["
+            "    LoadRowJz {"
+            "      Row: Row(0, 0, 0, false),"
+            "      Child: AndRowJz {"
+            "        Row: Row(3, 0, 0, false),"
+            "        Child: Report {"
+            "          Child: "
+            "        }"
+            "      }"
+            "    },"
+            "    LoadRowJz {"
+            "      Row: Row(4, 0, 0, true),"
+            "      Child: AndRowJz {"
+            "        Row: Row(5, 0, 0, false),"
+            "        Child: Report {"
+            "          Child: "
+            "        }"
+            "      }"
+            "    }"
+            "  ]"
+            "}",
+
+            // Report with a match tree child.
+            "LoadRowJz {"
+            "  Row: Row(0, 0, 0, false),"
+            "  Child: Report {"
+            "    Child: AndTree {"
+            "      Children: ["
+            "        Not {"
+            "          Child: LoadRow(1, 0, 0, false)"
+            "        },"
+            "        OrTree {"
+            "          Children: ["
+            "            LoadRow(2, 0, 0, false),"
+            "            LoadRow(3, 0, 0, true)"
+            "          ]"
+            "        }"
+            "      ]"
+            "    }"
+            "  }"
+            "}",
+
+            // Nested loads. The second row is not ANDed with the first, so
+            // a wide Jz would report lanes where the first row is zero.
+            // IsCompatible() must reject it.
+            "LoadRowJz {"
+            "  Row: Row(0, 0, 0, false),"
+            "  Child: LoadRowJz {"
+            "    Row: Row(1, 0, 0, false),"
+            "    Child: Report {"
+            "      Child: "
+            "    }"
+            "  }"
+            "}"
+        };
+
+        // Index in c_plans of the only plan that cannot be run wide.
+        static const size_t c_incompatiblePlan = 3;
+
+
+        //*********************************************************************
+        //
+        // RecordingResultsProcessor records the sequence of calls to
+        // AddResult() and FinishIteration(). Calls to FinishIteration() are
+        // recorded as entries with a zero accumulator.
+        //
+        //*********************************************************************
+        class RecordingResultsProcessor : public IResultsProcessor
+        {
+        public:
+            void AddResult(uint64_t accumulator, size_t offset) override
+            {
+                m_calls.push_back(std::make_pair(accumulator, offset));
+            }
+
+            bool FinishIteration(void const * sliceBuffer) override
+            {
+                m_calls.push_back(std::make_pair(
+                    0ull,
+                    reinterpret_cast<size_t>(sliceBuffer)));
+                return false;
+            }
+
+            bool TerminatedEarly() const override
+            {
+                return false;
+            }
+
+            std::vector<std::pair<uint64_t, size_t>> const & GetCalls() const
+            {
+                return m_calls;
+            }
+
+        private:
+            std::vector<std::pair<uint64_t, size_t>> m_calls;
+        };
+
+
+        //*********************************************************************
+        //
+        // CountingResultsProcessor counts calls to AddResult() so that
+        // benchmark timings are not dominated by result handling.
+        //
+        //*********************************************************************
+        class CountingResultsProcessor : public IResultsProcessor
+        {
+        public:
+            CountingResultsProcessor()
+              : m_resultCount(0)
+            {
+            }
+
+            void AddResult(uint64_t /*accumulator*/, size_t /*offset*/) override
+            {
+                ++m_resultCount;
+            }
+
+            bool FinishIteration(void const * /*sliceBuffer*/) override
+            {
+                return false;
+            }
+
+            bool TerminatedEarly() const override
+            {
+                return false;
+            }
+
+            size_t GetResultCount() const
+            {
+                return m_resultCount;
+            }
+
+        private:
+            size_t m_resultCount;
+        };
+
+
+        //*********************************************************************
+        //
+        // SyntheticSlices holds slices of random rows. Rows are sparse enough
+        // that many quadwords, and some groups of quadwords, are zero.
+        //
+        //*********************************************************************
+        class SyntheticSlices
+        {
+        public:
+            SyntheticSlices(size_t sliceCount, size_t quadwordsPerRow)
+              : m_data(sliceCount * c_rowCount * quadwordsPerRow)
+            {
+                std::mt19937_64 random(12345);
+                for (auto & quadword : m_data)
+                {
+                    quadword = random() & random() & random();
+                    if ((random() & 3) == 0)
+                    {
+                        quadword = 0;
+                    }
+                }
+
+                for (size_t slice = 0; slice < sliceCount; ++slice)
+                {
+                    m_sliceBuffers.push_back(reinterpret_cast<char *>(
+                        m_data.data() + slice * c_rowCount * quadwordsPerRow));
+                }
+
+                for (size_t row = 0; row < c_rowCount; ++row)
+                {
+                    m_rowOffsets.push_back(static_cast<ptrdiff_t>(
+                        row * quadwordsPerRow * sizeof(uint64_t)));
+                }
+            }
+
+            char * const * GetSliceBuffers() const
+            {
+                return m_sliceBuffers.data();
+            }
+
+            ptrdiff_t const * GetRowOffsets() const
+            {
+                return m_rowOffsets.data();
+            }
+
+        private:
+            std::vector<uint64_t> m_data;
+            std::vector<char *> m_sliceBuffers;
+            std::vector<ptrdiff_t> m_rowOffsets;
+        };
+
+
+        static void Compile(char const * text,
+                            IAllocator & allocator,
+                            ByteCodeGenerator & code)
+        {
+            std::stringstream input(text);
+            TextObjectParser parser(input, allocator, &CompileNode::GetType);
+            CompileNode const & node = CompileNode::Parse(parser);
+            node.Compile(code);
+            code.Seal();
+        }
+
+
+        TEST(WideWordInterpreter, IsCompatible)
+        {
+            for (size_t plan = 0; plan < sizeof(c_plans) / sizeof(c_plans[0]); ++plan)
+            {
+                Allocator allocator(c_allocatorSize);
+                ByteCodeGenerator code;
+                Compile(c_plans[plan], allocator, code);
+                EXPECT_EQ(plan != c_incompatiblePlan,
+                          WideWordInterpreter::IsCompatible(code))
+                    << c_plans[plan];
+            }
+
+            Allocator allocator(c_allocatorSize);
+            ByteCodeGenerator code;
+            Compile("RankDown {"
+                    "  Delta: 1,"
+                    "  Child: LoadRowJz {"
+                    "    Row: Row(0, 0, 0, false),"
+                    "    Child: Report {"
+                    "      Child: "
+                    "    }"
+                    "  }"
+                    "}",
+                    allocator,
+                    code);
+            EXPECT_FALSE(WideWordInterpreter::IsCompatible(code));
+        }
+
+
+        // ShardPlan relies on UsesWideWords() to choose between wide words
+        // and native code.
+        TEST(WideWordInterpreter, UsesWideWords)
+        {
+            const bool supported =
+                WideWordInterpreter::GetSupportedLaneCount() >= 4;
+
+            Allocator allocator(c_allocatorSize);
+            ByteCodeGenerator code;
+            Compile(c_plans[0], allocator, code);
+            EXPECT_EQ(supported, ByteCodeInterpreter::UsesWideWords(code, 64));
+
+            // Too few iterations to fill a wide word.
+            EXPECT_FALSE(ByteCodeInterpreter::UsesWideWords(code, 2));
+
+            Allocator rankDownAllocator(c_allocatorSize);
+            ByteCodeGenerator rankDownCode;
+            Compile("RankDown {"
+                    "  Delta: 1,"
+                    "  Child: LoadRowJz {"
+                    "    Row: Row(0, 0, 0, false),"
+                    "    Child: Report {"
+                    "      Child: "
+                    "    }"
+                    "  }"
+                    "}",
+                    rankDownAllocator,
+                    rankDownCode);
+            EXPECT_FALSE(ByteCodeInterpreter::UsesWideWords(rankDownCode, 64));
+        }
+
+
+        // Each supported lane count must make exactly the same calls to the
+        // IResultsProcessor as the scalar ThreadedCodeInterpreter.
+        TEST(WideWordInterpreter, MatchesScalar)
+        {
+            static const size_t c_quadwordsPerRow = 64;
+            SyntheticSlices slices(c_sliceCount, c_quadwordsPerRow);
+
+            for (auto text : c_plans)
+            {
+                Allocator allocator(c_allocatorSize);
+                ByteCodeGenerator code;
+                Compile(text, allocator, code);
+
+                RecordingResultsProcessor expected;
+                ThreadedCodeInterpreter threaded(code,
+                                                 expected,
+                                                 c_sliceCount,
+                                                 slices.GetSliceBuffers(),
+                                                 c_quadwordsPerRow,
+                                                 slices.GetRowOffsets());
+                threaded.Run();
+                ASSERT_GT(expected.GetCalls().size(), 0u);
+
+                // ByteCodeInterpreterRemainder covers the incompatible plan.
+                if (!WideWordInterpreter::IsCompatible(code))
+                {
+                    continue;
+                }
+
+                for (size_t laneCount = 4;
+                     laneCount <= WideWordInterpreter::GetSupportedLaneCount();
+                     laneCount *= 2)
+                {
+                    RecordingResultsProcessor observed;
+                    WideWordInterpreter wide(code,
+                                             observed,
+                                             slices.GetRowOffsets(),
+                                             laneCount);
+                    for (size_t slice = 0; slice < c_sliceCount; ++slice)
+                    {
+                        size_t iterations = 0;
+                        wide.ProcessOneSlice(slices.GetSliceBuffers()[slice],
+                                             c_quadwordsPerRow,
+                                             iterations);
+                        EXPECT_EQ(iterations, c_quadwordsPerRow);
+                    }
+
+                    EXPECT_EQ(observed.GetCalls(), expected.GetCalls())
+                        << "laneCount = " << laneCount;
+                }
+            }
+        }
+
+
+        // ByteCodeInterpreter runs the iterations that do not fill a wide
+        // word with scalar code.
+        TEST(WideWordInterpreter, ByteCodeInterpreterRemainder)
+        {
+            static const size_t c_quadwordsPerRow = 64;
+            static const size_t c_iterationsPerSlice = 61;
+            SyntheticSlices slices(c_sliceCount, c_quadwordsPerRow);
+
+            for (auto text : c_plans)
+            {
+                Allocator allocator(c_allocatorSize);
+                ByteCodeGenerator code;
+                Compile(text, allocator, code);
+
+                RecordingResultsProcessor expected;
+                ThreadedCodeInterpreter threaded(code,
+                                                 expected,
+                                                 c_sliceCount,
+                                                 slices.GetSliceBuffers(),
+                                                 c_iterationsPerSlice,
+                                                 slices.GetRowOffsets());
+                threaded.Run();
+
+                RecordingResultsProcessor observed;
+                ByteCodeInterpreter interpreter(code,
+                                                observed,
+                                                c_sliceCount,
+                                                slices.GetSliceBuffers(),
+                                                c_iterationsPerSlice,
+                                                slices.GetRowOffsets());
+                interpreter.Run();
+
+                EXPECT_EQ(observed.GetCalls(), expected.GetCalls());
+            }
+        }
+
+
+        // Compares scalar and wide word throughput on rank 0 plans. This
+        // test is disabled by default. Run it with
+        //   PlanTest --gtest_also_run_disabled_tests
+        //            --gtest_filter=*WideWordBenchmark*
+        TEST(WideWordInterpreter, DISABLED_WideWordBenchmark)
+        {
+            static const size_t c_quadwordsPerRow = 1024;
+            static const size_t c_benchmarkSliceCount = 64;
+            static const size_t c_runCount = 50;
+            SyntheticSlices slices(c_benchmarkSliceCount, c_quadwordsPerRow);
+
+            const double iterations =
+                static_cast<double>(c_runCount * c_benchmarkSliceCount * c_quadwordsPerRow);
+
+            for (size_t plan = 0; plan < sizeof(c_plans) / sizeof(c_plans[0]); ++plan)
+            {
+                Allocator allocator(c_allocatorSize);
+                ByteCodeGenerator code;
+                Compile(c_plans[plan], allocator, code);
+                if (!WideWordInterpreter::IsCompatible(code))
+                {
+                    continue;
+                }
+
+                CountingResultsProcessor scalarResults;
+                ThreadedCodeInterpreter threaded(code,
+                                                 scalarResults,
+                                                 c_benchmarkSliceCount,
+                                                 slices.GetSliceBuffers(),
+                                                 c_quadwordsPerRow,
+                                                 slices.GetRowOffsets());
+                Stopwatch scalarStopwatch;
+                for (size_t run = 0; run < c_runCount; ++run)
+                {
+                    threaded.Run();
+                }
+                std::cout << "Plan " << plan << " scalar:  "
+                          << scalarStopwatch.ElapsedTime() * 1e9 / iterations
+                          << "ns/quadword" << std::endl;
+
+                for (size_t laneCount = 4;
+                     laneCount <= WideWordInterpreter::GetSupportedLaneCount();
+                     laneCount *= 2)
+                {
+                    CountingResultsProcessor wideResults;
+                    WideWordInterpreter wide(code,
+                                             wideResults,
+                                             slices.GetRowOffsets(),
+                                             laneCount);
+                    Stopwatch wideStopwatch;
+                    for (size_t run = 0; run < c_runCount; ++run)
+                    {
+                        for (size_t slice = 0; slice < c_benchmarkSliceCount; ++slice)
+                        {
+                            size_t processed = 0;
+                            wide.ProcessOneSlice(slices.GetSliceBuffers()[slice],
+                                                 c_quadwordsPerRow,
+                                                 processed);
+                        }
+                    }
+                    std::cout << "Plan " << plan << " " << laneCount << " lanes: "
+                              << wideStopwatch.ElapsedTime() * 1e9 / iterations
+                              << "ns/quadword" << std::endl;
+
+                    EXPECT_EQ(wideResults.GetResultCount(),
+                              scalarResults.GetResultCount());
+                }
+            }
+        }
+    }
+}
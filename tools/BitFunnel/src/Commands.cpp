@@ -23,9 +23,11 @@
 #include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <stdexcept>    // std::logic_error.
 #include <thread>       // sleep_for, this_thread
 
 #include "BitFunnel/Configuration/Factories.h"
+#include "BitFunnel/Configuration/IFileSystem.h"
 #include "BitFunnel/Configuration/IStreamConfiguration.h"
 #include "BitFunnel/Data/Sonnets.h"
 #include "BitFunnel/Exceptions.h"
@@ -38,8 +40,9 @@
 #include "BitFunnel/Index/ITermTable.h"
 #include "BitFunnel/Plan/Factories.h"
 #include "BitFunnel/Plan/IMatchVerifier.h"
+#include "BitFunnel/Plan/IPlanCache.h"
 #include "BitFunnel/Plan/QueryPipeline.h"
-#include "BitFunnel/Plan/TermMatchTreeEvaluator.h"
+#include "BitFunnel/Plan/QueryRunner.h"
 #include "BitFunnel/Index/RowIdSequence.h"
 #include "BitFunnel/Term.h"
 #include "Commands.h"
@@ -324,7 +327,9 @@ namespace BitFunnel
     Query::Query(Environment & environment,
                  Id id,
                  char const * parameters)
-        : TaskBase(environment, id, Type::Synchronous)
+        : TaskBase(environment, id, Type::Synchronous),
+          m_iterations(1),
+          m_batchSize(1)
     {
         auto command = TaskFactory::GetNextToken(parameters);
         if (command.compare("one") == 0)
@@ -335,26 +340,68 @@ namespace BitFunnel
         else
         {
             m_isSingleQuery = false;
-            if (command.compare("log") != 0)
+            if (command.compare("batch") == 0)
             {
-                // TODO: Wire up query runner here.
-//                xyz;
-                RecoverableError error("Query expects \"one\" or \"log\".");
+                auto batchSize = TaskFactory::GetNextToken(parameters);
+                try
+                {
+                    m_batchSize = std::stoull(batchSize);
+                }
+                catch (std::logic_error const &)
+                {
+                    m_batchSize = 0;
+                }
+                if (m_batchSize == 0)
+                {
+                    RecoverableError error("Query batch expects a positive batch size.");
+                    throw error;
+                }
+            }
+            else if (command.compare("log") != 0)
+            {
+                RecoverableError error("Query expects \"one\", \"log\", or \"batch\".");
                 throw error;
             }
             m_query = TaskFactory::GetNextToken(parameters);
+
+            auto iterations = TaskFactory::GetNextToken(parameters);
+            if (!iterations.empty())
+            {
+                try
+                {
+                    m_iterations = std::stoull(iterations);
+                }
+                catch (std::logic_error const &)
+                {
+                    m_iterations = 0;
+                }
+                if (m_iterations == 0)
+                {
+                    RecoverableError error("Query log expects a positive iteration count.");
+                    throw error;
+                }
+            }
+
+            m_outputFile = TaskFactory::GetNextToken(parameters);
         }
     }
 
 
     void Query::Execute()
     {
+        auto & environment = GetEnvironment();
+
+        std::vector<std::string> queries;
+        size_t threadCount = 1;
+
         if (m_isSingleQuery)
         {
             std::cout
                 << "Processing query \""
                 << m_query
                 << "\"" << std::endl;
+
+            queries.push_back(m_query);
         }
         else
         {
@@ -362,8 +409,53 @@ namespace BitFunnel
                 << "Processing queries from log at \""
                 << m_query
                 << "\"" << std::endl;
+
+            auto input =
+                environment.GetFileSystem().OpenForRead(m_query.c_str(),
+                                                        std::ios::in);
+            std::string line;
+            while (std::getline(*input, line))
+            {
+                if (!line.empty())
+                {
+                    queries.push_back(line);
+                }
+            }
+
+            threadCount = environment.GetThreadCount();
+        }
+
+        if (queries.empty())
+        {
+            std::cout << "No queries." << std::endl;
+            return;
+        }
+
+        // Size the plan cache to hold every query in the log.
+        auto planCache = Factories::CreatePlanCache(queries.size());
+
+        auto statistics = QueryRunner::Run(environment.GetSimpleIndex(),
+                                           threadCount,
+                                           queries,
+                                           m_iterations,
+                                           planCache.get(),
+                                           m_batchSize);
+        statistics.Print(std::cout);
+        std::cout
+            << "Plan cache: "
+            << planCache->GetHitCount() << " hit(s), "
+            << planCache->GetMissCount() << " miss(es)" << std::endl;
+
+        if (!m_outputFile.empty())
+        {
+            auto output =
+                environment.GetFileSystem().OpenForWrite(m_outputFile.c_str());
+            statistics.WriteCsv(*output);
+            std::cout
+                << "Per-query results written to \""
+                << m_outputFile
+                << "\"" << std::endl;
         }
-        std::cout << "NOT IMPLEMENTED" << std::endl;
     }
 
 
@@ -371,11 +463,20 @@ namespace BitFunnel
     {
         return Documentation(
             "query",
-            "Process a single query or list of queries. (TODO)",
-            "query (one <expression>) | (log <file>)\n"
-            "  Processes a single query or a list of queries\n"
-            "  specified by a file.\n"
-            "  NOT IMPLEMENTED"
+            "Process a single query or list of queries.",
+            "query (one <expression>) |\n"
+            "      (log <file> [<iterations> [<csv file>]]) |\n"
+            "      (batch <size> <file> [<iterations> [<csv file>]])\n"
+            "  Processes a single query or a list of queries,\n"
+            "  one per line, specified by a file. Queries from\n"
+            "  a log are processed <iterations> times (default 1)\n"
+            "  on the number of threads given by --threads.\n"
+            "  With batch, each thread processes <size> queries\n"
+            "  at a time, scanning each shard once per batch,\n"
+            "  and each query's latency is that of its batch.\n"
+            "  Prints QPS, latency percentiles, and match counts.\n"
+            "  Optionally writes the latency and match count of\n"
+            "  each query to <csv file>.\n"
             );
     }
 
@@ -691,29 +792,25 @@ namespace BitFunnel
                 auto & environment = GetEnvironment();
                 auto & cache = environment.GetIngestor().GetDocumentCache();
                 auto & config = environment.GetConfiguration();
-                TermMatchTreeEvaluator evaluator(config);
 
-                size_t matchCount = 0;
                 size_t documentCount = 0;
-
-                for (auto entry : cache)
+                for (auto it = cache.begin(); it != cache.end(); ++it)
                 {
                     ++documentCount;
-                    bool matches = evaluator.Evaluate(*tree, entry.first);
-
-                    if (matches)
-                    {
-                        ++matchCount;
-                        //std::cout
-                        //    << "  DocId(" << entry.second << ") "
-                        //    << std::endl;
+                }
 
-                        verifier->AddExpected(entry.second);
-                    }
+                auto expected =
+                    Factories::MatchDocumentCache(*tree,
+                                                  config,
+                                                  cache,
+                                                  environment.GetThreadCount());
+                for (auto id : expected)
+                {
+                    verifier->AddExpected(id);
                 }
 
                 std::cout
-                    << matchCount << " match(es) out of "
+                    << expected.size() << " match(es) out of "
                     << documentCount << " documents."
                     << std::endl;
 
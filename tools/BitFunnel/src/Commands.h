@@ -123,6 +123,11 @@ namespace BitFunnel
     private:
         bool m_isSingleQuery;
         std::string m_query;
+        size_t m_iterations;
+        std::string m_outputFile;
+
+        // Number of queries from the log processed together by each thread.
+        size_t m_batchSize;
     };
 
 
@@ -40,7 +40,8 @@ namespace BitFunnel
           m_taskFactory(new TaskFactory(*this)),
           // Start one extra thread for the Recycler.
           m_taskPool(new TaskPool(threadCount + 1)),
-          m_index(Factories::CreateSimpleIndex(fileSystem))
+          m_index(Factories::CreateSimpleIndex(fileSystem)),
+          m_threadCount(threadCount)
     {
         m_index->ConfigureForServing(directory, gramSize, false);
         RegisterCommands();
@@ -108,4 +109,10 @@ namespace BitFunnel
     {
         return m_index->GetTermTable();
     }
+
+
+    size_t Environment::GetThreadCount() const
+    {
+        return m_threadCount;
+    }
 }
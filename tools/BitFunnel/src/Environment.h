@@ -55,6 +55,10 @@ namespace BitFunnel
         IIngestor & GetIngestor() const;
         ITermTable const & GetTermTable() const;
 
+        // Returns the number of threads available for ingestion and query
+        // processing, as specified by the --threads command line option.
+        size_t GetThreadCount() const;
+
     private:
         void RegisterCommands();
 
@@ -63,5 +67,6 @@ namespace BitFunnel
         std::unique_ptr<TaskFactory> m_taskFactory;
         std::unique_ptr<TaskPool> m_taskPool;
         std::unique_ptr<ISimpleIndex> m_index;
+        size_t m_threadCount;
     };
 }
@@ -122,12 +122,13 @@ namespace BitFunnel
             };
 
             // Create an input stream with commands to
-            // load a chunk, verify a query, and inspect
+            // load a chunk, verify and run a query, and inspect
             // some rows.
             std::stringstream input;
             input
                 << "cache chunk sonnet0" << std::endl
                 << "verify one blood" << std::endl
+                << "query one blood" << std::endl
                 << "show rows blood" << std::endl;
 
             tool.Main(input,